@@ -1,36 +1,49 @@
 # Completions for the programs
-lda_commands="transform train"
+lda_commands="transform train evaluate convert"
 lda_train=$(echo "--help" "--quiet" "--workers" "--topics" "--iterations"  \
     "--random_state" "--snapshot_every" "--continue" "--e_step_iterations" \
     "--e_step_tolerance" "--compute_likelihood" "--initialize_seeded"      \
-    "--initialize_random")
+    "--initialize_random" "--metrics_file" "--held_out" "--squarem"        \
+    "--deduplicate" "--tolerance" "--min_count" "--hash_buckets"           \
+    "--chunk_size")
 lda_transform=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
-    "--e_step_tolerance")
+    "--e_step_tolerance" "--chunk_size" "--top_topics" "--topic_threshold" \
+    "--hash_buckets")
+lda_evaluate=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
+    "--e_step_tolerance" "--observed" "--random_state" "--hash_buckets"   \
+    "--chunk_size")
+lda_convert=$(echo "--help" "--float")
 
-slda_commands="transform train"
+slda_commands="transform train evaluate"
 slda_train=$(echo "--help" "--quiet" "--workers" "--topics" "--iterations"  \
     "--random_state" "--snapshot_every" "--continue" "--e_step_iterations"  \
-    "--e_step_tolerance" "--compute_likelihood" "--fixed_point_iteration"   \
+    "--e_step_tolerance" "--compute_likelihood" "--fixed_point_iterations"  \
     "--m_step_iterations" "--m_step_tolerance" "--regularization_penalty"   \
-    "--initialize_seeded" "--initialize_random")
+    "--initialize_seeded" "--initialize_random" "--metrics_file" "--held_out" \
+    "--tolerance" "--continue_from_unsupervised")
 slda_transform=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
-    "--e_step_tolerance")
+    "--e_step_tolerance" "--chunk_size" "--top_topics" "--topic_threshold")
+slda_evaluate=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
+    "--e_step_tolerance" "--observed" "--random_state")
 
-fslda_commands="transform train online_train"
+fslda_commands="transform train online_train evaluate"
 fslda_train=$(echo "--help" "--quiet" "--workers" "--topics" "--iterations"   \
     "--random_state" "--snapshot_every" "--continue" "--e_step_iterations"    \
     "--e_step_tolerance" "--compute_likelihood"                               \
     "--m_step_iterations" "--m_step_tolerance" "--continue_from_unsupervised" \
     "--supervised_weight" "--regularization_penalty" "--initialize_seeded"    \
-    "--initialize_random")
+    "--initialize_random" "--metrics_file" "--held_out" "--tolerance")
 fslda_online_train=$(echo "--help" "--quiet" "--workers" "--topics"   \
     "--iterations" "--random_state" "--snapshot_every" "--continue"   \
     "--e_step_iterations" "--e_step_tolerance" "--compute_likelihood" \
     "--batch_size" "--momentum" "--learning_rate" "--beta_weight"     \
     "--continue_from_unsupervised" "--supervised_weight"              \
-    "--regularization_penalty" "--initialize_seeded" "--initialize_random")
+    "--regularization_penalty" "--initialize_seeded" "--initialize_random" \
+    "--metrics_file" "--held_out" "--tolerance")
 fslda_transform=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
-    "--e_step_tolerance")
+    "--e_step_tolerance" "--chunk_size" "--top_topics" "--topic_threshold")
+fslda_evaluate=$(echo "--help" "--quiet" "--workers" "--e_step_iterations"  \
+    "--e_step_tolerance" "--observed" "--random_state")
 
 _ldaplusplus()
 {
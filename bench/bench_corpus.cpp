@@ -0,0 +1,59 @@
+#include <memory>
+
+#include <benchmark/benchmark.h>
+
+#include <Eigen/Core>
+
+#include "bench/utils.hpp"
+
+#include "ldaplusplus/Document.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+/**
+ * The arguments are, in order, the size of the vocabulary V and the
+ * percentage of the vocabulary that appears in each document. Every
+ * iteration visits all the 1000 documents of the corpus.
+ */
+static void WordsDensity(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"V", "density"});
+    b->ArgsProduct({{1000, 10000}, {1, 10}});
+}
+
+
+static void BM_EigenCorpus_at(benchmark::State &state) {
+    BenchPRNG prng(0);
+    MatrixXi X = random_corpus(state.range(0), 1000, state.range(1) / 100.0, prng);
+    corpus::EigenCorpus corpus(X);
+
+    for (auto _ : state) {
+        for (size_t i=0; i<corpus.size(); i++) {
+            auto doc = corpus.at(i);
+            benchmark::DoNotOptimize(doc->get_words().data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_EigenCorpus_at)->Apply(WordsDensity);
+
+
+static void BM_EigenClassificationCorpus_at(benchmark::State &state) {
+    BenchPRNG prng(0);
+    MatrixXi X = random_corpus(state.range(0), 1000, state.range(1) / 100.0, prng);
+    VectorXi y = random_labels(X.cols(), 10, prng);
+    corpus::EigenClassificationCorpus corpus(X, y);
+
+    for (auto _ : state) {
+        for (size_t i=0; i<corpus.size(); i++) {
+            auto doc = std::static_pointer_cast<corpus::ClassificationDocument>(
+                corpus.at(i)
+            );
+            benchmark::DoNotOptimize(doc->get_words().data());
+            benchmark::DoNotOptimize(doc->get_class());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * corpus.size());
+}
+BENCHMARK(BM_EigenClassificationCorpus_at)->Apply(WordsDensity);
@@ -0,0 +1,322 @@
+#include <benchmark/benchmark.h>
+
+#include <Eigen/Core>
+
+#include "bench/utils.hpp"
+
+#include "ldaplusplus/e_step_utils.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+/**
+ * The inputs of the e_step_utils kernels for a single document.
+ *
+ * The benchmark arguments are, in order, the number of topics K, the size of
+ * the vocabulary V, the percentage of the vocabulary that appears in the
+ * document and the number of classes C (see the sweeps below). Unsupervised
+ * kernels only use the first arguments.
+ */
+template <typename Scalar>
+struct EStepData
+{
+    EStepData(int K, int V, double density = 1.0, int C = 2)
+        : prng(0),
+          K(K),
+          V(V),
+          density(density),
+          C(C),
+          y(C-1)
+    {
+        X = random_document(V, density, prng);
+        X_ratio = X.cast<Scalar>() / X.sum();
+        alpha = VectorX<Scalar>::Constant(K, 0.1);
+        beta = random_topics<Scalar>(K, V, prng);
+        // eta is kept positive so that it can be used by the multinomial
+        // and the correspondence kernels that take its log
+        eta = random_uniform<Scalar>(K, C, prng, 0.01, 1);
+        phi = random_phi<Scalar>(K, V, prng);
+        gamma = alpha.array() + static_cast<Scalar>(X.sum()) / K;
+        tau = VectorX<Scalar>::Constant(V, 1.0/V);
+        h = VectorX<Scalar>::Zero(K);
+    }
+
+    /**
+     * Report the number of topic-word pairs processed per second
+     */
+    void set_items_processed(benchmark::State &state) const {
+        state.SetItemsProcessed(state.iterations() * K * V);
+    }
+
+    BenchPRNG prng;
+    int K;
+    int V;
+    double density;
+    int C;
+    int y;
+
+    VectorXi X;
+    VectorX<Scalar> X_ratio;
+    VectorX<Scalar> alpha;
+    MatrixX<Scalar> beta;
+    MatrixX<Scalar> eta;
+    MatrixX<Scalar> phi;
+    VectorX<Scalar> gamma;
+    VectorX<Scalar> tau;
+    VectorX<Scalar> h;
+};
+
+
+// The sweeps over the size of the problem
+static void TopicsWords(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"K", "V"});
+    b->ArgsProduct({{20, 100, 500}, {1000, 10000}});
+}
+static void TopicsWordsDensity(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"K", "V", "density"});
+    b->ArgsProduct({{20, 100, 500}, {1000, 10000}, {1, 10}});
+}
+static void TopicsWordsDensityClasses(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"K", "V", "density", "C"});
+    b->ArgsProduct({{20, 100, 500}, {1000, 10000}, {1, 10}, {2, 20}});
+}
+
+
+template <typename Scalar>
+static void BM_compute_unsupervised_phi(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1));
+    for (auto _ : state) {
+        e_step_utils::compute_unsupervised_phi<Scalar>(d.beta, d.gamma, d.phi);
+        benchmark::DoNotOptimize(d.phi.data());
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_unsupervised_phi, TopicsWords);
+
+
+template <typename Scalar>
+static void BM_compute_gamma(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0);
+    for (auto _ : state) {
+        e_step_utils::compute_gamma<Scalar>(d.X, d.alpha, d.phi, d.gamma);
+        benchmark::DoNotOptimize(d.gamma.data());
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_gamma, TopicsWordsDensity);
+
+
+template <typename Scalar>
+static void BM_compute_unsupervised_gamma(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0);
+    VectorX<Scalar> scratch(d.K);
+    for (auto _ : state) {
+        e_step_utils::compute_unsupervised_gamma<Scalar>(d.X, d.alpha, d.beta, d.gamma, scratch);
+        benchmark::DoNotOptimize(d.gamma.data());
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_unsupervised_gamma, TopicsWordsDensity);
+
+
+template <typename Scalar>
+static void BM_compute_h(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0, state.range(3));
+    for (auto _ : state) {
+        e_step_utils::compute_h<Scalar>(d.X, d.X_ratio, d.eta, d.phi, d.h);
+        benchmark::DoNotOptimize(d.h.data());
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_h, TopicsWordsDensityClasses);
+
+
+template <typename Scalar>
+static void BM_compute_supervised_phi_gamma(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0, state.range(3));
+    for (auto _ : state) {
+        e_step_utils::compute_supervised_phi_gamma<Scalar>(
+            d.X,
+            d.X_ratio,
+            d.y,
+            d.beta,
+            d.eta,
+            1,
+            d.phi,
+            d.gamma,
+            d.h
+        );
+        benchmark::DoNotOptimize(d.phi.data());
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_supervised_phi_gamma, TopicsWordsDensityClasses);
+
+
+template <typename Scalar>
+static void BM_compute_supervised_approximate_phi(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0, state.range(3));
+    int num_words = d.X.sum();
+    for (auto _ : state) {
+        e_step_utils::compute_supervised_approximate_phi<Scalar>(
+            d.X_ratio,
+            num_words,
+            d.y,
+            d.beta,
+            d.eta,
+            d.gamma,
+            1.0,
+            d.phi
+        );
+        benchmark::DoNotOptimize(d.phi.data());
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_supervised_approximate_phi, TopicsWordsDensityClasses);
+
+
+template <typename Scalar>
+static void BM_compute_supervised_multinomial_phi(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0, state.range(3));
+    for (auto _ : state) {
+        e_step_utils::compute_supervised_multinomial_phi<Scalar>(
+            d.X,
+            d.y,
+            d.beta,
+            d.eta,
+            d.gamma,
+            1.0,
+            d.phi
+        );
+        benchmark::DoNotOptimize(d.phi.data());
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_supervised_multinomial_phi, TopicsWordsDensityClasses);
+
+
+template <typename Scalar>
+static void BM_compute_supervised_correspondence_phi(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0, state.range(3));
+    for (auto _ : state) {
+        e_step_utils::compute_supervised_correspondence_phi<Scalar>(
+            d.X,
+            d.y,
+            d.beta,
+            d.eta,
+            d.gamma,
+            d.tau,
+            d.phi
+        );
+        benchmark::DoNotOptimize(d.phi.data());
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_supervised_correspondence_phi, TopicsWordsDensityClasses);
+
+
+template <typename Scalar>
+static void BM_compute_supervised_correspondence_tau(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0, state.range(3));
+    for (auto _ : state) {
+        e_step_utils::compute_supervised_correspondence_tau<Scalar>(
+            d.X,
+            d.y,
+            d.eta,
+            d.phi,
+            d.tau
+        );
+        benchmark::DoNotOptimize(d.tau.data());
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_supervised_correspondence_tau, TopicsWordsDensityClasses);
+
+
+template <typename Scalar>
+static void BM_compute_unsupervised_likelihood(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            e_step_utils::compute_unsupervised_likelihood<Scalar>(
+                d.X,
+                d.alpha,
+                d.beta,
+                d.phi,
+                d.gamma
+            )
+        );
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_unsupervised_likelihood, TopicsWordsDensity);
+
+
+template <typename Scalar>
+static void BM_compute_supervised_likelihood(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0, state.range(3));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            e_step_utils::compute_supervised_likelihood<Scalar>(
+                d.X,
+                d.y,
+                d.alpha,
+                d.beta,
+                d.eta,
+                d.phi,
+                d.gamma
+            )
+        );
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_supervised_likelihood, TopicsWordsDensityClasses);
+
+
+template <typename Scalar>
+static void BM_compute_supervised_multinomial_likelihood(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0, state.range(3));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            e_step_utils::compute_supervised_multinomial_likelihood<Scalar>(
+                d.X,
+                d.y,
+                d.alpha,
+                d.beta,
+                d.eta,
+                d.phi,
+                d.gamma,
+                1.0 / d.C,
+                2.0,
+                1.0
+            )
+        );
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_supervised_multinomial_likelihood, TopicsWordsDensityClasses);
+
+
+template <typename Scalar>
+static void BM_compute_supervised_correspondence_likelihood(benchmark::State &state) {
+    EStepData<Scalar> d(state.range(0), state.range(1), state.range(2) / 100.0, state.range(3));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+            e_step_utils::compute_supervised_correspondence_likelihood<Scalar>(
+                d.X,
+                d.y,
+                d.alpha,
+                d.beta,
+                d.eta,
+                d.phi,
+                d.gamma,
+                d.tau,
+                2.0,
+                1.0
+            )
+        );
+    }
+    d.set_items_processed(state);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_compute_supervised_correspondence_likelihood, TopicsWordsDensityClasses);
@@ -0,0 +1,321 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <Eigen/Core>
+
+#include "bench/utils.hpp"
+
+#include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/LDABuilder.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::duration<double> >(d).count();
+}
+
+
+/**
+ * Wrap an E step and accumulate the time spent in doc_e_step() by all the
+ * workers.
+ *
+ * The events of the wrapped E step are not forwarded, which is fine since
+ * nobody listens to them in the benchmarks.
+ */
+template <typename Scalar>
+class TimedEStep : public em::EStepInterface<Scalar>
+{
+    public:
+        TimedEStep(std::shared_ptr<em::EStepInterface<Scalar> > e_step)
+            : e_step_(e_step), nanoseconds_(0)
+        {}
+
+        std::shared_ptr<parameters::Parameters> doc_e_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> parameters
+        ) override {
+            auto start = Clock::now();
+            auto vp = e_step_->doc_e_step(doc, parameters);
+            nanoseconds_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start
+            ).count();
+
+            return vp;
+        }
+
+        void e_step() override {
+            e_step_->e_step();
+        }
+
+        void set_workers(size_t workers) override {
+            e_step_->set_workers(workers);
+        }
+
+        /** The time spent in doc_e_step() summed over the workers */
+        double seconds() const {
+            return nanoseconds_ * 1e-9;
+        }
+
+    private:
+        std::shared_ptr<em::EStepInterface<Scalar> > e_step_;
+        std::atomic<int64_t> nanoseconds_;
+};
+
+
+/**
+ * Wrap an M step and accumulate the time spent in its online (doc_m_step())
+ * and batch (m_step()) parts.
+ */
+template <typename Scalar>
+class TimedMStep : public em::MStepInterface<Scalar>
+{
+    public:
+        TimedMStep(std::shared_ptr<em::MStepInterface<Scalar> > m_step)
+            : m_step_(m_step), online_(0), batch_(0)
+        {}
+
+        void m_step(std::shared_ptr<parameters::Parameters> parameters) override {
+            auto start = Clock::now();
+            m_step_->m_step(parameters);
+            batch_ += Clock::now() - start;
+        }
+
+        void doc_m_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> v_parameters,
+            std::shared_ptr<parameters::Parameters> m_parameters
+        ) override {
+            auto start = Clock::now();
+            m_step_->doc_m_step(doc, v_parameters, m_parameters);
+            online_ += Clock::now() - start;
+        }
+
+        double online_seconds() const { return seconds(online_); }
+        double batch_seconds() const { return seconds(batch_); }
+
+    private:
+        std::shared_ptr<em::MStepInterface<Scalar> > m_step_;
+        Clock::duration online_;
+        Clock::duration batch_;
+};
+
+
+// The corpus used for all the end to end benchmarks
+static const int V = 500;
+static const int N = 500;
+static const int K = 10;
+static const int C = 5;
+
+static const SyntheticCorpus & get_corpus() {
+    static BenchPRNG prng(0);
+    static SyntheticCorpus corpus = synthetic_corpus(V, N, K, 100, C, prng);
+    return corpus;
+}
+
+
+/**
+ * Create the E step and M step to be benchmarked using an LDABuilder and
+ * initialize its supervised parameters.
+ */
+template <typename Scalar>
+using Steps = std::pair<
+    std::shared_ptr<em::EStepInterface<Scalar> >,
+    std::shared_ptr<em::MStepInterface<Scalar> >
+>;
+template <typename Scalar>
+using Setup = std::function<Steps<Scalar>(LDABuilder<Scalar> &)>;
+
+
+/**
+ * Train for one epoch per iteration with state.range(0) workers and report
+ * the throughput, the time spent in each phase of the epoch and the scaling
+ * efficiency compared to the same benchmark with 1 worker.
+ *
+ * The phases are the E step (summed over the workers), the online and batch
+ * parts of the M step and the time the main thread spends waiting for the
+ * workers (the queue overhead and the E step time not hidden behind the
+ * online M step).
+ */
+template <typename Scalar>
+static void BM_fit(benchmark::State &state, std::string name, Setup<Scalar> setup) {
+    // docs per second with a single worker for each benchmark
+    static std::map<std::string, double> single_worker;
+
+    const SyntheticCorpus &data = get_corpus();
+    size_t workers = state.range(0);
+
+    LDABuilder<Scalar> builder;
+    builder.
+        set_workers(workers).
+        initialize_topics_seeded(data.X, K, 30, 0);
+    auto steps = setup(builder);
+
+    auto e_step = std::make_shared<TimedEStep<Scalar> >(steps.first);
+    auto m_step = std::make_shared<TimedMStep<Scalar> >(steps.second);
+    builder.set_e(e_step).set_m(m_step);
+    LDA<Scalar> lda = builder;
+
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(data.X, data.y);
+    Clock::duration wall(0);
+    for (auto _ : state) {
+        auto start = Clock::now();
+        lda.partial_fit(corpus);
+        wall += Clock::now() - start;
+    }
+
+    double epochs = state.iterations();
+    double docs_per_second = N * epochs / seconds(wall);
+    if (workers == 1) {
+        single_worker[name] = docs_per_second;
+    }
+
+    using benchmark::Counter;
+    state.counters["docs/s"] = Counter(N * epochs, Counter::kIsRate);
+    state.counters["tokens/s"] = Counter(data.X.sum() * epochs, Counter::kIsRate);
+    state.counters["e_step_s"] = Counter(e_step->seconds(), Counter::kAvgIterations);
+    state.counters["doc_m_step_s"] = Counter(m_step->online_seconds(), Counter::kAvgIterations);
+    state.counters["m_step_s"] = Counter(m_step->batch_seconds(), Counter::kAvgIterations);
+    state.counters["wait_s"] = Counter(
+        seconds(wall) - m_step->online_seconds() - m_step->batch_seconds(),
+        Counter::kAvgIterations
+    );
+    if (single_worker.count(name) > 0) {
+        state.counters["efficiency"] = docs_per_second / (workers * single_worker[name]);
+    }
+}
+
+
+/**
+ * Feed the corpus in minibatches of state.range(0) documents with
+ * state.range(1) workers, one LDA::partial_fit over a range of the corpus per
+ * minibatch, and report the throughput to compare with a full epoch.
+ */
+template <typename Scalar>
+static void BM_partial_fit_minibatch(benchmark::State &state, Setup<Scalar> setup) {
+    const SyntheticCorpus &data = get_corpus();
+    size_t minibatch = state.range(0);
+
+    LDABuilder<Scalar> builder;
+    builder.
+        set_workers(state.range(1)).
+        initialize_topics_seeded(data.X, K, 30, 0);
+    auto steps = setup(builder);
+    builder.set_e(steps.first).set_m(steps.second);
+    LDA<Scalar> lda = builder;
+
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(data.X, data.y);
+    for (auto _ : state) {
+        for (size_t begin=0; begin<N; begin+=minibatch) {
+            lda.partial_fit(corpus, begin, std::min<size_t>(begin + minibatch, N));
+        }
+    }
+
+    using benchmark::Counter;
+    state.counters["docs/s"] = Counter(N * state.iterations(), Counter::kIsRate);
+}
+
+
+/**
+ * Register the benchmark for every E step and M step combination that the
+ * console applications create through the LDABuilder (without computing the
+ * likelihood in the E steps).
+ */
+template <typename Scalar>
+static void register_fit_benchmarks(std::string type) {
+    std::vector<std::pair<std::string, Setup<Scalar> > > setups = {
+        {"lda", [](LDABuilder<Scalar> &b) {
+            b.initialize_eta_zeros(1);
+            return Steps<Scalar>(
+                b.get_classic_e_step(10, 1e-2, 0),
+                b.get_classic_m_step()
+            );
+        }},
+        {"slda", [](LDABuilder<Scalar> &b) {
+            b.initialize_eta_zeros(C);
+            return Steps<Scalar>(
+                b.get_supervised_e_step(10, 1e-2, 10, 0),
+                b.get_supervised_m_step()
+            );
+        }},
+        {"fslda", [](LDABuilder<Scalar> &b) {
+            b.initialize_eta_zeros(C);
+            return Steps<Scalar>(
+                b.get_fast_supervised_e_step(10, 1e-2, 1, 0),
+                b.get_fast_supervised_m_step()
+            );
+        }},
+        {"fslda_online", [](LDABuilder<Scalar> &b) {
+            b.initialize_eta_zeros(C);
+            return Steps<Scalar>(
+                b.get_fast_supervised_e_step(10, 1e-2, 1, 0),
+                b.get_fast_supervised_online_m_step(C)
+            );
+        }},
+        {"semi_supervised", [](LDABuilder<Scalar> &b) {
+            b.initialize_eta_zeros(C);
+            return Steps<Scalar>(
+                b.get_semi_supervised_e_step(
+                    b.get_supervised_e_step(10, 1e-2, 10, 0),
+                    b.get_classic_e_step(10, 1e-2, 0)
+                ),
+                b.get_semi_supervised_m_step()
+            );
+        }},
+        {"multinomial", [](LDABuilder<Scalar> &b) {
+            b.initialize_eta_uniform(C);
+            return Steps<Scalar>(
+                b.get_multinomial_supervised_e_step(10, 1e-2, 2, 1, 0),
+                b.get_multinomial_supervised_m_step()
+            );
+        }},
+        {"correspondence", [](LDABuilder<Scalar> &b) {
+            b.initialize_eta_uniform(C);
+            return Steps<Scalar>(
+                b.get_correspondence_supervised_e_step(10, 1e-2, 2, 0),
+                b.get_correspondence_supervised_m_step()
+            );
+        }}
+    };
+
+    for (auto &s : setups) {
+        std::string name = "BM_fit<" + type + ">/" + s.first;
+        benchmark::RegisterBenchmark(name.c_str(), BM_fit<Scalar>, name, s.second)->
+            ArgName("workers")->
+            Arg(1)->Arg(2)->Arg(4)->
+            Unit(benchmark::kMillisecond)->
+            UseRealTime();
+    }
+
+    // the streaming setups fed in minibatches and in a single batch
+    for (auto &s : setups) {
+        if (s.first != "lda" && s.first != "fslda_online") {
+            continue;
+        }
+        std::string name = "BM_partial_fit_minibatch<" + type + ">/" + s.first;
+        benchmark::RegisterBenchmark(name.c_str(), BM_partial_fit_minibatch<Scalar>, s.second)->
+            ArgNames({"minibatch", "workers"})->
+            Args({64, 1})->Args({256, 1})->Args({N, 1})->
+            Args({64, 4})->Args({256, 4})->Args({N, 4})->
+            Unit(benchmark::kMillisecond)->
+            UseRealTime();
+    }
+}
+
+static int registered BENCHMARK_UNUSED = (
+    register_fit_benchmarks<float>("float"),
+    register_fit_benchmarks<double>("double"),
+    0
+);
@@ -0,0 +1,82 @@
+#include <cmath>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "bench/utils.hpp"
+
+#include "ldaplusplus/utils.hpp"
+
+using namespace ldaplusplus;
+
+
+// The arguments of fast_exp are in [-50, 50) and the ones of digamma in
+// (0, 100) which is roughly what the E steps pass to them
+template <typename Scalar>
+static std::vector<Scalar> random_arguments(size_t N, Scalar low, Scalar high) {
+    BenchPRNG prng(0);
+    std::uniform_real_distribution<Scalar> uniform(low, high);
+    std::vector<Scalar> x(N);
+    for (auto &xi : x) {
+        xi = uniform(prng);
+    }
+
+    return x;
+}
+
+// The number of arguments evaluated per iteration
+static void Elements(benchmark::internal::Benchmark *b) {
+    b->Arg(1024);
+}
+
+
+template <typename Scalar>
+static void BM_fast_exp(benchmark::State &state) {
+    auto x = random_arguments<Scalar>(state.range(0), -50, 50);
+    for (auto _ : state) {
+        for (auto xi : x) {
+            benchmark::DoNotOptimize(math_utils::fast_exp(xi));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_fast_exp, Elements);
+
+
+template <typename Scalar>
+static void BM_std_exp(benchmark::State &state) {
+    auto x = random_arguments<Scalar>(state.range(0), -50, 50);
+    for (auto _ : state) {
+        for (auto xi : x) {
+            benchmark::DoNotOptimize(std::exp(xi));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_std_exp, Elements);
+
+
+template <typename Scalar>
+static void BM_digamma(benchmark::State &state) {
+    auto x = random_arguments<Scalar>(state.range(0), 1e-3, 100);
+    for (auto _ : state) {
+        for (auto xi : x) {
+            benchmark::DoNotOptimize(math_utils::digamma(xi));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_digamma, Elements);
+
+
+template <typename Scalar>
+static void BM_lgamma(benchmark::State &state) {
+    auto x = random_arguments<Scalar>(state.range(0), 1e-3, 100);
+    for (auto _ : state) {
+        for (auto xi : x) {
+            benchmark::DoNotOptimize(std::lgamma(xi));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_lgamma, Elements);
@@ -0,0 +1,56 @@
+#include <benchmark/benchmark.h>
+
+#include <Eigen/Core>
+
+#include "bench/utils.hpp"
+
+#include "ldaplusplus/optimization/MultinomialLogisticRegression.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+/**
+ * The arguments are, in order, the number of topics K, the number of
+ * documents N and the number of classes C.
+ */
+static void TopicsDocumentsClasses(benchmark::internal::Benchmark *b) {
+    b->ArgNames({"K", "N", "C"});
+    b->ArgsProduct({{20, 100, 500}, {1000, 10000}, {2, 10, 50}});
+}
+
+
+template <typename Scalar>
+static void BM_mlr_value(benchmark::State &state) {
+    int K = state.range(0), N = state.range(1), C = state.range(2);
+    BenchPRNG prng(0);
+    MatrixX<Scalar> X = random_phi<Scalar>(K, N, prng);
+    VectorXi y = random_labels(N, C, prng);
+    MatrixX<Scalar> eta = random_uniform<Scalar>(K, C, prng, -1, 1);
+
+    optimization::MultinomialLogisticRegression<Scalar> mlr(X, y, 1);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mlr.value(eta));
+    }
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_mlr_value, TopicsDocumentsClasses);
+
+
+template <typename Scalar>
+static void BM_mlr_gradient(benchmark::State &state) {
+    int K = state.range(0), N = state.range(1), C = state.range(2);
+    BenchPRNG prng(0);
+    MatrixX<Scalar> X = random_phi<Scalar>(K, N, prng);
+    VectorXi y = random_labels(N, C, prng);
+    MatrixX<Scalar> eta = random_uniform<Scalar>(K, C, prng, -1, 1);
+    MatrixX<Scalar> grad(K, C);
+
+    optimization::MultinomialLogisticRegression<Scalar> mlr(X, y, 1);
+    for (auto _ : state) {
+        mlr.gradient(eta, grad);
+        benchmark::DoNotOptimize(grad.data());
+    }
+    state.SetItemsProcessed(state.iterations() * N);
+}
+BENCHMARK_FLOAT_AND_DOUBLE(BM_mlr_gradient, TopicsDocumentsClasses);
@@ -0,0 +1,23 @@
+# Try to find Google Benchmark
+# Once done it will define
+# - BENCHMARK_FOUND
+# - BENCHMARK_INCLUDE_DIRS
+# - BENCHMARK_LIBRARIES
+#
+# BENCHMARK_LIBRARIES contains both libbenchmark and libbenchmark_main so the
+# benchmark sources need not define a main function.
+
+find_path(BENCHMARK_INCLUDE_DIRS benchmark/benchmark.h)
+find_library(BENCHMARK_LIBRARY benchmark)
+find_library(BENCHMARK_MAIN_LIBRARY benchmark_main)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(
+    Benchmark
+    DEFAULT_MSG
+    BENCHMARK_INCLUDE_DIRS
+    BENCHMARK_LIBRARY
+    BENCHMARK_MAIN_LIBRARY
+)
+
+set(BENCHMARK_LIBRARIES ${BENCHMARK_MAIN_LIBRARY} ${BENCHMARK_LIBRARY})
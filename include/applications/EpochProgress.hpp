@@ -10,6 +10,10 @@ using namespace ldaplusplus;
 /**
   * This class is used to keep track of the progress of a complete Expectation
   * - Maximization step.
+  *
+  * At the end of each epoch it prints the per document likelihood and a one
+  * line summary of where the time went. The likelihood and perplexity
+  * computed by a LikelihoodEvaluator are printed whenever they arrive.
   */
 class EpochProgress : public events::EventListenerInterface
 {
@@ -17,12 +21,16 @@ class EpochProgress : public events::EventListenerInterface
         EpochProgress();
 
         void on_event(std::shared_ptr<events::Event> event);
+        bool listens_to(size_t type) const;
 
     private:
        int em_iterations_;
        int likelihood_;
        int cnt_likelihoods_;
        int is_first_time_;
+       size_t e_step_documents_;
+       size_t e_step_iterations_;
+       size_t line_search_evaluations_;
 };
 
 #endif  // _APPLICATIONS_EPOCHPROGRESS_HPP_
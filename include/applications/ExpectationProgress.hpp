@@ -17,6 +17,7 @@ class ExpectationProgress : public events::EventListenerInterface
         ExpectationProgress(int print_every = 100);
 
         void on_event(std::shared_ptr<events::Event> event);
+        bool listens_to(size_t type) const;
 
     private:
         // The number of completed doc_e_step iterations so far.
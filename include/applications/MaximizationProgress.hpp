@@ -17,6 +17,7 @@ class MaximizationProgress : public events::EventListenerInterface
         MaximizationProgress();
 
         void on_event(std::shared_ptr<events::Event> event);
+        bool listens_to(size_t type) const;
 
     private:
         // The number of completed doc_m_step iterations
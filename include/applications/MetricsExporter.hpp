@@ -0,0 +1,91 @@
+#ifndef _APPLICATIONS_METRICSEXPORTER_HPP_
+#define _APPLICATIONS_METRICSEXPORTER_HPP_
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ldaplusplus/events/Events.hpp"
+#include "ldaplusplus/events/MetricsEvents.hpp"
+
+using namespace ldaplusplus;
+
+/**
+  * This class aggregates the progress and timing events of a training run and
+  * exports them for monitoring long running jobs.
+  *
+  * Two files are written:
+  *
+  * - path is rewritten (atomically) in the Prometheus text exposition format
+  *   at the end of every epoch and at most every update_interval seconds
+  *   during an epoch so that it can be scraped by the textfile collector of
+  *   the node exporter
+  * - path.jsonl gets a JSON object appended at the end of every epoch with the
+  *   throughput, the E step latency and iteration percentiles, the
+  *   likelihoods, the perplexity of the last evaluation, the memory usage
+  *   and the hardware counters per document (if the library was compiled
+  *   with LDAPLUSPLUS_PERF_COUNTERS)
+  *
+  * Failing to write either file does not interrupt the training; the error
+  * is printed to stderr and the exporter ignores every later event.
+  */
+class MetricsExporter : public events::EventListenerInterface
+{
+    public:
+        MetricsExporter(std::string path, double update_interval=10);
+
+        void on_event(std::shared_ptr<events::Event> event);
+        bool listens_to(size_t type) const;
+
+    private:
+        /** Rewrite the Prometheus textfile */
+        void write_textfile();
+        /** Append the metrics of the last epoch to the JSON-lines log */
+        void append_json();
+        /** Report a failed write and stop exporting */
+        void fail(const std::string &message);
+
+        std::string path_;
+        double update_interval_;
+        std::chrono::steady_clock::time_point last_update_;
+        bool failed_;
+
+        // Totals over the whole training run
+        size_t epochs_;
+        size_t documents_total_;
+
+        // The current epoch
+        size_t epoch_documents_;
+        double expectation_likelihood_;
+        size_t expectation_likelihoods_;
+        size_t line_search_iterations_;
+        size_t line_search_evaluations_;
+
+        // The last epoch
+        double wall_time_;
+        double queue_wait_;
+        double e_step_time_;
+        double m_step_online_;
+        double m_step_batch_;
+        double documents_per_second_;
+        std::vector<double> worker_documents_per_second_;
+        std::vector<double> e_step_latency_;
+        std::vector<size_t> e_step_iterations_;
+        double e_step_iterations_mean_;
+        double last_expectation_likelihood_;
+        double previous_expectation_likelihood_;
+        double maximization_likelihood_;
+        size_t last_line_search_iterations_;
+        size_t last_line_search_evaluations_;
+
+        // The last evaluation of a LikelihoodEvaluator
+        size_t evaluation_epoch_;
+        double evaluation_likelihood_;
+        double perplexity_;
+        std::map<std::string, std::shared_ptr<events::HardwareCountersEvent> > hardware_counters_;
+};
+
+#endif  // _APPLICATIONS_METRICSEXPORTER_HPP_
@@ -4,6 +4,7 @@
 #include <iostream>
 
 #include "ldaplusplus/Parameters.hpp"
+#include "ldaplusplus/Vocabulary.hpp"
 
 #include "ldaplusplus/events/Events.hpp"
 
@@ -12,9 +13,15 @@ using namespace ldaplusplus;
 class SnapshotEvery : public events::EventListenerInterface
 {
     public:
-        SnapshotEvery(std::string path, int save_every=10);
+        SnapshotEvery(
+            std::string path,
+            int save_every=10,
+            std::shared_ptr<const corpus::Vocabulary> vocabulary=nullptr,
+            int hash_buckets=0
+        );
 
         void on_event(std::shared_ptr<events::Event> event);
+        bool listens_to(size_t type) const;
 
         void snapshot(
             std::shared_ptr<parameters::Parameters> parameters
@@ -23,6 +30,8 @@ class SnapshotEvery : public events::EventListenerInterface
         std::string path_;
         int save_every_;
         int seen_so_far_;
+        std::shared_ptr<const corpus::Vocabulary> vocabulary_;
+        int hash_buckets_;
 };
 
 #endif // _APPLICATIONS_SNAPSHOTEVERY_HPP_
@@ -1,11 +1,16 @@
 #ifndef _APPLICATIONS_LDA_IO_HPP_
 #define _APPLICATIONS_LDA_IO_HPP_
 
+#include <cstdint>
 #include <memory>
+#include <string>
 
 #include <Eigen/Core>
+#include <Eigen/Sparse>
 
+#include "ldaplusplus/NumpyFormat.hpp"
 #include "ldaplusplus/Parameters.hpp"
+#include "ldaplusplus/Vocabulary.hpp"
 
 using namespace ldaplusplus;
 
@@ -38,28 +43,138 @@ void parse_input_data(
     Eigen::MatrixXi &X
 );
 
+/**
+  * Parse the input data from a file and hash the words into the buckets of
+  * hasher one chunk of documents at a time, so that the dense words x
+  * documents matrix is never in memory.
+  *
+  * @param data_path  The file to read the input data from
+  * @param hasher     The hasher that maps the words to buckets
+  * @param chunk_size The number of documents to read at a time
+  * @param X          An Eigen matrix containing the bucket counts
+  */
+void parse_input_data(
+    std::string data_path,
+    const corpus::FeatureHasher &hasher,
+    size_t chunk_size,
+    Eigen::MatrixXi &X
+);
+
 /**
   * Save a set of model parameters in a file defined by the model_path input
   * argument, according to the NumpyFormat.
   *
   * @param model_path The file to save the set of the input parameters
   * @param parameters The set of input parameters to be saved
+  * @param vocabulary If not null the topics were trained on compact word ids
+  *                   and are expanded back to the original ids
+  * @param hash_buckets If positive the topics are over the buckets of a
+  *                     FeatureHasher and their number is saved as a fourth
+  *                     1 x 1 int32 array (see model_hash_buckets)
   */
 void save_lda(
     std::string model_path,
-    std::shared_ptr<parameters::Parameters> parameters
+    std::shared_ptr<parameters::Parameters> parameters,
+    std::shared_ptr<const corpus::Vocabulary> vocabulary = nullptr,
+    int hash_buckets = 0
 );
 
 /**
-  * Read a set of model parameters saved in NumpyInput from a file
+  * Read a set of model parameters saved in NumpyInput or in the binary
+  * container of model_file from a file.
+  *
+  * The arrays are always copied in the returned parameters so that they can
+  * be trained further, see map_lda for inference. Numpy models are stored
+  * in double precision and binary models are converted from the precision
+  * of the file to Scalar (see is_float_model).
   *
   * @param model_path The file to read a set of model parameters from
   * @return The model parameters
   */
-std::shared_ptr<parameters::SupervisedModelParameters<double> > load_lda(
+template <typename Scalar = double>
+std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > load_lda(
     std::string model_path
 );
 
+/**
+  * Read a set of model parameters only to transform documents with them
+  * (see LDABuilder::initialize_from_view).
+  *
+  * Binary models of the precision of Scalar are mapped read-only and used
+  * in place without any copy (see model_file::map_parameters), any other
+  * model is loaded with load_lda and viewed.
+  *
+  * @param model_path The file to read a set of model parameters from
+  * @return The read-only model parameters
+  */
+template <typename Scalar = double>
+std::shared_ptr<parameters::ModelParametersView<Scalar> > map_lda(
+    std::string model_path
+);
+
+/**
+  * Read the number of buckets the documents were hashed into to train a
+  * model, from the fourth array of a numpy model (the first three are
+  * skipped without reading them) or the header of a binary model.
+  *
+  * @return The buckets or 0 if the model was trained on the words
+  */
+int model_hash_buckets(std::string model_path);
+
+/**
+  * Check whether a model is a binary model file (see model_file) stored in
+  * single precision so that it can be loaded without widening it to double.
+  */
+bool is_float_model(std::string model_path);
+
+/**
+  * Compact the topics of a model saved with a vocabulary (see save_lda) so
+  * that no word has zero probability in every topic.
+  *
+  * @param model The model parameters (changed by this function)
+  * @return      The vocabulary of the model or null if it uses every word
+  */
+std::shared_ptr<corpus::Vocabulary> compact_lda(
+    std::shared_ptr<parameters::ModelParameters<double> > model
+);
+std::shared_ptr<corpus::Vocabulary> compact_lda(
+    std::shared_ptr<parameters::ModelParameters<float> > model
+);
+
+
+/**
+  * Write the sparse topic mixtures of the documents (see
+  * LDA::transform_sparse) as a documents x topics CSR matrix, namely three
+  * 1 x n numpy arrays in the same file: indptr (int64), indices (int32) and
+  * data (float32).
+  *
+  * The chunks are streamed to temporary files next to the output which are
+  * concatenated by close() so that memory stays flat.
+  */
+class SparseTopicsWriter
+{
+    public:
+        SparseTopicsWriter(std::string path);
+        ~SparseTopicsWriter();
+
+        /**
+         * Append the documents (columns) of a chunk.
+         */
+        void write(const Eigen::SparseMatrix<double> &topics);
+
+        /**
+         * Concatenate the arrays in the output file.
+         */
+        void close();
+
+    private:
+        std::string path_;
+        int64_t nnz_;
+        std::unique_ptr<numpy_format::NumpyOutputStream<int64_t> > indptr_;
+        std::unique_ptr<numpy_format::NumpyOutputStream<int32_t> > indices_;
+        std::unique_ptr<numpy_format::NumpyOutputStream<float> > data_;
+};
+
 
 }  // namespace io
 
@@ -1,13 +1,40 @@
 #ifndef _APPLICATIONS_UTILS_HPP_
 #define _APPLICATIONS_UTILS_HPP_
 
+#include <functional>
+#include <map>
+#include <string>
+
 #include <Eigen/Core>
+#include <docopt/docopt.h>
+
+#include "ldaplusplus/LDABuilder.hpp"
 
 namespace utils {
 
 
 Eigen::VectorXd create_class_weights(const Eigen::VectorXi & y);
 
+/**
+  * Compute the likelihood every --compute_likelihood epochs in a low
+  * priority thread (nothing is done if it is not positive) with the E step
+  * options of the console applications.
+  *
+  * The evaluated documents are those in --held_out or the training ones.
+  *
+  * @param args    The parsed command line arguments
+  * @param X       The training documents
+  * @param builder The builder of the LDA being trained
+  * @param read    Reads the held out documents of a path (by default
+  *                io::parse_input_data)
+  */
+void add_likelihood_evaluator(
+    std::map<std::string, docopt::value> &args,
+    const Eigen::MatrixXi & X,
+    ldaplusplus::LDABuilder<double> & builder,
+    std::function<void(std::string, Eigen::MatrixXi &)> read = nullptr
+);
+
 }  // namespace utils
 
 #endif // _APPLICATIONS_UTILS_HPP_
@@ -0,0 +1,250 @@
+#ifndef _BENCH_UTILS_HPP_
+#define _BENCH_UTILS_HPP_
+
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <Eigen/Core>
+
+#include "ldaplusplus/utils.hpp"
+
+
+// Eigen 3.4 provides the same aliases so we use those to avoid ambiguities
+// in benchmarks that also use namespace Eigen
+#if EIGEN_VERSION_AT_LEAST(3, 3, 90)
+using Eigen::MatrixX;
+using Eigen::VectorX;
+#else
+template <typename T>
+using MatrixX = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+template <typename T>
+using VectorX = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+#endif
+
+typedef ldaplusplus::math_utils::Xoshiro256 BenchPRNG;
+
+
+/**
+ * Register a templated benchmark for both float and double applying the
+ * function args to set the arguments.
+ */
+#define BENCHMARK_FLOAT_AND_DOUBLE(func, args)               \
+    BENCHMARK_TEMPLATE(func, float)->Apply(args);            \
+    BENCHMARK_TEMPLATE(func, double)->Apply(args)
+
+
+/**
+ * Create a rows x cols matrix with values uniformly distributed in (low, high).
+ */
+template <typename Scalar>
+MatrixX<Scalar> random_uniform(int rows, int cols, BenchPRNG &prng, Scalar low=0, Scalar high=1) {
+    std::uniform_real_distribution<Scalar> uniform(low, high);
+    MatrixX<Scalar> x(rows, cols);
+    for (int j=0; j<cols; j++) {
+        for (int i=0; i<rows; i++) {
+            x(i, j) = uniform(prng);
+        }
+    }
+
+    return x;
+}
+
+
+/**
+ * Create a K x V topic matrix whose rows are distributions over the words.
+ */
+template <typename Scalar>
+MatrixX<Scalar> random_topics(int K, int V, BenchPRNG &prng) {
+    MatrixX<Scalar> beta = random_uniform<Scalar>(K, V, prng, 0.01, 1);
+    ldaplusplus::math_utils::normalize_rows(beta);
+
+    return beta;
+}
+
+
+/**
+ * Create a K x V matrix whose columns are distributions over the topics (for
+ * instance phi).
+ */
+template <typename Scalar>
+MatrixX<Scalar> random_phi(int K, int V, BenchPRNG &prng) {
+    MatrixX<Scalar> phi = random_uniform<Scalar>(K, V, prng, 0.01, 1);
+    ldaplusplus::math_utils::normalize_cols(phi);
+
+    return phi;
+}
+
+
+/**
+ * Create a document with V words of which approximately V*density appear
+ * from 1 to 10 times.
+ */
+inline Eigen::VectorXi random_document(int V, double density, BenchPRNG &prng) {
+    std::bernoulli_distribution appears(density);
+    std::uniform_int_distribution<int> count(1, 10);
+    Eigen::VectorXi X = Eigen::VectorXi::Zero(V);
+    for (int i=0; i<V; i++) {
+        if (appears(prng)) {
+            X[i] = count(prng);
+        }
+    }
+
+    // make sure that no document is empty
+    if (X.sum() == 0) {
+        X[0] = 1;
+    }
+
+    return X;
+}
+
+
+/**
+ * Create a V x N corpus, see random_document().
+ */
+inline Eigen::MatrixXi random_corpus(int V, int N, double density, BenchPRNG &prng) {
+    Eigen::MatrixXi X(V, N);
+    for (int i=0; i<N; i++) {
+        X.col(i) = random_document(V, density, prng);
+    }
+
+    return X;
+}
+
+
+/**
+ * Create N class labels in [0, C).
+ */
+inline Eigen::VectorXi random_labels(int N, int C, BenchPRNG &prng) {
+    std::uniform_int_distribution<int> label(0, C-1);
+    Eigen::VectorXi y(N);
+    for (int i=0; i<N; i++) {
+        y[i] = label(prng);
+    }
+
+    return y;
+}
+
+
+/**
+ * A corpus sampled from the generative process of LDA.
+ */
+struct SyntheticCorpus
+{
+    /** The word counts (V x N) */
+    Eigen::MatrixXi X;
+    /** The class of every document (only meaningful if classes > 0) */
+    Eigen::VectorXi y;
+    /** The topics used to sample the corpus (K x V) */
+    Eigen::MatrixXd beta;
+};
+
+
+/**
+ * Sample a vector from a symmetric or asymmetric Dirichlet distribution.
+ */
+inline Eigen::VectorXd sample_dirichlet(const Eigen::VectorXd &alpha, BenchPRNG &prng) {
+    Eigen::VectorXd x(alpha.rows());
+    for (int i=0; i<alpha.rows(); i++) {
+        std::gamma_distribution<double> gamma(alpha[i], 1.0);
+        x[i] = gamma(prng);
+    }
+
+    // very small concentrations may produce only zeros
+    if (x.sum() > 0) {
+        x /= x.sum();
+    } else {
+        x.fill(1.0/x.rows());
+    }
+
+    return x;
+}
+
+
+/**
+ * Create a corpus following the generative process of LDA.
+ *
+ * 1. The word frequencies follow Zipf's law with exponent zipf and each one
+ *    of the K topics is sampled from a Dirichlet centered on them
+ * 2. The length of each document is sampled from a Poisson with mean
+ *    mean_length
+ * 3. The topic proportions of each document are sampled from a symmetric
+ *    Dirichlet with concentration alpha and then every word from the
+ *    corresponding mixture of topics
+ * 4. If classes > 0 each document gets the class that maximizes a random
+ *    linear function of its topic proportions so that the labels can be
+ *    predicted from the topics
+ *
+ * @param V           The size of the vocabulary
+ * @param N           The number of documents
+ * @param K           The number of topics
+ * @param mean_length The mean number of words in a document
+ * @param classes     The number of classes (0 for an unlabeled corpus)
+ * @param prng        The source of randomness
+ * @param alpha       The concentration of the topic proportions
+ * @param zipf        The exponent of the word frequencies
+ */
+inline SyntheticCorpus synthetic_corpus(
+    int V,
+    int N,
+    int K,
+    double mean_length,
+    int classes,
+    BenchPRNG &prng,
+    double alpha = 0.1,
+    double zipf = 1.0
+) {
+    SyntheticCorpus corpus;
+
+    // Zipfian word frequencies
+    Eigen::VectorXd frequencies(V);
+    for (int v=0; v<V; v++) {
+        frequencies[v] = std::pow(v + 1.0, -zipf);
+    }
+    frequencies /= frequencies.sum();
+
+    // The topics and a distribution to sample words from each one of them
+    corpus.beta.resize(K, V);
+    std::vector<std::discrete_distribution<int> > words;
+    for (int k=0; k<K; k++) {
+        Eigen::VectorXd topic = sample_dirichlet(0.1 * V * frequencies, prng);
+        corpus.beta.row(k) = topic.transpose();
+        words.emplace_back(topic.data(), topic.data() + V);
+    }
+
+    // The classification parameters
+    std::normal_distribution<double> normal;
+    Eigen::MatrixXd eta(K, std::max(classes, 1));
+    for (int i=0; i<eta.size(); i++) {
+        eta(i) = normal(prng);
+    }
+
+    // The documents
+    std::poisson_distribution<int> length(mean_length);
+    Eigen::VectorXd doc_alpha = Eigen::VectorXd::Constant(K, alpha);
+    corpus.X = Eigen::MatrixXi::Zero(V, N);
+    corpus.y = Eigen::VectorXi::Zero(N);
+    for (int d=0; d<N; d++) {
+        Eigen::VectorXd theta = sample_dirichlet(doc_alpha, prng);
+        std::discrete_distribution<int> topics(theta.data(), theta.data() + K);
+
+        int L = std::max(1, length(prng));
+        for (int n=0; n<L; n++) {
+            corpus.X(words[topics(prng)](prng), d)++;
+        }
+
+        if (classes > 0) {
+            Eigen::Index y;
+            (eta.transpose() * theta).maxCoeff(&y);
+            corpus.y[d] = y;
+        }
+    }
+
+    return corpus;
+}
+
+
+#endif  // _BENCH_UTILS_HPP_
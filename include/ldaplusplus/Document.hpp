@@ -3,11 +3,13 @@
 
 
 #include <memory>
-#include <random>
 #include <vector>
 
 #include <Eigen/Core>
 
+#include "ldaplusplus/utils.hpp"
+#include "ldaplusplus/Vocabulary.hpp"
+
 namespace ldaplusplus {
 namespace corpus {
 
@@ -31,9 +33,10 @@ class Document
          */
         virtual const std::shared_ptr<const Corpus> get_corpus() const = 0;
         /**
-         * @return The bag of words dense vector
+         * @return The bag of words dense vector (a reference to the data
+         *         backing the document so no copy is made)
          */
-        virtual const Eigen::VectorXi & get_words() const = 0;
+        virtual Eigen::Ref<const Eigen::VectorXi> get_words() const = 0;
 
         /**
          * @return The corpus this documents belongs to after casting it to
@@ -44,6 +47,13 @@ class Document
             return std::static_pointer_cast<const T>(get_corpus());
         }
 
+        /**
+         * @return The number of identical documents this document stands
+         *         for (see EigenDeduplicatedCorpus). The M steps scale the
+         *         sufficient statistics of the document by it.
+         */
+        virtual int get_weight() const { return 1; }
+
         virtual ~Document(){};
 };
 
@@ -70,7 +80,18 @@ class Corpus
     public:
         /** The number of documents in the corpus */
         virtual size_t size() const = 0;
-        /** The ith document */
+        /**
+         * The number of documents the corpus stands for, namely the sum of
+         * the weights of its documents (see Document::get_weight).
+         */
+        virtual size_t total_weight() const { return size(); }
+        /**
+         * The ith document.
+         *
+         * The returned pointer may not own the document (the Eigen corpora
+         * hand out views they own) so a document must not outlive the
+         * corpus it came from.
+         */
         virtual const std::shared_ptr<Document> at(size_t index) const = 0;
         /**
          * Shuffle the documents so that the ith document is any of the
@@ -108,7 +129,7 @@ class EigenDocument : public Document
         EigenDocument(Eigen::VectorXi X, std::shared_ptr<const Corpus> corpus);
 
         const std::shared_ptr<const Corpus> get_corpus() const override;
-        const Eigen::VectorXi & get_words() const override;
+        Eigen::Ref<const Eigen::VectorXi> get_words() const override;
 
     private:
         Eigen::VectorXi X_;
@@ -130,8 +151,9 @@ class ClassificationDecorator : public ClassificationDocument
         ClassificationDecorator(std::shared_ptr<Document> doc, int y);
 
         const std::shared_ptr<const Corpus> get_corpus() const override;
-        const Eigen::VectorXi & get_words() const override;
+        Eigen::Ref<const Eigen::VectorXi> get_words() const override;
         int get_class() const override;
+        int get_weight() const override;
 
     private:
         std::shared_ptr<Document> document_;
@@ -139,6 +161,45 @@ class ClassificationDecorator : public ClassificationDocument
 };
 
 
+/**
+ * EigenDocumentView is a document that refers to a column of a matrix owned
+ * by a corpus instead of copying it. It is meant to be created once per
+ * document by the Eigen corpora so that accessing a document does not
+ * allocate any memory.
+ *
+ * Documents of unsupervised corpora have the class -1 (unlabeled).
+ */
+class EigenDocumentView : public ClassificationDocument
+{
+    public:
+        /**
+         * @param X      The words of the document (they must outlive the view)
+         * @param y      The class of the document
+         * @param corpus The corpus this document belongs to (it must outlive
+         *               the view as well)
+         * @param weight The number of identical documents this one stands
+         *               for
+         */
+        EigenDocumentView(
+            Eigen::Ref<const Eigen::VectorXi> X,
+            int y,
+            const Corpus * corpus,
+            int weight = 1
+        );
+
+        const std::shared_ptr<const Corpus> get_corpus() const override;
+        Eigen::Ref<const Eigen::VectorXi> get_words() const override;
+        int get_class() const override;
+        int get_weight() const override;
+
+    private:
+        Eigen::Map<const Eigen::VectorXi> X_;
+        int y_;
+        const Corpus * corpus_;
+        int weight_;
+};
+
+
 /**
  * Implement a shuffle method that shuffles indexes and provides them to
  * classes who want to implement the corpus interface.
@@ -167,18 +228,25 @@ class CorpusIndexes
         std::vector<int> indices_;
 
         /** A pseudo random number generator for the shuffling */
-        std::mt19937 prng_;
+        math_utils::Xoshiro256 prng_;
 };
 
 
 /**
  * Wrap a matrix X and implement the corpus interface.
+ *
+ * The documents returned by at() are views into X that are owned by the
+ * corpus, thus they are only valid as long as the corpus is.
  */
 class EigenCorpus : public Corpus
 {
     public:
         EigenCorpus(const Eigen::MatrixXi & X, int random_state=0);
 
+        // The documents point back to the corpus
+        EigenCorpus(const EigenCorpus &) = delete;
+        EigenCorpus & operator=(const EigenCorpus &) = delete;
+
         size_t size() const override;
         virtual const std::shared_ptr<Document> at(size_t index) const override;
         void shuffle() override;
@@ -193,12 +261,21 @@ class EigenCorpus : public Corpus
          */
         const Eigen::MatrixXi & X_;
 
+    private:
+        /**
+         * One view per column of X_, created once so that at() only needs
+         * to hand out a pointer (mutable because the Corpus interface
+         * returns non const documents from a const method).
+         */
+        mutable std::vector<EigenDocumentView> documents_;
 };
 
 
 /**
  * EigenClassificationCorpus wraps a pair of matrices X, y and implements the
  * Corpus interface with them using X as the words and y as the classes.
+ *
+ * Like EigenCorpus the documents are views owned by the corpus.
  */
 class EigenClassificationCorpus : public ClassificationCorpus
 {
@@ -209,6 +286,10 @@ class EigenClassificationCorpus : public ClassificationCorpus
             int random_state = 0
         );
 
+        // The documents point back to the corpus
+        EigenClassificationCorpus(const EigenClassificationCorpus &) = delete;
+        EigenClassificationCorpus & operator=(const EigenClassificationCorpus &) = delete;
+
         size_t size() const override;
         virtual const std::shared_ptr<Document> at(size_t index) const override;
         void shuffle() override;
@@ -224,6 +305,113 @@ class EigenClassificationCorpus : public ClassificationCorpus
 
         // The class priors
         Eigen::VectorXf priors_;
+
+        // The documents (see EigenCorpus)
+        mutable std::vector<EigenDocumentView> documents_;
+};
+
+
+/**
+ * EigenDeduplicatedCorpus collapses the identical columns of X (with the
+ * same class if y is given) to a single document whose weight is the number
+ * of copies so that the E step runs once per distinct document.
+ *
+ * Documents are hashed on their non zero words and counts and compared
+ * exactly only when the hashes collide. Unlike the other Eigen corpora it
+ * keeps a copy of the distinct columns so X and y need not outlive it.
+ * Without y the documents have the class -1 (unlabeled) and get_prior()
+ * should not be called.
+ */
+class EigenDeduplicatedCorpus : public ClassificationCorpus
+{
+    public:
+        EigenDeduplicatedCorpus(const Eigen::MatrixXi &X, int random_state = 0);
+        EigenDeduplicatedCorpus(
+            const Eigen::MatrixXi &X,
+            const Eigen::VectorXi &y,
+            int random_state = 0
+        );
+
+        // The documents point back to the corpus and into its X_
+        EigenDeduplicatedCorpus(const EigenDeduplicatedCorpus &) = delete;
+        EigenDeduplicatedCorpus & operator=(const EigenDeduplicatedCorpus &) = delete;
+
+        size_t size() const override;
+        /** The number of columns of X */
+        size_t total_weight() const override;
+        virtual const std::shared_ptr<Document> at(size_t index) const override;
+        void shuffle() override;
+        /** The class priors are computed over all the columns of X */
+        float get_prior(int y) const override;
+
+        /**
+         * For every column of X the index of the document of the corpus
+         * (before any shuffling) that stands for it. It is used to fan the
+         * per document results back out to the columns of X.
+         */
+        const Eigen::VectorXi & get_document_index() const { return index_; }
+
+    private:
+        void deduplicate(const Eigen::MatrixXi &X, const Eigen::VectorXi &y);
+
+        /** To implement shuffle */
+        CorpusIndexes indices_;
+
+        // The distinct documents, their classes and their weights
+        Eigen::MatrixXi X_;
+        Eigen::VectorXi y_;
+        Eigen::VectorXi weights_;
+
+        // The map from the columns of X to the documents
+        Eigen::VectorXi index_;
+
+        // The class priors
+        Eigen::VectorXf priors_;
+
+        // The documents (see EigenCorpus)
+        mutable std::vector<EigenDocumentView> documents_;
+};
+
+/**
+ * EigenHashedCorpus hashes the words of X into the buckets of a
+ * FeatureHasher and implements the Corpus interface on the result.
+ *
+ * It owns the hashed matrix (X need not outlive it) and hands out the
+ * documents of an EigenCorpus or an EigenClassificationCorpus wrapping it,
+ * thus the documents report that corpus from get_corpus().
+ */
+class EigenHashedCorpus : public ClassificationCorpus
+{
+    public:
+        EigenHashedCorpus(
+            const FeatureHasher &hasher,
+            const Eigen::MatrixXi &X,
+            int random_state = 0
+        );
+        EigenHashedCorpus(
+            const FeatureHasher &hasher,
+            const Eigen::MatrixXi &X,
+            const Eigen::VectorXi &y,
+            int random_state = 0
+        );
+
+        // The documents of corpus_ point into X_
+        EigenHashedCorpus(const EigenHashedCorpus &) = delete;
+        EigenHashedCorpus & operator=(const EigenHashedCorpus &) = delete;
+
+        size_t size() const override;
+        virtual const std::shared_ptr<Document> at(size_t index) const override;
+        void shuffle() override;
+        /** Only for a corpus created with classes */
+        float get_prior(int y) const override;
+
+    private:
+        // The hashed data
+        Eigen::MatrixXi X_;
+        Eigen::VectorXi y_;
+
+        // The corpus of the hashed data
+        std::shared_ptr<Corpus> corpus_;
 };
 
 }  // namespace corpus
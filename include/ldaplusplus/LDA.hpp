@@ -2,7 +2,10 @@
 #define _LDAPLUSPLUS_LDA_HPP_
 
 
+#include <chrono>
 #include <condition_variable>
+#include <exception>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -11,15 +14,66 @@
 #include <tuple>
 
 #include <Eigen/Core>
+#include <Eigen/Sparse>
 
 #include "ldaplusplus/events/Events.hpp"
 #include "ldaplusplus/em/EStepInterface.hpp"
 #include "ldaplusplus/em/MStepInterface.hpp"
+#include "ldaplusplus/LikelihoodEvaluator.hpp"
 #include "ldaplusplus/Parameters.hpp"
+#include "ldaplusplus/perf_utils.hpp"
 
 namespace ldaplusplus {
 
 
+/**
+ * LDAOptions groups the optional behaviour of an LDA (see the LDA constructor)
+ * which LDABuilder fills in through its setters.
+ */
+template <typename Scalar = double>
+struct LDAOptions
+{
+    LDAOptions()
+        : deterministic(false),
+          squarem(false),
+          tolerance(0),
+          held_out(false),
+          deduplicate(false)
+    {}
+
+    // Assign every document to a fixed worker and perform the maximization
+    // step in document order so that the results do not depend on thread
+    // timing (see LDA::partial_fit)
+    bool deterministic;
+
+    // An optional LikelihoodEvaluator that receives the model at the end of
+    // every epoch
+    std::shared_ptr<LikelihoodEvaluator<Scalar> > evaluator;
+
+    // Extrapolate the model parameters across epochs in LDA::fit (see
+    // LDA::squarem)
+    bool squarem;
+
+    // The minimum relative increase of the likelihood after an epoch for
+    // LDA::fit to keep iterating (0 disables the check)
+    Scalar tolerance;
+
+    // Measure the increase with the LikelihoodEvaluator instead of the
+    // training documents (see LDA::fit), the LDA constructor throws a
+    // std::runtime_error if there is no evaluator
+    bool held_out;
+
+    // Collapse the identical documents of the matrices passed to fit and
+    // transform to a single weighted document (see
+    // corpus::EigenDeduplicatedCorpus)
+    bool deduplicate;
+
+    // If not null hash the words of the matrices passed to fit, transform
+    // and evaluate into its buckets (see corpus::FeatureHasher)
+    std::shared_ptr<corpus::FeatureHasher> hasher;
+};
+
+
 /**
  * LDA contains the logic of using an expectation step, a maximization step and
  * some model parameters to train and make use of an LDA model.
@@ -44,7 +98,9 @@ class LDA
          *
          * @param model_parameters A pointer to a struct containing the model
          *                         parameters (for instance ModelParameters and
-         *                         SupervisedModelParameters)
+         *                         SupervisedModelParameters or a read-only
+         *                         ModelParametersView that can transform but
+         *                         not fit)
          * @param e_step           A pointer to an expectation step
          *                         implementation
          * @param m_step           A pointer to a maximization step
@@ -53,13 +109,15 @@ class LDA
          *                         LDA::fit
          * @param workers          The number of worker threads to create for
          *                         computing the expectation step
+         * @param options          The optional behaviour (see LDAOptions)
          */
         LDA(
             std::shared_ptr<parameters::Parameters> model_parameters,
             std::shared_ptr<em::EStepInterface<Scalar> > e_step,
             std::shared_ptr<em::MStepInterface<Scalar> > m_step,
             size_t iterations = 20,
-            size_t workers = 1
+            size_t workers = 1,
+            const LDAOptions<Scalar> &options = LDAOptions<Scalar>()
         );
 
         /**
@@ -71,7 +129,8 @@ class LDA
          * Compute a supervised topic model for word counts X and classes y.
          *
          * Perform as many EM iterations as configured and stop when reaching
-         * max_iter_ or any other stopping criterion.
+         * max_iter_ or any other stopping criterion. Before returning wait
+         * for the likelihood evaluation of the last epoch (if any).
          *
          * An EigenClassificationCorpus will be created from the passed
          * parameters.
@@ -85,7 +144,8 @@ class LDA
          * Compute an unsupervised topic model for word counts X.
          *
          * Perform as many EM iterations as configured and stop when reaching
-         * max_iter_ or any other stopping criterion.
+         * max_iter_ or any other stopping criterion. Before returning wait
+         * for the likelihood evaluation of the last epoch (if any).
          *
          * An EigenCorpus will be created from the passed
          * parameters.
@@ -94,6 +154,37 @@ class LDA
          */
         void fit(const Eigen::MatrixXi &X);
 
+        /**
+         * Compute a topic model for the documents of the corpus.
+         *
+         * Perform as many epochs as configured either one LDA::partial_fit
+         * at a time or in cycles of LDA::squarem when the extrapolation is
+         * enabled.
+         *
+         * If a tolerance is set, stop earlier when the relative increase of
+         * the likelihood falls below it. The likelihood is either
+         *
+         * - the likelihood of the evaluated documents of the
+         *   LikelihoodEvaluator (waiting for its evaluation after every
+         *   epoch) or
+         * - the bound of the training documents, namely
+         *   LDA::epoch_likelihood (the E step should compute the likelihood
+         *   of some documents otherwise a std::runtime_error is thrown after
+         *   the first epoch). Every epoch computes it for the parameters it
+         *   starts from so the check lags one epoch behind. When the E step
+         *   computes it for a random subset of the documents the bounds of
+         *   two epochs are sums over different documents, whose difference
+         *   is noise rather than progress, so the check is skipped unless
+         *   every document of the epoch has a likelihood.
+         *
+         * Only an increase smaller than the tolerance stops the training, a
+         * likelihood that decreased is not a sign of convergence.
+         *
+         * @param corpus The implementation of Corpus that contains the
+         *               observed variables.
+         */
+        void fit(std::shared_ptr<corpus::Corpus> corpus);
+
         /**
          * Perform a single EM iteration.
          *
@@ -108,33 +199,251 @@ class LDA
         /**
          * Perform a single EM iteration.
          *
+         * In deterministic mode the ith document is always processed by the
+         * worker i % workers and the online part of the maximization step
+         * consumes the documents in order, thus a fit produces bit identical
+         * models regardless of the number of workers and thread timing. The
+         * only exception are maximization steps that update the model during
+         * doc_m_step (for instance FastOnlineSupervisedMStep) since the
+         * workers read the model while it changes.
+         *
          * @param corpus The implementation of Corpus that contains the
          *               observed variables.
          */
         void partial_fit(std::shared_ptr<corpus::Corpus> corpus);
 
+        /**
+         * Perform a single EM iteration using only the documents [begin,
+         * end) of the corpus in their current order.
+         *
+         * Nothing else of the corpus is shuffled or queued, which makes it
+         * suitable for feeding a stream of minibatches, for instance to a
+         * FastOnlineSupervisedMStep. Every call is an epoch as far as the
+         * events and the LikelihoodEvaluator are concerned.
+         *
+         * @param corpus The implementation of Corpus that contains the
+         *               observed variables.
+         * @param begin  The index of the first document
+         * @param end    One past the index of the last document
+         */
+        void partial_fit(
+            std::shared_ptr<corpus::Corpus> corpus,
+            size_t begin,
+            size_t end
+        );
+
+        /**
+         * Perform one cycle of the SQUAREM extrapolation (the S3 scheme of
+         * Varadhan and Roland 2008) on the model parameters.
+         *
+         * Two epochs take the parameters \f$\theta_0\f$ to \f$\theta_1\f$
+         * and \f$\theta_2\f$, then the parameters are extrapolated to
+         *
+         *     \theta' = \theta_0 - 2a r + a^2 v
+         *
+         * where \f$r = \theta_1 - \theta_0\f$, \f$v = \theta_2 - 2\theta_1
+         * + \theta_0\f$ and \f$a = -\|r\| / \|v\|\f$, and a third epoch
+         * starts from \f$\theta'\f$. The extrapolated parameters are
+         * \f$\beta\f$ and \f$\eta\f$ (when the model has one). The
+         * entries of \f$\beta\f$ that the extrapolation makes nonpositive
+         * keep their value from \f$\theta_2\f$ and its rows are
+         * renormalized. So are the rows of \f$\eta\f$ when the
+         * maximization step normalizes them (see
+         * MStepInterface::normalizes_eta) otherwise \f$\eta\f$ is
+         * extrapolated as is.
+         *
+         * With a LikelihoodEvaluator the likelihood of the evaluated
+         * documents for \f$\theta'\f$ and \f$\theta_2\f$ is computed
+         * (\f$\eta\f$ is not part of it) and the third epoch starts from
+         * the better one.
+         *
+         * Otherwise the bound of the third epoch (see LDA::epoch_likelihood),
+         * namely the bound of \f$\theta'\f$, is compared with the last
+         * accepted bound \f$L(\theta_1)\f$ (the bound of \f$\theta_2\f$
+         * is unknown). If it is smaller the model falls back to
+         * \f$\theta_2\f$, the third epoch is lost and LDA::epoch_likelihood
+         * keeps \f$L(\theta_1)\f$. The bounds of different epochs are only
+         * comparable when they are computed over the same documents so a
+         * std::runtime_error is thrown if the E step does not compute the
+         * likelihood of every document.
+         *
+         * The extrapolation assumes that the maximization step updates the
+         * model only in MStepInterface::m_step.
+         *
+         * @param corpus The implementation of Corpus that contains the
+         *               observed variables.
+         * @return The number of epochs performed (2 when the step length
+         *         would not extrapolate beyond \f$\theta_2\f$ otherwise 3)
+         */
+        size_t squarem(std::shared_ptr<corpus::Corpus> corpus);
+
+        /**
+         * Return the mean of the likelihoods of the documents reported by
+         * the E step through ExpectationProgressEvent during the last epoch
+         * (weighted by the copies each document stands for) or NaN if none
+         * was computed.
+         *
+         * The likelihoods are only collected when LDA::fit uses them, namely
+         * for LDA::squarem without a LikelihoodEvaluator and for a
+         * tolerance that is not measured on the held out documents,
+         * otherwise it is always NaN.
+         *
+         * It is the bound for the model at the start of the epoch.
+         */
+        Scalar epoch_likelihood() const {
+            return epoch_likelihood_;
+        }
+
+        /**
+         * Wait for the LikelihoodEvaluator (if any) to evaluate every model
+         * it has received and dispatch its events.
+         *
+         * LDA::fit calls it at the end, when calling partial_fit the events
+         * of an epoch are dispatched during a later epoch unless this method
+         * is called.
+         */
+        void wait_for_evaluation();
+
         /**
          * Run the expectation step and return the topic mixtures for the
          * documents defined by the word counts X.
          *
+         * This and every other method that accepts documents throw
+         * std::invalid_argument if X does not have a row per word of the
+         * model (or, with a FeatureHasher, if the model does not have a word
+         * per hash bucket).
+         *
          * @param  X The word counts in column-major order
          * @return The variational parameter \f$\gamma\f$ for every document
          *         that approximates the count of words generated by each topic
          */
         MatrixX transform(const Eigen::MatrixXi &X);
 
+        /**
+         * Run the expectation step on a stream of documents one chunk at a
+         * time so that only a few chunks of the input and the output are in
+         * memory at any time.
+         *
+         * The workers are kept busy across the chunks, the next chunks are
+         * read and queued while the documents of the current one are
+         * inferred and the current one is passed to the sink while the
+         * workers infer the next (see LDA::stream_e_step). Chunks of a few
+         * hundred documents or more amortize the work done per chunk.
+         *
+         * Example:
+         *
+         *     numpy_format::NumpyInputStream<int> in("data.npy");
+         *     numpy_format::NumpyOutputStream<double> out("gammas.npy", K);
+         *     lda.transform(
+         *         [&in](Eigen::MatrixXi &X) { return in.read(X, 10000); },
+         *         [&out](const Eigen::MatrixXd &gammas) { out.write(gammas); }
+         *     );
+         *
+         * @param source Fills its argument with the word counts of the next
+         *               chunk of documents in column-major order and returns
+         *               false when there are no more documents
+         * @param sink   Receives the \f$\gamma\f$ of every chunk in the
+         *               order of the documents
+         */
+        void transform(
+            std::function<bool(Eigen::MatrixXi &)> source,
+            std::function<void(const MatrixX &)> sink
+        );
+
+        /**
+         * Run the expectation step and keep only the largest topic
+         * proportions of every document.
+         *
+         * The worker threads normalize \f$\gamma\f$ to the expected topic
+         * proportions and select the (at most) k largest ones that are
+         * greater than the threshold, so only the selected entries are passed
+         * back to the calling thread.
+         *
+         * @param  X         The word counts in column-major order
+         * @param  k         The maximum number of topics per document (0
+         *                   means no limit)
+         * @param  threshold The minimum topic proportion to keep
+         * @return A topics x documents column major sparse matrix, namely
+         *         each document is compressed like a row of a CSR matrix
+         */
+        Eigen::SparseMatrix<Scalar> transform_sparse(
+            const Eigen::MatrixXi &X,
+            size_t k,
+            Scalar threshold = 0
+        );
+
+        /**
+         * Like LDA::transform_sparse for a stream of documents (see the
+         * streaming LDA::transform).
+         */
+        void transform_sparse(
+            std::function<bool(Eigen::MatrixXi &)> source,
+            std::function<void(const Eigen::SparseMatrix<Scalar> &)> sink,
+            size_t k,
+            Scalar threshold = 0
+        );
+
+        /**
+         * Compute the document completion perplexity of the documents defined
+         * by the word counts X.
+         *
+         * The tokens of every document are split randomly in an observed and
+         * a held out part. The expectation step (as in LDA::transform) infers
+         * the topic mixture \f$\theta\f$ from the observed part and the
+         * likelihood of every held out word w is computed as
+         * \f$\log \sum_k \theta_k \beta_{kw}\f$ using only the words that
+         * appear in the held out part. The tokens are split over the non zero
+         * counts of every document and only the non zero observed and held
+         * out counts are kept. The E steps read dense word counts so the
+         * observed part of a document is expanded in a vector of V counts
+         * when a worker takes it, which allocates one such vector per
+         * document in flight instead of a copy of X.
+         *
+         * Like LDA::transform it throws std::invalid_argument if X does not
+         * have a row per word of the model.
+         *
+         * Like every other method the documents are inferred by a pool of
+         * workers that exists only for the duration of the call. The pool
+         * is not kept between calls since the workers run methods of this
+         * LDA which would be left dangling by the move constructor, the
+         * cost of starting it is paid once per call and not per document.
+         *
+         * Held out words with zero probability under the model (for instance
+         * words never seen during training) would make the perplexity
+         * infinite so they are counted as unseen and left out of the
+         * perplexity instead.
+         *
+         * An EvaluationProgressEvent is dispatched with the total held out
+         * likelihood, the number of held out words and the number of the
+         * unseen ones.
+         *
+         * @param  X            The word counts in column-major order
+         * @param  observed     The probability of a token being observed
+         *                      (in (0, 1))
+         * @param  random_state The seed for splitting the tokens
+         * @return The perplexity of the held out words
+         */
+        Scalar evaluate(
+            const Eigen::MatrixXi &X,
+            Scalar observed = 0.5,
+            int random_state = 0
+        );
+
         /**
          * Treat the SupervisedModelParameters::eta as a linear model and
          * compute the distances from the planes of the documents in the topic
          * space.
          *
-         * Use LDA::transform to obtain the \f$\gamma\f$ for every document and
-         * then assume that the \f$\eta\f$ parameters of the
+         * Compute the \f$\gamma\f$ for every document like LDA::transform
+         * and then assume that the \f$\eta\f$ parameters of the
          * SupervisedModelParameters are a linear model. Compute the dot
          * product between the normal vectors and the normalized topic mixtures
          * for each document. The more positive the value for a given class the
          * more confident is the model that a document belongs in this class.
          *
+         * The scores are computed by the worker threads right after the
+         * expectation step so the \f$\gamma\f$ are never collected.
+         *
          * @param  X The word counts in column-major order
          * @return A matrix of class scores (positive => confident) for each
          *         document
@@ -144,8 +453,9 @@ class LDA
         /**
          * Use the model to predict the class indexes for the word counts X.
          *
-         * Use LDA::decision_function to get class scores and then compute the
-         * *argmax* for every document.
+         * Compute the class scores like LDA::decision_function and then the
+         * *argmax* for every document. Everything happens in the worker
+         * threads which return only the class index of every document.
          *
          * @param  X The word counts in column-major order
          * @return A matrix of class indexes (the predicted class for each
@@ -157,6 +467,9 @@ class LDA
          * Return both the class predictions and the transformed data using a
          * single LDA expectation step.
          *
+         * Like LDA::predict the worker threads compute the predictions and
+         * return them together with the \f$\gamma\f$ of every document.
+         *
          * @param  X The word counts in column-major order
          * @return A tuple containing a matrix with the \f$\gamma\f$
          *         variational parameters for every document and a vector
@@ -185,7 +498,16 @@ class LDA
 
     protected:
         /**
-         * Generate a Corpus from a pair of X, y matrices
+         * Throw std::invalid_argument unless the documents have a row per
+         * word of the model (with a FeatureHasher, unless the model has a
+         * word per bucket) since the E steps index beta with the rows.
+         */
+        void check_words(const Eigen::MatrixXi &X);
+
+        /**
+         * Generate a Corpus from a pair of X, y matrices (an
+         * EigenDeduplicatedCorpus if the documents are deduplicated and
+         * with the words hashed if there is a FeatureHasher)
          */
         std::shared_ptr<corpus::Corpus> get_corpus(
             const Eigen::MatrixXi &X,
@@ -194,9 +516,19 @@ class LDA
 
         /**
          * Generate a Corpus from just the word count matrix.
+         *
+         * Both get_corpus() check the rows of X (see check_words) so every
+         * public method that accepts documents does.
          */
         std::shared_ptr<corpus::Corpus> get_corpus(const Eigen::MatrixXi &X);
 
+        /**
+         * For every column of the matrix a deduplicated corpus was created
+         * from, the index of the document that stands for it. It is used to
+         * fan the per document results back out.
+         */
+        const Eigen::VectorXi & document_index(std::shared_ptr<corpus::Corpus> corpus);
+
         /**
          * Create a worker thread pool.
          */
@@ -207,6 +539,48 @@ class LDA
          */
         void destroy_worker_pool();
 
+        /**
+         * Stop the workers dropping the documents that are still queued and
+         * the results that were not extracted, for instance when a job is
+         * interrupted by an exception. worker_output_ is reset as well.
+         */
+        void abort_worker_pool();
+
+        /**
+         * WorkerPoolScope guards a job of the worker pool so that, however
+         * the job exits, the workers are stopped, the queues are left empty
+         * and worker_output_ is reset for the next job.
+         *
+         * start() creates the pool once the documents are queued and
+         * finish() waits for the workers when the job completes, otherwise
+         * the destructor aborts them (see abort_worker_pool).
+         */
+        class WorkerPoolScope
+        {
+            public:
+                WorkerPoolScope(LDA &lda) : lda_(lda), finished_(false) {}
+                ~WorkerPoolScope() {
+                    if (!finished_) {
+                        lda_.abort_worker_pool();
+                    }
+                }
+
+                WorkerPoolScope(const WorkerPoolScope &) = delete;
+                WorkerPoolScope & operator=(const WorkerPoolScope &) = delete;
+
+                void start() { lda_.create_worker_pool(); }
+                void finish() {
+                    finished_ = true;
+                    lda_.close_input_queue();
+                    lda_.destroy_worker_pool();
+                    lda_.worker_output_ = nullptr;
+                }
+
+            private:
+                LDA &lda_;
+                bool finished_;
+        };
+
         /**
          * Forward the events generated in the worker threads to this event
          * dispatcher in this thread.
@@ -218,31 +592,109 @@ class LDA
         }
 
         /**
-         * Extract the variational parameters and the document index from the
-         * worker queue.
+         * Return the queue slot that the ith document of a job uses.
+         *
+         * In deterministic mode every worker has its own input and output
+         * queue otherwise all the workers share the slot 0.
          */
-        std::tuple<std::shared_ptr<parameters::Parameters>, size_t> extract_vp_from_queue();
+        size_t queue_slot(size_t i) {
+            return (deterministic_) ? i % workers_.size() : 0;
+        }
 
         /**
-         * A doc_e_step worker thread.
+         * Queue the ith document of the corpus for a worker.
          */
-        void doc_e_step_worker();
+        void queue_document(std::shared_ptr<corpus::Corpus> corpus, size_t i) {
+            queue_document(corpus, i, i);
+        }
 
         /**
-         * Implement the decision function using already transformed data.
-         * Topic representations instead of BOW.
+         * Queue the ith document of the corpus for a worker which reports
+         * its result with the given id instead of i (see
+         * extract_vp_from_queue). The id selects the queue slot as well.
+         */
+        void queue_document(std::shared_ptr<corpus::Corpus> corpus, size_t i, size_t id);
+
+        /**
+         * Queue every document of the corpus, the ith with the id
+         * first_id + i, taking the lock and waking the workers once.
+         */
+        void queue_documents(std::shared_ptr<corpus::Corpus> corpus, size_t first_id);
+
+        /**
+         * While the input queue is open the workers wait for more documents
+         * when it is empty instead of exiting.
+         */
+        void open_input_queue();
+
+        /**
+         * Let the workers exit once the input queue is empty.
          *
-         * @param X The \f$\gamma\f$ variational parameter for each document in
-         *          a column-major ordered matrix.
-         * @return A matrix of class scores (positive => confident) for each
-         *         document
+         * @param discard Drop the documents that are still queued as well
          */
-        MatrixX decision_function(const MatrixX &X);
+        void close_input_queue(bool discard = false);
 
         /**
-         * Transform the decision function to class predictions.
+         * Run the expectation step on a stream of chunks of documents
+         * without stopping the workers between the chunks.
+         *
+         * The following chunks are read and queued before the results of
+         * the current one are collected, at least one of them and enough
+         * to queue 64 documents per worker, so the workers keep
+         * inferring while the source and the sink run even when the chunks
+         * are small. Every chunk still costs a corpus, a lock and a wake up
+         * of the workers, and a call to the source and the sink, so chunks
+         * of a few hundred documents or more amortize that best. The
+         * results in flight are bounded like in any other job.
+         *
+         * The workers apply worker_output_ (if any) to every result and it
+         * is reset once the stream ends.
+         *
+         * @param source Fills its argument with the next chunk and returns
+         *               false when there are no more documents
+         * @param sink   Receives every chunk and the results for each of
+         *               its columns in order
          */
-        Eigen::VectorXi predict(const MatrixX &scores);
+        void stream_e_step(
+            std::function<bool(Eigen::MatrixXi &)> source,
+            std::function<void(
+                const Eigen::MatrixXi &,
+                const std::vector<std::shared_ptr<parameters::Parameters> > &
+            )> sink
+        );
+
+        /**
+         * Extract the variational parameters and the document index (or the
+         * id it was queued with) from the worker queue.
+         *
+         * @param slot The output queue to extract from (see queue_slot)
+         */
+        std::tuple<std::shared_ptr<parameters::Parameters>, size_t> extract_vp_from_queue(size_t slot);
+
+        /**
+         * A doc_e_step worker thread.
+         *
+         * @param worker The index of the worker in the pool
+         */
+        void doc_e_step_worker(size_t worker);
+
+        /**
+         * Run the expectation step, the decision function and the argmax for
+         * every document in the worker threads.
+         *
+         * @param X           The word counts in column-major order
+         * @param predictions The class index of every document (output)
+         * @param scores      If not null the class scores of every document
+         *                    (output)
+         * @param gammas      If not null the \f$\gamma\f$ of every
+         *                    document (output)
+         */
+        void fused_predict(
+            const Eigen::MatrixXi &X,
+            Eigen::VectorXi &predictions,
+            MatrixX *scores,
+            MatrixX *gammas = nullptr
+        );
 
 
     private:
@@ -252,6 +704,15 @@ class LDA
          */
         void set_up_event_dispatcher();
 
+        /**
+         * Whether LDA::fit uses the likelihood of the training documents
+         * (see LDA::epoch_likelihood).
+         */
+        bool uses_training_likelihood() const {
+            return (squarem_ && !evaluator_) ||
+                (tolerance_ > 0 && !(held_out_ && evaluator_));
+        }
+
         // The model parameters
         std::shared_ptr<parameters::Parameters> model_parameters_;
 
@@ -261,14 +722,58 @@ class LDA
 
         // Member variables that affect the behaviour of fit
         size_t iterations_;
+        bool squarem_;
+        Scalar tolerance_;
+        bool held_out_;
+
+        // Whether the corpora we create collapse identical documents and
+        // hash the words
+        bool deduplicate_;
+        std::shared_ptr<corpus::FeatureHasher> hasher_;
 
         // The thread related member variables
         std::vector<std::thread> workers_;
+        bool deterministic_;
         std::mutex queue_in_mutex_;
-        std::list<std::tuple<std::shared_ptr<corpus::Corpus>, size_t> > queue_in_;
+        std::condition_variable queue_in_cv_;
+        bool queue_in_open_;
+        std::vector<std::list<std::tuple<std::shared_ptr<corpus::Corpus>, size_t, size_t> > > queue_in_;
         std::mutex queue_out_mutex_;
         std::condition_variable queue_out_cv_;
-        std::list<std::tuple<std::shared_ptr<parameters::Parameters>, size_t> > queue_out_;
+        std::condition_variable queue_out_space_cv_;
+        std::vector<std::list<std::tuple<std::shared_ptr<parameters::Parameters>, size_t> > > queue_out_;
+        size_t queue_out_capacity_;
+        // The first exception thrown by a worker, rethrown by
+        // extract_vp_from_queue (guarded by queue_out_mutex_)
+        std::exception_ptr worker_error_;
+
+        // The time each worker spent in doc_e_step(), the documents it
+        // processed and a histogram of the time per document during the
+        // current epoch (every worker only writes to its own element)
+        std::vector<std::chrono::steady_clock::duration> worker_e_step_time_;
+        std::vector<size_t> worker_documents_;
+        std::vector<std::vector<size_t> > worker_e_step_latency_;
+
+        // An optional function applied by the workers to the variational
+        // parameters of every document before they are queued
+        std::function<
+            std::shared_ptr<parameters::Parameters>(std::shared_ptr<parameters::Parameters>)
+        > worker_output_;
+
+        // The hardware counters measured around doc_e_step() by each worker
+        // (only when compiled with LDAPLUSPLUS_PERF_COUNTERS)
+        std::vector<perf_utils::CounterValues> worker_e_step_counters_;
+
+        // The optional likelihood evaluation and the epochs so far
+        std::shared_ptr<LikelihoodEvaluator<Scalar> > evaluator_;
+        size_t epochs_;
+
+        // The mean likelihood of the documents, the number of documents it
+        // was computed for during the last epoch and whether that was every
+        // document of the epoch (instead of a random subset)
+        Scalar epoch_likelihood_;
+        size_t epoch_likelihoods_;
+        bool epoch_likelihood_complete_;
 
         // An event dispatcher that we will use to communicate with the
         // external components
@@ -12,7 +12,9 @@
 #include "ldaplusplus/em/FastSupervisedEStep.hpp"
 #include "ldaplusplus/em/EStepInterface.hpp"
 #include "ldaplusplus/em/MStepInterface.hpp"
+#include "ldaplusplus/em/UnsupervisedEStep.hpp"
 #include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/LikelihoodEvaluator.hpp"
 
 namespace ldaplusplus {
 
@@ -83,6 +85,58 @@ class LDABuilder : public LDABuilderInterface<Scalar>
         /** Choose a number of parallel workers for the expectation step */
         LDABuilder & set_workers(size_t workers);
 
+        /**
+         * Choose whether the parallel workers should produce bit identical
+         * results regardless of thread timing (see LDA::partial_fit).
+         */
+        LDABuilder & set_deterministic(bool deterministic = true);
+
+        /**
+         * Choose whether LDA::fit should extrapolate the model parameters
+         * across epochs to converge in fewer passes over the corpus (see
+         * LDA::squarem).
+         */
+        LDABuilder & set_squarem(bool squarem = true);
+
+        /**
+         * Stop LDA::fit before the configured iterations when the relative
+         * increase of the likelihood after an epoch is less than tolerance.
+         *
+         * Without held_out the E step should compute the likelihood of some
+         * documents, and with it an evaluator should be set, otherwise
+         * LDA::fit and the LDA constructor respectively throw a
+         * std::runtime_error.
+         *
+         * @param tolerance The minimum relative increase of the likelihood
+         *                  (0 disables the check)
+         * @param held_out  Use the likelihood computed by the evaluator (see
+         *                  set_likelihood_evaluator) instead of the bound
+         *                  reported by the E step for the training documents
+         */
+        LDABuilder & set_convergence_tolerance(Scalar tolerance, bool held_out = false);
+
+        /**
+         * Choose whether the LDA should collapse identical documents to a
+         * single document weighted by the number of copies, so that the E
+         * step runs once for all of them (see
+         * corpus::EigenDeduplicatedCorpus).
+         */
+        LDABuilder & set_deduplicate(bool deduplicate = true);
+
+        /**
+         * Hash the words of the documents into a fixed number of buckets so
+         * that the size of the model does not depend on the vocabulary (see
+         * corpus::FeatureHasher).
+         *
+         * It should be called before the initialize_topics_* and
+         * set_likelihood_evaluator methods that receive documents since they
+         * hash them as well. initialize_topics_random ignores the number of
+         * words and uses the number of buckets.
+         *
+         * @param buckets The number of buckets (0 disables the hashing)
+         */
+        LDABuilder & set_feature_hashing(int buckets);
+
         /**
          * Create an UnsupervisedEStep.
          *
@@ -99,12 +153,17 @@ class LDABuilder : public LDABuilderInterface<Scalar>
          *                           every document)
          * @param random_state       An initial seed value for any random
          *                           numbers needed
+         * @param squarem            Extrapolate the fixed point iteration
+         *                           on \f$\gamma\f$ to perform fewer
+         *                           iterations per document (see
+         *                           AbstractEStep::squarem)
          */
         std::shared_ptr<em::EStepInterface<Scalar> > get_classic_e_step(
             size_t e_step_iterations = 10,
             Scalar e_step_tolerance = 1e-2,
             Scalar compute_likelihood = 1.0,
-            int random_state = 0
+            int random_state = 0,
+            bool squarem = false
         );
         /**
          * See the corresponding get_*_e_step() method.
@@ -113,14 +172,16 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             size_t e_step_iterations = 10,
             Scalar e_step_tolerance = 1e-2,
             Scalar compute_likelihood = 1.0,
-            int random_state = 0
+            int random_state = 0,
+            bool squarem = false
         ) {
             e_requires_eta_ = false;
             return set_e(get_classic_e_step(
                 e_step_iterations,
                 e_step_tolerance,
                 compute_likelihood,
-                random_state
+                random_state,
+                squarem
             ));
         }
 
@@ -673,6 +734,56 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             return *this;
         }
 
+        /**
+         * Create a LikelihoodEvaluator that computes the likelihood of a
+         * random sample of the documents X after every epoch in a low
+         * priority thread.
+         *
+         * @param X                 The word counts of the documents (for
+         *                          instance held out documents or the
+         *                          training documents)
+         * @param sample            The fraction of the documents to evaluate
+         * @param e_step_iterations The max number of iterations for inferring
+         *                          the variational parameters
+         * @param e_step_tolerance  The minimum mean change of \f$\gamma\f$
+         *                          to keep iterating
+         * @param random_state      The initial state of the random number
+         *                          generator used for sampling
+         */
+        std::shared_ptr<LikelihoodEvaluator<Scalar> > get_likelihood_evaluator(
+            const Eigen::MatrixXi &X,
+            Scalar sample = 1.0,
+            size_t e_step_iterations = 20,
+            Scalar e_step_tolerance = 1e-3,
+            int random_state = 0
+        );
+        /**
+         * See get_likelihood_evaluator().
+         */
+        LDABuilder & set_likelihood_evaluator(
+            const Eigen::MatrixXi &X,
+            Scalar sample = 1.0,
+            size_t e_step_iterations = 20,
+            Scalar e_step_tolerance = 1e-3,
+            int random_state = 0
+        ) {
+            return set_evaluator(get_likelihood_evaluator(
+                X,
+                sample,
+                e_step_iterations,
+                e_step_tolerance,
+                random_state
+            ));
+        }
+
+        /**
+         * Set a likelihood evaluator or remove it by passing nullptr.
+         */
+        LDABuilder & set_evaluator(std::shared_ptr<LikelihoodEvaluator<Scalar> > evaluator) {
+            options_.evaluator = evaluator;
+            return *this;
+        }
+
         /**
          * Initialize the topic over words distributions by seeding them from
          * the passed in documents.
@@ -748,6 +859,22 @@ class LDABuilder : public LDABuilderInterface<Scalar>
             return *this;
         }
 
+        /**
+         * Use a read-only view of a model, for instance a mapped model file
+         * (see model_file::map_parameters), without copying it.
+         *
+         * The built LDA can only transform documents (and predict if the
+         * view has an eta) with the classic unsupervised E step. The view
+         * replaces any other initialize_topics_* and initialize_eta_*.
+         */
+        LDABuilder & initialize_from_view(
+            std::shared_ptr<parameters::ModelParametersView<Scalar> > model
+        ) {
+            model_view_ = model;
+
+            return *this;
+        }
+
         /**
          * Initialize the supervised model parameters which generate the class
          * label with zeros.
@@ -786,6 +913,23 @@ class LDABuilder : public LDABuilderInterface<Scalar>
          * unusable LDA instance and throws a runtime_error. 
          */
         virtual operator LDA<Scalar>() const override {
+            if (model_view_) {
+                if (!std::dynamic_pointer_cast<em::UnsupervisedEStep<Scalar> >(e_step_)) {
+                    throw std::runtime_error("A read-only view of a model can "
+                                             "only be used with the classic "
+                                             "unsupervised E step.");
+                }
+
+                return LDA<Scalar>(
+                    model_view_,
+                    e_step_,
+                    m_step_,
+                    iterations_,
+                    workers_,
+                    options_
+                );
+            }
+
             if (model_parameters_->beta.rows() == 0) {
                 throw std::runtime_error("You need to call initialize_topics before "
                                          "creating an LDA from the builder.");
@@ -805,7 +949,8 @@ class LDABuilder : public LDABuilderInterface<Scalar>
                 e_step_,
                 m_step_,
                 iterations_,
-                workers_
+                workers_,
+                options_
             );
         };
 
@@ -813,6 +958,7 @@ class LDABuilder : public LDABuilderInterface<Scalar>
         // generic lda parameters
         size_t iterations_;
         size_t workers_;
+        LDAOptions<Scalar> options_;
 
         // implementations
         std::shared_ptr<em::EStepInterface<Scalar> > e_step_;
@@ -820,6 +966,7 @@ class LDABuilder : public LDABuilderInterface<Scalar>
 
         // the model parameters
         std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > model_parameters_;
+        std::shared_ptr<parameters::ModelParametersView<Scalar> > model_view_;
 
         // A flag to keep track of having set EM steps that require the eta
         // model parameters.
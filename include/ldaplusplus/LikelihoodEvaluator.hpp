@@ -0,0 +1,135 @@
+#ifndef _LDAPLUSPLUS_LIKELIHOOD_EVALUATOR_HPP_
+#define _LDAPLUSPLUS_LIKELIHOOD_EVALUATOR_HPP_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/events/Events.hpp"
+#include "ldaplusplus/Parameters.hpp"
+
+namespace ldaplusplus {
+
+
+/**
+ * LikelihoodEvaluator computes the (unsupervised) likelihood of a fixed set
+ * of documents, for instance held out documents or a sample of the training
+ * documents, in a separate low priority thread.
+ *
+ * LDA passes it a copy of the model parameters at the end of every epoch so
+ * that the training workers never compute likelihoods themselves. The
+ * variational parameters of each document are inferred and the likelihood is
+ * computed using only the words that appear in the document (see
+ * e_step_utils::compute_unsupervised_likelihood_sparse).
+ *
+ * The result is dispatched as an EvaluationProgressEvent. If a new model
+ * arrives while the previous one is still being evaluated, the one waiting
+ * (if any) is replaced so that the evaluation never falls behind more than
+ * one epoch.
+ */
+template <typename Scalar = double>
+class LikelihoodEvaluator
+{
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    public:
+        /**
+         * @param X                 The word counts of the documents to
+         *                          evaluate in column-major order (only the
+         *                          non zero counts are copied)
+         * @param e_step_iterations The max number of iterations for inferring
+         *                          the variational parameters of a document
+         * @param e_step_tolerance  The minimum mean change of \f$\gamma\f$ to
+         *                          keep iterating
+         */
+        LikelihoodEvaluator(
+            const Eigen::MatrixXi &X,
+            size_t e_step_iterations = 20,
+            Scalar e_step_tolerance = 1e-3
+        );
+
+        /**
+         * Stop the evaluation thread discarding any model that has not been
+         * evaluated yet.
+         */
+        ~LikelihoodEvaluator();
+
+        LikelihoodEvaluator(const LikelihoodEvaluator &) = delete;
+        LikelihoodEvaluator & operator=(const LikelihoodEvaluator &) = delete;
+
+        /**
+         * Queue a model for evaluation and return immediately.
+         *
+         * @param epoch            The epoch to report in the event
+         * @param model_parameters The model (ModelParameters or any
+         *                         subclass) which is copied
+         */
+        void evaluate(size_t epoch, std::shared_ptr<parameters::Parameters> model_parameters);
+
+        /**
+         * Block until every queued model has been evaluated.
+         */
+        void wait();
+
+        /**
+         * Compute the sum of the likelihood of the documents for the model
+         * in the calling thread.
+         */
+        Scalar likelihood(const parameters::ModelParameters<Scalar> &model) const;
+
+        /** The number of documents that are evaluated */
+        size_t documents() const { return words_.size(); }
+
+        /** The number of words in the documents that are evaluated */
+        size_t total_words() const { return total_words_; }
+
+        void set_event_dispatcher(
+            std::shared_ptr<events::EventDispatcherInterface> dispatcher
+        );
+        std::shared_ptr<events::EventDispatcherInterface> get_event_dispatcher();
+
+    private:
+        /**
+         * Infer the variational parameters and compute the likelihood of the
+         * dth document.
+         */
+        Scalar document_likelihood(
+            size_t d,
+            const VectorX &alpha,
+            const MatrixX &beta
+        ) const;
+
+        /**
+         * The body of the evaluation thread.
+         */
+        void evaluation_thread();
+
+        // The non zero words and their counts for every document
+        std::vector<Eigen::VectorXi> words_;
+        std::vector<VectorX> counts_;
+        size_t total_words_;
+
+        size_t e_step_iterations_;
+        Scalar e_step_tolerance_;
+
+        // The evaluation thread and the model waiting for it
+        std::thread thread_;
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::shared_ptr<parameters::ModelParameters<Scalar> > pending_;
+        size_t pending_epoch_;
+        bool busy_;
+        bool stop_;
+
+        std::shared_ptr<events::EventDispatcherInterface> event_dispatcher_;
+};
+
+
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_LIKELIHOOD_EVALUATOR_HPP_
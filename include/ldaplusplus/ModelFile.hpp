@@ -0,0 +1,184 @@
+#ifndef _LDAPLUSPLUS_MODEL_FILE_HPP_
+#define _LDAPLUSPLUS_MODEL_FILE_HPP_
+
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <Eigen/Core>
+
+#include "ldaplusplus/Parameters.hpp"
+
+namespace ldaplusplus {
+namespace model_file {
+
+
+/**
+ * The binary model container is a 64 byte header followed by alpha, beta,
+ * eta and optionally log beta stored column-major in the native byte order,
+ * each one starting at a multiple of 64 bytes (the padding is zeros).
+ *
+ *     offset  size  field
+ *     0       8     magic "LDAPPMDL"
+ *     8       4     version (uint32)
+ *     12      4     scalar size in bytes, 4 or 8 (uint32)
+ *     16      8     topics K (uint64)
+ *     24      8     words V (uint64)
+ *     32      8     rows of eta (uint64)
+ *     40      8     columns of eta (uint64)
+ *     48      8     flags (uint64, see LOG_BETA)
+ *     56      8     hash buckets (uint64, 0 if the words are not hashed)
+ *
+ * The K x V beta is column-major so the K topic probabilities of every
+ * word are already contiguous (word-major) which is the access pattern of
+ * the E steps. Since there is nothing to parse the file can be mapped in
+ * memory and the arrays read in place (see MappedModel).
+ */
+const uint32_t VERSION = 1;
+
+/**
+ * The file also stores the K x V log(beta + 1e-44) after eta, which the
+ * likelihood of the E step uses instead of taking a logarithm per word.
+ */
+const uint64_t LOG_BETA = 1;
+
+/**
+ * Write the model parameters in the binary container. The precision of the
+ * file is the Scalar of the parameters (cast them to float to halve the
+ * size of the file).
+ *
+ * @param path  The file to write
+ * @param alpha The Dirichlet priors (K)
+ * @param beta  The topic over word distributions (K x V)
+ * @param eta   The classification parameters (possibly empty)
+ * @param flags LOG_BETA to store the logarithm of beta as well (it doubles
+ *              the size of the file)
+ * @param hash_buckets The buckets of the FeatureHasher the model was
+ *                     trained with (V) or 0 if it was trained without one
+ */
+template <typename Scalar>
+void save(
+    const std::string &path,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &alpha,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &beta,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &eta,
+    uint64_t flags = 0,
+    uint64_t hash_buckets = 0
+);
+
+/**
+ * Check whether a file starts with the magic of the binary container
+ * instead of, for instance, a numpy array.
+ */
+bool is_model_file(const std::string &path);
+
+
+/**
+ * MappedModel maps a binary model file read-only in memory.
+ *
+ * alpha(), beta(), eta() and log_beta() are views of the mapped pages
+ * without any copy so every process that maps the same file shares the one
+ * copy in the page cache. They require the Scalar to match the precision of
+ * the file. map_parameters() wraps them in model parameters that an LDA can
+ * transform documents with.
+ *
+ * parameters() on the other hand copies the arrays in new model parameters
+ * which can be trained further or converted to another precision.
+ *
+ * The views are valid for the lifetime of the MappedModel while the
+ * parameters are independent of it.
+ */
+class MappedModel
+{
+    template <typename Scalar>
+    using MatrixMap = Eigen::Map<const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> >;
+    template <typename Scalar>
+    using VectorMap = Eigen::Map<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> >;
+
+    public:
+        /**
+         * Map the file and validate its header and size.
+         */
+        MappedModel(const std::string &path);
+        ~MappedModel();
+
+        MappedModel(const MappedModel &) = delete;
+        MappedModel & operator=(const MappedModel &) = delete;
+
+        /**
+         * The size in bytes of the stored scalars (4 or 8).
+         */
+        size_t scalar_size() const { return scalar_size_; }
+
+        size_t topics() const { return topics_; }
+        size_t words() const { return words_; }
+
+        template <typename Scalar>
+        VectorMap<Scalar> alpha() const;
+        template <typename Scalar>
+        MatrixMap<Scalar> beta() const;
+        template <typename Scalar>
+        MatrixMap<Scalar> eta() const;
+        /**
+         * The stored log(beta + 1e-44) or an empty view if the file does
+         * not have it (see has_log_beta()).
+         */
+        template <typename Scalar>
+        MatrixMap<Scalar> log_beta() const;
+
+        bool has_log_beta() const { return (flags_ & LOG_BETA) != 0; }
+
+        /**
+         * The buckets the documents should be hashed into (see
+         * corpus::FeatureHasher) or 0 if the model has a word per word.
+         */
+        size_t hash_buckets() const { return hash_buckets_; }
+
+        /**
+         * Copy the mapped arrays in model parameters of any precision (the
+         * values are widened or narrowed when it differs from the file).
+         */
+        template <typename Scalar>
+        std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > parameters() const;
+
+    private:
+        template <typename Scalar>
+        const Scalar * array(size_t offset) const;
+
+        std::string path_;
+        const char * data_;
+        size_t size_;
+
+        size_t scalar_size_;
+        size_t topics_;
+        size_t words_;
+        size_t eta_rows_;
+        size_t eta_cols_;
+        uint64_t flags_;
+        size_t hash_buckets_;
+        size_t alpha_offset_;
+        size_t beta_offset_;
+        size_t eta_offset_;
+        size_t log_beta_offset_;
+};
+
+
+/**
+ * Map a binary model file in read-only model parameters whose arrays are
+ * views of the mapped pages (see LDABuilder::initialize_from_view). The
+ * MappedModel stays mapped while the parameters (or an LDA) hold them.
+ *
+ * @param path The file to map, Scalar should match its precision
+ */
+template <typename Scalar>
+std::shared_ptr<parameters::ModelParametersView<Scalar> > map_parameters(
+    const std::string &path
+);
+
+
+}  // namespace model_file
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_MODEL_FILE_HPP_
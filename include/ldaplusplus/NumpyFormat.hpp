@@ -2,9 +2,13 @@
 #define _LDAPLUSPLUS_NUMPY_FORMAT_HPP_
 
 
+#include <algorithm>
 #include <cstdint>
 #include <fstream>
+#include <limits>
 #include <memory>
+#include <sstream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -73,6 +77,150 @@ namespace numpy_format {
     }
 
 
+    namespace detail {
+        /**
+         * Write the magic string, the version and the header of a numpy
+         * array.
+         *
+         * The header is padded with spaces so that the total length is
+         * divisible by 16 and at least min_length bytes, which allows
+         * rewriting it in place with a different shape.
+         *
+         * @return The number of bytes written
+         */
+        inline size_t write_header(
+            std::ostream &os,
+            const std::string &dtype,
+            bool fortran,
+            const std::vector<size_t> &shape,
+            size_t min_length = 0
+        ) {
+            const uint8_t MAGIC_AND_VERSION[] = {
+                0x93, 0x4e, 0x55, 0x4d, 0x50, 0x59, 0x01, 0x00
+            };
+
+            // We need to create the header for the data which is a python literal
+            // string
+            std::ostringstream header;
+            header << "{'descr': '" << dtype << "',"
+                   << " 'fortran_order': " << (fortran ? "True" : "False") << ","
+                   << " 'shape': (";
+            for (auto d : shape) {
+                header << d << ", ";
+            }
+            header << ")}";
+
+            // Now we need to pad it with spaces until the total size of the magic +
+            // version + header_len + header is divisible by 16
+            while ((static_cast<size_t>(header.tellp()) + 11) % 16 ||
+                   static_cast<size_t>(header.tellp()) + 11 < min_length) {
+                header << " ";
+            }
+            header << "\n";
+
+            // Now we need to write the magic and version
+            os.write(reinterpret_cast<const char *>(MAGIC_AND_VERSION), 8);
+
+            // Write the header length in little endian no matter what
+            uint16_t header_len = header.tellp();
+            if (!is_big_endian()) {
+                os.write(reinterpret_cast<const char *>(&header_len), 2);
+            } else {
+                os.write(reinterpret_cast<const char *>(&header_len) + 1, 1);
+                os.write(reinterpret_cast<const char *>(&header_len), 1);
+            }
+
+            // Write the header
+            os << header.str();
+
+            return header_len + 10;
+        }
+
+
+        /**
+         * Read the magic string, the version and the header of a numpy array
+         * of type Scalar leaving the stream at the start of the data.
+         *
+         * @param is      The stream to read from
+         * @param shape   The shape of the array (output)
+         * @param fortran Whether the array is column major (output)
+         * @return Whether the data need to have their endianess swapped
+         */
+        template <typename Scalar>
+        bool read_header(std::istream &is, std::vector<size_t> &shape, bool &fortran) {
+            shape.clear();
+
+            // read the magic and the version and assert that it is compatible
+            char MAGIC_AND_VERSION[8];
+            is.read(MAGIC_AND_VERSION, 8);
+            if (MAGIC_AND_VERSION[6] > 1) {
+                throw std::runtime_error(
+                    "Only version 1 of the numpy format is supported"
+                );
+            }
+
+            // if the file is empty (aka we read nothing) just throw a
+            // runtime error
+            if (is.gcount() == 0) {
+                throw std::runtime_error(
+                    "The file is empty and cannot be read"
+                );
+            }
+
+            // read the header len
+            uint16_t header_len;
+            is.read(reinterpret_cast<char *>(&header_len), 2);
+            if (is_big_endian()) {
+                swap_endianess(&header_len, 1);
+            }
+
+            // read the header
+            std::vector<char> buffer(header_len+1);
+            is.read(&buffer[0], header_len);
+            buffer[header_len] = 0;
+            std::string header(&buffer[0]);
+
+            // we can parse the header efficiently using the fact that the
+            // specification requires the dictionary to be passed by
+            // pprint.pformat()
+
+            // parse dtype info
+            std::string dtype = header.substr(11, 3);
+            bool endianness = dtype[0] == '>';
+            if (dtype.substr(1) != dtype_for_scalar<Scalar>()) {
+                throw std::runtime_error(
+                    std::string() + 
+                    "The type of the array is not the " +
+                    "one requested: " + dtype.substr(1) +
+                    " != " + dtype_for_scalar<Scalar>()
+                );
+            }
+
+            // parse contiguity type
+            fortran = header[34] == 'T';
+
+            // parse shape
+            std::string shape_string = header.substr(
+                header.find_last_of('(')+1,
+                header.find_last_of(')')
+            );
+            try {
+                while (true) {
+                    size_t processed;
+                    shape.push_back(std::stoi(shape_string, &processed));
+
+                    // +2 to account for the comma and the space
+                    shape_string = shape_string.substr(processed + 2);
+                }
+            } catch (const std::invalid_argument&) {
+                // that's ok it means we finished parsing the tuple
+            }
+
+            return endianness != is_big_endian();
+        }
+    }  // namespace detail
+
+
     /**
      * NumpyOutput provides an easy way to serialize a contiguous array using
      * the numpy format.
@@ -150,42 +298,12 @@ namespace numpy_format {
              * Scalar.
              */
             friend std::ostream & operator<<(std::ostream &os, const NumpyOutput &data) {
-                const uint8_t MAGIC_AND_VERSION[] = {
-                    0x93, 0x4e, 0x55, 0x4d, 0x50, 0x59, 0x01, 0x00
-                };
-
-                // We need to create the header for the data which is a python literal
-                // string
-                std::ostringstream header;
-                header << "{'descr': '" << data.dtype() << "',"
-                       << " 'fortran_order': " << (data.fortran_contiguous() ? "True" : "False") << ","
-                       << " 'shape': (";
-                for (auto d : data.shape()) {
-                    header << d << ", ";
-                }
-                header << ")}";
-
-                // Now we need to pad it with spaces until the total size of the magic +
-                // version + header_len + header is divisible by 16
-                while ((static_cast<size_t>(header.tellp()) + 11) % 16) {
-                    header << " ";
-                }
-                header << "\n";
-
-                // Now we need to write the magic and version
-                os.write(reinterpret_cast<const char *>(MAGIC_AND_VERSION), 8);
-
-                // Write the header length in little endian no matter what
-                uint16_t header_len = header.tellp();
-                if (!is_big_endian()) {
-                    os.write(reinterpret_cast<const char *>(&header_len), 2);
-                } else {
-                    os.write(reinterpret_cast<const char *>(&header_len) + 1, 1);
-                    os.write(reinterpret_cast<const char *>(&header_len), 1);
-                }
-
-                // Write the header
-                os << header.str();
+                detail::write_header(
+                    os,
+                    data.dtype(),
+                    data.fortran_contiguous(),
+                    data.shape()
+                );
 
                 // Finally write the data
                 size_t N = 1;
@@ -272,95 +390,233 @@ namespace numpy_format {
             friend std::istream & operator>>(std::istream &is, NumpyInput &data) {
                 // reset the NumpyInput instance
                 data.data_.clear();
-                data.shape_.clear();
+                bool swap = detail::read_header<Scalar>(is, data.shape_, data.fortran_);
 
-                // read the magic and the version and assert that it is compatible
-                char MAGIC_AND_VERSION[8];
-                is.read(MAGIC_AND_VERSION, 8);
-                if (MAGIC_AND_VERSION[6] > 1) {
-                    throw std::runtime_error(
-                        "Only version 1 of the numpy format is supported"
-                    );
+                // compute the total size of the data
+                int N = 1;
+                for (auto c : data.shape_) {
+                    N *= c;
                 }
 
-                // if the file is empty (aka we read nothing) just throw a
-                // runtime error
-                if (is.gcount() == 0) {
-                    throw std::runtime_error(
-                        "The file is empty and cannot be read"
-                    );
+                // read the data
+                data.data_.resize(N);
+                is.read(reinterpret_cast<char *>(&data.data_[0]), N*sizeof(Scalar));
+
+                // fix the endianess
+                if (swap) {
+                    swap_endianess(&data.data_[0], N);
                 }
 
-                // read the header len
-                uint16_t header_len;
-                is.read(reinterpret_cast<char *>(&header_len), 2);
-                if (is_big_endian()) {
-                    swap_endianess(&header_len, 1);
+                return is;
+            }
+
+            std::vector<Scalar> data_;
+            std::vector<size_t> shape_;
+            bool fortran_;
+    };
+
+
+    /**
+     * NumpyOutputStream writes a column major rows x N array to a file one
+     * block of columns at a time, so that N need not be known in advance and
+     * the whole array is never kept in memory.
+     *
+     * The header is written with space for any number of columns and is
+     * rewritten with the final shape by close() (or the destructor).
+     *
+     * Example:
+     *
+     *     numpy_format::NumpyOutputStream<float> out("gammas.npy", 10);
+     *     out.write(MatrixXf::Random(10, 20));
+     *     out.write(MatrixXf::Random(10, 5));
+     *     out.close();  // gammas.npy now contains a 10x25 array
+     */
+    template <typename Scalar>
+    class NumpyOutputStream
+    {
+        public:
+            /**
+             * @param path The file to write the array to
+             * @param rows The number of rows of the array
+             */
+            NumpyOutputStream(std::string path, size_t rows)
+                : stream_(path, std::ios::out | std::ios::binary | std::ios::trunc),
+                  rows_(rows),
+                  cols_(0)
+            {
+                if (!stream_) {
+                    throw std::runtime_error("Couldn't open " + path + " for writing");
                 }
 
-                // read the header
-                std::vector<char> buffer(header_len+1);
-                is.read(&buffer[0], header_len);
-                buffer[header_len] = 0;
-                std::string header(&buffer[0]);
+                // reserve room for the header of the largest array
+                std::ostringstream largest;
+                header_length_ = detail::write_header(
+                    largest,
+                    dtype(),
+                    true,
+                    {rows_, std::numeric_limits<size_t>::max()}
+                );
+                write_header();
+            }
 
-                // we can parse the header efficiently using the fact that the
-                // specification requires the dictionary to be passed by
-                // pprint.pformat()
+            ~NumpyOutputStream() {
+                try {
+                    close();
+                } catch (...) {
+                    // nothing sensible to do in a destructor
+                }
+            }
 
-                // parse dtype info
-                std::string dtype = header.substr(11, 3);
-                bool endianness = dtype[0] == '>';
-                if (dtype.substr(1) != dtype_for_scalar<Scalar>()) {
+            NumpyOutputStream(const NumpyOutputStream &) = delete;
+            NumpyOutputStream & operator=(const NumpyOutputStream &) = delete;
+
+            /**
+             * Append the columns of a matrix with the same number of rows.
+             */
+            void write(const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &block) {
+                if (static_cast<size_t>(block.rows()) != rows_) {
                     throw std::runtime_error(
-                        std::string() + 
-                        "The type of the array is not the " +
-                        "one requested: " + dtype.substr(1) +
-                        " != " + dtype_for_scalar<Scalar>()
+                        "The block should have " + std::to_string(rows_) + " rows"
                     );
                 }
+                stream_.write(
+                    reinterpret_cast<const char *>(block.data()),
+                    block.size() * sizeof(Scalar)
+                );
+                cols_ += block.cols();
+            }
+
+            /**
+             * Write the final shape in the header and close the file.
+             */
+            void close() {
+                if (!stream_.is_open()) {
+                    return;
+                }
+                stream_.seekp(0);
+                write_header();
+                stream_.close();
+                if (stream_.fail()) {
+                    throw std::runtime_error("Couldn't write the numpy array");
+                }
+            }
 
-                // parse contiguity type
-                data.fortran_ = header[34] == 'T';
+            /** The number of columns written so far */
+            size_t cols() const { return cols_; }
 
-                // parse shape
-                std::string shape = header.substr(
-                    header.find_last_of('(')+1,
-                    header.find_last_of(')')
-                );
-                try {
-                    while (true) {
-                        size_t processed;
-                        data.shape_.push_back(std::stoi(shape, &processed));
+        private:
+            std::string dtype() const {
+                return std::string(is_big_endian() ? ">" : "<") +
+                       dtype_for_scalar<Scalar>();
+            }
 
-                        // +2 to account for the comma and the space
-                        shape = shape.substr(processed + 2);
-                    }
-                } catch (const std::invalid_argument&) {
-                    // that's ok it means we finished parsing the tuple
+            void write_header() {
+                detail::write_header(stream_, dtype(), true, {rows_, cols_}, header_length_);
+            }
+
+            std::fstream stream_;
+            size_t rows_;
+            size_t cols_;
+            size_t header_length_;
+    };
+
+
+    /**
+     * NumpyInputStream reads a 2 dimensional numpy array from a file one
+     * block of columns at a time.
+     *
+     * Column major arrays are read sequentially, row major ones by seeking to
+     * the block in every row.
+     *
+     * Example:
+     *
+     *     numpy_format::NumpyInputStream<int> in("data.npy");
+     *     MatrixXi X;
+     *     while (in.read(X, 1000)) {
+     *         // X contains the next (at most) 1000 columns
+     *     }
+     */
+    template <typename Scalar>
+    class NumpyInputStream
+    {
+        public:
+            NumpyInputStream(std::string path)
+                : stream_(path, std::ios::in | std::ios::binary),
+                  col_(0)
+            {
+                if (!stream_) {
+                    throw std::runtime_error("Couldn't open " + path + " for reading");
                 }
+                swap_ = detail::read_header<Scalar>(stream_, shape_, fortran_);
+                data_start_ = stream_.tellg();
 
-                // compute the total size of the data
-                int N = 1;
-                for (auto c : data.shape_) {
-                    N *= c;
+                // like NumpyInput treat the trailing dimensions as columns
+                rows_ = shape_[0];
+                cols_ = 1;
+                for (size_t i=1; i<shape_.size(); i++) {
+                    cols_ *= shape_[i];
                 }
+            }
 
-                // read the data
-                data.data_.resize(N);
-                is.read(reinterpret_cast<char *>(&data.data_[0]), N*sizeof(Scalar));
+            size_t rows() const { return rows_; }
+            size_t cols() const { return cols_; }
 
-                // fix the endianess
-                if (endianness != is_big_endian()) {
-                    swap_endianess(&data.data_[0], N);
+            /**
+             * Read the next (at most) max_cols columns into block.
+             *
+             * @return false if there were no more columns to read
+             */
+            template <int Rows, int Cols, int Options>
+            bool read(Eigen::Matrix<Scalar, Rows, Cols, Options> &block, size_t max_cols) {
+                size_t n = std::min(max_cols, cols_ - col_);
+                if (n == 0) {
+                    return false;
                 }
 
-                return is;
+                std::vector<Scalar> buffer(rows_ * n);
+                if (fortran_) {
+                    stream_.read(
+                        reinterpret_cast<char *>(&buffer[0]),
+                        buffer.size() * sizeof(Scalar)
+                    );
+                } else {
+                    for (size_t r=0; r<rows_; r++) {
+                        stream_.seekg(data_start_ + static_cast<std::streamoff>(
+                            (r * cols_ + col_) * sizeof(Scalar)
+                        ));
+                        stream_.read(
+                            reinterpret_cast<char *>(&buffer[r * n]),
+                            n * sizeof(Scalar)
+                        );
+                    }
+                }
+                if (!stream_) {
+                    throw std::runtime_error("The numpy array is truncated");
+                }
+                if (swap_) {
+                    swap_endianess(&buffer[0], buffer.size());
+                }
+
+                block.resize(rows_, n);
+                for (size_t i=0; i<n; i++) {
+                    for (size_t j=0; j<rows_; j++) {
+                        block(j, i) = buffer[(fortran_) ? i*rows_ + j : j*n + i];
+                    }
+                }
+                col_ += n;
+
+                return true;
             }
 
-            std::vector<Scalar> data_;
+        private:
+            std::fstream stream_;
             std::vector<size_t> shape_;
             bool fortran_;
+            bool swap_;
+            std::streamoff data_start_;
+            size_t rows_;
+            size_t cols_;
+            size_t col_;
     };
 
 
@@ -2,7 +2,10 @@
 #define _LDAPLUSPLUS_PARAMETERS_HPP_
 
 
+#include <memory>
+#include <new>
 #include <utility>
+#include <vector>
 
 #include <Eigen/Core>
 
@@ -12,9 +15,13 @@ namespace parameters {
 
 /**
  * All the parameter related objects will be extending this empty struct.
+ *
+ * It is polymorphic so that code holding a pointer to Parameters can check
+ * which parameters it actually has (see LDA::squarem).
  */
 struct Parameters
 {
+    virtual ~Parameters() {}
 };
 
 
@@ -59,23 +66,169 @@ struct SupervisedModelParameters : public ModelParameters<Scalar>
 };
 
 
+/**
+ * ModelParametersView are read-only model parameters whose arrays live
+ * somewhere else, for instance in a memory mapped model file (see
+ * model_file::map_parameters), so that inference needs no copy of them.
+ *
+ * The owner keeps that memory alive for as long as any view (or LDA
+ * holding one) exists. log_beta is the elementwise logarithm of beta used
+ * by the likelihood, it is empty unless it was precomputed.
+ *
+ * Only the UnsupervisedEStep and the inference methods of LDA accept views,
+ * a model cannot be trained in place.
+ */
+template <typename Scalar = double>
+struct ModelParametersView : public Parameters
+{
+    typedef Eigen::Map<const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> > VectorMap;
+    typedef Eigen::Map<const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> > MatrixMap;
+
+    ModelParametersView(
+        VectorMap a,
+        MatrixMap b,
+        MatrixMap e,
+        MatrixMap lb,
+        std::shared_ptr<const void> o
+    ) : alpha(a),
+        beta(b),
+        eta(e),
+        log_beta(lb),
+        owner(std::move(o))
+    {}
+
+    /**
+     * View the arrays of model parameters which should outlive the view.
+     */
+    explicit ModelParametersView(const ModelParameters<Scalar> &model)
+        : alpha(model.alpha.data(), model.alpha.rows()),
+          beta(model.beta.data(), model.beta.rows(), model.beta.cols()),
+          eta(nullptr, 0, 0),
+          log_beta(nullptr, 0, 0)
+    {
+        auto supervised = dynamic_cast<const SupervisedModelParameters<Scalar> *>(&model);
+        if (supervised) {
+            new (&eta) MatrixMap(
+                supervised->eta.data(),
+                supervised->eta.rows(),
+                supervised->eta.cols()
+            );
+        }
+    }
+
+    /**
+     * View either ModelParameters or a ModelParametersView so that the
+     * inference code reads both the same way.
+     */
+    static ModelParametersView view(const Parameters &parameters) {
+        auto view = dynamic_cast<const ModelParametersView *>(&parameters);
+        if (view) {
+            return *view;
+        }
+
+        return ModelParametersView(
+            static_cast<const ModelParameters<Scalar> &>(parameters)
+        );
+    }
+
+    VectorMap alpha;
+    MatrixMap beta;
+    MatrixMap eta;
+    MatrixMap log_beta;
+    std::shared_ptr<const void> owner;
+};
+
+
 /**
  * The variational parameters are (duh) the variational parameters of the LDA
  * model.
+ *
+ * Besides the dense topics x words phi, the E steps fill in the ids of the
+ * words that appear in the document and the corresponding columns of phi
+ * multiplied by the word counts (topics x nnz). These are all that the M
+ * steps need so an E step may leave phi empty (for instance the
+ * UnsupervisedEStep does) and no work proportional to the size of the
+ * vocabulary is done for a document.
+ *
+ * words and phi_scaled view storage that set_words() only grows, so the
+ * parameters recycled by em::VariationalParametersPool stop allocating
+ * once they have held the largest document. The same holds for the
+ * scratch space of the E steps.
  */
 template <typename Scalar = double>
 struct VariationalParameters : public Parameters
 {
-    VariationalParameters() {}
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> MatrixX;
+
+    VariationalParameters()
+        : words(nullptr, 0),
+          phi_scaled(nullptr, 0, 0)
+    {}
     VariationalParameters(
         Eigen::Matrix<Scalar, Eigen::Dynamic, 1> g,
-        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> p
+        MatrixX p
     ) : gamma(std::move(g)),
-        phi(std::move(p))
+        phi(std::move(p)),
+        words(nullptr, 0),
+        phi_scaled(nullptr, 0, 0)
     {}
+    VariationalParameters(const VariationalParameters &other)
+        : VariationalParameters()
+    {
+        *this = other;
+    }
+    VariationalParameters & operator=(const VariationalParameters &other) {
+        gamma = other.gamma;
+        phi = other.phi;
+        resize_words(other.phi_scaled.rows(), other.words.rows());
+        words = other.words;
+        phi_scaled = other.phi_scaled;
+        scratch = other.scratch;
+
+        return *this;
+    }
+
+    /**
+     * Set words to the ids of the non zero counts of X and resize
+     * phi_scaled to topics x words (its contents are unspecified).
+     */
+    void set_words(const Eigen::Ref<const Eigen::VectorXi> &X, int topics) {
+        resize_words(topics, (X.array() != 0).count());
+        for (int i=0, j=0; i<X.rows(); i++) {
+            if (X[i] != 0) {
+                words[j++] = i;
+            }
+        }
+    }
 
     Eigen::Matrix<Scalar, Eigen::Dynamic, 1> gamma;
-    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> phi;
+    MatrixX phi;
+
+    Eigen::Map<Eigen::VectorXi> words;
+    Eigen::Map<MatrixX> phi_scaled;
+
+    // Buffers for the intermediate values of the E steps, their number,
+    // size and contents are up to the E step that uses them
+    std::vector<Eigen::Matrix<Scalar, Eigen::Dynamic, 1> > scratch;
+
+    private:
+        void resize_words(int topics, int nnz) {
+            if (words_storage_.rows() < nnz) {
+                words_storage_.resize(nnz);
+            }
+            if (phi_scaled_storage_.rows() < topics * nnz) {
+                phi_scaled_storage_.resize(topics * nnz);
+            }
+            new (&words) Eigen::Map<Eigen::VectorXi>(words_storage_.data(), nnz);
+            new (&phi_scaled) Eigen::Map<MatrixX>(
+                phi_scaled_storage_.data(),
+                topics,
+                nnz
+            );
+        }
+
+        Eigen::VectorXi words_storage_;
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> phi_scaled_storage_;
 };
 
 
@@ -98,6 +251,41 @@ struct SupervisedCorrespondenceVariationalParameters : public VariationalParamet
     Eigen::Matrix<Scalar, Eigen::Dynamic, 1> tau;
 };
 
+
+/**
+ * SparseTopics keep the largest topic proportions of a document, the topics
+ * in increasing order and their weights.
+ */
+template <typename Scalar = double>
+struct SparseTopics : public Parameters
+{
+    SparseTopics() {}
+    SparseTopics(
+        Eigen::VectorXi t,
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> w
+    ) : topics(std::move(t)),
+        weights(std::move(w))
+    {}
+
+    Eigen::VectorXi topics;
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> weights;
+};
+
+/**
+ * ClassPrediction holds the predicted class of a document and optionally the
+ * scores for every class and the variational parameter gamma it was
+ * predicted from.
+ */
+template <typename Scalar = double>
+struct ClassPrediction : public Parameters
+{
+    ClassPrediction() : label(0) {}
+
+    int label;
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> scores;
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> gamma;
+};
+
 }  // namespace parameters
 }  // namespace ldaplusplus
 
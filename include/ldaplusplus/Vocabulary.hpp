@@ -0,0 +1,152 @@
+#ifndef _LDAPLUSPLUS_VOCABULARY_HPP_
+#define _LDAPLUSPLUS_VOCABULARY_HPP_
+
+
+#include <Eigen/Core>
+
+namespace ldaplusplus {
+namespace corpus {
+
+
+/**
+ * Vocabulary maps the word ids of a corpus to a dense compact range that
+ * contains only the words worth modelling.
+ *
+ * The topics over words distributions are K x V and every E and M step
+ * touches them, so words that never (or rarely) appear in the training
+ * documents cost time and memory while the smoothing of the M steps keeps
+ * them alive. Training on compact() documents sizes the model to the
+ * words that are kept and expand_topics() maps it back to the original ids
+ * (the dropped words get zero probability). from_topics() recovers the
+ * vocabulary from such an expanded model so that the documents to be
+ * transformed can be compacted (or masked) the same way.
+ */
+class Vocabulary
+{
+    template <typename Scalar>
+    using MatrixX = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+    public:
+        /**
+         * Keep the words that appear at least min_count times in X.
+         *
+         * @param X         The word counts in column-major order
+         * @param min_count The minimum number of occurrences of a word to be
+         *                  kept (0 keeps every word)
+         */
+        Vocabulary(const Eigen::MatrixXi &X, int min_count = 1);
+
+        /**
+         * @param words         The original ids of the kept words in
+         *                      increasing order
+         * @param original_size The number of words in the original id space
+         */
+        Vocabulary(Eigen::VectorXi words, int original_size);
+
+        /**
+         * Keep the words that have non zero probability in at least one
+         * topic.
+         *
+         * @param beta The topics over words distributions (K x V), for
+         *             instance a view of a mapped model
+         */
+        template <typename Scalar>
+        static Vocabulary from_topics(const Eigen::Ref<const MatrixX<Scalar> > &beta);
+
+        /** The number of kept words */
+        int size() const { return words_.rows(); }
+        /** The number of words in the original id space */
+        int original_size() const { return ids_.rows(); }
+        /** The original id of every compact id */
+        const Eigen::VectorXi & words() const { return words_; }
+        /** The compact id of an original word id or -1 if it was dropped */
+        int compact_id(int word) const { return ids_[word]; }
+
+        /**
+         * Keep only the rows of X that correspond to kept words.
+         *
+         * @param X The word counts in the original id space
+         * @return  The word counts in the compact id space
+         */
+        Eigen::MatrixXi compact(const Eigen::MatrixXi &X) const;
+
+        /**
+         * Zero the rows of X that correspond to dropped words keeping the
+         * original ids, for topics that cannot be compacted (for instance a
+         * read-only mapped model).
+         *
+         * @param X The word counts in the original id space
+         * @return  The word counts of the kept words in the original id
+         *          space
+         */
+        Eigen::MatrixXi mask(const Eigen::MatrixXi &X) const;
+
+        /**
+         * Keep only the columns of the kept words and renormalize every
+         * topic.
+         *
+         * @param beta The topics in the original id space (K x V)
+         * @return     The topics in the compact id space
+         */
+        template <typename Scalar>
+        MatrixX<Scalar> compact_topics(const MatrixX<Scalar> &beta) const;
+
+        /**
+         * Move the columns of the topics back to the original ids leaving
+         * zeros for the dropped words.
+         *
+         * @param beta The topics in the compact id space
+         * @return     The topics in the original id space (K x V)
+         */
+        template <typename Scalar>
+        MatrixX<Scalar> expand_topics(const MatrixX<Scalar> &beta) const;
+
+    private:
+        // The map from compact ids to original ids and back
+        Eigen::VectorXi words_;
+        Eigen::VectorXi ids_;
+};
+
+
+/**
+ * FeatureHasher maps any word id to one of a fixed number of buckets so
+ * that the topics are K x buckets no matter how many distinct words a
+ * stream of documents contains.
+ *
+ * The counts of the words that share a bucket are summed (no sign is used
+ * since the counts must stay non negative). The hash depends only on the
+ * word id so documents with different numbers of rows, for instance the
+ * chunks of a growing vocabulary, map consistently. It keeps no state so a
+ * FeatureHasher can be shared between threads.
+ */
+class FeatureHasher
+{
+    public:
+        /**
+         * @param buckets The number of buckets (the words of the model)
+         */
+        FeatureHasher(int buckets);
+
+        /** The number of buckets */
+        int buckets() const { return buckets_; }
+
+        /** The bucket of an original word id */
+        int bucket(int word) const;
+
+        /**
+         * Sum the counts of the words of every document into their buckets.
+         *
+         * @param X The word counts in column-major order (any number of
+         *          rows)
+         * @return  The bucket counts (buckets x documents)
+         */
+        Eigen::MatrixXi transform(const Eigen::MatrixXi &X) const;
+
+    private:
+        int buckets_;
+};
+
+}  // namespace corpus
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_VOCABULARY_HPP_
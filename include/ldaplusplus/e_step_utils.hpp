@@ -20,13 +20,53 @@ namespace e_step_utils {
      */
     template <typename Scalar>
     Scalar compute_unsupervised_likelihood(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         const VectorX<Scalar> &alpha,
         const MatrixX<Scalar> &beta,
         const MatrixX<Scalar> &phi,
         const VectorX<Scalar> &gamma
     );
 
+    /**
+     * Compute the same value as compute_unsupervised_likelihood() using only
+     * the words that appear in the document.
+     *
+     * It allocates nothing of size V and takes the logarithm of K x nnz
+     * elements of beta instead of K x V.
+     *
+     * @param counts The counts of the nnz words that appear in the document
+     * @param alpha  The Dirichlet priors
+     * @param beta   The columns of the topic over word distributions for the
+     *               nnz words of the document (K x nnz)
+     * @param phi    The Multinomial parameters for the nnz words (K x nnz)
+     * @param gamma  The Dirichlet parameters
+     */
+    template <typename Scalar>
+    Scalar compute_unsupervised_likelihood_sparse(
+        const VectorX<Scalar> &counts,
+        const Ref<const VectorX<Scalar> > &alpha,
+        const MatrixX<Scalar> &beta,
+        const MatrixX<Scalar> &phi,
+        const VectorX<Scalar> &gamma
+    );
+
+    /**
+     * Compute the same value as compute_unsupervised_likelihood_sparse()
+     * from the columns of log(beta + 1e-44) so that a model with a
+     * precomputed log beta (see ModelParametersView) takes no logarithm.
+     *
+     * @param log_beta The logarithm of the columns of beta for the nnz words
+     *                 of the document (K x nnz)
+     */
+    template <typename Scalar>
+    Scalar compute_unsupervised_likelihood_sparse_log_beta(
+        const VectorX<Scalar> &counts,
+        const Ref<const VectorX<Scalar> > &alpha,
+        const MatrixX<Scalar> &log_beta,
+        const MatrixX<Scalar> &phi,
+        const VectorX<Scalar> &gamma
+    );
+
     /**
      * Compute the value of the ELBO (using the supervised definition of the
      * model) for a given document, model parameters and variational
@@ -44,7 +84,7 @@ namespace e_step_utils {
      */
     template <typename Scalar>
     Scalar compute_supervised_likelihood(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         int y,
         const VectorX<Scalar> &alpha,
         const MatrixX<Scalar> &beta,
@@ -54,7 +94,7 @@ namespace e_step_utils {
     );
     template <typename Scalar>
     Scalar compute_supervised_likelihood(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         int y,
         const VectorX<Scalar> &alpha,
         const MatrixX<Scalar> &beta,
@@ -66,7 +106,7 @@ namespace e_step_utils {
 
     template <typename Scalar>
     Scalar compute_supervised_multinomial_likelihood(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         int y,
         const VectorX<Scalar> &alpha,
         const MatrixX<Scalar> &beta,
@@ -80,7 +120,7 @@ namespace e_step_utils {
 
     template <typename Scalar>
     Scalar compute_supervised_correspondence_likelihood(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         int y,
         const VectorX<Scalar> &alpha,
         const MatrixX<Scalar> &beta,
@@ -112,7 +152,7 @@ namespace e_step_utils {
      */
     template <typename Scalar>
     void compute_h(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         const VectorX<Scalar> & X_ratio,
         const MatrixX<Scalar> &eta,
         const MatrixX<Scalar> &phi,
@@ -121,7 +161,7 @@ namespace e_step_utils {
 
     template <typename Scalar>
     void compute_supervised_phi_gamma(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         const VectorX<Scalar> & X_ratio,
         int y,
         const MatrixX<Scalar> & beta,
@@ -144,7 +184,7 @@ namespace e_step_utils {
      */
     template <typename Scalar>
     void compute_gamma(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         const VectorX<Scalar> & alpha,
         const MatrixX<Scalar> & phi,
         Ref<VectorX<Scalar> > gamma
@@ -170,6 +210,77 @@ namespace e_step_utils {
         Ref<MatrixX<Scalar> > phi
     );
 
+    /**
+     * Perform one iteration of compute_unsupervised_phi() followed by
+     * compute_gamma() without materializing phi.
+     *
+     * Since
+     *
+     *     \sum_n \phi_{n,i} = t_i \sum_n X_n beta_{i, w_n} / (\sum_j beta_{j, w_n} t_j)
+     *
+     * where t_i = exp(\psi(\gamma_i)), it suffices to stream once over the non
+     * zero words of the document accumulating the scaled columns of beta.
+     * Nothing of size V is written and only K x nnz elements of beta are
+     * read.
+     *
+     * @param X       The word counts of the document
+     * @param alpha   The Dirichlet priors
+     * @param beta    The topic over word distributions
+     * @param gamma   The Dirichlet parameters which are updated in place
+     * @param scratch A buffer of size K (it is resized if needed)
+     */
+    template <typename Scalar>
+    void compute_unsupervised_gamma(
+        const Ref<const VectorXi> &X,
+        const Ref<const VectorX<Scalar> > & alpha,
+        const Ref<const MatrixX<Scalar> > & beta,
+        Ref<VectorX<Scalar> > gamma,
+        VectorX<Scalar> & scratch
+    );
+
+    /**
+     * Gather the columns of phi for the words that appear in the document
+     * multiplied by their counts (see VariationalParameters::phi_scaled).
+     *
+     * @param X          The word counts of the document
+     * @param phi        The Multinomial parameters (K x V)
+     * @param words      The ids of the nnz words of the document (see
+     *                   VariationalParameters::set_words)
+     * @param phi_scaled The columns of phi scaled by the counts (K x nnz
+     *                   output)
+     */
+    template <typename Scalar>
+    void compute_phi_scaled(
+        const Ref<const VectorXi> &X,
+        const MatrixX<Scalar> & phi,
+        const Ref<const VectorXi> &words,
+        Ref<MatrixX<Scalar> > phi_scaled
+    );
+
+    /**
+     * Compute the same as compute_unsupervised_phi() followed by
+     * compute_phi_scaled() without computing the columns of phi for the words
+     * that do not appear in the document.
+     *
+     * @param X          The word counts of the document
+     * @param beta       The topic over word distributions
+     * @param gamma      The Dirichlet parameters
+     * @param words      The ids of the nnz words of the document (see
+     *                   VariationalParameters::set_words)
+     * @param phi_scaled The columns of phi scaled by the counts (K x nnz
+     *                   output)
+     * @param scratch    A buffer of size K (it is resized if needed)
+     */
+    template <typename Scalar>
+    void compute_unsupervised_phi_scaled(
+        const Ref<const VectorXi> &X,
+        const Ref<const MatrixX<Scalar> > & beta,
+        const Ref<const VectorX<Scalar> > & gamma,
+        const Ref<const VectorXi> &words,
+        Ref<MatrixX<Scalar> > phi_scaled,
+        VectorX<Scalar> & scratch
+    );
+
     /**
      * Update Multinomial parameter phi, according to the following approximation
      *
@@ -189,7 +300,7 @@ namespace e_step_utils {
 
     template <typename Scalar>
     void compute_supervised_multinomial_phi(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         int y,
         const MatrixX<Scalar> & beta,
         const MatrixX<Scalar> & eta,
@@ -200,7 +311,7 @@ namespace e_step_utils {
 
     template <typename Scalar>
     void compute_supervised_correspondence_phi(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         int y,
         const MatrixX<Scalar> & beta,
         const MatrixX<Scalar> & eta,
@@ -211,7 +322,7 @@ namespace e_step_utils {
 
     template <typename Scalar>
     void compute_supervised_correspondence_tau(
-        const VectorXi & X,
+        const Ref<const VectorXi> &X,
         int y,
         const MatrixX<Scalar> & eta,
         const MatrixX<Scalar> & phi,
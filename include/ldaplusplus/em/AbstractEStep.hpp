@@ -1,9 +1,13 @@
 #ifndef _LDAPLUSPLUS_EM_ABSTRACTESTEP_HPP_
 #define _LDAPLUSPLUS_EM_ABSTRACTESTEP_HPP_
 
+#include <functional>
+#include <mutex>
 #include <random>
+#include <vector>
 
 #include "ldaplusplus/em/EStepInterface.hpp"
+#include "ldaplusplus/em/VariationalParametersPool.hpp"
 #include "ldaplusplus/utils.hpp"
 
 namespace ldaplusplus {
@@ -13,14 +17,19 @@ namespace em {
  * A base class that provides few common functionalities for implementing an
  * E step.
  *
- * - Implements an empty void e_step() since most work happens in doc_e_step()
+ * - Implements e_step() that only reports the iterations recorded during the
+ *   epoch since most work happens in doc_e_step()
  * - Provides convergence check based on variational parameter \f$\gamma\f$
- * - Provides a PRNG initialized using a seed in the constructor
+ * - Provides SQUAREM extrapolation of the fixed point iteration on
+ *   \f$\gamma\f$
+ * - Provides a PRNG stream per worker initialized using a seed in the
+ *   constructor (and a locked one for the threads that are not workers)
+ * - Provides recycled variational parameters to be returned by doc_e_step()
  */
 template <typename Scalar>
 class AbstractEStep : public EStepInterface<Scalar>
 {
-    typedef math_utils::ThreadSafePRNG<std::default_random_engine> PRNG;
+    typedef math_utils::WorkerPRNG PRNG;
 
     public:
         /**
@@ -32,12 +41,28 @@ class AbstractEStep : public EStepInterface<Scalar>
         AbstractEStep(int random_state);
 
         /**
-         * Implement an empty e_step because almost nobody needs to perform
-         * some action at the end of each corpus epoch.
+         * Dispatch an ExpectationIterationsEvent with the iterations recorded
+         * during the epoch and reset them. Almost nobody needs to perform
+         * some other action at the end of each corpus epoch but those who do
+         * should call this method as well.
          */
-        virtual void e_step() override {}
+        virtual void e_step() override;
+
+        /**
+         * Create a non overlapping PRNG stream for every worker (the streams
+         * that already exist are kept).
+         */
+        virtual void set_workers(size_t workers) override;
 
     protected:
+        /**
+         * Record the number of iterations the E step performed for a
+         * document, to be reported at the end of the epoch.
+         *
+         * @param iterations The iterations performed for the document
+         */
+        void record_iterations(size_t iterations);
+
         /**
          * Check for convergence based on the mean relative change of the
          * variational parameter \f$\gamma\f$.
@@ -53,9 +78,60 @@ class AbstractEStep : public EStepInterface<Scalar>
             Scalar tolerance
         );
 
+        /**
+         * Perform one cycle of the SQUAREM extrapolation (scheme S3 in
+         * Simple and globally convergent methods for accelerating the
+         * convergence of any EM algorithm, Varadhan and Roland 2008) of the
+         * fixed point iteration on \f$\gamma\f$.
+         *
+         * Two plain updates \f$\gamma_1 = F(\gamma_0)\f$ and \f$\gamma_2 =
+         * F(\gamma_1)\f$ give the step length \f$a = -\|r\| / \|v\|\f$
+         * where \f$r = \gamma_1 - \gamma_0\f$ and \f$v = \gamma_2 -
+         * 2\gamma_1 + \gamma_0\f$. The extrapolated \f$\gamma_0 - 2ar +
+         * a^2v\f$ is moved back towards \f$\gamma_2\f$ until it is
+         * positive and then stabilized with one more update. If the bound is
+         * less than the bound at \f$\gamma_0\f$ the extrapolation is
+         * discarded and the plain update from \f$\gamma_1\f$ is used
+         * instead so a cycle never decreases the bound. A bound that is NaN
+         * never discards it. Only E steps whose updates monotonically increase
+         * the bound should use it, otherwise the plain update cannot be
+         * guaranteed to be the better one.
+         *
+         * The E steps only start a cycle when 4 more updates fit in their
+         * maximum number of iterations so that it stays a hard limit.
+         *
+         * @param update One plain update of gamma in place (it may update
+         *               more variational parameters, for instance phi)
+         * @param bound  The ELBO of the document for the passed gamma and
+         *               everything else as left by the last update
+         * @param gamma  The gamma to start from, the new gamma at exit
+         * @param value  The bound at the starting gamma, the bound at the new
+         *               gamma at exit
+         * @param scratch Buffers for the intermediate gammas, the first
+         *                SQUAREM_SCRATCH are overwritten (the vector is
+         *                resized if it has fewer)
+         * @return The number of updates performed (3 or 4 or 2 if there was
+         *         nothing to extrapolate)
+         */
+        size_t squarem(
+            const std::function<void(Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &)> &update,
+            const std::function<Scalar(const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &)> &bound,
+            Eigen::Matrix<Scalar, Eigen::Dynamic, 1> & gamma,
+            Scalar & value,
+            std::vector<Eigen::Matrix<Scalar, Eigen::Dynamic, 1> > & scratch
+        );
+
+        // The number of scratch buffers that squarem() uses
+        static const size_t SQUAREM_SCRATCH = 5;
+
         /**
          * Return a PRNG for use with any distribution.
          *
+         * Every worker gets its own stream so no locking is required and the
+         * random numbers drawn by a worker do not depend on the others. The
+         * threads that are not workers (for instance a caller of
+         * doc_e_step() outside of LDA) share a stream behind a lock.
+         *
          * Although this isn't all that different from making random_ protected
          * it could allow for future change of the object returned since it can
          * be anything that satisfies the UniformRandomBitGenerator (see:
@@ -63,10 +139,35 @@ class AbstractEStep : public EStepInterface<Scalar>
          */
         PRNG &get_prng() { return random_; }
 
+        /**
+         * Return variational parameters, with uninitialized phi and gamma of
+         * the given dimensions, that are recycled once every reference to
+         * them has been dropped.
+         *
+         * @param topics The number of topics (rows of phi)
+         * @param words  The number of words (columns of phi)
+         */
+        std::shared_ptr<parameters::VariationalParameters<Scalar> > get_variational_parameters(
+            size_t topics,
+            size_t words
+        ) {
+            return variational_parameters_.get(topics, words);
+        }
+
     private:
-        // A random number generator to be used for every random number needed
-        // in this E step (initialized with random_state constructor parameter)
+        // The random number generators to be used for every random number
+        // needed in this E step, a stream per worker
         PRNG random_;
+
+        // A histogram of the iterations per document for every worker so
+        // that recording them requires no locking, and one for the threads
+        // that are not workers guarded by iterations_mutex_
+        std::vector<std::vector<size_t> > iterations_;
+        std::vector<size_t> shared_iterations_;
+        std::mutex iterations_mutex_;
+
+        // The buffers returned by get_variational_parameters()
+        VariationalParametersPool<parameters::VariationalParameters<Scalar> > variational_parameters_;
 };
 
 
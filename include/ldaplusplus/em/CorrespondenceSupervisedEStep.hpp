@@ -116,6 +116,9 @@ class CorrespondenceSupervisedEStep: public AbstractEStep<Scalar>
         Scalar mu_;
         // Compute the likelihood of that many documents (pecentile)
         Scalar compute_likelihood_;
+
+        // Recycled variational parameters (we also need tau)
+        VariationalParametersPool<parameters::SupervisedCorrespondenceVariationalParameters<Scalar> > variational_parameters_;
 };
 
 }  // namespace em
@@ -63,8 +63,12 @@ class CorrespondenceSupervisedMStep : public MStepInterface<Scalar>
             std::shared_ptr<parameters::Parameters> m_parameters
         ) override;
 
+        /**
+         * The rows of eta are distributions over the classes.
+         */
+        virtual bool normalizes_eta() const override { return true; }
+
     private:
-        MatrixX phi_scaled_;
         VectorX phi_scaled_sum_;
         MatrixX b_;
         MatrixX h_;
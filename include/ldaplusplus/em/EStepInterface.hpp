@@ -50,6 +50,17 @@ class EStepInterface : public events::EventDispatcherComposition
          */
         virtual void e_step()=0;
 
+        /**
+         * Inform the E step that doc_e_step will be called concurrently by
+         * that many workers, namely by threads whose
+         * thread_utils::worker_index() is smaller than workers. It is called
+         * before any worker starts, so that per worker state can be
+         * allocated without locking.
+         *
+         * @param workers The number of worker threads
+         */
+        virtual void set_workers(size_t workers) {}
+
         virtual ~EStepInterface(){};
 };
 
@@ -121,6 +121,7 @@ class FastOnlineSupervisedMStep : public MStepInterface<Scalar>
         Scalar beta_weight_;
         MatrixX expected_z_bar_;
         Eigen::VectorXi y_;
+        VectorX weights_;
         MatrixX eta_velocity_;
         MatrixX eta_gradient_;
         Scalar eta_momentum_;
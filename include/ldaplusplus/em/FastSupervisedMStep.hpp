@@ -107,6 +107,8 @@ class FastSupervisedMStep : public UnsupervisedMStep<Scalar>
         int docs_;
         MatrixX expected_z_bar_;
         Eigen::VectorXi y_;
+        // The copies each document stands for (see corpus::Document::get_weight)
+        VectorX weights_;
 };
 
 }  // namespace em
@@ -60,6 +60,14 @@ class MStepInterface : public events::EventDispatcherComposition
             std::shared_ptr<parameters::Parameters> m_parameters
         )=0;
 
+        /**
+         * Whether m_step() normalizes the rows of the supervised parameters
+         * \f$\eta\f$ to distributions (like the rows of \f$\beta\f$), in
+         * which case any other update of them (for instance LDA::squarem)
+         * should keep them on the simplex.
+         */
+        virtual bool normalizes_eta() const { return false; }
+
         virtual ~MStepInterface(){};
 };
 
@@ -52,6 +52,11 @@ class SemiSupervisedEStep : public EStepInterface<Scalar>
          */
         void e_step() override;
 
+        /**
+         * Inform both the sub e steps about the number of workers.
+         */
+        void set_workers(size_t workers) override;
+
     private:
         std::shared_ptr<EStepInterface<Scalar> > supervised_step_;
         std::shared_ptr<EStepInterface<Scalar> > unsupervised_step_;
@@ -104,6 +104,8 @@ class SupervisedMStep : public UnsupervisedMStep<Scalar>
         MatrixX expected_z_bar_;
         std::vector<MatrixX> variance_z_bar_;
         Eigen::VectorXi y_;
+        // The copies each document stands for (see corpus::Document::get_weight)
+        VectorX weights_;
 };
 
 }  // namespace em
@@ -40,12 +40,15 @@ class UnsupervisedEStep : public AbstractEStep<Scalar>
          *                           every document)
          * @param random_state       An initial seed value for any random
          *                           numbers needed
+         * @param squarem            Extrapolate the iterations on
+         *                           \f$\gamma\f$ (see AbstractEStep::squarem)
          */
         UnsupervisedEStep(
             size_t e_step_iterations = 10,
             Scalar e_step_tolerance = 1e-2,
             Scalar compute_likelihood = 1.0,
-            int random_state = 0
+            int random_state = 0,
+            bool squarem = false
         );
 
         /**
@@ -81,6 +84,8 @@ class UnsupervisedEStep : public AbstractEStep<Scalar>
         Scalar e_step_tolerance_;
         // Compute the likelihood of that many documents (pecentile)
         Scalar compute_likelihood_;
+        // Extrapolate the fixed point iteration on gamma
+        bool squarem_;
 };
 
 }  // namespace em
@@ -0,0 +1,75 @@
+#ifndef _LDAPLUSPLUS_EM_VARIATIONALPARAMETERSPOOL_HPP_
+#define _LDAPLUSPLUS_EM_VARIATIONALPARAMETERSPOOL_HPP_
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ldaplusplus/Parameters.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+/**
+ * VariationalParametersPool recycles the variational parameters returned by
+ * the E steps so that the K x V phi matrices are not allocated for every
+ * document and freed from a different thread after the M step.
+ *
+ * The consumers simply drop their shared pointers without knowing about the
+ * pool. The pool keeps a reference to every buffer it hands out and a buffer
+ * is reused once that is the only reference left, so that reusing it
+ * allocates neither the matrices nor the control block of the shared
+ * pointer. The shards are selected by the worker index of the calling thread
+ * so that the workers do not contend for a single lock (the threads that are
+ * not workers all share one).
+ *
+ * Every shard keeps at most capacity buffers and the ones requested when all
+ * of them are in use are freed by their last consumer, so the memory held by
+ * the pool is bounded by the buffers that are in use at any one time (see
+ * LDA which bounds the documents in flight per worker) instead of the most
+ * that ever were.
+ */
+template <typename VariationalParameters>
+class VariationalParametersPool
+{
+    public:
+        /**
+         * @param shards   The number of independent free lists (ideally at
+         *                 least as many as the threads using the pool)
+         * @param capacity The maximum number of buffers each shard keeps
+         *                 for reuse
+         */
+        VariationalParametersPool(size_t shards = 16, size_t capacity = 8);
+
+        /**
+         * Get variational parameters with a topics x words phi and a topics
+         * dimensional gamma. The contents of the matrices are unspecified
+         * and should be initialized by the caller.
+         *
+         * @param topics The number of topics
+         * @param words  The number of words in the vocabulary
+         */
+        std::shared_ptr<VariationalParameters> get(size_t topics, size_t words);
+
+        /**
+         * @return The number of buffers kept for reuse that are not in use
+         */
+        size_t size() const;
+
+    private:
+        struct Shard
+        {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<VariationalParameters> > buffers;
+        };
+
+        size_t capacity_;
+        std::vector<std::unique_ptr<Shard> > shards_;
+};
+
+
+}  // namespace em
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_EM_VARIATIONALPARAMETERSPOOL_HPP_
@@ -2,16 +2,42 @@
 #define _LDAPLUSPLUS_EVENTS_EVENTS_HPP_
 
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
-#include <unordered_set>
+#include <vector>
 
 namespace ldaplusplus {
 namespace events {
 
 
+/**
+ * Get the integer type that corresponds to the string id of an event. Types
+ * are assigned in order of registration starting from 0 so they are small
+ * integers that can be compared (and used as bit indices) much faster than
+ * the string ids.
+ *
+ * This function takes a lock so it should be called once per event class
+ * (see for instance ExpectationProgressEvent::static_type()).
+ *
+ * @param id A string that identifies an event
+ * @return   The integer type of events with that id
+ */
+size_t get_event_type(const std::string &id);
+
+
+/**
+ * @param type An event type returned by get_event_type()
+ * @return     The string id that corresponds to the type
+ */
+const std::string & get_event_id(size_t type);
+
+
 /**
  * A base event object that will be dispatched and received.
  */
@@ -23,14 +49,26 @@ class Event
          */
         Event(std::string id);
 
+        /**
+         * @param type An integer type created by get_event_type()
+         */
+        Event(size_t type);
+
         /**
          * @return A string that identifies the event (passed in the
          *         constructor)
          */
         const std::string & id() const;
 
+        /**
+         * @return The integer type of the event which corresponds to the id
+         */
+        size_t type() const { return type_; }
+
+        virtual ~Event(){};
+
     private:
-        std::string id_;
+        size_t type_;
 };
 
 
@@ -45,6 +83,17 @@ class EventListenerInterface
          */
         virtual void on_event(std::shared_ptr<Event> event) = 0;
 
+        /**
+         * Declare whether this listener wants to receive events of a given
+         * type. The dispatchers ask once when the listener is added and do
+         * not even create events that no listener wants.
+         *
+         * By default a listener receives every event.
+         *
+         * @param type An event type (see Event::type())
+         */
+        virtual bool listens_to(size_t type) const { return true; }
+
         virtual ~EventListenerInterface(){};
 };
 
@@ -57,10 +106,22 @@ class FunctionEventListener : public EventListenerInterface
     public:
         FunctionEventListener(std::function<void(std::shared_ptr<Event>)> listener);
 
+        /**
+         * @param listener The function to be called for every event
+         * @param types    The types of events the function wants to receive
+         */
+        FunctionEventListener(
+            std::function<void(std::shared_ptr<Event>)> listener,
+            std::vector<size_t> types
+        );
+
         void on_event(std::shared_ptr<Event> event) override;
+        bool listens_to(size_t type) const override;
 
     private:
         std::function<void(std::shared_ptr<Event>)> listener_;
+        std::vector<size_t> types_;
+        bool all_types_;
 };
 
 
@@ -104,6 +165,17 @@ class EventDispatcherInterface
          */
         virtual void dispatch(std::shared_ptr<Event> event) = 0;
 
+        /**
+         * Return whether any of the listeners wants events of the given type
+         * (see EventListenerInterface::listens_to). When it returns false
+         * events of this type can be dropped without being created.
+         *
+         * The default implementation conservatively returns true.
+         *
+         * @param type An event type (see Event::type())
+         */
+        virtual bool has_listeners(size_t type) const { return true; }
+
         /**
          * Create on the fly a listener from the function and add it to the
          * dispatcher.
@@ -123,6 +195,24 @@ class EventDispatcherInterface
             return l;
         }
 
+        /**
+         * Create on the fly a listener from the function that only receives
+         * events of the given types and add it to the dispatcher.
+         *
+         * @param listener A function implementing the EventListener interface.
+         * @param types    The event types to be received
+         */
+        std::shared_ptr<EventListenerInterface> add_listener(
+            std::function<void(std::shared_ptr<Event>)> listener,
+            std::vector<size_t> types
+        ) {
+            auto l = std::make_shared<FunctionEventListener>(listener, types);
+
+            add_listener(l);
+
+            return l;
+        }
+
         /**
          * Create on the fly a listener of type ListenerType and add it to the
          * dispatcher.
@@ -145,17 +235,81 @@ class EventDispatcherInterface
         /**
          * Create on the fly an event object and dispatch it.
          *
+         * If EventType provides a static_type() method and no listener
+         * wants that type then the event is not even created.
+         *
          * @param args Variadic template arguments to be expanded as
          *             constructor parameters for the event
          */
         template <class EventType, typename... Args>
         void dispatch(Args... args) {
+            if (!has_listeners_for<EventType>(0)) {
+                return;
+            }
+
             auto event = std::make_shared<EventType>(args...);
 
             dispatch(event);
         }
 
         virtual ~EventDispatcherInterface(){};
+
+    private:
+        template <class EventType>
+        auto has_listeners_for(int) const -> decltype(EventType::static_type(), bool()) {
+            return has_listeners(EventType::static_type());
+        }
+
+        template <class EventType>
+        bool has_listeners_for(...) const {
+            return true;
+        }
+};
+
+
+/**
+ * Keep track of the event types that a set of listeners want in a bit set so
+ * that EventDispatcherInterface::has_listeners can be answered from any
+ * thread without locking.
+ *
+ * Only the first 64 event types are tracked, any type after that is always
+ * considered wanted.
+ */
+class EventTypeSubscriptions
+{
+    public:
+        EventTypeSubscriptions() : types_(0) {}
+        EventTypeSubscriptions(const EventTypeSubscriptions &other)
+            : types_(other.types_.load())
+        {}
+        EventTypeSubscriptions & operator=(const EventTypeSubscriptions &other) {
+            types_.store(other.types_.load());
+            return *this;
+        }
+
+        /**
+         * Recompute the subscriptions from a collection of listeners.
+         */
+        template <typename Listeners>
+        void update(const Listeners &listeners) {
+            uint64_t types = 0;
+            for (auto & l : listeners) {
+                for (size_t t=0; t<64; t++) {
+                    if (l->listens_to(t)) {
+                        types |= uint64_t(1) << t;
+                    }
+                }
+            }
+            types_.store(types, std::memory_order_relaxed);
+        }
+
+        bool has(size_t type) const {
+            return type >= 64 ||
+                (types_.load(std::memory_order_relaxed) >> type) & 1;
+        }
+
+    private:
+        std::atomic<uint64_t> types_;
 };
 
 
@@ -166,12 +320,17 @@ class EventDispatcherInterface
 class EventDispatcher : public EventDispatcherInterface
 {
     public:
+        using EventDispatcherInterface::add_listener;
+        using EventDispatcherInterface::dispatch;
+
         void add_listener(std::shared_ptr<EventListenerInterface> listener) override;
         void remove_listener(std::shared_ptr<EventListenerInterface> listener) override;
         void dispatch(std::shared_ptr<Event> event) override;
+        bool has_listeners(size_t type) const override;
 
     private:
         std::list<std::shared_ptr<EventListenerInterface> > listeners_;
+        EventTypeSubscriptions subscriptions_;
 };
 
 
@@ -202,13 +361,30 @@ class EventDispatcherComposition
 /**
  * A thread safe event dispatcher that dispatches the events when its process_events
  * method is called and on the thread that the process_events method is called.
+ *
+ * Dispatching neither locks nor allocates. The events are pushed in a
+ * bounded lock-free ring buffer that any number of threads can write to and
+ * only when it is full they are appended to a locked overflow list. Until
+ * process_events() drains that list the following events are appended to it
+ * as well so that the events of every thread are delivered in order. Events
+ * of types that no listener wants are dropped immediately.
  */
 class ThreadSafeEventDispatcher : public EventDispatcherInterface
 {
     public:
+        /**
+         * @param capacity The number of events that can be queued without
+         *                 locking (rounded up to a power of 2)
+         */
+        ThreadSafeEventDispatcher(size_t capacity = 4096);
+
+        using EventDispatcherInterface::add_listener;
+        using EventDispatcherInterface::dispatch;
+
         virtual void add_listener(std::shared_ptr<EventListenerInterface> listener) override;
         virtual void remove_listener(std::shared_ptr<EventListenerInterface> listener) override;
         virtual void dispatch(std::shared_ptr<Event> event) override;
+        virtual bool has_listeners(size_t type) const override;
 
         /**
          * Traverse the listener queue and notify them of any events that
@@ -219,15 +395,47 @@ class ThreadSafeEventDispatcher : public EventDispatcherInterface
          */
         void process_events();
 
+    protected:
+        /**
+         * Call on_event of every listener that wants this event.
+         */
+        void notify_listeners(const std::shared_ptr<Event> &event);
+
     private:
-        std::mutex listeners_mutex_;
-        std::list<std::shared_ptr<EventListenerInterface> > listeners_;
+        typedef std::vector<std::shared_ptr<EventListenerInterface> > Listeners;
+
+        /**
+         * Push an event in the ring buffer and return false if it is full.
+         */
+        bool push_event(std::shared_ptr<Event> &event);
 
-        std::mutex deleted_listeners_mutex_;
-        std::unordered_set<std::shared_ptr<EventListenerInterface> > deleted_listeners_;
+        /**
+         * Pop an event from the ring buffer and return false if it is empty.
+         */
+        bool pop_event(std::shared_ptr<Event> &event);
 
-        std::mutex events_mutex_;
-        std::list<std::shared_ptr<Event> > events_;
+        // The listeners are copied on write so that process_events only needs
+        // to lock for copying a pointer
+        std::mutex listeners_mutex_;
+        std::shared_ptr<const Listeners> listeners_;
+        EventTypeSubscriptions subscriptions_;
+
+        // A bounded multiple producer queue (see D. Vyukov's bounded MPMC
+        // queue)
+        struct EventSlot
+        {
+            std::atomic<size_t> sequence;
+            std::shared_ptr<Event> event;
+        };
+        std::unique_ptr<EventSlot[]> events_;
+        size_t events_mask_;
+        std::atomic<size_t> events_head_;
+        char padding_[64];
+        std::atomic<size_t> events_tail_;
+
+        std::mutex overflow_mutex_;
+        std::list<std::shared_ptr<Event> > overflow_;
+        std::atomic<bool> has_overflow_;
 };
 
 
@@ -243,6 +451,8 @@ class SameThreadEventDispatcher : public ThreadSafeEventDispatcher
     public:
         SameThreadEventDispatcher();
 
+        using EventDispatcherInterface::dispatch;
+
         virtual void dispatch(std::shared_ptr<Event> event) override;
 
     private:
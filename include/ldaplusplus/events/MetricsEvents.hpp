@@ -0,0 +1,312 @@
+#ifndef _LDAPLUSPLUS_EVENTS_METRICS_EVENTS_HPP_
+#define _LDAPLUSPLUS_EVENTS_METRICS_EVENTS_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ldaplusplus/events/Events.hpp"
+
+namespace ldaplusplus {
+namespace events {
+
+
+/**
+ * Return the smallest bucket of the histogram such that at least a fraction q
+ * of the counts are in it or in the ones before it.
+ */
+inline size_t histogram_quantile(const std::vector<size_t> &histogram, double q) {
+    size_t total = std::accumulate(histogram.begin(), histogram.end(), size_t(0));
+    if (total == 0) {
+        return 0;
+    }
+
+    size_t count = 0;
+    for (size_t i=0; i<histogram.size(); i++) {
+        count += histogram[i];
+        if (count > 0 && count >= q * total) {
+            return i;
+        }
+    }
+    return histogram.size() - 1;
+}
+
+
+/**
+ * Report where the time went during an epoch of LDA::partial_fit().
+ *
+ * All times are wall clock times in seconds. The E step times are measured
+ * in each worker so their sum can be larger than the epoch's wall time.
+ */
+class EpochTimingEvent : public Event
+{
+    public:
+        static size_t static_type() {
+            static size_t type = get_event_type("EpochTimingEvent");
+            return type;
+        }
+
+        /**
+         * @param wall_time          The duration of the whole epoch
+         * @param queue_wait         The time the main thread waited for the
+         *                           workers to produce variational parameters
+         * @param m_step_online      The time spent in doc_m_step()
+         * @param m_step_batch       The time spent in m_step()
+         * @param worker_e_step_time The time each worker spent in doc_e_step()
+         * @param worker_documents   The number of documents each worker
+         *                           processed
+         * @param e_step_latency     The ith element is the number of
+         *                           documents whose doc_e_step() took from
+         *                           2^i to 2^(i+1) microseconds
+         */
+        EpochTimingEvent(
+            double wall_time,
+            double queue_wait,
+            double m_step_online,
+            double m_step_batch,
+            std::vector<double> worker_e_step_time,
+            std::vector<size_t> worker_documents,
+            std::vector<size_t> e_step_latency = std::vector<size_t>()
+        ) : Event(static_type()),
+            wall_time_(wall_time),
+            queue_wait_(queue_wait),
+            m_step_online_(m_step_online),
+            m_step_batch_(m_step_batch),
+            worker_e_step_time_(std::move(worker_e_step_time)),
+            worker_documents_(std::move(worker_documents)),
+            e_step_latency_(std::move(e_step_latency))
+        {}
+
+        double wall_time() const { return wall_time_; }
+        double queue_wait() const { return queue_wait_; }
+        double m_step_online() const { return m_step_online_; }
+        double m_step_batch() const { return m_step_batch_; }
+
+        /** The time spent in doc_e_step() summed over the workers */
+        double e_step_compute() const {
+            return std::accumulate(
+                worker_e_step_time_.begin(),
+                worker_e_step_time_.end(),
+                0.0
+            );
+        }
+
+        /** The number of documents processed in the epoch */
+        size_t documents() const {
+            return std::accumulate(
+                worker_documents_.begin(),
+                worker_documents_.end(),
+                size_t(0)
+            );
+        }
+
+        /** The throughput of the whole epoch */
+        double documents_per_second() const {
+            return (wall_time_ > 0) ? documents() / wall_time_ : 0;
+        }
+
+        const std::vector<double> & worker_e_step_time() const {
+            return worker_e_step_time_;
+        }
+        const std::vector<size_t> & worker_documents() const {
+            return worker_documents_;
+        }
+
+        const std::vector<size_t> & e_step_latency() const {
+            return e_step_latency_;
+        }
+
+        /**
+         * An upper bound in seconds of the q-quantile of the time
+         * doc_e_step() took per document, computed from the latency
+         * histogram.
+         */
+        double e_step_latency_quantile(double q) const {
+            if (e_step_latency_.empty()) {
+                return 0;
+            }
+            size_t bucket = histogram_quantile(e_step_latency_, q);
+            return std::ldexp(1.0, bucket + 1) * 1e-6;
+        }
+
+        /** The documents each worker processed per second of doc_e_step() */
+        std::vector<double> worker_documents_per_second() const {
+            std::vector<double> dps(worker_documents_.size(), 0);
+            for (size_t i=0; i<dps.size(); i++) {
+                if (worker_e_step_time_[i] > 0) {
+                    dps[i] = worker_documents_[i] / worker_e_step_time_[i];
+                }
+            }
+            return dps;
+        }
+
+    private:
+        double wall_time_;
+        double queue_wait_;
+        double m_step_online_;
+        double m_step_batch_;
+        std::vector<double> worker_e_step_time_;
+        std::vector<size_t> worker_documents_;
+        std::vector<size_t> e_step_latency_;
+};
+
+
+/**
+ * Report how many iterations the E step needed per document during an epoch.
+ *
+ * It is dispatched by the E steps at the end of each epoch (from e_step()).
+ */
+class ExpectationIterationsEvent : public Event
+{
+    public:
+        static size_t static_type() {
+            static size_t type = get_event_type("ExpectationIterationsEvent");
+            return type;
+        }
+
+        /**
+         * @param histogram The ith element is the number of documents for
+         *                  which the E step performed i iterations
+         */
+        ExpectationIterationsEvent(std::vector<size_t> histogram) :
+            Event(static_type()),
+            histogram_(std::move(histogram))
+        {}
+
+        const std::vector<size_t> & histogram() const { return histogram_; }
+
+        /** The number of documents in the histogram */
+        size_t documents() const {
+            return std::accumulate(histogram_.begin(), histogram_.end(), size_t(0));
+        }
+
+        /** The q-quantile of the iterations per document */
+        size_t quantile(double q) const {
+            return histogram_quantile(histogram_, q);
+        }
+
+        /** The mean number of iterations per document */
+        double mean() const {
+            size_t total = 0;
+            for (size_t i=0; i<histogram_.size(); i++) {
+                total += i * histogram_[i];
+            }
+            size_t N = documents();
+            return (N > 0) ? static_cast<double>(total) / N : 0;
+        }
+
+    private:
+        std::vector<size_t> histogram_;
+};
+
+
+/**
+ * Report the cost of a gradient descent minimization performed by an M step.
+ */
+class LineSearchEvent : public Event
+{
+    public:
+        static size_t static_type() {
+            static size_t type = get_event_type("LineSearchEvent");
+            return type;
+        }
+
+        /**
+         * @param iterations  The gradient descent iterations
+         * @param evaluations The times the objective was evaluated by the
+         *                    line search
+         */
+        LineSearchEvent(size_t iterations, size_t evaluations) :
+            Event(static_type()),
+            iterations_(iterations),
+            evaluations_(evaluations)
+        {}
+
+        size_t iterations() const { return iterations_; }
+        size_t evaluations() const { return evaluations_; }
+
+    private:
+        size_t iterations_;
+        size_t evaluations_;
+};
+
+
+/**
+ * Report the hardware counters measured around doc_e_step() or doc_m_step()
+ * during an epoch.
+ *
+ * It is only dispatched when the library is compiled with
+ * LDAPLUSPLUS_PERF_COUNTERS and the counters can be opened. The E step
+ * counters are summed over the workers.
+ */
+class HardwareCountersEvent : public Event
+{
+    public:
+        static size_t static_type() {
+            static size_t type = get_event_type("HardwareCountersEvent");
+            return type;
+        }
+
+        /**
+         * @param phase        Either "doc_e_step" or "doc_m_step"
+         * @param documents    The number of documents that were measured
+         * @param cycles       The cpu cycles
+         * @param instructions The retired instructions
+         * @param cache_misses The last level cache misses
+         */
+        HardwareCountersEvent(
+            std::string phase,
+            size_t documents,
+            uint64_t cycles,
+            uint64_t instructions,
+            uint64_t cache_misses
+        ) : Event(static_type()),
+            phase_(std::move(phase)),
+            documents_(documents),
+            cycles_(cycles),
+            instructions_(instructions),
+            cache_misses_(cache_misses)
+        {}
+
+        const std::string & phase() const { return phase_; }
+        size_t documents() const { return documents_; }
+        uint64_t cycles() const { return cycles_; }
+        uint64_t instructions() const { return instructions_; }
+        uint64_t cache_misses() const { return cache_misses_; }
+
+        double cycles_per_document() const { return per_document(cycles_); }
+        double instructions_per_document() const { return per_document(instructions_); }
+        double cache_misses_per_document() const { return per_document(cache_misses_); }
+
+        double instructions_per_cycle() const {
+            return (cycles_ > 0) ? static_cast<double>(instructions_) / cycles_ : 0;
+        }
+
+        /**
+         * An estimate of the bytes moved from memory per document, namely a
+         * cache line for every last level cache miss.
+         */
+        double bytes_per_document() const {
+            return per_document(cache_misses_) * 64;
+        }
+
+    private:
+        double per_document(uint64_t x) const {
+            return (documents_ > 0) ? static_cast<double>(x) / documents_ : 0;
+        }
+
+        std::string phase_;
+        size_t documents_;
+        uint64_t cycles_;
+        uint64_t instructions_;
+        uint64_t cache_misses_;
+};
+
+
+}  // namespace events
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_EVENTS_METRICS_EVENTS_HPP_
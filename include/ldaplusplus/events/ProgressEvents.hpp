@@ -1,6 +1,7 @@
 #ifndef _LDAPLUSPLUS_EVENTS_PROGRESS_EVENTS_HPP_
 #define _LDAPLUSPLUS_EVENTS_PROGRESS_EVENTS_HPP_
 
+#include <cmath>
 
 #include "ldaplusplus/events/Events.hpp"
 #include "ldaplusplus/Parameters.hpp"
@@ -17,15 +18,32 @@ template <typename Scalar>
 class ExpectationProgressEvent : public Event
 {
     public:
-        ExpectationProgressEvent(Scalar likelihood) :
-            Event("ExpectationProgressEvent"),
-            likelihood_(likelihood)
+        /**
+         * The event type of every ExpectationProgressEvent
+         * regardless of the Scalar type.
+         */
+        static size_t static_type() {
+            static size_t type = get_event_type("ExpectationProgressEvent");
+            return type;
+        }
+
+        ExpectationProgressEvent(Scalar likelihood, int weight = 1) :
+            Event(static_type()),
+            likelihood_(likelihood),
+            weight_(weight)
         {}
 
         Scalar likelihood() const { return likelihood_; }
 
+        /**
+         * The number of identical documents the document stands for (see
+         * corpus::Document::get_weight), the likelihood is of one of them.
+         */
+        int weight() const { return weight_; }
+
     private:
         Scalar likelihood_;
+        int weight_;
 };
 
 
@@ -33,8 +51,17 @@ template <typename Scalar>
 class MaximizationProgressEvent : public Event
 {
     public:
+        /**
+         * The event type of every MaximizationProgressEvent
+         * regardless of the Scalar type.
+         */
+        static size_t static_type() {
+            static size_t type = get_event_type("MaximizationProgressEvent");
+            return type;
+        }
+
         MaximizationProgressEvent(Scalar likelihood) :
-            Event("MaximizationProgressEvent"),
+            Event(static_type()),
             likelihood_(likelihood)
         {}
 
@@ -49,8 +76,17 @@ template <typename Scalar>
 class EpochProgressEvent : public Event
 {
     public:
+        /**
+         * The event type of every EpochProgressEvent
+         * regardless of the Scalar type.
+         */
+        static size_t static_type() {
+            static size_t type = get_event_type("EpochProgressEvent");
+            return type;
+        }
+
         EpochProgressEvent(const std::shared_ptr<parameters::Parameters> parameters) :
-            Event("EpochProgressEvent"),
+            Event(static_type()),
             model_parameters_(parameters)
         {}
 
@@ -62,6 +98,75 @@ class EpochProgressEvent : public Event
        std::shared_ptr<parameters::Parameters> model_parameters_;
 };
 
+
+/**
+ * Report the likelihood of a set of documents computed for the model of an
+ * epoch.
+ *
+ * A LikelihoodEvaluator dispatches it from the evaluation thread so it
+ * reaches the listeners of an LDA some time after the epoch it refers to.
+ * LDA::evaluate dispatches it with the likelihood of the held out words.
+ */
+template <typename Scalar>
+class EvaluationProgressEvent : public Event
+{
+    public:
+        /**
+         * The event type of every EvaluationProgressEvent
+         * regardless of the Scalar type.
+         */
+        static size_t static_type() {
+            static size_t type = get_event_type("EvaluationProgressEvent");
+            return type;
+        }
+
+        /**
+         * @param epoch      The epoch of the model that was evaluated
+         * @param likelihood The sum of the likelihood of the documents
+         * @param documents  The number of evaluated documents
+         * @param words      The number of words in the evaluated documents
+         * @param unseen     The number of words that were not evaluated
+         *                   because the model gives them zero probability
+         */
+        EvaluationProgressEvent(
+            size_t epoch,
+            Scalar likelihood,
+            size_t documents,
+            size_t words,
+            size_t unseen = 0
+        ) :
+            Event(static_type()),
+            epoch_(epoch),
+            likelihood_(likelihood),
+            documents_(documents),
+            words_(words),
+            unseen_(unseen)
+        {}
+
+        size_t epoch() const { return epoch_; }
+        Scalar likelihood() const { return likelihood_; }
+        size_t documents() const { return documents_; }
+        size_t words() const { return words_; }
+        size_t unseen_words() const { return unseen_; }
+
+        /** The mean likelihood per document */
+        Scalar per_document_likelihood() const {
+            return (documents_ > 0) ? likelihood_ / documents_ : 0;
+        }
+
+        /** The perplexity of the documents exp(-likelihood / words) */
+        Scalar perplexity() const {
+            return (words_ > 0) ? std::exp(-likelihood_ / words_) : 0;
+        }
+
+    private:
+        size_t epoch_;
+        Scalar likelihood_;
+        size_t documents_;
+        size_t words_;
+        size_t unseen_;
+};
+
 }  // namespace events
 }  // namespace ldaplusplus
 
@@ -41,7 +41,16 @@ class LineSearch
             const ParameterType &direction
         ) = 0;
 
+        /**
+         * @return The number of times the function has been evaluated by
+         *         this line search
+         */
+        size_t evaluations() const { return evaluations_; }
+
         virtual ~LineSearch(){};
+
+    protected:
+        size_t evaluations_ = 0;
 };
 
 
@@ -67,6 +76,7 @@ class ConstantLineSearch : public LineSearch<ProblemType, ParameterType>
             const ParameterType &direction
         ) {
             x0 -= alpha_ * direction;
+            this->evaluations_++;
 
             return problem.value(x0);
         }
@@ -118,6 +128,7 @@ class ArmijoLineSearch : public LineSearch<ProblemType, ParameterType>
         ) {
             ParameterType x_copy(x0.rows(), x0.cols());
             Scalar value_x0 = problem.value(x0);
+            this->evaluations_++;
             Scalar decrease = beta_ * (grad_x0.array() * direction.array()).sum();
             Scalar value = value_x0;
             Scalar a = 1.0/tau_;
@@ -126,6 +137,7 @@ class ArmijoLineSearch : public LineSearch<ProblemType, ParameterType>
                 a *= tau_;
                 x_copy = x0 - a * direction;
                 value = problem.value(x_copy);
+                this->evaluations_++;
             }
 
             x0 -= a * direction;
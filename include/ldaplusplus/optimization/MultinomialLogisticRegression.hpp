@@ -41,6 +41,22 @@ class MultinomialLogisticRegression
          * @param L  The L2 regularization penalty for the weights
          */
         MultinomialLogisticRegression(const MatrixX &X, const Eigen::VectorXi &y, Scalar L);
+        /**
+         * @param X       The documents defining the minimization problem
+         *                (\f$X \in \mathbb{R}^{D \times N}\f$)
+         * @param y       The class indexes for each document (\f$y \in
+         *                \mathbb{N}^N\f$)
+         * @param L       The L2 regularization penalty for the weights
+         * @param weights A weight for each document (for instance the
+         *                number of identical documents it stands for) that
+         *                multiplies its class weight
+         */
+        MultinomialLogisticRegression(
+            const MatrixX &X,
+            const Eigen::VectorXi &y,
+            Scalar L,
+            VectorX weights
+        );
 
         /**
          * The value of the objective function to be minimized.
@@ -52,7 +68,7 @@ class MultinomialLogisticRegression
          * is the class of the nth document.
          *
          * \f[
-         *     J = -\sum_{n=1}^N C_{y_n}\left(\eta_{y_n}^T X_n - \log\left(
+         *     J = -\sum_{n=1}^N w_n C_{y_n}\left(\eta_{y_n}^T X_n - \log\left(
          *         \sum_{\hat{y}=1}^Y \exp\left( \eta_{\hat{y}}^T X_n \right)
          *         \right)\right) +
          *         \frac{L}{2} \left\| \eta \right\|_F^2
@@ -70,7 +86,7 @@ class MultinomialLogisticRegression
          * \f$y\f$ (a vector with all the values 0 except at the yth position).
          *
          * \f[
-         *     \nabla_{\eta} J = -\sum_{n=1}^N C_{y_n} \left(
+         *     \nabla_{\eta} J = -\sum_{n=1}^N w_n C_{y_n} \left(
          *         X_n I(y_n)^T -
          *         \frac{\sum_{\hat{y}=1}^Y X_n I(\hat{y})^T \exp(\eta_{\hat{y}}^T X_n)}
          *              {\sum_{\hat{y}=1}^Y \exp(\eta_{\hat{y}}^T X_n)}
@@ -90,6 +106,7 @@ class MultinomialLogisticRegression
         const Eigen::VectorXi &y_;
         Scalar L_;
         VectorX Cy_;
+        VectorX weights_;
 };
 
 
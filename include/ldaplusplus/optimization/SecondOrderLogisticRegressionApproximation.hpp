@@ -75,6 +75,27 @@ class SecondOrderLogisticRegressionApproximation
             Scalar L
         );
 
+        /**
+         * @param X       The documents defining the minimization problem
+         *                (\f$X \in \mathbb{R}^{D \times N}\f$)
+         * @param X_var   A vector containing the variance matrix for each
+         *                document (\f$X_{\text{var}} \in \mathbb{R}^{N \times
+         *                D \times D}\f$)
+         * @param y       The class indexes for each document (\f$y \in
+         *                \mathbb{N}^N\f$)
+         * @param L       The L2 regularization penalty for the weights
+         * @param weights A weight for each document (for instance the
+         *                number of identical documents it stands for) that
+         *                multiplies its class weight
+         */
+        SecondOrderLogisticRegressionApproximation(
+            const MatrixX &X,
+            const std::vector<MatrixX> &X_var,
+            const Eigen::VectorXi &y,
+            Scalar L,
+            VectorX weights
+        );
+
         /**
          * The value of the objective function to be minimized.
          *
@@ -87,7 +108,7 @@ class SecondOrderLogisticRegressionApproximation
          * the class description).
          *
          * \f[
-         *     J = - \sum_{n=1}^N C_{y_n} \left(
+         *     J = - \sum_{n=1}^N w_n C_{y_n} \left(
          *         \eta_{y_n}^T X_n -
          *         \log \sum_{\hat{y}=1}^Y \exp(\eta_{\hat{y}}^T X_n) \left(
          *         1 +
@@ -109,7 +130,7 @@ class SecondOrderLogisticRegressionApproximation
          * \f$y\f$ (a vector with all the values 0 except at the yth position).
          *
          * \f[
-         *     \nabla_{\eta} J = - \sum_{n=1}^N C_{y_n} \left(
+         *     \nabla_{\eta} J = - \sum_{n=1}^N w_n C_{y_n} \left(
          *         X_n I(y_n)^T -
          *         \frac{
          *              \sum_{\hat{y}=1}^Y \left(\left(
@@ -146,6 +167,7 @@ class SecondOrderLogisticRegressionApproximation
         const Eigen::VectorXi &y_;
         Scalar L_;
         VectorX Cy_;
+        VectorX weights_;
 };
 
 
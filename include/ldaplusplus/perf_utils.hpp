@@ -0,0 +1,98 @@
+#ifndef _LDAPLUSPLUS_PERF_UTILS_HPP_
+#define _LDAPLUSPLUS_PERF_UTILS_HPP_
+
+#include <cstdint>
+
+namespace ldaplusplus {
+namespace perf_utils {
+
+
+/**
+ * The values of the hardware counters read by PerfCounters.
+ */
+struct CounterValues
+{
+    uint64_t cycles = 0;
+    uint64_t instructions = 0;
+    uint64_t cache_misses = 0;
+
+    CounterValues & operator+=(const CounterValues &other) {
+        cycles += other.cycles;
+        instructions += other.instructions;
+        cache_misses += other.cache_misses;
+        return *this;
+    }
+
+    /**
+     * The difference between two readings. Scaled readings are estimates so
+     * the difference is clamped to 0 instead of wrapping around.
+     */
+    CounterValues operator-(const CounterValues &other) const {
+        CounterValues result;
+        result.cycles = difference(cycles, other.cycles);
+        result.instructions = difference(instructions, other.instructions);
+        result.cache_misses = difference(cache_misses, other.cache_misses);
+        return result;
+    }
+
+    private:
+        static uint64_t difference(uint64_t a, uint64_t b) {
+            return (a > b) ? a - b : 0;
+        }
+};
+
+
+#ifdef LDAPLUSPLUS_PERF_COUNTERS
+
+/**
+ * Count the cycles, instructions and last level cache misses of the calling
+ * thread using perf_event_open (Linux only).
+ *
+ * The counters are opened as a group in the constructor and count only user
+ * space events of the thread that created the object. If the kernel does not
+ * allow opening them (for instance because of perf_event_paranoid) then
+ * available() returns false and read() always returns zeros.
+ *
+ * This class is only implemented when the library is compiled with
+ * LDAPLUSPLUS_PERF_COUNTERS, otherwise it does nothing and costs nothing.
+ */
+class PerfCounters
+{
+    public:
+        PerfCounters();
+        ~PerfCounters();
+
+        PerfCounters(const PerfCounters &) = delete;
+        PerfCounters & operator=(const PerfCounters &) = delete;
+
+        /** Whether the counters could be opened */
+        bool available() const { return leader_ != -1; }
+
+        /**
+         * Read the counters. If they were multiplexed with other events the
+         * values are scaled to estimate the full count.
+         */
+        CounterValues read() const;
+
+    private:
+        int leader_;
+        int instructions_;
+        int cache_misses_;
+};
+
+#else
+
+class PerfCounters
+{
+    public:
+        bool available() const { return false; }
+        CounterValues read() const { return CounterValues(); }
+};
+
+#endif
+
+
+}  // namespace perf_utils
+}  // namespace ldaplusplus
+
+#endif  // _LDAPLUSPLUS_PERF_UTILS_HPP_
@@ -1,14 +1,66 @@
 #ifndef _LDAPLUSPLUS_UTILS_HPP_
 #define _LDAPLUSPLUS_UTILS_HPP_
 
+#include <array>
 #include <cmath>
+#include <cstdint>
 #include <memory>
 #include <mutex>
-#include <array>
+#include <vector>
 
 #include <Eigen/Core>
 
+// Mark a declaration deprecated with a message (C++11 has no [[deprecated]])
+#if defined(__GNUC__) || defined(__clang__)
+#define LDAPLUSPLUS_DEPRECATED(message) __attribute__((deprecated(message)))
+#elif defined(_MSC_VER)
+#define LDAPLUSPLUS_DEPRECATED(message) __declspec(deprecated(message))
+#else
+#define LDAPLUSPLUS_DEPRECATED(message)
+#endif
+
 namespace ldaplusplus {
+namespace thread_utils {
+
+
+/**
+ * The worker index of the threads that are not LDA workers.
+ */
+static const size_t NO_WORKER = static_cast<size_t>(-1);
+
+
+namespace detail {
+    inline size_t & worker_index() {
+        static thread_local size_t index = NO_WORKER;
+        return index;
+    }
+}
+
+
+/**
+ * Return the index of the LDA worker that runs on the calling thread. It is
+ * meant for selecting per worker resources (for instance PRNG streams)
+ * without locking.
+ *
+ * Threads that are not LDA workers have the index NO_WORKER so per worker
+ * resources must fall back to something shared (and locked) for them.
+ */
+inline size_t worker_index() {
+    return detail::worker_index();
+}
+
+
+/**
+ * Set the worker index of the calling thread (see worker_index()).
+ */
+inline void set_worker_index(size_t index) {
+    detail::worker_index() = index;
+}
+
+
+}  // namespace thread_utils
+
+
 namespace math_utils {
 
 
@@ -583,35 +635,179 @@ void sum_cols_scaled(
     }
 }
 
+/**
+ * Xoshiro256 implements the xoshiro256** generator by David Blackman and
+ * Sebastiano Vigna (see http://prng.di.unimi.it/).
+ *
+ * It is small and fast and it provides jump() which is equivalent to 2^128
+ * calls to operator(), thus it can split a seed into non overlapping streams
+ * for use in different threads without any locking.
+ *
+ * see UniformRandomBitGenerator C++ concept
+ * http://en.cppreference.com/w/cpp/concept/UniformRandomBitGenerator
+ */
+class Xoshiro256
+{
+    public:
+        typedef uint64_t result_type;
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return UINT64_MAX; }
+
+        /**
+         * Initialize the state by expanding the seed with splitmix64 as
+         * recommended by the authors.
+         */
+        Xoshiro256(uint64_t random_state = 0) {
+            for (int i=0; i<4; i++) {
+                uint64_t z = (random_state += 0x9e3779b97f4a7c15);
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+                s_[i] = z ^ (z >> 31);
+            }
+        }
+
+        result_type operator()() {
+            const uint64_t result = rotl(s_[1] * 5, 7) * 9;
+            const uint64_t t = s_[1] << 17;
+
+            s_[2] ^= s_[0];
+            s_[3] ^= s_[1];
+            s_[1] ^= s_[2];
+            s_[0] ^= s_[3];
+            s_[2] ^= t;
+            s_[3] = rotl(s_[3], 45);
+
+            return result;
+        }
+
+        /**
+         * Advance the state as if operator() was called 2^128 times.
+         */
+        void jump() {
+            static const uint64_t JUMP[] = {
+                0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                0xa9582618e03fc9aa, 0x39abdc4529b1661c
+            };
+
+            uint64_t s[4] = {0, 0, 0, 0};
+            for (int i=0; i<4; i++) {
+                for (int b=0; b<64; b++) {
+                    if (JUMP[i] & (uint64_t(1) << b)) {
+                        for (int j=0; j<4; j++) {
+                            s[j] ^= s_[j];
+                        }
+                    }
+                    (*this)();
+                }
+            }
+            for (int j=0; j<4; j++) {
+                s_[j] = s[j];
+            }
+        }
+
+    private:
+        static uint64_t rotl(const uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        uint64_t s_[4];
+};
+
+
+/**
+ * WorkerPRNG keeps a non overlapping Xoshiro256 stream for every worker (see
+ * thread_utils::worker_index()) so that the workers draw random numbers
+ * without locking and independently of each other. The threads that are not
+ * workers share one more stream protected by a mutex.
+ *
+ * see UniformRandomBitGenerator C++ concept
+ * http://en.cppreference.com/w/cpp/concept/UniformRandomBitGenerator
+ */
+class WorkerPRNG
+{
+    public:
+        typedef Xoshiro256::result_type result_type;
+        static constexpr result_type min() { return Xoshiro256::min(); }
+        static constexpr result_type max() { return Xoshiro256::max(); }
+
+        /**
+         * The shared stream is the one seeded with random_state and the ith
+         * worker gets it jumped i+1 times.
+         */
+        WorkerPRNG(uint64_t random_state = 0)
+            : shared_(random_state),
+              next_stream_(random_state)
+        {
+            next_stream_.jump();
+        }
+
+        /**
+         * Create the streams of the first workers (the streams that already
+         * exist are kept). It is not thread safe and should be called before
+         * the workers start.
+         */
+        void set_workers(size_t workers) {
+            while (streams_.size() < workers) {
+                streams_.push_back(next_stream_);
+                next_stream_.jump();
+            }
+        }
+
+        result_type operator()() {
+            size_t worker = thread_utils::worker_index();
+            if (worker < streams_.size()) {
+                return streams_[worker]();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            return shared_();
+        }
+
+    private:
+        std::vector<Xoshiro256> streams_;
+        Xoshiro256 shared_;
+        Xoshiro256 next_stream_;
+        std::mutex mutex_;
+};
+
+
 /**
  * Wrap a PRNG with this class in order to be able to pass it around even
  * to other threads and protect its internal state from being corrupted.
  *
+ * Deprecated, it is kept for source compatibility on top of a WorkerPRNG
+ * (shared by the copies) so the PRNG parameter is ignored and the numbers
+ * come from Xoshiro256 streams. Use WorkerPRNG instead.
+ *
  * see UniformRandomBitGenerator C++ concept
  * http://en.cppreference.com/w/cpp/concept/UniformRandomBitGenerator
  */
-template <typename PRNG>
-class ThreadSafePRNG
+template <typename PRNG = Xoshiro256>
+class LDAPLUSPLUS_DEPRECATED("use math_utils::WorkerPRNG") ThreadSafePRNG
 {
     public:
-        typedef typename PRNG::result_type result_type;
-        static constexpr result_type min() { return PRNG::min(); }
-        static constexpr result_type max() { return PRNG::max(); }
+        typedef WorkerPRNG::result_type result_type;
+        static constexpr result_type min() { return WorkerPRNG::min(); }
+        static constexpr result_type max() { return WorkerPRNG::max(); }
 
         ThreadSafePRNG(int random_state) {
-            prng_mutex_ = std::make_shared<std::mutex>();
-            prng_ = std::make_shared<PRNG>(random_state);
+            prng_ = std::make_shared<WorkerPRNG>(random_state);
         }
 
-        result_type operator()() {
-            std::lock_guard<std::mutex> lock(*prng_mutex_);
+        /**
+         * See WorkerPRNG::set_workers(), without it every thread draws from
+         * the locked stream.
+         */
+        void set_workers(size_t workers) {
+            prng_->set_workers(workers);
+        }
 
+        result_type operator()() {
             return (*prng_)();
         }
 
     private:
-        std::shared_ptr<std::mutex> prng_mutex_;
-        std::shared_ptr<PRNG> prng_;
+        std::shared_ptr<WorkerPRNG> prng_;
 };
 
 
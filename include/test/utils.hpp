@@ -12,10 +12,17 @@ typedef ::testing::Types<float, double> ForFloatAndDouble;
 template <typename T>
 class ParameterizedTest : public ::testing::Test {};
 
+// Eigen 3.4 provides the same aliases so we use those to avoid ambiguities
+// in tests that also use namespace Eigen
+#if EIGEN_VERSION_AT_LEAST(3, 3, 90)
+using Eigen::MatrixX;
+using Eigen::VectorX;
+#else
 template <typename T>
 using MatrixX = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
 template <typename T>
 using VectorX = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+#endif
 
 
 template <typename T>
@@ -1,3 +1,7 @@
+#include <iomanip>
+#include <sstream>
+
+#include "ldaplusplus/events/MetricsEvents.hpp"
 #include "ldaplusplus/events/ProgressEvents.hpp"
 
 #include "applications/EpochProgress.hpp"
@@ -7,10 +11,13 @@ EpochProgress::EpochProgress() {
     likelihood_ = 0;
     cnt_likelihoods_ = 0;
     is_first_time_ = true;
+    e_step_documents_ = 0;
+    e_step_iterations_ = 0;
+    line_search_evaluations_ = 0;
 }
 
 void EpochProgress::on_event(std::shared_ptr<events::Event> event) {
-    if (event->id() == "ExpectationProgressEvent") {
+    if (event->type() == events::ExpectationProgressEvent<double>::static_type()) {
         auto progress = std::static_pointer_cast<events::ExpectationProgressEvent<double> >(event);
 
         if (is_first_time_) {
@@ -20,11 +27,65 @@ void EpochProgress::on_event(std::shared_ptr<events::Event> event) {
 
         // Keep track of the likelihood
         if (std::isfinite(progress->likelihood()) && progress->likelihood() < 0) {
-            likelihood_ += progress->likelihood();
-            cnt_likelihoods_++;
+            likelihood_ += progress->weight() * progress->likelihood();
+            cnt_likelihoods_ += progress->weight();
+        }
+    }
+    else if (event->type() == events::ExpectationIterationsEvent::static_type()) {
+        auto iterations = std::static_pointer_cast<events::ExpectationIterationsEvent>(event);
+
+        e_step_documents_ += iterations->documents();
+        for (size_t i=0; i<iterations->histogram().size(); i++) {
+            e_step_iterations_ += i * iterations->histogram()[i];
+        }
+    }
+    else if (event->type() == events::LineSearchEvent::static_type()) {
+        auto line_search = std::static_pointer_cast<events::LineSearchEvent>(event);
+
+        line_search_evaluations_ += line_search->evaluations();
+    }
+    else if (event->type() == events::EpochTimingEvent::static_type()) {
+        auto timing = std::static_pointer_cast<events::EpochTimingEvent>(event);
+        auto worker_dps = timing->worker_documents_per_second();
+        double mean_worker_dps = 0;
+        for (auto dps : worker_dps) {
+            mean_worker_dps += dps / worker_dps.size();
         }
+
+        // format in a separate stream to leave the state of cout untouched
+        std::ostringstream summary;
+        summary << std::fixed << std::setprecision(2)
+                << "Epoch time: " << timing->wall_time() << "s"
+                << " (queue wait " << timing->queue_wait() << "s"
+                << ", E step " << timing->e_step_compute() << "s"
+                << ", M step online " << timing->m_step_online() << "s"
+                << ", batch " << timing->m_step_batch() << "s)"
+                << ", " << timing->documents_per_second() << " docs/s"
+                << " (" << mean_worker_dps << " per worker)";
+        if (e_step_documents_ > 0) {
+            summary << ", " << static_cast<double>(e_step_iterations_) / e_step_documents_
+                    << " E step iterations per doc";
+        }
+        if (line_search_evaluations_ > 0) {
+            summary << ", " << line_search_evaluations_ << " line search evaluations";
+        }
+        std::cout << summary.str() << std::endl;
+
+        e_step_documents_ = 0;
+        e_step_iterations_ = 0;
+        line_search_evaluations_ = 0;
     }
-    else if (event->id() == "EpochProgressEvent") {
+    else if (event->type() == events::EvaluationProgressEvent<double>::static_type()) {
+        auto evaluation = std::static_pointer_cast<events::EvaluationProgressEvent<double> >(event);
+
+        // the evaluation runs in its own thread so it may be reported after
+        // the next epoch has started
+        std::cout << "Epoch " << evaluation->epoch()
+                  << " per document likelihood: " << evaluation->per_document_likelihood()
+                  << ", perplexity: " << evaluation->perplexity()
+                  << " (" << evaluation->documents() << " documents)" << std::endl;
+    }
+    else if (event->type() == events::EpochProgressEvent<double>::static_type()) {
         if (likelihood_ < 0) {
             std::cout << "Per document likelihood: " <<
                 likelihood_ / cnt_likelihoods_ << std::endl;
@@ -38,3 +99,12 @@ void EpochProgress::on_event(std::shared_ptr<events::Event> event) {
     }
 
 }
+
+bool EpochProgress::listens_to(size_t type) const {
+    return type == events::ExpectationProgressEvent<double>::static_type() ||
+           type == events::ExpectationIterationsEvent::static_type() ||
+           type == events::LineSearchEvent::static_type() ||
+           type == events::EpochTimingEvent::static_type() ||
+           type == events::EvaluationProgressEvent<double>::static_type() ||
+           type == events::EpochProgressEvent<double>::static_type();
+}
@@ -8,15 +8,20 @@ ExpectationProgress::ExpectationProgress(int print_every) {
 }
 
 void ExpectationProgress::on_event(std::shared_ptr<events::Event> event) {
-    if (event->id() == "ExpectationProgressEvent") {
+    if (event->type() == events::ExpectationProgressEvent<double>::static_type()) {
 
         e_iterations_++;
         if (e_iterations_ % print_every_ == 0) {
             std::cout << e_iterations_ << std::endl;
         }
     }
-    else if (event->id() == "EpochProgressEvent") {
+    else if (event->type() == events::EpochProgressEvent<double>::static_type()) {
         // If one Epoch is completed reset the member variables
         e_iterations_ = 0;
     }
 }
+
+bool ExpectationProgress::listens_to(size_t type) const {
+    return type == events::ExpectationProgressEvent<double>::static_type() ||
+           type == events::EpochProgressEvent<double>::static_type();
+}
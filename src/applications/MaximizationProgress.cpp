@@ -7,14 +7,19 @@ MaximizationProgress::MaximizationProgress() {
 }
 
 void MaximizationProgress::on_event(std::shared_ptr<events::Event> event) {
-    if (event->id() == "MaximizationProgressEvent") {
+    if (event->type() == events::MaximizationProgressEvent<double>::static_type()) {
 
         auto progress = std::static_pointer_cast<events::MaximizationProgressEvent<double> >(event);
         std::cout << "log p(y | \\bar{z}, eta): " << progress->likelihood() << std::endl;
         m_iterations_++;
     }
-    else if (event->id() == "EpochProgressEvent") {
+    else if (event->type() == events::EpochProgressEvent<double>::static_type()) {
         // If one Epoch is completed reset the member variables
         m_iterations_ = 0;
     }
 }
+
+bool MaximizationProgress::listens_to(size_t type) const {
+    return type == events::MaximizationProgressEvent<double>::static_type() ||
+           type == events::EpochProgressEvent<double>::static_type();
+}
@@ -0,0 +1,480 @@
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "ldaplusplus/events/MetricsEvents.hpp"
+#include "ldaplusplus/events/ProgressEvents.hpp"
+
+#include "applications/MetricsExporter.hpp"
+
+static const double QUANTILES[] = {0.5, 0.9, 0.99};
+static const char * QUANTILE_NAMES[] = {"0.5", "0.9", "0.99"};
+
+/**
+ * Read a value in kB from /proc/self/status and return it in bytes or NaN if
+ * it is not available (for instance not on Linux).
+ */
+static double read_memory_status(const std::string &key) {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, key.size(), key) == 0 && line[key.size()] == ':') {
+            std::istringstream value(line.substr(key.size() + 1));
+            double kb;
+            if (value >> kb) {
+                return kb * 1024;
+            }
+        }
+    }
+
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+/**
+ * Write a number so that it is valid JSON (non finite values become null).
+ */
+static void write_json_number(std::ostream &out, double x) {
+    if (std::isfinite(x)) {
+        out << x;
+    } else {
+        out << "null";
+    }
+}
+
+/**
+ * Write a metric in the Prometheus text exposition format.
+ */
+static void write_metric(
+    std::ostream &out,
+    const std::string &name,
+    const std::string &type,
+    const std::string &help
+) {
+    out << "# HELP ldaplusplus_" << name << " " << help << "\n"
+        << "# TYPE ldaplusplus_" << name << " " << type << "\n";
+}
+
+static void write_sample(
+    std::ostream &out,
+    const std::string &name,
+    double value,
+    const std::string &labels=""
+) {
+    out << "ldaplusplus_" << name;
+    if (!labels.empty()) {
+        out << "{" << labels << "}";
+    }
+    out << " ";
+    if (std::isfinite(value)) {
+        out << value;
+    } else {
+        out << "NaN";
+    }
+    out << "\n";
+}
+
+MetricsExporter::MetricsExporter(std::string path, double update_interval) {
+    path_ = std::move(path);
+    update_interval_ = update_interval;
+    last_update_ = std::chrono::steady_clock::now();
+    failed_ = false;
+
+    epochs_ = 0;
+    documents_total_ = 0;
+
+    epoch_documents_ = 0;
+    expectation_likelihood_ = 0;
+    expectation_likelihoods_ = 0;
+    line_search_iterations_ = 0;
+    line_search_evaluations_ = 0;
+
+    wall_time_ = 0;
+    queue_wait_ = 0;
+    e_step_time_ = 0;
+    m_step_online_ = 0;
+    m_step_batch_ = 0;
+    documents_per_second_ = 0;
+    e_step_latency_.resize(sizeof(QUANTILES) / sizeof(double), 0);
+    e_step_iterations_.resize(sizeof(QUANTILES) / sizeof(double), 0);
+    e_step_iterations_mean_ = 0;
+    last_expectation_likelihood_ = std::numeric_limits<double>::quiet_NaN();
+    previous_expectation_likelihood_ = std::numeric_limits<double>::quiet_NaN();
+    maximization_likelihood_ = std::numeric_limits<double>::quiet_NaN();
+    last_line_search_iterations_ = 0;
+    last_line_search_evaluations_ = 0;
+    evaluation_epoch_ = 0;
+    evaluation_likelihood_ = std::numeric_limits<double>::quiet_NaN();
+    perplexity_ = std::numeric_limits<double>::quiet_NaN();
+
+    // start the JSON-lines log from scratch
+    std::ofstream log(path_ + ".jsonl", std::ios::trunc);
+    if (!log) {
+        throw std::runtime_error("Couldn't open the metrics file " + path_ + ".jsonl");
+    }
+}
+
+void MetricsExporter::on_event(std::shared_ptr<events::Event> event) {
+    // the listener runs in the middle of training so a failed write only
+    // stops the export (see fail())
+    if (failed_) {
+        return;
+    }
+
+    if (event->type() == events::ExpectationProgressEvent<double>::static_type()) {
+        auto progress = std::static_pointer_cast<events::ExpectationProgressEvent<double> >(event);
+
+        epoch_documents_++;
+        documents_total_++;
+        if (std::isfinite(progress->likelihood()) && progress->likelihood() < 0) {
+            expectation_likelihood_ += progress->weight() * progress->likelihood();
+            expectation_likelihoods_ += progress->weight();
+        }
+
+        // Keep the textfile fresh during long epochs
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - last_update_).count() > update_interval_) {
+            write_textfile();
+        }
+    }
+    else if (event->type() == events::MaximizationProgressEvent<double>::static_type()) {
+        auto progress = std::static_pointer_cast<events::MaximizationProgressEvent<double> >(event);
+
+        maximization_likelihood_ = progress->likelihood();
+    }
+    else if (event->type() == events::ExpectationIterationsEvent::static_type()) {
+        auto iterations = std::static_pointer_cast<events::ExpectationIterationsEvent>(event);
+
+        for (size_t i=0; i<e_step_iterations_.size(); i++) {
+            e_step_iterations_[i] = iterations->quantile(QUANTILES[i]);
+        }
+        e_step_iterations_mean_ = iterations->mean();
+    }
+    else if (event->type() == events::LineSearchEvent::static_type()) {
+        auto line_search = std::static_pointer_cast<events::LineSearchEvent>(event);
+
+        line_search_iterations_ += line_search->iterations();
+        line_search_evaluations_ += line_search->evaluations();
+    }
+    else if (event->type() == events::EpochTimingEvent::static_type()) {
+        auto timing = std::static_pointer_cast<events::EpochTimingEvent>(event);
+
+        wall_time_ = timing->wall_time();
+        queue_wait_ = timing->queue_wait();
+        e_step_time_ = timing->e_step_compute();
+        m_step_online_ = timing->m_step_online();
+        m_step_batch_ = timing->m_step_batch();
+        documents_per_second_ = timing->documents_per_second();
+        worker_documents_per_second_ = timing->worker_documents_per_second();
+        for (size_t i=0; i<e_step_latency_.size(); i++) {
+            e_step_latency_[i] = timing->e_step_latency_quantile(QUANTILES[i]);
+        }
+    }
+    else if (event->type() == events::HardwareCountersEvent::static_type()) {
+        auto counters = std::static_pointer_cast<events::HardwareCountersEvent>(event);
+
+        hardware_counters_[counters->phase()] = counters;
+    }
+    else if (event->type() == events::EvaluationProgressEvent<double>::static_type()) {
+        auto evaluation = std::static_pointer_cast<events::EvaluationProgressEvent<double> >(event);
+
+        evaluation_epoch_ = evaluation->epoch();
+        evaluation_likelihood_ = evaluation->per_document_likelihood();
+        perplexity_ = evaluation->perplexity();
+    }
+    else if (event->type() == events::EpochProgressEvent<double>::static_type()) {
+        epochs_++;
+        previous_expectation_likelihood_ = last_expectation_likelihood_;
+        last_expectation_likelihood_ = (expectation_likelihoods_ > 0) ?
+            expectation_likelihood_ / expectation_likelihoods_ :
+            std::numeric_limits<double>::quiet_NaN();
+        last_line_search_iterations_ = line_search_iterations_;
+        last_line_search_evaluations_ = line_search_evaluations_;
+
+        append_json();
+
+        epoch_documents_ = 0;
+        expectation_likelihood_ = 0;
+        expectation_likelihoods_ = 0;
+        line_search_iterations_ = 0;
+        line_search_evaluations_ = 0;
+
+        if (!failed_) {
+            write_textfile();
+        }
+    }
+}
+
+bool MetricsExporter::listens_to(size_t type) const {
+    return type == events::ExpectationProgressEvent<double>::static_type() ||
+           type == events::MaximizationProgressEvent<double>::static_type() ||
+           type == events::ExpectationIterationsEvent::static_type() ||
+           type == events::LineSearchEvent::static_type() ||
+           type == events::EpochTimingEvent::static_type() ||
+           type == events::HardwareCountersEvent::static_type() ||
+           type == events::EvaluationProgressEvent<double>::static_type() ||
+           type == events::EpochProgressEvent<double>::static_type();
+}
+
+void MetricsExporter::write_textfile() {
+    last_update_ = std::chrono::steady_clock::now();
+
+    std::ostringstream out;
+    out.precision(10);
+
+    write_metric(out, "epochs_total", "counter", "Completed training epochs");
+    write_sample(out, "epochs_total", epochs_);
+    write_metric(out, "documents_total", "counter", "Documents processed by the E step");
+    write_sample(out, "documents_total", documents_total_);
+    write_metric(out, "epoch_documents", "gauge", "Documents processed in the current epoch");
+    write_sample(out, "epoch_documents", epoch_documents_);
+
+    write_metric(out, "epoch_seconds", "gauge", "Duration of each phase of the last epoch");
+    write_sample(out, "epoch_seconds", wall_time_, "phase=\"wall\"");
+    write_sample(out, "epoch_seconds", queue_wait_, "phase=\"queue_wait\"");
+    write_sample(out, "epoch_seconds", e_step_time_, "phase=\"e_step\"");
+    write_sample(out, "epoch_seconds", m_step_online_, "phase=\"m_step_online\"");
+    write_sample(out, "epoch_seconds", m_step_batch_, "phase=\"m_step_batch\"");
+
+    write_metric(out, "documents_per_second", "gauge", "Throughput of the last epoch");
+    write_sample(out, "documents_per_second", documents_per_second_);
+    write_metric(
+        out,
+        "worker_documents_per_second",
+        "gauge",
+        "Documents per second of E step of each worker in the last epoch"
+    );
+    for (size_t i=0; i<worker_documents_per_second_.size(); i++) {
+        write_sample(
+            out,
+            "worker_documents_per_second",
+            worker_documents_per_second_[i],
+            "worker=\"" + std::to_string(i) + "\""
+        );
+    }
+
+    write_metric(
+        out,
+        "e_step_latency_seconds",
+        "gauge",
+        "Upper bound of the quantiles of the E step time per document in the last epoch"
+    );
+    for (size_t i=0; i<e_step_latency_.size(); i++) {
+        write_sample(
+            out,
+            "e_step_latency_seconds",
+            e_step_latency_[i],
+            std::string("quantile=\"") + QUANTILE_NAMES[i] + "\""
+        );
+    }
+    write_metric(
+        out,
+        "e_step_iterations",
+        "gauge",
+        "Quantiles of the E step iterations per document in the last epoch"
+    );
+    for (size_t i=0; i<e_step_iterations_.size(); i++) {
+        write_sample(
+            out,
+            "e_step_iterations",
+            e_step_iterations_[i],
+            std::string("quantile=\"") + QUANTILE_NAMES[i] + "\""
+        );
+    }
+    write_metric(
+        out,
+        "e_step_iterations_mean",
+        "gauge",
+        "Mean E step iterations per document in the last epoch"
+    );
+    write_sample(out, "e_step_iterations_mean", e_step_iterations_mean_);
+
+    write_metric(
+        out,
+        "line_search_evaluations",
+        "gauge",
+        "Objective evaluations by the M step line search in the last epoch"
+    );
+    write_sample(out, "line_search_evaluations", last_line_search_evaluations_);
+
+    write_metric(out, "likelihood", "gauge", "Likelihood at the end of the last epoch");
+    write_sample(out, "likelihood", last_expectation_likelihood_, "step=\"expectation\"");
+    write_sample(out, "likelihood", maximization_likelihood_, "step=\"maximization\"");
+    write_sample(out, "likelihood", evaluation_likelihood_, "step=\"evaluation\"");
+    write_metric(
+        out,
+        "likelihood_change",
+        "gauge",
+        "Change of the per document likelihood since the previous epoch"
+    );
+    write_sample(
+        out,
+        "likelihood_change",
+        last_expectation_likelihood_ - previous_expectation_likelihood_
+    );
+
+    write_metric(
+        out,
+        "perplexity",
+        "gauge",
+        "Perplexity of the evaluation documents for the last evaluated epoch"
+    );
+    write_sample(out, "perplexity", perplexity_);
+    write_metric(out, "evaluation_epoch", "gauge", "The last epoch that was evaluated");
+    write_sample(out, "evaluation_epoch", evaluation_epoch_);
+
+    if (!hardware_counters_.empty()) {
+        write_metric(out, "cycles_per_document", "gauge", "CPU cycles per document in the last epoch");
+        for (auto &kv : hardware_counters_) {
+            write_sample(out, "cycles_per_document", kv.second->cycles_per_document(),
+                         "phase=\"" + kv.first + "\"");
+        }
+        write_metric(out, "instructions_per_cycle", "gauge", "Instructions per cycle in the last epoch");
+        for (auto &kv : hardware_counters_) {
+            write_sample(out, "instructions_per_cycle", kv.second->instructions_per_cycle(),
+                         "phase=\"" + kv.first + "\"");
+        }
+        write_metric(
+            out,
+            "cache_misses_per_document",
+            "gauge",
+            "Last level cache misses per document in the last epoch"
+        );
+        for (auto &kv : hardware_counters_) {
+            write_sample(out, "cache_misses_per_document", kv.second->cache_misses_per_document(),
+                         "phase=\"" + kv.first + "\"");
+        }
+        write_metric(
+            out,
+            "memory_bytes_per_document",
+            "gauge",
+            "Estimated bytes moved from memory per document in the last epoch"
+        );
+        for (auto &kv : hardware_counters_) {
+            write_sample(out, "memory_bytes_per_document", kv.second->bytes_per_document(),
+                         "phase=\"" + kv.first + "\"");
+        }
+    }
+
+    double rss = read_memory_status("VmRSS");
+    double hwm = read_memory_status("VmHWM");
+    if (std::isfinite(rss)) {
+        write_metric(out, "resident_memory_bytes", "gauge", "Resident memory size");
+        write_sample(out, "resident_memory_bytes", rss);
+    }
+    if (std::isfinite(hwm)) {
+        write_metric(out, "peak_resident_memory_bytes", "gauge", "Peak resident memory size");
+        write_sample(out, "peak_resident_memory_bytes", hwm);
+    }
+
+    write_metric(out, "last_update_timestamp_seconds", "gauge", "Time of the last update");
+    write_sample(out, "last_update_timestamp_seconds", std::time(nullptr));
+
+    // Write to a temporary file and rename it so that a scraper never sees a
+    // partially written file
+    std::string tmp_path = path_ + ".tmp";
+    {
+        std::ofstream file(tmp_path, std::ios::trunc);
+        file << out.str();
+        if (!file) {
+            fail("Couldn't write the metrics file " + tmp_path);
+            return;
+        }
+    }
+    if (std::rename(tmp_path.c_str(), path_.c_str()) != 0) {
+        fail("Couldn't rename the metrics file to " + path_);
+    }
+}
+
+void MetricsExporter::append_json() {
+    std::ostringstream out;
+    out.precision(10);
+
+    out << "{\"epoch\": " << epochs_
+        << ", \"timestamp\": " << std::time(nullptr)
+        << ", \"documents\": " << epoch_documents_
+        << ", \"wall_seconds\": ";
+    write_json_number(out, wall_time_);
+    out << ", \"queue_wait_seconds\": ";
+    write_json_number(out, queue_wait_);
+    out << ", \"e_step_seconds\": ";
+    write_json_number(out, e_step_time_);
+    out << ", \"m_step_online_seconds\": ";
+    write_json_number(out, m_step_online_);
+    out << ", \"m_step_batch_seconds\": ";
+    write_json_number(out, m_step_batch_);
+    out << ", \"documents_per_second\": ";
+    write_json_number(out, documents_per_second_);
+    out << ", \"worker_documents_per_second\": [";
+    for (size_t i=0; i<worker_documents_per_second_.size(); i++) {
+        out << ((i > 0) ? ", " : "");
+        write_json_number(out, worker_documents_per_second_[i]);
+    }
+    out << "], \"e_step_latency_seconds\": {";
+    for (size_t i=0; i<e_step_latency_.size(); i++) {
+        out << ((i > 0) ? ", " : "") << "\"" << QUANTILE_NAMES[i] << "\": ";
+        write_json_number(out, e_step_latency_[i]);
+    }
+    out << "}, \"e_step_iterations\": {";
+    for (size_t i=0; i<e_step_iterations_.size(); i++) {
+        out << ((i > 0) ? ", " : "") << "\"" << QUANTILE_NAMES[i] << "\": "
+            << e_step_iterations_[i];
+    }
+    out << ", \"mean\": ";
+    write_json_number(out, e_step_iterations_mean_);
+    out << "}, \"line_search_iterations\": " << last_line_search_iterations_
+        << ", \"line_search_evaluations\": " << last_line_search_evaluations_
+        << ", \"expectation_likelihood\": ";
+    write_json_number(out, last_expectation_likelihood_);
+    out << ", \"maximization_likelihood\": ";
+    write_json_number(out, maximization_likelihood_);
+    if (evaluation_epoch_ > 0) {
+        // the evaluation runs in its own thread so it may lag behind
+        out << ", \"evaluation\": {\"epoch\": " << evaluation_epoch_
+            << ", \"likelihood\": ";
+        write_json_number(out, evaluation_likelihood_);
+        out << ", \"perplexity\": ";
+        write_json_number(out, perplexity_);
+        out << "}";
+    }
+    if (!hardware_counters_.empty()) {
+        out << ", \"hardware_counters\": {";
+        bool first = true;
+        for (auto &kv : hardware_counters_) {
+            out << ((first) ? "" : ", ") << "\"" << kv.first << "\": {"
+                << "\"cycles_per_document\": ";
+            write_json_number(out, kv.second->cycles_per_document());
+            out << ", \"instructions_per_document\": ";
+            write_json_number(out, kv.second->instructions_per_document());
+            out << ", \"instructions_per_cycle\": ";
+            write_json_number(out, kv.second->instructions_per_cycle());
+            out << ", \"cache_misses_per_document\": ";
+            write_json_number(out, kv.second->cache_misses_per_document());
+            out << ", \"memory_bytes_per_document\": ";
+            write_json_number(out, kv.second->bytes_per_document());
+            out << "}";
+            first = false;
+        }
+        out << "}";
+    }
+    out << ", \"resident_memory_bytes\": ";
+    write_json_number(out, read_memory_status("VmRSS"));
+    out << ", \"peak_resident_memory_bytes\": ";
+    write_json_number(out, read_memory_status("VmHWM"));
+    out << "}\n";
+
+    std::ofstream log(path_ + ".jsonl", std::ios::app);
+    log << out.str();
+    if (!log) {
+        fail("Couldn't append to the metrics file " + path_ + ".jsonl");
+    }
+}
+
+void MetricsExporter::fail(const std::string &message) {
+    std::cerr << message << ", the metrics will no longer be exported"
+              << std::endl;
+    failed_ = true;
+}
@@ -3,10 +3,17 @@
 #include "applications/lda_io.hpp"
 #include "applications/SnapshotEvery.hpp"
 
-SnapshotEvery::SnapshotEvery(std::string path, int save_every) {
+SnapshotEvery::SnapshotEvery(
+    std::string path,
+    int save_every,
+    std::shared_ptr<const corpus::Vocabulary> vocabulary,
+    int hash_buckets
+) {
     seen_so_far_ = 0;
     save_every_ = save_every;
     path_ = std::move(path);
+    vocabulary_ = std::move(vocabulary);
+    hash_buckets_ = hash_buckets;
 }
 
 void SnapshotEvery::snapshot(
@@ -18,11 +25,11 @@ void SnapshotEvery::snapshot(
     actual_path.width(3);
     actual_path << seen_so_far_;
 
-    io::save_lda(actual_path.str(), parameters);
+    io::save_lda(actual_path.str(), parameters, vocabulary_, hash_buckets_);
 }
 
 void SnapshotEvery::on_event(std::shared_ptr<events::Event> event) {
-    if (event->id() == "EpochProgressEvent") {
+    if (event->type() == events::EpochProgressEvent<double>::static_type()) {
         auto progress = std::static_pointer_cast<events::EpochProgressEvent<double> >(event);
 
         seen_so_far_ ++;
@@ -31,3 +38,7 @@ void SnapshotEvery::on_event(std::shared_ptr<events::Event> event) {
         }
     }
 }
+
+bool SnapshotEvery::listens_to(size_t type) const {
+    return type == events::EpochProgressEvent<double>::static_type();
+}
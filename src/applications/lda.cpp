@@ -1,44 +1,149 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <Eigen/Core>
 #include <docopt/docopt.h>
 
 #include "ldaplusplus/LDABuilder.hpp"
 #include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/ModelFile.hpp"
 #include "ldaplusplus/NumpyFormat.hpp"
 
 #include "applications/EpochProgress.hpp"
 #include "applications/ExpectationProgress.hpp"
 #include "applications/lda_io.hpp"
 #include "applications/MaximizationProgress.hpp"
+#include "applications/MetricsExporter.hpp"
 #include "applications/SnapshotEvery.hpp"
+#include "applications/utils.hpp"
 
 using namespace ldaplusplus;
 
 
+// Hash the word ids into the buckets of the model being read (MODEL or
+// --continue) or into --hash_buckets buckets when training a new model
+// (nullptr to keep the words)
+std::shared_ptr<corpus::FeatureHasher> create_hasher(
+    std::map<std::string, docopt::value> &args
+) {
+    long buckets = args["--hash_buckets"].asLong();
+    std::string model_path;
+    if (!args["train"].asBool()) {
+        model_path = args["MODEL"].asString();
+    } else if (args["--continue"]) {
+        model_path = args["--continue"].asString();
+    }
+    if (!model_path.empty()) {
+        long saved_buckets = io::model_hash_buckets(model_path);
+        if (buckets > 0 && buckets != saved_buckets) {
+            throw std::runtime_error(
+                model_path + " was trained with " +
+                std::to_string(saved_buckets) + " hash buckets"
+            );
+        }
+        buckets = saved_buckets;
+    }
+
+    if (buckets <= 0) {
+        return nullptr;
+    }
+
+    return std::make_shared<corpus::FeatureHasher>(buckets);
+}
+
+
+// Read the word counts of a file, hashing them --chunk_size documents at a
+// time when there is a hasher (see create_hasher)
+void read_documents(
+    std::map<std::string, docopt::value> &args,
+    std::string path,
+    Eigen::MatrixXi &X
+) {
+    auto hasher = create_hasher(args);
+    if (hasher) {
+        io::parse_input_data(path, *hasher, args["--chunk_size"].asLong(), X);
+    } else {
+        io::parse_input_data(path, X);
+    }
+}
+
+
 LDA<double> create_lda_for_train(
     std::map<std::string, docopt::value> &args,  // should be const but const
                                                  // C++ map is annoying
-    const Eigen::MatrixXi & X
+    Eigen::MatrixXi & X,
+    std::shared_ptr<corpus::Vocabulary> & vocabulary
 ) {
     LDABuilder<double> builder;
 
+    // Train only on the words of the model we continue from or the words
+    // that appear at least min_count times (X is compacted in place)
+    std::shared_ptr<parameters::SupervisedModelParameters<double> > model;
+    if (args["--continue"]) {
+        model = io::load_lda(args["--continue"].asString());
+        vocabulary = io::compact_lda(model);
+    } else if (args["--min_count"].asLong() > 0) {
+        vocabulary = std::make_shared<corpus::Vocabulary>(
+            X,
+            args["--min_count"].asLong()
+        );
+    }
+    if (vocabulary) {
+        X = vocabulary->compact(X);
+    }
+
     // Start building the LDA model by adding the number of iterations and
     // workers
     builder.set_iterations(args["--iterations"].asLong());
     builder.set_workers(args["--workers"].asLong());
-
-    // Add the parameters regarding the Expectation step
+    builder.set_squarem(args["--squarem"].asBool());
+    builder.set_deduplicate(args["--deduplicate"].asBool());
+
+    // Stop early using the likelihood of the evaluator if there is one
+    double compute_likelihood = std::stof(args["--compute_likelihood"].asString());
+    double tolerance = std::stof(args["--tolerance"].asString());
+    builder.set_convergence_tolerance(tolerance, compute_likelihood > 0);
+
+    // Add the parameters regarding the Expectation step (the extrapolation
+    // and the convergence use the evaluator if there is one otherwise the
+    // bound of every training document)
+    bool e_step_likelihood = compute_likelihood <= 0 &&
+        (args["--squarem"].asBool() || tolerance > 0);
     builder.set_classic_e_step(
         args["--e_step_iterations"].asLong(),
         std::stof(args["--e_step_tolerance"].asString()),
-        std::stof(args["--compute_likelihood"].asString()),
+        (e_step_likelihood) ? 1.0 : 0.0,
         args["--random_state"].asLong()
     );
-    
+
+    // Compute the likelihood in a low priority thread instead of the workers
+    utils::add_likelihood_evaluator(
+        args,
+        X,
+        builder,
+        [&args, &vocabulary](std::string path, Eigen::MatrixXi &X_held_out) {
+            read_documents(args, path, X_held_out);
+            if (vocabulary) {
+                // the words the model does not know cannot be evaluated, so
+                // report how many tokens are left out of the perplexity
+                long tokens = X_held_out.sum();
+                X_held_out = vocabulary->compact(X_held_out);
+                if (!args["--quiet"].asBool()) {
+                    std::cout << "Held out tokens out of vocabulary: "
+                              << tokens - X_held_out.sum() << std::endl;
+                }
+            }
+        }
+    );
+
+
     // Initialize the model parameters
-    if (args["--continue"]) {
-        auto model = io::load_lda(args["--continue"].asString());
+    if (model) {
         builder.initialize_topics_from_model(model);
     } else if (args["--initialize_random"].asBool()) {
         builder.initialize_topics_random(
@@ -62,11 +167,12 @@ LDA<double> create_lda_for_train(
     return builder;
 }
 
-LDA<double> create_lda_for_transform(
+template <typename Scalar>
+LDA<Scalar> create_lda_for_transform(
     std::map<std::string, docopt::value> &args,
-    std::shared_ptr<parameters::ModelParameters<double>> model
+    std::shared_ptr<parameters::ModelParametersView<Scalar> > model
 ) {
-    LDABuilder<double> builder;
+    LDABuilder<Scalar> builder;
 
     builder.set_workers(args["--workers"].asLong());
 
@@ -76,24 +182,176 @@ LDA<double> create_lda_for_transform(
         0.0
     );
 
-    builder.initialize_topics_from_model(model);
+    builder.initialize_from_view(model);
 
     // LDABuilder can be implicitly cashed in LDA
     return builder;
 }
 
+/**
+ * Zero the counts of the words a model gives zero probability in every
+ * topic (for instance the words dropped by a model saved with a vocabulary)
+ * keeping the original ids.
+ *
+ * Only the columns of beta of the words that appear in the documents are
+ * checked, once each, so that a large mapped model is not scanned whole
+ * before the first document.
+ */
+template <typename Scalar>
+class ModelWordMask
+{
+    public:
+        ModelWordMask(std::shared_ptr<const parameters::ModelParametersView<Scalar> > model)
+            : model_(model),
+              checked_(model->beta.cols(), UNCHECKED)
+        {}
+
+        void mask(Eigen::MatrixXi &X) {
+            // the rows the model does not have are left to LDA to reject
+            int words = std::min<int>(X.rows(), checked_.size());
+            for (int j=0; j<X.cols(); j++) {
+                for (int i=0; i<words; i++) {
+                    if (X(i, j) != 0 && !modelled(i)) {
+                        X(i, j) = 0;
+                    }
+                }
+            }
+        }
+
+    private:
+        enum : char { UNCHECKED, MODELLED, DROPPED };
+
+        bool modelled(int word) {
+            if (checked_[word] == UNCHECKED) {
+                bool nonzero = (model_->beta.col(word).array() != 0).any();
+                checked_[word] = (nonzero) ? MODELLED : DROPPED;
+            }
+            return checked_[word] == MODELLED;
+        }
+
+        std::shared_ptr<const parameters::ModelParametersView<Scalar> > model_;
+        std::vector<char> checked_;
+};
+
+// Write the topic mixtures of the documents with a model of the precision
+// of Scalar
+template <typename Scalar>
+void transform_documents(std::map<std::string, docopt::value> &args) {
+    using MatrixX = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+    // Map the LDA model read-only and mask the words it does not model
+    auto model = io::map_lda<Scalar>(args["MODEL"].asString());
+    ModelWordMask<Scalar> vocabulary(model);
+
+    auto lda = create_lda_for_transform<Scalar>(args, model);
+
+    // Add the listeners to be used (there are no epochs to report)
+    if (!args["--quiet"].asBool()) {
+        lda.get_event_dispatcher()->template add_listener<ExpectationProgress>();
+    }
+
+    // Read the documents and write the topic mixtures in chunks so that
+    // the memory needed does not depend on the number of documents
+    numpy_format::NumpyInputStream<int> input(args["DATA"].asString());
+    size_t chunk_size = args["--chunk_size"].asLong();
+    auto hasher = create_hasher(args);
+    auto source = [&input, chunk_size, hasher, &vocabulary](Eigen::MatrixXi &X) {
+        bool more = input.read(X, chunk_size);
+        if (hasher && X.cols() > 0) {
+            X = hasher->transform(X);
+        }
+        vocabulary.mask(X);
+        return more;
+    };
+    long top_topics = args["--top_topics"].asLong();
+    double topic_threshold = std::stof(args["--topic_threshold"].asString());
+
+    if (top_topics > 0 || topic_threshold > 0) {
+        // keep only the largest topic proportions of every document
+        io::SparseTopicsWriter output(args["OUTPUT"].asString());
+        lda.transform_sparse(
+            source,
+            [&output](const Eigen::SparseMatrix<Scalar> &topics) {
+                output.write(topics.template cast<double>());
+            },
+            top_topics,
+            topic_threshold
+        );
+        output.close();
+    } else {
+        numpy_format::NumpyOutputStream<double> output(
+            args["OUTPUT"].asString(),
+            model->beta.rows()
+        );
+        lda.transform(
+            source,
+            [&output](const MatrixX &doc_topic_distribution) {
+                output.write(doc_topic_distribution.template cast<double>());
+            }
+        );
+        output.close();
+    }
+}
+
+
+// Print the document completion perplexity of a model of the precision of
+// Scalar
+template <typename Scalar>
+void evaluate_documents(std::map<std::string, docopt::value> &args) {
+    Eigen::MatrixXi X;
+    // Parse data from input file (only the word counts are needed)
+    read_documents(args, args["DATA"].asString(), X);
+
+    // Map the LDA model read-only and mask the words it does not model which
+    // are counted as out of vocabulary instead of silently vanishing
+    auto model = io::map_lda<Scalar>(args["MODEL"].asString());
+    long tokens = X.sum();
+    ModelWordMask<Scalar>(model).mask(X);
+    long oov_tokens = tokens - X.sum();
+
+    auto lda = create_lda_for_transform<Scalar>(args, model);
+
+    // Add the listeners to be used
+    if (!args["--quiet"].asBool()) {
+        lda.get_event_dispatcher()->template add_listener<ExpectationProgress>();
+    }
+
+    // Compute the document completion perplexity and the throughput
+    auto start = std::chrono::steady_clock::now();
+    double perplexity = lda.evaluate(
+        X,
+        std::stof(args["--observed"].asString()),
+        args["--random_state"].asLong()
+    );
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Perplexity: " << perplexity << std::endl
+              << "Out of vocabulary tokens: " << oov_tokens << std::endl
+              << "Tokens per second: " << tokens / elapsed.count() << std::endl;
+}
+
+
 static const char * USAGE = 
 R"(Console application for unsupervised LDA.
 
     Usage:
         lda train [--topics=K] [--iterations=I] [--e_step_iterations=EI]
                   [--e_step_tolerance=ET] [--random_state=RS]
-                  [--compute_likelihood=CL] [--initialize_seeded | --initialize_random]
-                  [-q | --quiet] [--snapshot_every=N] [--workers=W]
-                  [--continue=M] DATA MODEL
+                  [--compute_likelihood=CL] [--held_out=H]
+                  [--initialize_seeded | --initialize_random]
+                  [-q | --quiet] [--snapshot_every=N] [--workers=W] [--metrics_file=F]
+                  [--squarem] [--deduplicate] [--tolerance=T] [--continue=M]
+                  [--min_count=N] [--hash_buckets=B] [--chunk_size=CS]
+                  DATA MODEL
         lda transform [-q | --quiet] [--e_step_iterations=EI]
                       [--e_step_tolerance=ET] [--workers=W]
+                      [--chunk_size=CS] [--top_topics=T] [--topic_threshold=TT]
                       MODEL DATA OUTPUT
+        lda evaluate [-q | --quiet] [--e_step_iterations=EI]
+                     [--e_step_tolerance=ET] [--workers=W]
+                     [--observed=O] [--random_state=RS]
+                     [--chunk_size=CS] MODEL DATA
+        lda convert [--float] [--log_beta] MODEL OUTPUT
         lda (-h | --help)
 
     General Options:
@@ -110,17 +368,61 @@ R"(Console application for unsupervised LDA.
                                 random distributions. The default
                                 initialization option is initialize_seeded
         --snapshot_every=N      Snapshot the model every N iterations [default: -1]
+        --metrics_file=F        Export training metrics in the Prometheus text
+                                format to F and as JSON lines to F.jsonl
         --workers=N             The number of concurrent workers [default: 1]
         --continue=M            A model to continue training from
+        --min_count=N           Train only on the words that appear at least
+                                N times in DATA, the rest get zero
+                                probability in the saved model [default: 0]
+        --hash_buckets=B        Hash the word ids of the documents into B
+                                buckets and model the buckets instead of the
+                                words, the model remembers B for transform,
+                                evaluate and --continue (0 keeps the words)
+                                [default: 0]
+        --squarem               Extrapolate the model across iterations to
+                                converge in fewer passes over the data
+                                (checked with the likelihood of the
+                                evaluated documents if --compute_likelihood
+                                is set)
+        --deduplicate           Run the E step once for identical documents
+                                and count it as many times as their copies
+        --tolerance=T           Stop before the last iteration when the
+                                relative increase of the likelihood (of the
+                                evaluated documents if --compute_likelihood
+                                is set) is less than T [default: 0]
 
     E Step Options:
         --e_step_iterations=EI  The maximum number of iterations to perform
                                 in the E step [default: 30]
         --e_step_tolerance=ET   The minimum accepted relative increase in log
                                 likelihood during the E step [default: 1e-3]
-        --compute_likelihood=CL The percentage of documents to compute the
-                                likelihood for (1.0 means compute for every
-                                document) [default: 0.0]
+        --compute_likelihood=CL The fraction of the (training or held out)
+                                documents whose likelihood is computed after
+                                every epoch in a low priority thread (1.0 means
+                                every document) [default: 0.0]
+        --held_out=H            Compute the likelihood of the documents in H
+                                instead of the training documents
+
+    Transform Options:
+        --chunk_size=CS         The number of documents to transform, or to
+                                hash when reading a hashed model, at a time
+                                [default: 10000]
+        --top_topics=T          Write only the T largest topic proportions of
+                                every document as a sparse matrix [default: 0]
+        --topic_threshold=TT    Write only the topic proportions larger than TT
+                                as a sparse matrix [default: 0]
+
+    Evaluation Options:
+        --observed=O            The fraction of the tokens of every document
+                                that is used to infer its topics, the rest are
+                                used to compute the perplexity [default: 0.5]
+
+    Convert Options:
+        --float                 Store the model in single precision
+        --log_beta              Store the logarithm of the topics as well which
+                                the likelihood of the E step reads instead of
+                                computing it
 )";
 
 int main(int argc, char **argv) {
@@ -135,9 +437,14 @@ int main(int argc, char **argv) {
     if (args["train"].asBool()) {
         Eigen::MatrixXi X;
         // Parse data from input file
-        io::parse_input_data(args["DATA"].asString(), X);
+        read_documents(args, args["DATA"].asString(), X);
+
+        std::shared_ptr<corpus::Vocabulary> vocabulary;
+        auto lda = create_lda_for_train(args, X, vocabulary);
 
-        auto lda = create_lda_for_train(args, X);
+        // Save the buckets with the model so that it is read hashed
+        auto hasher = create_hasher(args);
+        int hash_buckets = (hasher) ? hasher->buckets() : 0;
 
         // Add the listeners to be used
         if (!args["--quiet"].asBool()) {
@@ -148,7 +455,15 @@ int main(int argc, char **argv) {
         if (args["--snapshot_every"].asLong() > 0) {
             lda.get_event_dispatcher()->add_listener<SnapshotEvery>(
                 args["MODEL"].asString(),
-                args["--snapshot_every"].asLong()
+                args["--snapshot_every"].asLong(),
+                vocabulary,
+                hash_buckets
+            );
+        }
+
+        if (args["--metrics_file"]) {
+            lda.get_event_dispatcher()->add_listener<MetricsExporter>(
+                args["--metrics_file"].asString()
             );
         }
 
@@ -158,32 +473,51 @@ int main(int argc, char **argv) {
         //Save the trained model
         io::save_lda(
             args["MODEL"].asString(),
-            lda.model_parameters()
+            lda.model_parameters(),
+            vocabulary,
+            hash_buckets
         );
     }
     else if (args["transform"].asBool()) {
-        Eigen::MatrixXi X;
-        // Parse data from input file
-        io::parse_input_data(args["DATA"].asString(), X);
-
-        // Load LDA model from file
+        // float models are used in single precision instead of widening them
+        if (io::is_float_model(args["MODEL"].asString())) {
+            transform_documents<float>(args);
+        } else {
+            transform_documents<double>(args);
+        }
+    }
+    else if (args["evaluate"].asBool()) {
+        if (io::is_float_model(args["MODEL"].asString())) {
+            evaluate_documents<float>(args);
+        } else {
+            evaluate_documents<double>(args);
+        }
+    }
+    else if (args["convert"].asBool()) {
+        // Write the model in the binary container that transform and
+        // evaluate map instead of parsing
         auto model = io::load_lda(args["MODEL"].asString());
-
-        auto lda = create_lda_for_transform(args, model);
-
-        // Add the listeners to be used
-        if (!args["--quiet"].asBool()) {
-            lda.get_event_dispatcher()->add_listener<EpochProgress>();
-            lda.get_event_dispatcher()->add_listener<ExpectationProgress>();
+        uint64_t flags = (args["--log_beta"].asBool()) ? model_file::LOG_BETA : 0;
+        uint64_t hash_buckets = io::model_hash_buckets(args["MODEL"].asString());
+        if (args["--float"].asBool()) {
+            model_file::save<float>(
+                args["OUTPUT"].asString(),
+                model->alpha.cast<float>(),
+                model->beta.cast<float>(),
+                model->eta.cast<float>(),
+                flags,
+                hash_buckets
+            );
+        } else {
+            model_file::save<double>(
+                args["OUTPUT"].asString(),
+                model->alpha,
+                model->beta,
+                model->eta,
+                flags,
+                hash_buckets
+            );
         }
-
-        Eigen::MatrixXd doc_topic_distribution;
-        doc_topic_distribution = lda.transform(X);
-
-        numpy_format::save(
-            args["OUTPUT"].asString(),
-            doc_topic_distribution
-        );
     }
     else {
         std::cout << "Invalid command" << std::endl;
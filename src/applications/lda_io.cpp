@@ -1,6 +1,11 @@
+#include <cstdio>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
+#include "ldaplusplus/ModelFile.hpp"
 #include "ldaplusplus/NumpyFormat.hpp"
 
 #include "applications/lda_io.hpp"
@@ -47,9 +52,29 @@ void parse_input_data(
     X = ni;
 }
 
+void parse_input_data(
+    std::string data_path,
+    const corpus::FeatureHasher &hasher,
+    size_t chunk_size,
+    Eigen::MatrixXi &X
+) {
+    numpy_format::NumpyInputStream<int> input(data_path);
+    X.resize(hasher.buckets(), input.cols());
+
+    // hash every chunk in its columns
+    Eigen::MatrixXi chunk;
+    size_t col = 0;
+    while (input.read(chunk, chunk_size)) {
+        X.middleCols(col, chunk.cols()) = hasher.transform(chunk);
+        col += chunk.cols();
+    }
+}
+
 void save_lda(
     std::string model_path,
-    std::shared_ptr<parameters::Parameters> parameters
+    std::shared_ptr<parameters::Parameters> parameters,
+    std::shared_ptr<const corpus::Vocabulary> vocabulary,
+    int hash_buckets
 ) {
     // cast the model parameters SupervisedModelParameters regardless the type
     // of the trained LDA model. In this way, one can train initially a
@@ -66,16 +91,32 @@ void save_lda(
     );
 
     model << numpy_format::NumpyOutput<double>(model_parameters->alpha);
-    model << numpy_format::NumpyOutput<double>(model_parameters->beta);
+    if (vocabulary) {
+        model << numpy_format::NumpyOutput<double>(
+            vocabulary->expand_topics(model_parameters->beta)
+        );
+    } else {
+        model << numpy_format::NumpyOutput<double>(model_parameters->beta);
+    }
     model << numpy_format::NumpyOutput<double>(model_parameters->eta);
+    if (hash_buckets > 0) {
+        model << numpy_format::NumpyOutput<int32_t>(&hash_buckets, {1, 1}, true);
+    }
 }
 
-std::shared_ptr<parameters::SupervisedModelParameters<double> > load_lda(
+template <typename Scalar>
+std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > load_lda(
     std::string model_path
 ) {
+    // binary models are mapped and copied without parsing
+    if (model_file::is_model_file(model_path)) {
+        return model_file::MappedModel(model_path).parameters<Scalar>();
+    }
+
     // we will be needing those
-    auto model_parameters = std::make_shared<parameters::SupervisedModelParameters<double> >();
+    auto model_parameters = std::make_shared<parameters::SupervisedModelParameters<Scalar> >();
     numpy_format::NumpyInput<double> ni;
+    Eigen::MatrixXd array;
 
     // open the file
     std::fstream model(
@@ -83,13 +124,185 @@ std::shared_ptr<parameters::SupervisedModelParameters<double> > load_lda(
         std::ios::in | std::ios::binary
     );
 
-    model >> ni; model_parameters->alpha = ni;
-    model >> ni; model_parameters->beta = ni;
-    model >> ni; model_parameters->eta = ni;
+    model >> ni; array = ni; model_parameters->alpha = array.cast<Scalar>();
+    model >> ni; array = ni; model_parameters->beta = array.cast<Scalar>();
+    model >> ni; array = ni; model_parameters->eta = array.cast<Scalar>();
 
     return model_parameters;
 }
 
+template <typename Scalar>
+std::shared_ptr<parameters::ModelParametersView<Scalar> > map_lda(
+    std::string model_path
+) {
+    if (
+        model_file::is_model_file(model_path) &&
+        model_file::MappedModel(model_path).scalar_size() == sizeof(Scalar)
+    ) {
+        return model_file::map_parameters<Scalar>(model_path);
+    }
+
+    // the view keeps the loaded parameters alive
+    auto model = load_lda<Scalar>(model_path);
+    auto view = std::make_shared<parameters::ModelParametersView<Scalar> >(*model);
+    view->owner = model;
+
+    return view;
+}
+
+int model_hash_buckets(std::string model_path) {
+    if (model_file::is_model_file(model_path)) {
+        return model_file::MappedModel(model_path).hash_buckets();
+    }
+
+    // seek over alpha, beta and eta
+    std::fstream model(
+        model_path,
+        std::ios::in | std::ios::binary
+    );
+    std::vector<size_t> shape;
+    bool fortran;
+    for (int i=0; i<3; i++) {
+        numpy_format::detail::read_header<double>(model, shape, fortran);
+        size_t N = 1;
+        for (auto c : shape) {
+            N *= c;
+        }
+        model.seekg(N*sizeof(double), std::ios::cur);
+    }
+
+    // models saved without a hasher end here
+    if (model.peek() == std::char_traits<char>::eof()) {
+        return 0;
+    }
+    numpy_format::NumpyInput<int32_t> ni;
+    Eigen::MatrixXi buckets;
+    model >> ni; buckets = ni;
+
+    return buckets(0, 0);
+}
+
+bool is_float_model(std::string model_path) {
+    return model_file::is_model_file(model_path) &&
+           model_file::MappedModel(model_path).scalar_size() == sizeof(float);
+}
+
+namespace {
+
+template <typename Scalar>
+std::shared_ptr<corpus::Vocabulary> compact_model(
+    std::shared_ptr<parameters::ModelParameters<Scalar> > model
+) {
+    auto vocabulary = std::make_shared<corpus::Vocabulary>(
+        corpus::Vocabulary::from_topics<Scalar>(model->beta)
+    );
+    if (vocabulary->size() == vocabulary->original_size()) {
+        return nullptr;
+    }
+    model->beta = vocabulary->compact_topics(model->beta);
+
+    return vocabulary;
+}
+
+}  // namespace
+
+std::shared_ptr<corpus::Vocabulary> compact_lda(
+    std::shared_ptr<parameters::ModelParameters<double> > model
+) {
+    return compact_model(model);
+}
+
+std::shared_ptr<corpus::Vocabulary> compact_lda(
+    std::shared_ptr<parameters::ModelParameters<float> > model
+) {
+    return compact_model(model);
+}
+
+
+SparseTopicsWriter::SparseTopicsWriter(std::string path)
+    : path_(std::move(path)),
+      nnz_(0),
+      indptr_(new numpy_format::NumpyOutputStream<int64_t>(path_ + ".indptr.tmp", 1)),
+      indices_(new numpy_format::NumpyOutputStream<int32_t>(path_ + ".indices.tmp", 1)),
+      data_(new numpy_format::NumpyOutputStream<float>(path_ + ".data.tmp", 1))
+{
+    indptr_->write(Eigen::Matrix<int64_t, Eigen::Dynamic, Eigen::Dynamic>::Zero(1, 1));
+}
+
+SparseTopicsWriter::~SparseTopicsWriter() {
+    try {
+        close();
+    } catch (...) {
+        // nothing sensible to do in a destructor
+    }
+}
+
+void SparseTopicsWriter::write(const Eigen::SparseMatrix<double> &topics) {
+    if (!indptr_) {
+        throw std::runtime_error("The sparse topics file is already closed");
+    }
+
+    Eigen::Matrix<int64_t, Eigen::Dynamic, Eigen::Dynamic> indptr(1, topics.cols());
+    Eigen::Matrix<int32_t, Eigen::Dynamic, Eigen::Dynamic> indices(1, topics.nonZeros());
+    Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic> data(1, topics.nonZeros());
+    int i = 0;
+    for (int d=0; d<topics.outerSize(); d++) {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(topics, d); it; ++it) {
+            indices(0, i) = it.row();
+            data(0, i) = it.value();
+            i++;
+        }
+        indptr(0, d) = nnz_ + i;
+    }
+    nnz_ += i;
+
+    indptr_->write(indptr);
+    indices_->write(indices);
+    data_->write(data);
+}
+
+void SparseTopicsWriter::close() {
+    if (!indptr_) {
+        return;
+    }
+
+    indptr_->close();
+    indices_->close();
+    data_->close();
+    indptr_.reset();
+    indices_.reset();
+    data_.reset();
+
+    // concatenate the three arrays
+    std::fstream output(path_, std::ios::out | std::ios::binary | std::ios::trunc);
+    for (auto suffix : {".indptr.tmp", ".indices.tmp", ".data.tmp"}) {
+        std::string tmp_path = path_ + suffix;
+        {
+            std::fstream tmp(tmp_path, std::ios::in | std::ios::binary);
+            output << tmp.rdbuf();
+        }
+        std::remove(tmp_path.c_str());
+    }
+    if (!output) {
+        throw std::runtime_error("Couldn't write the sparse topics to " + path_);
+    }
+}
+
+
+// Template instantiation
+template std::shared_ptr<parameters::SupervisedModelParameters<float> > load_lda<float>(
+    std::string model_path
+);
+template std::shared_ptr<parameters::SupervisedModelParameters<double> > load_lda<double>(
+    std::string model_path
+);
+template std::shared_ptr<parameters::ModelParametersView<float> > map_lda<float>(
+    std::string model_path
+);
+template std::shared_ptr<parameters::ModelParametersView<double> > map_lda<double>(
+    std::string model_path
+);
+
 
 }  // namespace io
 
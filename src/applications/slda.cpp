@@ -1,3 +1,4 @@
+#include <chrono>
 #include <iostream>
 
 #include <Eigen/Core>
@@ -11,7 +12,9 @@
 #include "applications/ExpectationProgress.hpp"
 #include "applications/lda_io.hpp"
 #include "applications/MaximizationProgress.hpp"
+#include "applications/MetricsExporter.hpp"
 #include "applications/SnapshotEvery.hpp"
+#include "applications/utils.hpp"
 
 using namespace ldaplusplus;
 
@@ -29,15 +32,24 @@ LDA<double> create_lda_for_train(
     builder.set_iterations(args["--iterations"].asLong());
     builder.set_workers(args["--workers"].asLong());
 
-    // Add the parameters regarding the Expectation step
+    // Stop early using the likelihood of the evaluator if there is one
+    double compute_likelihood = std::stof(args["--compute_likelihood"].asString());
+    double tolerance = std::stof(args["--tolerance"].asString());
+    builder.set_convergence_tolerance(tolerance, compute_likelihood > 0);
+
+    // Add the parameters regarding the Expectation step (the convergence
+    // without an evaluator checks the bound of every document)
     builder.set_supervised_e_step(
         args["--e_step_iterations"].asLong(),
         std::stof(args["--e_step_tolerance"].asString()),
         args["--fixed_point_iterations"].asLong(),
-        std::stof(args["--compute_likelihood"].asString()),
+        (tolerance > 0 && compute_likelihood <= 0) ? 1.0 : 0.0,
         args["--random_state"].asLong()
     );
 
+    // Compute the likelihood in a low priority thread instead of the workers
+    utils::add_likelihood_evaluator(args, X, builder);
+
     // Add the parameters regarding the Maximization step
     builder.set_supervised_m_step(
         args["--m_step_iterations"].asLong(),
@@ -108,15 +120,20 @@ R"(Console application for supervised LDA.
     Usage:
         slda train [--topics=K] [--iterations=I] [--e_step_iterations=EI]
                    [--e_step_tolerance=ET] [--fixed_point_iterations=FI]
-                   [--random_state=RS] [--compute_likelihood=CL]
+                   [--random_state=RS] [--compute_likelihood=CL] [--held_out=H]
                    [--initialize_seeded | --initialize_random]
                    [--m_step_iterations=MI] [--m_step_tolerance=MT]
-                   [--regularization_penalty=L]
-                   [-q | --quiet] [--snapshot_every=N] [--workers=W]
+                   [--regularization_penalty=L] [--tolerance=T]
+                   [-q | --quiet] [--snapshot_every=N] [--workers=W] [--metrics_file=F]
                    [--continue=M] [--continue_from_unsupervised=M] DATA MODEL
         slda transform [-q | --quiet] [--e_step_iterations=EI]
                        [--e_step_tolerance=ET] [--workers=W]
+                       [--chunk_size=CS] [--top_topics=T] [--topic_threshold=TT]
                        MODEL DATA OUTPUT
+        slda evaluate [-q | --quiet] [--e_step_iterations=EI]
+                      [--e_step_tolerance=ET] [--workers=W]
+                      [--observed=O] [--random_state=RS]
+                      MODEL DATA
         slda (-h | --help)
 
     General Options:
@@ -133,9 +150,15 @@ R"(Console application for supervised LDA.
                                           random distributions. The default
                                           initialization option is initialize_seeded
         --snapshot_every=N                Snapshot the model every N iterations [default: -1]
+        --metrics_file=F                  Export training metrics in the Prometheus text
+                                          format to F and as JSON lines to F.jsonl
         --workers=N                       The number of concurrent workers [default: 1]
         --continue=M                      A model to continue training from
         --continue_from_unsupervised=M    An unsupervised model to continue training from
+        --tolerance=T                     Stop before the last iteration when the
+                                          relative increase of the likelihood (of the
+                                          evaluated documents if --compute_likelihood
+                                          is set) is less than T [default: 0]
 
     E Step Options:
         --e_step_iterations=EI            The maximum number of iterations to perform
@@ -144,9 +167,12 @@ R"(Console application for supervised LDA.
                                           likelihood during the E step [default: 1e-4]
         --fixed_point_iterations=FI       The number of fixed point iterations to compute
                                           phi [default: 20]
-        --compute_likelihood=CL           The percentage of documents to compute the
-                                          likelihood for (1.0 means compute for every
-                                          document) [default: 0.0]
+        --compute_likelihood=CL           The fraction of the (training or held out)
+                                          documents whose likelihood is computed after
+                                          every epoch in a low priority thread (1.0
+                                          means every document) [default: 0.0]
+        --held_out=H                      Compute the likelihood of the documents in H
+                                          instead of the training documents
 
     M Step Options:
         --m_step_iterations=MI            The maximum number of iterations to perform
@@ -155,6 +181,19 @@ R"(Console application for supervised LDA.
                                           likelihood during the M step [default: 1e-4]
         -L L, --regularization_penalty=L  The regularization penalty for the Multinomial
                                           Logistic Regression [default: 0.05]
+
+    Transform Options:
+        --chunk_size=CS                   The number of documents to transform at a time
+                                          [default: 10000]
+        --top_topics=T                    Write only the T largest topic proportions of
+                                          every document as a sparse matrix [default: 0]
+        --topic_threshold=TT              Write only the topic proportions larger than TT
+                                          as a sparse matrix [default: 0]
+
+    Evaluation Options:
+        --observed=O                      The fraction of the tokens of every document
+                                          that is used to infer its topics, the rest are
+                                          used to compute the perplexity [default: 0.5]
 )";
 
 int main(int argc, char **argv) {
@@ -188,6 +227,12 @@ int main(int argc, char **argv) {
             );
         }
 
+        if (args["--metrics_file"]) {
+            lda.get_event_dispatcher()->add_listener<MetricsExporter>(
+                args["--metrics_file"].asString()
+            );
+        }
+
         // Fit LDA model according to the given training data and parameters
         lda.fit(X, y);
 
@@ -198,11 +243,6 @@ int main(int argc, char **argv) {
         );
     }
     else if (args["transform"].asBool()) {
-        
-        Eigen::MatrixXi X, y;
-        // Parse data from input file
-        io::parse_input_data(args["DATA"].asString(), X, y);
-
         // Load LDA model from file
         auto model = io::load_lda(args["MODEL"].asString());
 
@@ -214,13 +254,68 @@ int main(int argc, char **argv) {
             lda.get_event_dispatcher()->add_listener<ExpectationProgress>();
         }
 
-        Eigen::MatrixXd doc_topic_distribution;
-        doc_topic_distribution = lda.transform(X);
+        // Read the documents and write the topic mixtures in chunks so that
+        // the memory needed does not depend on the number of documents
+        numpy_format::NumpyInputStream<int> input(args["DATA"].asString());
+        size_t chunk_size = args["--chunk_size"].asLong();
+        auto source = [&input, chunk_size](Eigen::MatrixXi &X) {
+            return input.read(X, chunk_size);
+        };
+        long top_topics = args["--top_topics"].asLong();
+        double topic_threshold = std::stof(args["--topic_threshold"].asString());
+
+        if (top_topics > 0 || topic_threshold > 0) {
+            // keep only the largest topic proportions of every document
+            io::SparseTopicsWriter output(args["OUTPUT"].asString());
+            lda.transform_sparse(
+                source,
+                [&output](const Eigen::SparseMatrix<double> &topics) {
+                    output.write(topics);
+                },
+                top_topics,
+                topic_threshold
+            );
+            output.close();
+        } else {
+            numpy_format::NumpyOutputStream<double> output(
+                args["OUTPUT"].asString(),
+                model->beta.rows()
+            );
+            lda.transform(
+                source,
+                [&output](const Eigen::MatrixXd &doc_topic_distribution) {
+                    output.write(doc_topic_distribution);
+                }
+            );
+            output.close();
+        }
+    }
+    else if (args["evaluate"].asBool()) {
+        Eigen::MatrixXi X;
+        // Parse data from input file (only the word counts are needed)
+        io::parse_input_data(args["DATA"].asString(), X);
+
+        // Load LDA model from file
+        auto model = io::load_lda(args["MODEL"].asString());
+
+        auto lda = create_lda_for_transform(args, model);
+
+        // Add the listeners to be used
+        if (!args["--quiet"].asBool()) {
+            lda.get_event_dispatcher()->add_listener<ExpectationProgress>();
+        }
 
-        numpy_format::save(
-            args["OUTPUT"].asString(),
-            doc_topic_distribution
+        // Compute the document completion perplexity and the throughput
+        auto start = std::chrono::steady_clock::now();
+        double perplexity = lda.evaluate(
+            X,
+            std::stof(args["--observed"].asString()),
+            args["--random_state"].asLong()
         );
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << "Perplexity: " << perplexity << std::endl
+                  << "Tokens per second: " << X.sum() / elapsed.count() << std::endl;
     }
     else {
         std::cout << "Invalid command" << std::endl;
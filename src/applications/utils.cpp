@@ -1,3 +1,4 @@
+#include "applications/lda_io.hpp"
 #include "applications/utils.hpp"
 
 namespace utils {
@@ -16,4 +17,33 @@ Eigen::VectorXd create_class_weights(const Eigen::VectorXi & y) {
     return Cy;
 }
 
+
+void add_likelihood_evaluator(
+    std::map<std::string, docopt::value> &args,
+    const Eigen::MatrixXi & X,
+    ldaplusplus::LDABuilder<double> & builder,
+    std::function<void(std::string, Eigen::MatrixXi &)> read
+) {
+    double compute_likelihood = std::stof(args["--compute_likelihood"].asString());
+    if (compute_likelihood <= 0) {
+        return;
+    }
+
+    Eigen::MatrixXi X_held_out;
+    if (args["--held_out"]) {
+        if (read) {
+            read(args["--held_out"].asString(), X_held_out);
+        } else {
+            io::parse_input_data(args["--held_out"].asString(), X_held_out);
+        }
+    }
+    builder.set_likelihood_evaluator(
+        (args["--held_out"]) ? X_held_out : X,
+        compute_likelihood,
+        args["--e_step_iterations"].asLong(),
+        std::stof(args["--e_step_tolerance"].asString()),
+        args["--random_state"].asLong()
+    );
+}
+
 }  // namespace utils
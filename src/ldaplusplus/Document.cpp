@@ -1,5 +1,8 @@
 
+#include <algorithm>
+#include <functional>
 #include <numeric>
+#include <unordered_map>
 #include <utility>
 
 #include "ldaplusplus/Document.hpp"
@@ -21,7 +24,7 @@ const std::shared_ptr<const Corpus> EigenDocument::get_corpus() const {
     return corpus_;
 }
 
-const Eigen::VectorXi & EigenDocument::get_words() const {
+Eigen::Ref<const Eigen::VectorXi> EigenDocument::get_words() const {
     return X_;
 }
 
@@ -40,7 +43,7 @@ const std::shared_ptr<const Corpus> ClassificationDecorator::get_corpus() const
     return document_->get_corpus();
 }
 
-const Eigen::VectorXi & ClassificationDecorator::get_words() const {
+Eigen::Ref<const Eigen::VectorXi> ClassificationDecorator::get_words() const {
     return document_->get_words();
 }
 
@@ -48,6 +51,43 @@ int ClassificationDecorator::get_class() const {
     return y_;
 }
 
+int ClassificationDecorator::get_weight() const {
+    return document_->get_weight();
+}
+
+
+// 
+// EigenDocumentView
+//
+EigenDocumentView::EigenDocumentView(
+    Eigen::Ref<const Eigen::VectorXi> X,
+    int y,
+    const Corpus * corpus,
+    int weight
+) : X_(X.data(), X.rows()),
+    y_(y),
+    corpus_(corpus),
+    weight_(weight)
+{}
+
+const std::shared_ptr<const Corpus> EigenDocumentView::get_corpus() const {
+    // Use the aliasing constructor with an empty owner to create a non owning
+    // pointer without allocating a control block
+    return std::shared_ptr<const Corpus>(std::shared_ptr<const Corpus>(), corpus_);
+}
+
+Eigen::Ref<const Eigen::VectorXi> EigenDocumentView::get_words() const {
+    return X_;
+}
+
+int EigenDocumentView::get_class() const {
+    return y_;
+}
+
+int EigenDocumentView::get_weight() const {
+    return weight_;
+}
+
 
 // 
 // CorpusIndexes
@@ -70,7 +110,12 @@ void CorpusIndexes::shuffle() {
 EigenCorpus::EigenCorpus(const Eigen::MatrixXi &X, int random_state)
     : indices_(X.cols(), random_state),
       X_(X)
-{}
+{
+    documents_.reserve(X_.cols());
+    for (int i=0; i<X_.cols(); i++) {
+        documents_.emplace_back(X_.col(i), -1, this);
+    }
+}
 
 size_t EigenCorpus::size() const {
     return X_.cols();
@@ -79,7 +124,8 @@ size_t EigenCorpus::size() const {
 const std::shared_ptr<Document> EigenCorpus::at(size_t index) const {
     int i = indices_.get_index(index);
 
-    return std::make_shared<EigenDocument>(X_.col(i));
+    // Non owning pointer to the view (see EigenDocumentView::get_corpus())
+    return std::shared_ptr<Document>(std::shared_ptr<Document>(), &documents_[i]);
 }
 
 void EigenCorpus::shuffle() {
@@ -104,6 +150,11 @@ EigenClassificationCorpus::EigenClassificationCorpus(
         priors_[y_[i]] ++;
     }
     priors_.array() /= priors_.sum();
+
+    documents_.reserve(X_.cols());
+    for (int i=0; i<X_.cols(); i++) {
+        documents_.emplace_back(X_.col(i), y_[i], this);
+    }
 }
 
 size_t EigenClassificationCorpus::size() const {
@@ -113,13 +164,8 @@ size_t EigenClassificationCorpus::size() const {
 const std::shared_ptr<Document> EigenClassificationCorpus::at(size_t index) const {
     int i = indices_.get_index(index);
 
-    return std::make_shared<ClassificationDecorator>(
-        std::make_shared<EigenDocument>(
-            X_.col(i),
-            std::shared_ptr<const Corpus>(this, [](const Corpus*){})
-        ),
-        y_[i]
-    );
+    // Non owning pointer to the view (see EigenDocumentView::get_corpus())
+    return std::shared_ptr<Document>(std::shared_ptr<Document>(), &documents_[i]);
 }
 
 void EigenClassificationCorpus::shuffle() {
@@ -130,5 +176,149 @@ float EigenClassificationCorpus::get_prior(int y) const {
     return priors_[y];
 }
 
+
+// 
+// EigenDeduplicatedCorpus
+//
+EigenDeduplicatedCorpus::EigenDeduplicatedCorpus(
+    const Eigen::MatrixXi & X,
+    int random_state
+) : indices_(0, random_state)
+{
+    deduplicate(X, Eigen::VectorXi::Constant(X.cols(), -1));
+    indices_ = CorpusIndexes(X_.cols(), random_state);
+}
+
+EigenDeduplicatedCorpus::EigenDeduplicatedCorpus(
+    const Eigen::MatrixXi & X,
+    const Eigen::VectorXi & y,
+    int random_state
+) : indices_(0, random_state),
+    priors_(Eigen::VectorXf::Zero(y.maxCoeff()+1))
+{
+    for (int i=0; i<y.rows(); i++) {
+        if (y[i] >= 0) {
+            priors_[y[i]] ++;
+        }
+    }
+    priors_.array() /= priors_.sum();
+
+    deduplicate(X, y);
+    indices_ = CorpusIndexes(X_.cols(), random_state);
+}
+
+void EigenDeduplicatedCorpus::deduplicate(
+    const Eigen::MatrixXi & X,
+    const Eigen::VectorXi & y
+) {
+    // Map every column of X to the first column with the same words and
+    // class (the buckets hold the candidates with the same hash)
+    std::unordered_map<size_t, std::vector<int> > buckets;
+    std::vector<int> first;
+    std::vector<int> weights;
+    index_.resize(X.cols());
+    for (int d=0; d<X.cols(); d++) {
+        size_t h = std::hash<int>()(y[d]);
+        for (int w=0; w<X.rows(); w++) {
+            if (X(w, d) != 0) {
+                h ^= std::hash<int>()(w) + 0x9e3779b9 + (h << 6) + (h >> 2);
+                h ^= std::hash<int>()(X(w, d)) + 0x9e3779b9 + (h << 6) + (h >> 2);
+            }
+        }
+
+        auto &bucket = buckets[h];
+        index_[d] = -1;
+        for (auto i : bucket) {
+            if (y[first[i]] == y[d] && X.col(first[i]) == X.col(d)) {
+                index_[d] = i;
+                weights[i] ++;
+                break;
+            }
+        }
+        if (index_[d] < 0) {
+            index_[d] = first.size();
+            bucket.push_back(first.size());
+            first.push_back(d);
+            weights.push_back(1);
+        }
+    }
+
+    // Copy the distinct documents
+    X_.resize(X.rows(), first.size());
+    y_.resize(first.size());
+    weights_.resize(first.size());
+    for (size_t i=0; i<first.size(); i++) {
+        X_.col(i) = X.col(first[i]);
+        y_[i] = y[first[i]];
+        weights_[i] = weights[i];
+    }
+
+    documents_.reserve(X_.cols());
+    for (int i=0; i<X_.cols(); i++) {
+        documents_.emplace_back(X_.col(i), y_[i], this, weights_[i]);
+    }
+}
+
+size_t EigenDeduplicatedCorpus::size() const {
+    return X_.cols();
+}
+
+size_t EigenDeduplicatedCorpus::total_weight() const {
+    return index_.rows();
+}
+
+const std::shared_ptr<Document> EigenDeduplicatedCorpus::at(size_t index) const {
+    int i = indices_.get_index(index);
+
+    // Non owning pointer to the view (see EigenDocumentView::get_corpus())
+    return std::shared_ptr<Document>(std::shared_ptr<Document>(), &documents_[i]);
+}
+
+void EigenDeduplicatedCorpus::shuffle() {
+    indices_.shuffle();
+}
+
+float EigenDeduplicatedCorpus::get_prior(int y) const {
+    return priors_[y];
+}
+
+
+// 
+// EigenHashedCorpus
+//
+EigenHashedCorpus::EigenHashedCorpus(
+    const FeatureHasher & hasher,
+    const Eigen::MatrixXi & X,
+    int random_state
+) : X_(hasher.transform(X)),
+    corpus_(std::make_shared<EigenCorpus>(X_, random_state))
+{}
+
+EigenHashedCorpus::EigenHashedCorpus(
+    const FeatureHasher & hasher,
+    const Eigen::MatrixXi & X,
+    const Eigen::VectorXi & y,
+    int random_state
+) : X_(hasher.transform(X)),
+    y_(y),
+    corpus_(std::make_shared<EigenClassificationCorpus>(X_, y_, random_state))
+{}
+
+size_t EigenHashedCorpus::size() const {
+    return corpus_->size();
+}
+
+const std::shared_ptr<Document> EigenHashedCorpus::at(size_t index) const {
+    return corpus_->at(index);
+}
+
+void EigenHashedCorpus::shuffle() {
+    corpus_->shuffle();
+}
+
+float EigenHashedCorpus::get_prior(int y) const {
+    return std::static_pointer_cast<ClassificationCorpus>(corpus_)->get_prior(y);
+}
+
 }  // namespace corpus
 }  // namespace ldaplusplus
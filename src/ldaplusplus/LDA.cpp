@@ -1,14 +1,223 @@
 
 #include <algorithm>
+#include <cmath>
+#include <deque>
 #include <numeric>
 #include <random>
+#include <stdexcept>
 #include <utility>
 
 #include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/events/MetricsEvents.hpp"
 #include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/utils.hpp"
 
 namespace ldaplusplus {
 
+typedef std::chrono::steady_clock Clock;
+
+static double seconds(Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::duration<double> >(d).count();
+}
+
+// The results a worker queues before waiting for them to be consumed, which
+// bounds the variational parameters alive at any time
+static const size_t QUEUED_PER_WORKER = 4;
+
+// The documents per worker that a stream queues ahead of the chunk whose
+// results are being collected, so that small chunks keep the workers busy
+// while the source and the sink run
+static const size_t STREAMED_PER_WORKER = 64;
+
+
+namespace {
+
+/**
+ * The observed part of the documents of LDA::evaluate kept as the non zero
+ * words and counts of every document.
+ *
+ * at() expands a document to a dense vector so that only the documents being
+ * inferred by the workers are ever dense.
+ */
+class SparseCorpus : public corpus::Corpus
+{
+    public:
+        SparseCorpus(int words) : words_(words), offsets_(1, 0) {}
+
+        /** Append a document made of the non zero counts of x */
+        void push_back(const Eigen::VectorXi &x) {
+            for (int w=0; w<x.rows(); w++) {
+                if (x[w] > 0) {
+                    ids_.push_back(w);
+                    counts_.push_back(x[w]);
+                }
+            }
+            offsets_.push_back(ids_.size());
+        }
+
+        size_t size() const override { return offsets_.size() - 1; }
+
+        /**
+         * Expand a document in dense counts (the E steps index the words
+         * with the rows) which allocates V ints per call.
+         */
+        const std::shared_ptr<corpus::Document> at(size_t index) const override {
+            Eigen::VectorXi x = Eigen::VectorXi::Zero(words_);
+            for (size_t j=offsets_[index]; j<offsets_[index+1]; j++) {
+                x[ids_[j]] = counts_[j];
+            }
+
+            // non owning pointer to the corpus like the EigenDocumentView
+            return std::make_shared<corpus::ClassificationDecorator>(
+                std::make_shared<corpus::EigenDocument>(
+                    std::move(x),
+                    std::shared_ptr<const corpus::Corpus>(
+                        std::shared_ptr<const corpus::Corpus>(),
+                        this
+                    )
+                ),
+                -1
+            );
+        }
+
+        /** The documents are never shuffled */
+        void shuffle() override {}
+
+    private:
+        int words_;
+        std::vector<int> ids_;
+        std::vector<int> counts_;
+        std::vector<size_t> offsets_;
+};
+
+/**
+ * A chunk of documents of LDA::stream_e_step, the results are collected in
+ * the order of the corpus until none remains.
+ */
+struct StreamChunk
+{
+    Eigen::MatrixXi X;
+    std::shared_ptr<corpus::Corpus> corpus;
+    std::vector<std::shared_ptr<parameters::Parameters> > results;
+    size_t offset;
+    size_t remaining;
+};
+
+}  // namespace
+
+
+/**
+ * Keep the (at most) k largest topic proportions of a document that are
+ * greater than the threshold.
+ */
+template <typename Scalar>
+static std::shared_ptr<parameters::SparseTopics<Scalar> > select_topics(
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &gamma,
+    size_t k,
+    Scalar threshold
+) {
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> theta = gamma / gamma.sum();
+
+    std::vector<int> topics;
+    for (int i=0; i<theta.rows(); i++) {
+        if (theta[i] > threshold) {
+            topics.push_back(i);
+        }
+    }
+    if (k > 0 && topics.size() > k) {
+        std::nth_element(
+            topics.begin(),
+            topics.begin() + k,
+            topics.end(),
+            [&theta](int a, int b) { return theta[a] > theta[b]; }
+        );
+        topics.resize(k);
+    }
+    std::sort(topics.begin(), topics.end());
+
+    auto selected = std::make_shared<parameters::SparseTopics<Scalar> >();
+    selected->topics.resize(topics.size());
+    selected->weights.resize(topics.size());
+    for (size_t i=0; i<topics.size(); i++) {
+        selected->topics[i] = topics[i];
+        selected->weights[i] = theta[topics[i]];
+    }
+
+    return selected;
+}
+
+
+/**
+ * Put the SparseTopics of every document in a topics x documents column
+ * major sparse matrix.
+ */
+template <typename Scalar>
+static Eigen::SparseMatrix<Scalar> sparse_topics(
+    const std::vector<std::shared_ptr<parameters::Parameters> > &documents,
+    int topics
+) {
+    Eigen::SparseMatrix<Scalar> matrix(topics, documents.size());
+    Eigen::VectorXi nnz(documents.size());
+    for (size_t d=0; d<documents.size(); d++) {
+        nnz[d] = std::static_pointer_cast<parameters::SparseTopics<Scalar> >(
+            documents[d]
+        )->topics.rows();
+    }
+    matrix.reserve(nnz);
+    for (size_t d=0; d<documents.size(); d++) {
+        auto document = std::static_pointer_cast<parameters::SparseTopics<Scalar> >(
+            documents[d]
+        );
+        for (int i=0; i<nnz[d]; i++) {
+            matrix.insert(document->topics[i], d) = document->weights[i];
+        }
+    }
+    matrix.makeCompressed();
+
+    return matrix;
+}
+
+
+/**
+ * Read-only views of a model (see parameters::ModelParametersView) can only
+ * be used for inference since the M steps update the model in place.
+ */
+template <typename Scalar>
+static void check_trainable(const std::shared_ptr<parameters::Parameters> &model) {
+    if (std::dynamic_pointer_cast<parameters::ModelParametersView<Scalar> >(model)) {
+        throw std::runtime_error("A read-only view of a model cannot be "
+                                 "trained, it can only transform documents");
+    }
+}
+
+
+/**
+ * Move the parameters x to x0 - 2ar + a^2v (see LDA::squarem).
+ *
+ * When the rows of x are distributions (beta and the eta of the M steps
+ * that normalize it), the entries that the extrapolation makes nonpositive
+ * keep their value from x and the rows are renormalized so that they stay
+ * on the simplex.
+ */
+template <typename Scalar>
+static void extrapolate(
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &x0,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &r,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &v,
+    Scalar a,
+    bool distributions,
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &x
+) {
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> extrapolated =
+        x0 - 2 * a * r + a * a * v;
+    if (distributions) {
+        x = (extrapolated.array() > 0).select(extrapolated, x);
+        math_utils::normalize_rows(x);
+    } else {
+        x = extrapolated;
+    }
+}
+
 
 template <typename Scalar>
 LDA<Scalar>::LDA(
@@ -16,15 +225,41 @@ LDA<Scalar>::LDA(
     std::shared_ptr<em::EStepInterface<Scalar> > e_step,
     std::shared_ptr<em::MStepInterface<Scalar> > m_step,
     size_t iterations,
-    size_t workers
+    size_t workers,
+    const LDAOptions<Scalar> &options
 ) : model_parameters_(model_parameters),
     e_step_(e_step),
     m_step_(m_step),
     iterations_(iterations),
+    squarem_(options.squarem),
+    tolerance_(options.tolerance),
+    held_out_(options.held_out),
+    deduplicate_(options.deduplicate),
+    hasher_(options.hasher),
     workers_(workers),
+    deterministic_(options.deterministic),
+    queue_in_open_(false),
+    queue_in_((options.deterministic) ? workers : 1),
+    queue_out_((options.deterministic) ? workers : 1),
+    queue_out_capacity_(QUEUED_PER_WORKER * ((options.deterministic) ? 1 : workers)),
+    worker_e_step_time_(workers),
+    worker_documents_(workers),
+    worker_e_step_latency_(workers),
+    worker_e_step_counters_(workers),
+    evaluator_(options.evaluator),
+    epochs_(0),
+    epoch_likelihood_(NAN),
+    epoch_likelihoods_(0),
+    epoch_likelihood_complete_(false),
     event_dispatcher_(std::make_shared<events::SameThreadEventDispatcher>())
 {
+    if (held_out_ && !evaluator_) {
+        throw std::runtime_error("Checking the convergence on held out "
+                                 "documents needs a likelihood evaluator");
+    }
+
     set_up_event_dispatcher();
+    e_step_->set_workers(workers);
 }
 
 template <typename Scalar>
@@ -33,7 +268,26 @@ LDA<Scalar>::LDA(LDA<Scalar> &&lda)
       e_step_(std::move(lda.e_step_)),
       m_step_(std::move(lda.m_step_)),
       iterations_(lda.iterations_),
+      squarem_(lda.squarem_),
+      tolerance_(lda.tolerance_),
+      held_out_(lda.held_out_),
+      deduplicate_(lda.deduplicate_),
+      hasher_(std::move(lda.hasher_)),
       workers_(lda.workers_.size()),
+      deterministic_(lda.deterministic_),
+      queue_in_open_(false),
+      queue_in_(lda.queue_in_.size()),
+      queue_out_(lda.queue_out_.size()),
+      queue_out_capacity_(lda.queue_out_capacity_),
+      worker_e_step_time_(lda.worker_e_step_time_.size()),
+      worker_documents_(lda.worker_documents_.size()),
+      worker_e_step_latency_(lda.worker_e_step_latency_.size()),
+      worker_e_step_counters_(lda.worker_e_step_counters_.size()),
+      evaluator_(std::move(lda.evaluator_)),
+      epochs_(lda.epochs_),
+      epoch_likelihood_(lda.epoch_likelihood_),
+      epoch_likelihoods_(lda.epoch_likelihoods_),
+      epoch_likelihood_complete_(lda.epoch_likelihood_complete_),
       event_dispatcher_(std::move(lda.event_dispatcher_))
 {}
 
@@ -43,6 +297,9 @@ void LDA<Scalar>::set_up_event_dispatcher() {
 
     e_step_->set_event_dispatcher(event_dispatcher);
     m_step_->set_event_dispatcher(event_dispatcher);
+    if (evaluator_) {
+        evaluator_->set_event_dispatcher(event_dispatcher);
+    }
 }
 
 
@@ -51,32 +308,217 @@ std::shared_ptr<corpus::Corpus> LDA<Scalar>::get_corpus(
     const Eigen::MatrixXi &X,
     const Eigen::VectorXi &y
 ) {
+    check_words(X);
+
+    if (hasher_ && deduplicate_) {
+        return std::make_shared<corpus::EigenDeduplicatedCorpus>(hasher_->transform(X), y);
+    } else if (hasher_) {
+        return std::make_shared<corpus::EigenHashedCorpus>(*hasher_, X, y);
+    } else if (deduplicate_) {
+        return std::make_shared<corpus::EigenDeduplicatedCorpus>(X, y);
+    }
+
     return std::make_shared<corpus::EigenClassificationCorpus>(X, y);
 }
 
 
 template <typename Scalar>
 std::shared_ptr<corpus::Corpus> LDA<Scalar>::get_corpus(const Eigen::MatrixXi &X) {
+    check_words(X);
+
+    if (hasher_ && deduplicate_) {
+        return std::make_shared<corpus::EigenDeduplicatedCorpus>(hasher_->transform(X));
+    } else if (hasher_) {
+        return std::make_shared<corpus::EigenHashedCorpus>(*hasher_, X);
+    } else if (deduplicate_) {
+        return std::make_shared<corpus::EigenDeduplicatedCorpus>(X);
+    }
+
     return std::make_shared<corpus::EigenCorpus>(X);
 }
 
 
+template <typename Scalar>
+void LDA<Scalar>::check_words(const Eigen::MatrixXi &X) {
+    // the view works for any model parameters
+    long words = parameters::ModelParametersView<Scalar>::view(
+        *model_parameters_
+    ).beta.cols();
+    long rows = (hasher_) ? hasher_->buckets() : X.rows();
+    if (rows != words) {
+        throw std::invalid_argument(
+            "The documents have " + std::to_string(rows) + " " +
+            ((hasher_) ? "hash buckets" : "words") + " but the model has " +
+            std::to_string(words)
+        );
+    }
+}
+
+
+template <typename Scalar>
+const Eigen::VectorXi & LDA<Scalar>::document_index(
+    std::shared_ptr<corpus::Corpus> corpus
+) {
+    return std::static_pointer_cast<corpus::EigenDeduplicatedCorpus>(
+        corpus
+    )->get_document_index();
+}
+
+
 template <typename Scalar>
 void LDA<Scalar>::fit(const Eigen::MatrixXi &X, const Eigen::VectorXi &y) {
-    auto corpus = get_corpus(X, y);
+    fit(get_corpus(X, y));
+}
 
-    for (size_t i=0; i<iterations_; i++) {
-        partial_fit(corpus);
+
+template <typename Scalar>
+void LDA<Scalar>::fit(const Eigen::MatrixXi &X) {
+    fit(get_corpus(X));
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::fit(std::shared_ptr<corpus::Corpus> corpus) {
+    check_trainable<Scalar>(model_parameters_);
+
+    // Keep the likelihood of the last evaluation
+    bool held_out = held_out_ && tolerance_ > 0;
+    Scalar evaluation_likelihood = NAN;
+    std::shared_ptr<events::EventListenerInterface> evaluation_listener;
+    if (held_out) {
+        evaluation_listener = get_event_dispatcher()->add_listener(
+            [&evaluation_likelihood](std::shared_ptr<events::Event> event) {
+                evaluation_likelihood = std::static_pointer_cast<
+                    events::EvaluationProgressEvent<Scalar>
+                >(event)->likelihood();
+            },
+            {events::EvaluationProgressEvent<Scalar>::static_type()}
+        );
+    }
+
+    size_t epochs = 0;
+    Scalar likelihood = NAN;
+    while (epochs < iterations_) {
+        // a cycle of the extrapolation needs 3 epochs
+        if (squarem_ && iterations_ - epochs >= 3) {
+            epochs += squarem(corpus);
+        } else {
+            partial_fit(corpus);
+            epochs++;
+        }
+
+        // check for convergence (nothing converges while the likelihood is
+        // NaN)
+        if (tolerance_ > 0) {
+            Scalar previous = likelihood;
+            if (held_out) {
+                wait_for_evaluation();
+                likelihood = evaluation_likelihood;
+            } else {
+                if (epoch_likelihoods_ == 0) {
+                    throw std::runtime_error("The convergence tolerance needs "
+                                             "an expectation step that "
+                                             "computes the likelihood of some "
+                                             "documents");
+                }
+                // the bounds of random subsets of the documents are not
+                // comparable across epochs
+                if (!epoch_likelihood_complete_) {
+                    continue;
+                }
+                likelihood = epoch_likelihood_;
+            }
+            Scalar improvement = (likelihood - previous) / std::abs(previous);
+            if (improvement >= 0 && improvement < tolerance_) {
+                break;
+            }
+        }
+    }
+
+    if (evaluation_listener) {
+        get_event_dispatcher()->remove_listener(evaluation_listener);
     }
+
+    wait_for_evaluation();
 }
 
 
 template <typename Scalar>
-void LDA<Scalar>::fit(const Eigen::MatrixXi &X) {
-    auto corpus = get_corpus(X);
+size_t LDA<Scalar>::squarem(std::shared_ptr<corpus::Corpus> corpus) {
+    // beta is always there while eta only in supervised models
+    auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
+        model_parameters_
+    );
+    auto supervised = std::dynamic_pointer_cast<
+        parameters::SupervisedModelParameters<Scalar>
+    >(model_parameters_);
+    MatrixX empty;
+    MatrixX &eta = (supervised) ? supervised->eta : empty;
+
+    // theta_0 -> theta_1 -> theta_2
+    MatrixX beta_0 = model->beta;
+    MatrixX eta_0 = eta;
+    partial_fit(corpus);
+    MatrixX beta_1 = model->beta;
+    MatrixX eta_1 = eta;
+    partial_fit(corpus);
+    Scalar likelihood_1 = epoch_likelihood_;
+    if (!evaluator_ && !epoch_likelihood_complete_) {
+        throw std::runtime_error("SQUAREM needs a likelihood evaluator or an "
+                                 "expectation step that computes the "
+                                 "likelihood of every document");
+    }
+
+    // compute the step length
+    MatrixX r_beta = beta_1 - beta_0;
+    MatrixX r_eta = eta_1 - eta_0;
+    MatrixX v_beta = model->beta - beta_1 - r_beta;
+    MatrixX v_eta = eta - eta_1 - r_eta;
+    Scalar r_norm = std::sqrt(r_beta.squaredNorm() + r_eta.squaredNorm());
+    Scalar v_norm = std::sqrt(v_beta.squaredNorm() + v_eta.squaredNorm());
+    Scalar a = (v_norm > 0) ? -r_norm / v_norm : -1;
+    if (a >= -1) {
+        return 2;
+    }
 
-    for (size_t i=0; i<iterations_; i++) {
+    // extrapolate
+    MatrixX beta_2 = model->beta;
+    MatrixX eta_2 = eta;
+    extrapolate<Scalar>(beta_0, r_beta, v_beta, a, true, model->beta);
+    extrapolate<Scalar>(eta_0, r_eta, v_eta, a, m_step_->normalizes_eta(), eta);
+
+    // with an evaluator compare the extrapolation with theta_2 directly and
+    // perform the third epoch from the better one
+    if (evaluator_) {
+        parameters::ModelParameters<Scalar> model_2(model->alpha, beta_2);
+        if (!(evaluator_->likelihood(*model) >= evaluator_->likelihood(model_2))) {
+            model->beta = std::move(beta_2);
+            eta = std::move(eta_2);
+        }
         partial_fit(corpus);
+
+        return 3;
+    }
+
+    // otherwise the third epoch computes the bound of the extrapolation
+    // which should not be worse than the last accepted bound, that of
+    // theta_1 since the bound of theta_2 is unknown
+    partial_fit(corpus);
+    if (!(epoch_likelihood_ >= likelihood_1)) {
+        model->beta = std::move(beta_2);
+        eta = std::move(eta_2);
+        epoch_likelihood_ = likelihood_1;
+    }
+
+    return 3;
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::wait_for_evaluation() {
+    if (evaluator_) {
+        evaluator_->wait();
+        process_worker_events();
     }
 }
 
@@ -92,43 +534,167 @@ void LDA<Scalar>::partial_fit(std::shared_ptr<corpus::Corpus> corpus) {
     // Shuffle the documents for a randomized pass through
     corpus->shuffle();
 
-    // Queue all the documents
-    for (size_t i=0; i<corpus->size(); i++) {
-        queue_in_.emplace_back(corpus, i);
+    partial_fit(corpus, 0, corpus->size());
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::partial_fit(
+    std::shared_ptr<corpus::Corpus> corpus,
+    size_t begin,
+    size_t end
+) {
+    if (begin > end || end > corpus->size()) {
+        throw std::runtime_error("The documents to fit should be a range "
+                                 "of the corpus");
+    }
+    check_trainable<Scalar>(model_parameters_);
+
+    // Keep track of where the time goes
+    auto epoch_start = Clock::now();
+    Clock::duration queue_wait(0), m_step_online(0);
+    std::fill(worker_e_step_time_.begin(), worker_e_step_time_.end(), Clock::duration(0));
+    std::fill(worker_documents_.begin(), worker_documents_.end(), 0);
+    for (auto &h : worker_e_step_latency_) {
+        h.clear();
+    }
+    std::fill(
+        worker_e_step_counters_.begin(),
+        worker_e_step_counters_.end(),
+        perf_utils::CounterValues()
+    );
+    perf_utils::PerfCounters counters;
+    perf_utils::CounterValues m_step_counters;
+
+    // Aggregate the bound of the documents (the E steps report NaN for the
+    // documents they do not compute it for) only when LDA::fit needs it since
+    // otherwise the events are not even created (in double so that a float
+    // sum over the corpus does not swamp the changes the tolerance checks)
+    double likelihood = 0;
+    size_t likelihoods = 0;
+    size_t missing_likelihoods = end - begin;
+    std::shared_ptr<events::EventListenerInterface> likelihood_listener;
+    if (uses_training_likelihood()) {
+        likelihood_listener = get_event_dispatcher()->add_listener(
+            [&likelihood, &likelihoods, &missing_likelihoods](std::shared_ptr<events::Event> event) {
+                auto progress = std::static_pointer_cast<
+                    events::ExpectationProgressEvent<Scalar>
+                >(event);
+                if (!std::isnan(progress->likelihood())) {
+                    likelihood += progress->weight() * progress->likelihood();
+                    likelihoods += progress->weight();
+                    missing_likelihoods--;
+                }
+            },
+            {events::ExpectationProgressEvent<Scalar>::static_type()}
+        );
     }
 
-    // create the thread pool
-    create_worker_pool();
+    // Queue the documents and start the workers (they are stopped however
+    // this function exits)
+    WorkerPoolScope pool(*this);
+    for (size_t i=begin; i<end; i++) {
+        queue_document(corpus, i);
+    }
+    pool.start();
 
-    // Extract variational parameters and calculate the doc_m_step
-    for (size_t i=0; i<corpus->size(); i++) {
+    // Extract variational parameters and calculate the doc_m_step (in
+    // deterministic mode the ith extracted document is the ith document)
+    for (size_t i=begin; i<end; i++) {
         std::shared_ptr<parameters::Parameters> variational_parameters;
         size_t index;
 
-        std::tie(variational_parameters, index) = extract_vp_from_queue();
+        auto start = Clock::now();
+        std::tie(variational_parameters, index) = extract_vp_from_queue(queue_slot(i));
+        queue_wait += Clock::now() - start;
 
         // tell the thread safe event dispatcher to process the events from the
         // workers
         process_worker_events();
 
         // perform the online part of m step
+        start = Clock::now();
+        auto before = counters.read();
         m_step_->doc_m_step(
             corpus->at(index),
             variational_parameters,
             model_parameters_  // output
         );
+        m_step_counters += counters.read() - before;
+        m_step_online += Clock::now() - start;
     }
 
-    // destroy the thread pool
-    destroy_worker_pool();
+    // wait for the workers
+    pool.finish();
 
     // Perform any corpuswise action related to e step
     e_step_->e_step();
 
     // perform the batch part of m step
+    auto m_step_start = Clock::now();
     m_step_->m_step(
         model_parameters_  // output
     );
+    auto epoch_end = Clock::now();
+    if (likelihood_listener) {
+        get_event_dispatcher()->remove_listener(likelihood_listener);
+    }
+    epoch_likelihood_ = (likelihoods > 0) ? likelihood / likelihoods : NAN;
+    epoch_likelihoods_ = likelihoods;
+    epoch_likelihood_complete_ = likelihoods > 0 && missing_likelihoods == 0;
+
+    // report the timings
+    std::vector<double> worker_e_step_time(worker_e_step_time_.size());
+    std::transform(
+        worker_e_step_time_.begin(),
+        worker_e_step_time_.end(),
+        worker_e_step_time.begin(),
+        seconds
+    );
+    std::vector<size_t> e_step_latency;
+    for (auto &h : worker_e_step_latency_) {
+        if (h.size() > e_step_latency.size()) {
+            e_step_latency.resize(h.size(), 0);
+        }
+        for (size_t i=0; i<h.size(); i++) {
+            e_step_latency[i] += h[i];
+        }
+    }
+    get_event_dispatcher()->template dispatch<events::EpochTimingEvent>(
+        seconds(epoch_end - epoch_start),
+        seconds(queue_wait),
+        seconds(m_step_online),
+        seconds(epoch_end - m_step_start),
+        worker_e_step_time,
+        worker_documents_,
+        e_step_latency
+    );
+    if (counters.available()) {
+        perf_utils::CounterValues e_step_counters;
+        for (auto &c : worker_e_step_counters_) {
+            e_step_counters += c;
+        }
+        get_event_dispatcher()->template dispatch<events::HardwareCountersEvent>(
+            "doc_e_step",
+            end - begin,
+            e_step_counters.cycles,
+            e_step_counters.instructions,
+            e_step_counters.cache_misses
+        );
+        get_event_dispatcher()->template dispatch<events::HardwareCountersEvent>(
+            "doc_m_step",
+            end - begin,
+            m_step_counters.cycles,
+            m_step_counters.instructions,
+            m_step_counters.cache_misses
+        );
+    }
+
+    // hand the model to the evaluation thread
+    epochs_++;
+    if (evaluator_) {
+        evaluator_->evaluate(epochs_, model_parameters_);
+    }
 
     // inform the world that the epoch is over
     get_event_dispatcher()->template dispatch<events::EpochProgressEvent<Scalar> >(model_parameters_);
@@ -137,31 +703,30 @@ void LDA<Scalar>::partial_fit(std::shared_ptr<corpus::Corpus> corpus) {
 
 template <typename Scalar>
 typename LDA<Scalar>::MatrixX LDA<Scalar>::transform(const Eigen::MatrixXi& X) {
-    // cast the parameters to what is needed
-    auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
-        model_parameters_
-    );
+    // the workers are stopped and the queues emptied however this exits
+    WorkerPoolScope pool(*this);
 
-    // make some room for the transformed data
-    MatrixX gammas(model->beta.rows(), X.cols());
+    // view the parameters (they may be a read-only mapped model)
+    auto model = parameters::ModelParametersView<Scalar>::view(*model_parameters_);
 
     // make a corpus to use
     auto corpus = get_corpus(X);
 
-    // Queue all the documents
+    // make some room for the transformed data
+    MatrixX gammas(model.beta.rows(), corpus->size());
+
+    // Queue all the documents and start the workers
     for (size_t i=0; i<corpus->size(); i++) {
-        queue_in_.emplace_back(corpus, i);
+        queue_document(corpus, i);
     }
-
-    // create the thread pool
-    create_worker_pool();
+    pool.start();
 
     // Extract variational parameters and calculate the doc_e_step
     for (size_t i=0; i<corpus->size(); i++) {
         std::shared_ptr<parameters::Parameters> vp;
         size_t index;
 
-        std::tie(vp, index) = extract_vp_from_queue();
+        std::tie(vp, index) = extract_vp_from_queue(queue_slot(i));
         gammas.col(index) = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(vp)->gamma;
 
         // tell the thread safe event dispatcher to process the events from the
@@ -169,52 +734,382 @@ typename LDA<Scalar>::MatrixX LDA<Scalar>::transform(const Eigen::MatrixXi& X) {
         process_worker_events();
     }
 
-    // destroy the thread pool
-    destroy_worker_pool();
+    // wait for the workers
+    pool.finish();
+
+    // fan the identical documents back out
+    if (deduplicate_) {
+        const Eigen::VectorXi &index = document_index(corpus);
+        MatrixX all_gammas(gammas.rows(), X.cols());
+        for (int d=0; d<X.cols(); d++) {
+            all_gammas.col(d) = gammas.col(index[d]);
+        }
+        return all_gammas;
+    }
 
     return gammas;
 }
 
 
 template <typename Scalar>
-typename LDA<Scalar>::MatrixX LDA<Scalar>::decision_function(const Eigen::MatrixXi &X) {
-    return decision_function(transform(X));
+void LDA<Scalar>::transform(
+    std::function<bool(Eigen::MatrixXi &)> source,
+    std::function<void(const MatrixX &)> sink
+) {
+    // keep only gamma so that a chunk of results does not hold on to the
+    // rest of the variational parameters
+    worker_output_ = [](std::shared_ptr<parameters::Parameters> vp) {
+        auto gamma = std::make_shared<parameters::VariationalParameters<Scalar> >();
+        gamma->gamma = std::static_pointer_cast<
+            parameters::VariationalParameters<Scalar>
+        >(vp)->gamma;
+
+        return gamma;
+    };
+
+    int topics = parameters::ModelParametersView<Scalar>::view(
+        *model_parameters_
+    ).beta.rows();
+    stream_e_step(
+        source,
+        [&sink, topics](
+            const Eigen::MatrixXi &X,
+            const std::vector<std::shared_ptr<parameters::Parameters> > &results
+        ) {
+            MatrixX gammas(topics, X.cols());
+            for (int d=0; d<X.cols(); d++) {
+                gammas.col(d) = std::static_pointer_cast<
+                    parameters::VariationalParameters<Scalar>
+                >(results[d])->gamma;
+            }
+            sink(gammas);
+        }
+    );
 }
 
 
 template <typename Scalar>
-typename LDA<Scalar>::MatrixX LDA<Scalar>::decision_function(const MatrixX &X) {
-    // this function requires a supervised LDA so let's cast our models
-    // parameters accordingly
-    auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(
-        model_parameters_
+Eigen::SparseMatrix<Scalar> LDA<Scalar>::transform_sparse(
+    const Eigen::MatrixXi &X,
+    size_t k,
+    Scalar threshold
+) {
+    // the workers are stopped, the queues emptied and worker_output_ reset
+    // however this exits
+    WorkerPoolScope pool(*this);
+
+    // select the topics in the workers
+    worker_output_ = [k, threshold](std::shared_ptr<parameters::Parameters> vp) {
+        return select_topics<Scalar>(
+            std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(vp)->gamma,
+            k,
+            threshold
+        );
+    };
+
+    // make a corpus to use
+    auto corpus = get_corpus(X);
+
+    // Queue all the documents and start the workers
+    for (size_t i=0; i<corpus->size(); i++) {
+        queue_document(corpus, i);
+    }
+    pool.start();
+
+    // Extract the selected topics
+    std::vector<std::shared_ptr<parameters::Parameters> > documents(corpus->size());
+    for (size_t i=0; i<corpus->size(); i++) {
+        std::shared_ptr<parameters::Parameters> selected;
+        size_t index;
+
+        std::tie(selected, index) = extract_vp_from_queue(queue_slot(i));
+        documents[index] = selected;
+
+        // tell the thread safe event dispatcher to process the events from the
+        // workers
+        process_worker_events();
+    }
+
+    // wait for the workers
+    pool.finish();
+
+    // fan the identical documents back out
+    if (deduplicate_) {
+        const Eigen::VectorXi &index = document_index(corpus);
+        std::vector<std::shared_ptr<parameters::Parameters> > all_documents(X.cols());
+        for (int d=0; d<X.cols(); d++) {
+            all_documents[d] = documents[index[d]];
+        }
+        documents.swap(all_documents);
+    }
+
+    // and put them in a sparse matrix
+    auto model = parameters::ModelParametersView<Scalar>::view(*model_parameters_);
+
+    return sparse_topics<Scalar>(documents, model.beta.rows());
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::transform_sparse(
+    std::function<bool(Eigen::MatrixXi &)> source,
+    std::function<void(const Eigen::SparseMatrix<Scalar> &)> sink,
+    size_t k,
+    Scalar threshold
+) {
+    // select the topics in the workers
+    worker_output_ = [k, threshold](std::shared_ptr<parameters::Parameters> vp) {
+        return select_topics<Scalar>(
+            std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(vp)->gamma,
+            k,
+            threshold
+        );
+    };
+
+    int topics = parameters::ModelParametersView<Scalar>::view(
+        *model_parameters_
+    ).beta.rows();
+    stream_e_step(
+        source,
+        [&sink, topics](
+            const Eigen::MatrixXi &,
+            const std::vector<std::shared_ptr<parameters::Parameters> > &results
+        ) {
+            sink(sparse_topics<Scalar>(results, topics));
+        }
     );
+}
 
-    // the linear model is trained on
-    // E_q[\bar z] = \fraction{\gamma - \alpha}{\sum_i \gamma_i}
-    MatrixX expected_z_bar = X.colwise() - model->alpha;
-    expected_z_bar.array().rowwise() /= expected_z_bar.array().colwise().sum();
 
-    // finally return the linear scores like a boss
-    return model->eta.transpose() * expected_z_bar;
+template <typename Scalar>
+Scalar LDA<Scalar>::evaluate(
+    const Eigen::MatrixXi &X,
+    Scalar observed,
+    int random_state
+) {
+    if (observed <= 0 || observed >= 1) {
+        throw std::runtime_error("The observed fraction of the tokens should "
+                                 "be in (0, 1)");
+    }
+
+    // view the parameters (they may be a read-only mapped model)
+    auto model = parameters::ModelParametersView<Scalar>::view(*model_parameters_);
+
+    check_words(X);
+
+    // the workers are stopped and the queues emptied however this exits
+    WorkerPoolScope pool(*this);
+
+    // Split the tokens of every document (hashing the words first if needed
+    // so that the held out words are buckets) and keep only the non zero
+    // observed and held out words and their counts
+    int rows = (hasher_) ? hasher_->buckets() : X.rows();
+    auto corpus = std::make_shared<SparseCorpus>(rows);
+    std::vector<std::vector<int> > held_out_words(X.cols());
+    std::vector<std::vector<int> > held_out_counts(X.cols());
+    Eigen::VectorXi x(rows);
+    Eigen::VectorXi x_observed(rows);
+    std::mt19937 rng(random_state);
+    for (int d=0; d<X.cols(); d++) {
+        if (hasher_) {
+            x.setZero();
+            for (int w=0; w<X.rows(); w++) {
+                x[hasher_->bucket(w)] += X(w, d);
+            }
+        }
+        else {
+            x = X.col(d);
+        }
+
+        x_observed.setZero();
+        for (int w=0; w<rows; w++) {
+            if (x[w] <= 0) {
+                continue;
+            }
+            std::binomial_distribution<int> tokens(x[w], observed);
+            x_observed[w] = tokens(rng);
+            int held_out = x[w] - x_observed[w];
+            if (held_out > 0) {
+                held_out_words[d].push_back(w);
+                held_out_counts[d].push_back(held_out);
+            }
+        }
+        corpus->push_back(x_observed);
+    }
+
+    // Queue all the documents and start the workers
+    for (size_t i=0; i<corpus->size(); i++) {
+        queue_document(corpus, i);
+    }
+    pool.start();
+
+    // Extract the variational parameters and compute the likelihood of the
+    // held out words while the workers infer the next documents (summed in
+    // double since a float sum over millions of words loses the small terms)
+    double likelihood = 0;
+    size_t held_out_total = 0;
+    size_t unseen_total = 0;
+    for (size_t i=0; i<corpus->size(); i++) {
+        std::shared_ptr<parameters::Parameters> vp;
+        size_t index;
+
+        std::tie(vp, index) = extract_vp_from_queue(queue_slot(i));
+        VectorX theta = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(vp)->gamma;
+        theta /= theta.sum();
+
+        // words the model gives zero probability to are left out instead of
+        // making the perplexity infinite
+        auto &words = held_out_words[index];
+        auto &counts = held_out_counts[index];
+        for (size_t j=0; j<words.size(); j++) {
+            Scalar p = theta.dot(model.beta.col(words[j]));
+            if (p > 0) {
+                likelihood += counts[j] * std::log(p);
+                held_out_total += counts[j];
+            }
+            else {
+                unseen_total += counts[j];
+            }
+        }
+
+        // tell the thread safe event dispatcher to process the events from the
+        // workers
+        process_worker_events();
+    }
+
+    // wait for the workers
+    pool.finish();
+
+    get_event_dispatcher()->template dispatch<events::EvaluationProgressEvent<Scalar> >(
+        epochs_,
+        likelihood,
+        X.cols(),
+        held_out_total,
+        unseen_total
+    );
+
+    return (held_out_total > 0) ? std::exp(-likelihood / held_out_total) : 0;
+}
+
+
+template <typename Scalar>
+typename LDA<Scalar>::MatrixX LDA<Scalar>::decision_function(const Eigen::MatrixXi &X) {
+    Eigen::VectorXi predictions;
+    MatrixX scores;
+    fused_predict(X, predictions, &scores);
+
+    return scores;
 }
 
 
 template <typename Scalar>
 Eigen::VectorXi LDA<Scalar>::predict(const Eigen::MatrixXi &X) {
-    return predict(decision_function(X));
+    Eigen::VectorXi predictions;
+    fused_predict(X, predictions, nullptr);
+
+    return predictions;
 }
 
 
 template <typename Scalar>
-Eigen::VectorXi LDA<Scalar>::predict(const MatrixX &scores) {
-    Eigen::VectorXi predictions(scores.cols());
+void LDA<Scalar>::fused_predict(
+    const Eigen::MatrixXi &X,
+    Eigen::VectorXi &predictions,
+    MatrixX *scores,
+    MatrixX *gammas
+) {
+    // this function requires a supervised LDA, the view (which may be a
+    // read-only mapped model) has an eta
+    auto model = parameters::ModelParametersView<Scalar>::view(*model_parameters_);
+
+    // the workers are stopped, the queues emptied and worker_output_ reset
+    // however this exits
+    WorkerPoolScope pool(*this);
+
+    // compute E_q[\bar z], the scores and the argmax in the workers
+    bool keep_scores = scores != nullptr;
+    bool keep_gammas = gammas != nullptr;
+    worker_output_ = [model, keep_scores, keep_gammas](std::shared_ptr<parameters::Parameters> vp) {
+        auto prediction = std::make_shared<parameters::ClassPrediction<Scalar> >();
+        const VectorX &gamma = std::static_pointer_cast<
+            parameters::VariationalParameters<Scalar>
+        >(vp)->gamma;
+        VectorX expected_z_bar = gamma - model.alpha;
+        expected_z_bar /= expected_z_bar.sum();
+        VectorX class_scores = model.eta.transpose() * expected_z_bar;
+        class_scores.maxCoeff(&prediction->label);
+        if (keep_scores) {
+            prediction->scores = std::move(class_scores);
+        }
+        if (keep_gammas) {
+            prediction->gamma = gamma;
+        }
+
+        return prediction;
+    };
+
+    // make a corpus to use
+    auto corpus = get_corpus(X);
 
-    for (int d=0; d<scores.cols(); d++) {
-        scores.col(d).maxCoeff( &predictions[d] );
+    // Queue all the documents and start the workers
+    for (size_t i=0; i<corpus->size(); i++) {
+        queue_document(corpus, i);
     }
+    pool.start();
 
-    return predictions;
+    // Extract the predictions
+    predictions.resize(corpus->size());
+    if (keep_scores) {
+        scores->resize(model.eta.cols(), corpus->size());
+    }
+    if (keep_gammas) {
+        gammas->resize(model.beta.rows(), corpus->size());
+    }
+    for (size_t i=0; i<corpus->size(); i++) {
+        std::shared_ptr<parameters::Parameters> p;
+        size_t index;
+
+        std::tie(p, index) = extract_vp_from_queue(queue_slot(i));
+        auto prediction = std::static_pointer_cast<parameters::ClassPrediction<Scalar> >(p);
+        predictions[index] = prediction->label;
+        if (keep_scores) {
+            scores->col(index) = prediction->scores;
+        }
+        if (keep_gammas) {
+            gammas->col(index) = prediction->gamma;
+        }
+
+        // tell the thread safe event dispatcher to process the events from the
+        // workers
+        process_worker_events();
+    }
+
+    // wait for the workers
+    pool.finish();
+
+    // fan the identical documents back out
+    if (deduplicate_) {
+        const Eigen::VectorXi &index = document_index(corpus);
+        Eigen::VectorXi all_predictions(X.cols());
+        MatrixX all_scores(keep_scores ? scores->rows() : 0, X.cols());
+        MatrixX all_gammas(keep_gammas ? gammas->rows() : 0, X.cols());
+        for (int d=0; d<X.cols(); d++) {
+            all_predictions[d] = predictions[index[d]];
+            if (keep_scores) {
+                all_scores.col(d) = scores->col(index[d]);
+            }
+            if (keep_gammas) {
+                all_gammas.col(d) = gammas->col(index[d]);
+            }
+        }
+        predictions.swap(all_predictions);
+        if (keep_scores) {
+            scores->swap(all_scores);
+        }
+        if (keep_gammas) {
+            gammas->swap(all_gammas);
+        }
+    }
 }
 
 
@@ -222,8 +1117,9 @@ template <typename Scalar>
 std::tuple<typename LDA<Scalar>::MatrixX, Eigen::VectorXi> LDA<Scalar>::transform_predict(
     const Eigen::MatrixXi &X
 ) {
-    MatrixX gammas = transform(X);
-    Eigen::VectorXi predictions = predict(decision_function(gammas));
+    MatrixX gammas;
+    Eigen::VectorXi predictions;
+    fused_predict(X, predictions, nullptr, &gammas);
 
     return std::make_tuple(gammas, predictions);
 }
@@ -231,9 +1127,9 @@ std::tuple<typename LDA<Scalar>::MatrixX, Eigen::VectorXi> LDA<Scalar>::transfor
 
 template <typename Scalar>
 void LDA<Scalar>::create_worker_pool() {
-    for (auto & t : workers_) {
-        t = std::thread(
-            std::bind(&LDA<Scalar>::doc_e_step_worker, this)
+    for (size_t i=0; i<workers_.size(); i++) {
+        workers_[i] = std::thread(
+            std::bind(&LDA<Scalar>::doc_e_step_worker, this, i)
         );
     }
 }
@@ -242,36 +1138,255 @@ void LDA<Scalar>::create_worker_pool() {
 template <typename Scalar>
 void LDA<Scalar>::destroy_worker_pool() {
     for (auto & t : workers_) {
-        t.join();
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::abort_worker_pool() {
+    // drop the queued documents and the results so that the workers can
+    // finish the documents they are inferring and exit
+    close_input_queue(true);
+    {
+        std::lock_guard<std::mutex> lock(queue_out_mutex_);
+        for (auto &q : queue_out_) {
+            q.clear();
+        }
+    }
+    queue_out_space_cv_.notify_all();
+    destroy_worker_pool();
+
+    // and whatever they queued meanwhile
+    for (auto &q : queue_out_) {
+        q.clear();
     }
+    worker_error_ = nullptr;
+    worker_output_ = nullptr;
 }
 
 
 template <typename Scalar>
-void LDA<Scalar>::doc_e_step_worker() {
+void LDA<Scalar>::queue_document(
+    std::shared_ptr<corpus::Corpus> corpus,
+    size_t i,
+    size_t id
+) {
+    {
+        std::lock_guard<std::mutex> lock(queue_in_mutex_);
+        queue_in_[queue_slot(id)].emplace_back(corpus, i, id);
+    }
+    if (queue_in_open_) {
+        queue_in_cv_.notify_all();
+    }
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::queue_documents(
+    std::shared_ptr<corpus::Corpus> corpus,
+    size_t first_id
+) {
+    {
+        std::lock_guard<std::mutex> lock(queue_in_mutex_);
+        for (size_t i=0; i<corpus->size(); i++) {
+            queue_in_[queue_slot(first_id + i)].emplace_back(corpus, i, first_id + i);
+        }
+    }
+    if (queue_in_open_) {
+        queue_in_cv_.notify_all();
+    }
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::open_input_queue() {
+    std::lock_guard<std::mutex> lock(queue_in_mutex_);
+    queue_in_open_ = true;
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::close_input_queue(bool discard) {
+    {
+        std::lock_guard<std::mutex> lock(queue_in_mutex_);
+        queue_in_open_ = false;
+        if (discard) {
+            for (auto &q : queue_in_) {
+                q.clear();
+            }
+        }
+    }
+    queue_in_cv_.notify_all();
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::stream_e_step(
+    std::function<bool(Eigen::MatrixXi &)> source,
+    std::function<void(
+        const Eigen::MatrixXi &,
+        const std::vector<std::shared_ptr<parameters::Parameters> > &
+    )> sink
+) {
+    // The chunks in flight and the ids of the documents queued and
+    // extracted so far. A deque never moves its elements so the corpora can
+    // keep referring to the X of their chunk.
+    std::deque<StreamChunk> chunks;
+    size_t queued = 0;
+    size_t extracted = 0;
+
+    // Read the next non empty chunk and queue its documents with their
+    // position in the stream as id
+    auto queue_chunk = [&]() {
+        chunks.emplace_back();
+        StreamChunk &chunk = chunks.back();
+        while (source(chunk.X)) {
+            if (chunk.X.cols() == 0) {
+                continue;
+            }
+            chunk.corpus = get_corpus(chunk.X);
+            chunk.results.resize(chunk.corpus->size());
+            chunk.offset = queued;
+            chunk.remaining = chunk.corpus->size();
+            queue_documents(chunk.corpus, queued);
+            queued += chunk.corpus->size();
+            return true;
+        }
+        chunks.pop_back();
+        return false;
+    };
+
+    WorkerPoolScope pool(*this);
+    open_input_queue();
+    pool.start();
+    size_t ahead = STREAMED_PER_WORKER * workers_.size();
+    bool more = queue_chunk();
+    while (!chunks.empty()) {
+        // keep the workers busy with the next chunks while this one is
+        // collected and passed to the sink, small chunks are read until
+        // enough documents are queued after this one
+        StreamChunk &current = chunks.front();
+        size_t current_end = current.offset + current.results.size();
+        while (more && (chunks.size() < 2 || queued - current_end < ahead)) {
+            more = queue_chunk();
+        }
+
+        // the results of the next chunks may come first when the workers
+        // share a queue
+        while (current.remaining > 0) {
+            std::shared_ptr<parameters::Parameters> result;
+            size_t id;
+
+            std::tie(result, id) = extract_vp_from_queue(queue_slot(extracted++));
+            auto chunk = chunks.begin();
+            while (id >= chunk->offset + chunk->results.size()) {
+                ++chunk;
+            }
+            chunk->results[id - chunk->offset] = std::move(result);
+            chunk->remaining--;
+
+            // tell the thread safe event dispatcher to process the events
+            // from the workers
+            process_worker_events();
+        }
+
+        // fan the identical documents back out
+        if (deduplicate_) {
+            const Eigen::VectorXi &index = document_index(current.corpus);
+            std::vector<std::shared_ptr<parameters::Parameters> > all_results(current.X.cols());
+            for (int d=0; d<current.X.cols(); d++) {
+                all_results[d] = current.results[index[d]];
+            }
+            current.results.swap(all_results);
+        }
+
+        sink(current.X, current.results);
+        chunks.pop_front();
+    }
+    pool.finish();
+}
+
+
+template <typename Scalar>
+void LDA<Scalar>::doc_e_step_worker(size_t worker) {
     std::shared_ptr<corpus::Corpus> corpus;
     size_t index;
+    size_t id;
+    size_t slot = (deterministic_) ? worker : 0;
+
+    // let the E step know which worker is calling it
+    thread_utils::set_worker_index(worker);
+
+    // the counters only count the thread that opened them
+    perf_utils::PerfCounters counters;
 
     while (true) {
-        // extract a job
+        // extract a job (waiting for one while the queue is open)
         {
-            std::lock_guard<std::mutex> lock(queue_in_mutex_);
-            if (queue_in_.empty())
+            std::unique_lock<std::mutex> lock(queue_in_mutex_);
+            queue_in_cv_.wait(lock, [this, slot]() {
+                return !queue_in_[slot].empty() || !queue_in_open_;
+            });
+            if (queue_in_[slot].empty())
                 break;
-            std::tie(corpus, index) = queue_in_.front();
-            queue_in_.pop_front();
+            std::tie(corpus, index, id) = queue_in_[slot].front();
+            queue_in_[slot].pop_front();
         }
 
         // do said job
-        auto vp = e_step_->doc_e_step(
-            corpus->at(index),
-            model_parameters_
-        );
+        auto start = Clock::now();
+        auto before = counters.read();
+        std::shared_ptr<parameters::Parameters> vp;
+        try {
+            vp = e_step_->doc_e_step(
+                corpus->at(index),
+                model_parameters_
+            );
+            if (worker_output_) {
+                vp = worker_output_(vp);
+            }
+        } catch (...) {
+            // hand the error to the thread extracting the results which
+            // rethrows it and stops the job
+            {
+                std::lock_guard<std::mutex> lock(queue_out_mutex_);
+                if (!worker_error_) {
+                    worker_error_ = std::current_exception();
+                }
+            }
+            queue_out_cv_.notify_all();
+            break;
+        }
+        worker_e_step_counters_[worker] += counters.read() - before;
+        auto elapsed = Clock::now() - start;
+        worker_e_step_time_[worker] += elapsed;
+        worker_documents_[worker]++;
+
+        // the ith bucket counts the documents that took [2^i, 2^(i+1))
+        // microseconds (the first one also contains those below 1us)
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        size_t bucket = 0;
+        while (us > 1) {
+            us >>= 1;
+            bucket++;
+        }
+        auto &latency = worker_e_step_latency_[worker];
+        if (latency.size() <= bucket) {
+            latency.resize(bucket + 1, 0);
+        }
+        latency[bucket]++;
 
-        // show some results
+        // show some results (once the previous ones are consumed so that
+        // the results do not pile up when the consumer is slower)
         {
-            std::lock_guard<std::mutex> lock(queue_out_mutex_);
-            queue_out_.emplace_back(vp, index);
+            std::unique_lock<std::mutex> lock(queue_out_mutex_);
+            queue_out_space_cv_.wait(lock, [this, slot]() {
+                return queue_out_[slot].size() < queue_out_capacity_;
+            });
+            queue_out_[slot].emplace_back(vp, id);
         }
         // talk about those results
         queue_out_cv_.notify_one();
@@ -280,12 +1395,23 @@ void LDA<Scalar>::doc_e_step_worker() {
 
 
 template <typename Scalar>
-std::tuple<std::shared_ptr<parameters::Parameters>, size_t> LDA<Scalar>::extract_vp_from_queue() {
+std::tuple<std::shared_ptr<parameters::Parameters>, size_t> LDA<Scalar>::extract_vp_from_queue(
+    size_t slot
+) {
     std::unique_lock<std::mutex> lock(queue_out_mutex_);
-    queue_out_cv_.wait(lock, [this](){ return !queue_out_.empty(); });
+    queue_out_cv_.wait(lock, [this, slot]() {
+        return !queue_out_[slot].empty() || worker_error_;
+    });
+    if (worker_error_) {
+        std::rethrow_exception(worker_error_);
+    }
+
+    auto f = queue_out_[slot].front();
+    queue_out_[slot].pop_front();
+    lock.unlock();
 
-    auto f = queue_out_.front();
-    queue_out_.pop_front();
+    // wake up the workers waiting for room in the queue
+    queue_out_space_cv_.notify_all();
 
     return f;
 }
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
 #include "ldaplusplus/LDABuilder.hpp"
 #include "ldaplusplus/em/CorrespondenceSupervisedEStep.hpp"
 #include "ldaplusplus/em/CorrespondenceSupervisedMStep.hpp"
@@ -41,18 +45,106 @@ LDABuilder<Scalar> & LDABuilder<Scalar>::set_workers(size_t workers) {
     return *this;
 }
 
+template <typename Scalar>
+LDABuilder<Scalar> & LDABuilder<Scalar>::set_deterministic(bool deterministic) {
+    options_.deterministic = deterministic;
+
+    return *this;
+}
+
+template <typename Scalar>
+LDABuilder<Scalar> & LDABuilder<Scalar>::set_squarem(bool squarem) {
+    options_.squarem = squarem;
+
+    return *this;
+}
+
+template <typename Scalar>
+LDABuilder<Scalar> & LDABuilder<Scalar>::set_convergence_tolerance(
+    Scalar tolerance,
+    bool held_out
+) {
+    options_.tolerance = tolerance;
+    options_.held_out = held_out;
+
+    return *this;
+}
+
+template <typename Scalar>
+LDABuilder<Scalar> & LDABuilder<Scalar>::set_deduplicate(bool deduplicate) {
+    options_.deduplicate = deduplicate;
+
+    return *this;
+}
+
+template <typename Scalar>
+LDABuilder<Scalar> & LDABuilder<Scalar>::set_feature_hashing(int buckets) {
+    options_.hasher = (buckets > 0) ? std::make_shared<corpus::FeatureHasher>(buckets) : nullptr;
+
+    return *this;
+}
+
+template <typename Scalar>
+std::shared_ptr<LikelihoodEvaluator<Scalar> > LDABuilder<Scalar>::get_likelihood_evaluator(
+    const Eigen::MatrixXi &X,
+    Scalar sample,
+    size_t e_step_iterations,
+    Scalar e_step_tolerance,
+    int random_state
+) {
+    if (sample >= 1 && options_.hasher) {
+        return std::make_shared<LikelihoodEvaluator<Scalar> >(
+            options_.hasher->transform(X),
+            e_step_iterations,
+            e_step_tolerance
+        );
+    } else if (sample >= 1) {
+        return std::make_shared<LikelihoodEvaluator<Scalar> >(
+            X,
+            e_step_iterations,
+            e_step_tolerance
+        );
+    }
+
+    // Choose a random subset of the documents keeping their order
+    std::vector<int> documents(X.cols());
+    std::iota(documents.begin(), documents.end(), 0);
+    math_utils::Xoshiro256 prng(random_state);
+    std::shuffle(documents.begin(), documents.end(), prng);
+    int N = std::max(1, static_cast<int>(std::round(sample * X.cols())));
+    N = std::min(N, static_cast<int>(X.cols()));
+    std::sort(documents.begin(), documents.begin() + N);
+
+    Eigen::MatrixXi X_sample(X.rows(), N);
+    for (int i=0; i<N; i++) {
+        X_sample.col(i) = X.col(documents[i]);
+    }
+
+    if (options_.hasher) {
+        X_sample = options_.hasher->transform(X_sample);
+    }
+
+    return std::make_shared<LikelihoodEvaluator<Scalar> >(
+        X_sample,
+        e_step_iterations,
+        e_step_tolerance
+    );
+}
+
 template <typename Scalar>
 std::shared_ptr<em::EStepInterface<Scalar> > LDABuilder<Scalar>::get_classic_e_step(
     size_t e_step_iterations,
     Scalar e_step_tolerance,
     Scalar compute_likelihood,
-    int random_state
+    int random_state,
+    bool squarem
 ) {
     return std::make_shared<em::UnsupervisedEStep<Scalar> >(
         e_step_iterations,
         e_step_tolerance,
         compute_likelihood,
-        random_state
+        random_state,
+        squarem
     );
 }
 
@@ -273,6 +365,15 @@ LDABuilder<Scalar> & LDABuilder<Scalar>::initialize_topics_seeded(
     size_t N,
     int random_state
 ) {
+    if (options_.hasher) {
+        return initialize_topics_seeded(
+            std::make_shared<corpus::EigenHashedCorpus>(*options_.hasher, X),
+            topics,
+            N,
+            random_state
+        );
+    }
+
     return initialize_topics_seeded(
         std::make_shared<corpus::EigenCorpus>(X),
         topics,
@@ -322,7 +423,11 @@ LDABuilder<Scalar> & LDABuilder<Scalar>::initialize_topics_random(
     // Initialize alpha as 1/topics
     model_parameters_->alpha = VectorX::Constant(topics, 1.0 / topics);
 
-    // Allocate memory for beta
+    // Allocate memory for beta (the words are the hash buckets if the
+    // documents are hashed)
+    if (options_.hasher) {
+        words = options_.hasher->buckets();
+    }
     model_parameters_->beta = MatrixX::Zero(topics, words);
     
     std::mt19937 rng(random_state);
@@ -0,0 +1,222 @@
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ldaplusplus/e_step_utils.hpp"
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/LikelihoodEvaluator.hpp"
+#include "ldaplusplus/utils.hpp"
+
+namespace ldaplusplus {
+
+
+/**
+ * Ask the scheduler to run the calling thread only when a cpu would otherwise
+ * be idle (only on Linux, elsewhere it does nothing).
+ */
+static void set_idle_priority() {
+    #ifdef __linux__
+    struct sched_param param;
+    param.sched_priority = 0;
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+    #endif
+}
+
+
+template <typename Scalar>
+LikelihoodEvaluator<Scalar>::LikelihoodEvaluator(
+    const Eigen::MatrixXi &X,
+    size_t e_step_iterations,
+    Scalar e_step_tolerance
+) : words_(X.cols()),
+    counts_(X.cols()),
+    total_words_(X.sum()),
+    e_step_iterations_(e_step_iterations),
+    e_step_tolerance_(e_step_tolerance),
+    pending_epoch_(0),
+    busy_(false),
+    stop_(false),
+    event_dispatcher_(std::make_shared<events::EventDispatcher>())
+{
+    for (int d=0; d<X.cols(); d++) {
+        int nnz = (X.col(d).array() != 0).count();
+        words_[d].resize(nnz);
+        counts_[d].resize(nnz);
+        for (int i=0, j=0; i<X.rows(); i++) {
+            if (X(i, d) != 0) {
+                words_[d][j] = i;
+                counts_[d][j] = X(i, d);
+                j++;
+            }
+        }
+    }
+}
+
+
+template <typename Scalar>
+LikelihoodEvaluator<Scalar>::~LikelihoodEvaluator() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+
+template <typename Scalar>
+void LikelihoodEvaluator<Scalar>::evaluate(
+    size_t epoch,
+    std::shared_ptr<parameters::Parameters> model_parameters
+) {
+    // copy the parameters needed since the model changes during the next
+    // epoch
+    auto model = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(
+        model_parameters
+    );
+    auto snapshot = std::make_shared<parameters::ModelParameters<Scalar> >(
+        model->alpha,
+        model->beta
+    );
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = snapshot;
+        pending_epoch_ = epoch;
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&LikelihoodEvaluator<Scalar>::evaluation_thread, this);
+        }
+    }
+    cv_.notify_all();
+}
+
+
+template <typename Scalar>
+void LikelihoodEvaluator<Scalar>::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return pending_ == nullptr && !busy_; });
+}
+
+
+template <typename Scalar>
+Scalar LikelihoodEvaluator<Scalar>::likelihood(
+    const parameters::ModelParameters<Scalar> &model
+) const {
+    // sum in double so that the float models do not round away the
+    // likelihood of the documents once the sum grows large
+    double likelihood = 0;
+    for (size_t d=0; d<words_.size(); d++) {
+        likelihood += document_likelihood(d, model.alpha, model.beta);
+    }
+
+    return likelihood;
+}
+
+
+template <typename Scalar>
+Scalar LikelihoodEvaluator<Scalar>::document_likelihood(
+    size_t d,
+    const VectorX &alpha,
+    const MatrixX &beta
+) const {
+    const Eigen::VectorXi &words = words_[d];
+    const VectorX &counts = counts_[d];
+    int K = beta.rows();
+    int nnz = words.rows();
+
+    // Gather the columns of beta for the words of the document
+    MatrixX beta_d(K, nnz);
+    for (int i=0; i<nnz; i++) {
+        beta_d.col(i) = beta.col(words[i]);
+    }
+
+    // Infer phi and gamma exactly like the UnsupervisedEStep but only for
+    // the words in the document
+    MatrixX phi(K, nnz);
+    VectorX gamma = alpha.array() + counts.sum() / K;
+    VectorX gamma_old;
+    auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
+    for (size_t iteration=0; iteration<e_step_iterations_; iteration++) {
+        gamma_old = gamma;
+
+        VectorX t = (
+            gamma.unaryExpr(cwise_digamma).array() - math_utils::digamma(gamma.sum())
+        ).exp();
+        phi = beta_d.array().colwise() * t.array();
+        phi.array().rowwise() /= phi.array().colwise().sum();
+        gamma = alpha + phi * counts;
+
+        Scalar mean_change = (gamma_old - gamma).array().abs().sum() / K;
+        if (mean_change < e_step_tolerance_) {
+            break;
+        }
+    }
+
+    return e_step_utils::compute_unsupervised_likelihood_sparse<Scalar>(
+        counts,
+        alpha,
+        beta_d,
+        phi,
+        gamma
+    );
+}
+
+
+template <typename Scalar>
+void LikelihoodEvaluator<Scalar>::evaluation_thread() {
+    set_idle_priority();
+
+    while (true) {
+        std::shared_ptr<parameters::ModelParameters<Scalar> > model;
+        size_t epoch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            busy_ = false;
+            cv_.notify_all();
+            cv_.wait(lock, [this]() { return stop_ || pending_ != nullptr; });
+            if (stop_) {
+                return;
+            }
+            model = pending_;
+            epoch = pending_epoch_;
+            pending_ = nullptr;
+            busy_ = true;
+        }
+
+        Scalar value = likelihood(*model);
+
+        get_event_dispatcher()->template dispatch<events::EvaluationProgressEvent<Scalar> >(
+            epoch,
+            value,
+            documents(),
+            total_words()
+        );
+    }
+}
+
+
+template <typename Scalar>
+void LikelihoodEvaluator<Scalar>::set_event_dispatcher(
+    std::shared_ptr<events::EventDispatcherInterface> dispatcher
+) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    event_dispatcher_ = dispatcher;
+}
+
+
+template <typename Scalar>
+std::shared_ptr<events::EventDispatcherInterface> LikelihoodEvaluator<Scalar>::get_event_dispatcher() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return event_dispatcher_;
+}
+
+
+// Template instantiation
+template class LikelihoodEvaluator<float>;
+template class LikelihoodEvaluator<double>;
+
+
+}  // namespace ldaplusplus
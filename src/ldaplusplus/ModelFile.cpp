@@ -0,0 +1,331 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ldaplusplus/ModelFile.hpp"
+
+namespace ldaplusplus {
+namespace model_file {
+
+
+namespace {
+
+const char MAGIC[8] = {'L', 'D', 'A', 'P', 'P', 'M', 'D', 'L'};
+const size_t ALIGNMENT = 64;
+
+struct Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t scalar_size;
+    uint64_t topics;
+    uint64_t words;
+    uint64_t eta_rows;
+    uint64_t eta_cols;
+    uint64_t flags;
+    uint64_t hash_buckets;
+};
+static_assert(sizeof(Header) == ALIGNMENT, "The header should be 64 bytes");
+
+size_t align(size_t offset) {
+    return ((offset + ALIGNMENT - 1) / ALIGNMENT) * ALIGNMENT;
+}
+
+/**
+ * Compute where every array starts and the size of the file.
+ */
+void layout(
+    const Header &header,
+    size_t &alpha_offset,
+    size_t &beta_offset,
+    size_t &eta_offset,
+    size_t &log_beta_offset,
+    size_t &total_size
+) {
+    size_t beta_size = header.topics * header.words * header.scalar_size;
+    alpha_offset = sizeof(Header);
+    beta_offset = align(alpha_offset + header.topics * header.scalar_size);
+    eta_offset = align(beta_offset + beta_size);
+    total_size = eta_offset + header.eta_rows * header.eta_cols * header.scalar_size;
+    log_beta_offset = align(total_size);
+    if (header.flags & LOG_BETA) {
+        total_size = log_beta_offset + beta_size;
+    }
+}
+
+void write_padding(std::ofstream &file, size_t offset) {
+    static const char zeros[ALIGNMENT] = {0};
+    size_t position = file.tellp();
+    file.write(zeros, offset - position);
+}
+
+}  // namespace
+
+
+template <typename Scalar>
+void save(
+    const std::string &path,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &alpha,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &beta,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> &eta,
+    uint64_t flags,
+    uint64_t hash_buckets
+) {
+    if (alpha.rows() != beta.rows()) {
+        throw std::runtime_error("alpha and beta should have one row per topic");
+    }
+    if (flags & ~LOG_BETA) {
+        throw std::runtime_error("Unknown model file flags");
+    }
+    if (hash_buckets != 0 && hash_buckets != static_cast<uint64_t>(beta.cols())) {
+        throw std::runtime_error("A hashed model should have a word per bucket");
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.scalar_size = sizeof(Scalar);
+    header.topics = beta.rows();
+    header.words = beta.cols();
+    header.eta_rows = eta.rows();
+    header.eta_cols = eta.cols();
+    header.flags = flags;
+    header.hash_buckets = hash_buckets;
+
+    size_t alpha_offset, beta_offset, eta_offset, log_beta_offset, total_size;
+    layout(header, alpha_offset, beta_offset, eta_offset, log_beta_offset, total_size);
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    file.write(
+        reinterpret_cast<const char *>(alpha.data()),
+        alpha.size() * sizeof(Scalar)
+    );
+    write_padding(file, beta_offset);
+    file.write(
+        reinterpret_cast<const char *>(beta.data()),
+        beta.size() * sizeof(Scalar)
+    );
+    write_padding(file, eta_offset);
+    file.write(
+        reinterpret_cast<const char *>(eta.data()),
+        eta.size() * sizeof(Scalar)
+    );
+
+    // the logarithm is taken one word at a time to not need another K x V
+    if (flags & LOG_BETA) {
+        write_padding(file, log_beta_offset);
+        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> log_beta(beta.rows());
+        for (int w=0; w<beta.cols(); w++) {
+            log_beta = (beta.col(w).array() + 1e-44).log();
+            file.write(
+                reinterpret_cast<const char *>(log_beta.data()),
+                log_beta.size() * sizeof(Scalar)
+            );
+        }
+    }
+
+    if (!file) {
+        throw std::runtime_error("Couldn't write the model to " + path);
+    }
+}
+
+
+bool is_model_file(const std::string &path) {
+    char magic[sizeof(MAGIC)];
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    file.read(magic, sizeof(MAGIC));
+
+    return file && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+
+MappedModel::MappedModel(const std::string &path)
+    : path_(path),
+      data_(nullptr),
+      size_(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Couldn't open the model " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error(path + " is not a model file");
+    }
+    size_ = st.st_size;
+    void * data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Couldn't map the model " + path);
+    }
+    data_ = static_cast<const char *>(data);
+
+    // validate the header before trusting any size in it
+    Header header;
+    std::memcpy(&header, data_, sizeof(Header));
+    std::string error;
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = path + " is not a model file";
+    } else if (header.version != VERSION) {
+        error = path + " has an unsupported version or byte order";
+    } else if (header.scalar_size != 4 && header.scalar_size != 8) {
+        error = path + " has an unsupported scalar size";
+    } else if (header.flags & ~LOG_BETA) {
+        error = path + " has unsupported flags";
+    } else if (header.hash_buckets != 0 && header.hash_buckets != header.words) {
+        error = path + " has more words than hash buckets";
+    } else if (
+        header.topics > size_ || header.words > size_ ||
+        header.eta_rows > size_ || header.eta_cols > size_ ||
+        (header.words > 0 && header.topics > size_ / header.words) ||
+        (header.eta_cols > 0 && header.eta_rows > size_ / header.eta_cols)
+    ) {
+        error = path + " is truncated";
+    }
+    if (error.empty()) {
+        size_t total_size;
+        layout(
+            header,
+            alpha_offset_,
+            beta_offset_,
+            eta_offset_,
+            log_beta_offset_,
+            total_size
+        );
+        if (total_size > size_) {
+            error = path + " is truncated";
+        }
+    }
+    if (!error.empty()) {
+        munmap(const_cast<char *>(data_), size_);
+        throw std::runtime_error(error);
+    }
+
+    scalar_size_ = header.scalar_size;
+    topics_ = header.topics;
+    words_ = header.words;
+    eta_rows_ = header.eta_rows;
+    eta_cols_ = header.eta_cols;
+    flags_ = header.flags;
+    hash_buckets_ = header.hash_buckets;
+}
+
+MappedModel::~MappedModel() {
+    munmap(const_cast<char *>(data_), size_);
+}
+
+template <typename Scalar>
+const Scalar * MappedModel::array(size_t offset) const {
+    if (sizeof(Scalar) != scalar_size_) {
+        throw std::runtime_error(
+            "The precision of " + path_ + " does not match the requested one"
+        );
+    }
+
+    return reinterpret_cast<const Scalar *>(data_ + offset);
+}
+
+template <typename Scalar>
+MappedModel::VectorMap<Scalar> MappedModel::alpha() const {
+    return VectorMap<Scalar>(array<Scalar>(alpha_offset_), topics_);
+}
+
+template <typename Scalar>
+MappedModel::MatrixMap<Scalar> MappedModel::beta() const {
+    return MatrixMap<Scalar>(array<Scalar>(beta_offset_), topics_, words_);
+}
+
+template <typename Scalar>
+MappedModel::MatrixMap<Scalar> MappedModel::eta() const {
+    return MatrixMap<Scalar>(array<Scalar>(eta_offset_), eta_rows_, eta_cols_);
+}
+
+template <typename Scalar>
+MappedModel::MatrixMap<Scalar> MappedModel::log_beta() const {
+    if (!has_log_beta()) {
+        return MatrixMap<Scalar>(nullptr, 0, 0);
+    }
+
+    return MatrixMap<Scalar>(array<Scalar>(log_beta_offset_), topics_, words_);
+}
+
+template <typename Scalar>
+std::shared_ptr<parameters::SupervisedModelParameters<Scalar> > MappedModel::parameters() const {
+    auto model = std::make_shared<parameters::SupervisedModelParameters<Scalar> >();
+
+    if (scalar_size_ == sizeof(float)) {
+        model->alpha = alpha<float>().template cast<Scalar>();
+        model->beta = beta<float>().template cast<Scalar>();
+        model->eta = eta<float>().template cast<Scalar>();
+    } else {
+        model->alpha = alpha<double>().template cast<Scalar>();
+        model->beta = beta<double>().template cast<Scalar>();
+        model->eta = eta<double>().template cast<Scalar>();
+    }
+
+    return model;
+}
+
+
+template <typename Scalar>
+std::shared_ptr<parameters::ModelParametersView<Scalar> > map_parameters(
+    const std::string &path
+) {
+    auto model = std::make_shared<const MappedModel>(path);
+
+    return std::make_shared<parameters::ModelParametersView<Scalar> >(
+        model->alpha<Scalar>(),
+        model->beta<Scalar>(),
+        model->eta<Scalar>(),
+        model->log_beta<Scalar>(),
+        model
+    );
+}
+
+
+// Template instantiation
+template void save<float>(
+    const std::string &path,
+    const Eigen::Matrix<float, Eigen::Dynamic, 1> &alpha,
+    const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic> &beta,
+    const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic> &eta,
+    uint64_t flags,
+    uint64_t hash_buckets
+);
+template void save<double>(
+    const std::string &path,
+    const Eigen::Matrix<double, Eigen::Dynamic, 1> &alpha,
+    const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &beta,
+    const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> &eta,
+    uint64_t flags,
+    uint64_t hash_buckets
+);
+template MappedModel::VectorMap<float> MappedModel::alpha<float>() const;
+template MappedModel::VectorMap<double> MappedModel::alpha<double>() const;
+template MappedModel::MatrixMap<float> MappedModel::beta<float>() const;
+template MappedModel::MatrixMap<double> MappedModel::beta<double>() const;
+template MappedModel::MatrixMap<float> MappedModel::eta<float>() const;
+template MappedModel::MatrixMap<double> MappedModel::eta<double>() const;
+template MappedModel::MatrixMap<float> MappedModel::log_beta<float>() const;
+template MappedModel::MatrixMap<double> MappedModel::log_beta<double>() const;
+template std::shared_ptr<parameters::SupervisedModelParameters<float> > MappedModel::parameters<float>() const;
+template std::shared_ptr<parameters::SupervisedModelParameters<double> > MappedModel::parameters<double>() const;
+template std::shared_ptr<parameters::ModelParametersView<float> > map_parameters<float>(
+    const std::string &path
+);
+template std::shared_ptr<parameters::ModelParametersView<double> > map_parameters<double>(
+    const std::string &path
+);
+
+
+}  // namespace model_file
+}  // namespace ldaplusplus
@@ -0,0 +1,164 @@
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "ldaplusplus/Vocabulary.hpp"
+
+namespace ldaplusplus {
+namespace corpus {
+
+
+/**
+ * Collect the indices of the true elements of a mask.
+ */
+template <typename Derived>
+static Eigen::VectorXi nonzero(const Eigen::DenseBase<Derived> &mask) {
+    std::vector<int> indices;
+    for (int i=0; i<mask.size(); i++) {
+        if (mask[i]) {
+            indices.push_back(i);
+        }
+    }
+
+    return Eigen::Map<Eigen::VectorXi>(indices.data(), indices.size());
+}
+
+
+Vocabulary::Vocabulary(const Eigen::MatrixXi &X, int min_count)
+    : Vocabulary(
+        nonzero((X.rowwise().sum().array() >= min_count).eval()),
+        X.rows()
+    )
+{}
+
+Vocabulary::Vocabulary(Eigen::VectorXi words, int original_size)
+    : words_(std::move(words)),
+      ids_(Eigen::VectorXi::Constant(original_size, -1))
+{
+    for (int i=0; i<words_.rows(); i++) {
+        if (words_[i] < 0 || words_[i] >= original_size ||
+            (i > 0 && words_[i] <= words_[i-1])) {
+            throw std::runtime_error("The words of a vocabulary should be "
+                                     "increasing ids in [0, original_size)");
+        }
+        ids_[words_[i]] = i;
+    }
+}
+
+template <typename Scalar>
+Vocabulary Vocabulary::from_topics(const Eigen::Ref<const MatrixX<Scalar> > &beta) {
+    return Vocabulary(
+        nonzero((beta.array() > 0).colwise().any().eval()),
+        beta.cols()
+    );
+}
+
+Eigen::MatrixXi Vocabulary::compact(const Eigen::MatrixXi &X) const {
+    if (X.rows() != original_size()) {
+        throw std::runtime_error("The documents do not have as many words as "
+                                 "the vocabulary");
+    }
+
+    Eigen::MatrixXi X_compact(size(), X.cols());
+    for (int d=0; d<X.cols(); d++) {
+        for (int i=0; i<size(); i++) {
+            X_compact(i, d) = X(words_[i], d);
+        }
+    }
+
+    return X_compact;
+}
+
+Eigen::MatrixXi Vocabulary::mask(const Eigen::MatrixXi &X) const {
+    if (X.rows() != original_size()) {
+        throw std::runtime_error("The documents do not have as many words as "
+                                 "the vocabulary");
+    }
+
+    Eigen::MatrixXi X_masked = Eigen::MatrixXi::Zero(X.rows(), X.cols());
+    for (int d=0; d<X.cols(); d++) {
+        for (int i=0; i<size(); i++) {
+            X_masked(words_[i], d) = X(words_[i], d);
+        }
+    }
+
+    return X_masked;
+}
+
+template <typename Scalar>
+Vocabulary::MatrixX<Scalar> Vocabulary::compact_topics(const MatrixX<Scalar> &beta) const {
+    if (beta.cols() != original_size()) {
+        throw std::runtime_error("The topics do not have as many words as "
+                                 "the vocabulary");
+    }
+
+    MatrixX<Scalar> beta_compact(beta.rows(), size());
+    for (int i=0; i<size(); i++) {
+        beta_compact.col(i) = beta.col(words_[i]);
+    }
+    beta_compact.array().colwise() /= beta_compact.array().rowwise().sum();
+
+    return beta_compact;
+}
+
+template <typename Scalar>
+Vocabulary::MatrixX<Scalar> Vocabulary::expand_topics(const MatrixX<Scalar> &beta) const {
+    if (beta.cols() != size()) {
+        throw std::runtime_error("The topics do not have as many words as "
+                                 "the vocabulary");
+    }
+
+    MatrixX<Scalar> beta_expanded = MatrixX<Scalar>::Zero(beta.rows(), original_size());
+    for (int i=0; i<size(); i++) {
+        beta_expanded.col(words_[i]) = beta.col(i);
+    }
+
+    return beta_expanded;
+}
+
+
+FeatureHasher::FeatureHasher(int buckets)
+    : buckets_(buckets)
+{
+    if (buckets <= 0) {
+        throw std::runtime_error("The number of hash buckets should be positive");
+    }
+}
+
+int FeatureHasher::bucket(int word) const {
+    // The splitmix64 finalizer spreads consecutive ids over the buckets
+    uint64_t z = static_cast<uint64_t>(word) + 0x9e3779b97f4a7c15;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    z = z ^ (z >> 31);
+
+    return static_cast<int>(z % static_cast<uint64_t>(buckets_));
+}
+
+Eigen::MatrixXi FeatureHasher::transform(const Eigen::MatrixXi &X) const {
+    // hashing only the non zero counts is cheaper than a table of every row
+    // for sparse documents
+    Eigen::MatrixXi X_hashed = Eigen::MatrixXi::Zero(buckets_, X.cols());
+    for (int d=0; d<X.cols(); d++) {
+        for (int w=0; w<X.rows(); w++) {
+            if (X(w, d) != 0) {
+                X_hashed(bucket(w), d) += X(w, d);
+            }
+        }
+    }
+
+    return X_hashed;
+}
+
+
+// Template instantiation
+template Vocabulary Vocabulary::from_topics<float>(const Eigen::Ref<const MatrixX<float> > &beta);
+template Vocabulary Vocabulary::from_topics<double>(const Eigen::Ref<const MatrixX<double> > &beta);
+template Vocabulary::MatrixX<float> Vocabulary::compact_topics<float>(const MatrixX<float> &beta) const;
+template Vocabulary::MatrixX<double> Vocabulary::compact_topics<double>(const MatrixX<double> &beta) const;
+template Vocabulary::MatrixX<float> Vocabulary::expand_topics<float>(const MatrixX<float> &beta) const;
+template Vocabulary::MatrixX<double> Vocabulary::expand_topics<double>(const MatrixX<double> &beta) const;
+
+}  // namespace corpus
+}  // namespace ldaplusplus
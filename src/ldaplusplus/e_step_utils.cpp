@@ -8,7 +8,7 @@ namespace e_step_utils {
 
 template <typename Scalar>
 Scalar compute_unsupervised_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<Scalar> &alpha,
     const MatrixX<Scalar> &beta,
     const MatrixX<Scalar> &phi,
@@ -45,9 +45,64 @@ Scalar compute_unsupervised_likelihood(
 }
 
 
+template <typename Scalar>
+Scalar compute_unsupervised_likelihood_sparse(
+    const VectorX<Scalar> &counts,
+    const Ref<const VectorX<Scalar> > &alpha,
+    const MatrixX<Scalar> &beta,
+    const MatrixX<Scalar> &phi,
+    const VectorX<Scalar> &gamma
+) {
+    return compute_unsupervised_likelihood_sparse_log_beta<Scalar>(
+        counts,
+        alpha,
+        (beta.array() + 1e-44).log().matrix(),
+        phi,
+        gamma
+    );
+}
+
+
+template <typename Scalar>
+Scalar compute_unsupervised_likelihood_sparse_log_beta(
+    const VectorX<Scalar> &counts,
+    const Ref<const VectorX<Scalar> > &alpha,
+    const MatrixX<Scalar> &log_beta,
+    const MatrixX<Scalar> &phi,
+    const VectorX<Scalar> &gamma
+) {
+    auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
+    auto cwise_lgamma = math_utils::CwiseLgamma<Scalar>();
+
+    Scalar likelihood = 0;
+
+    // \Psi(\gamma) - \Psi(\sum_j \gamma)
+    VectorX<Scalar> t1 = gamma.unaryExpr(cwise_digamma).array() - math_utils::digamma(gamma.sum());
+
+    // E_q[log p(\theta | \alpha)]
+    likelihood += ((alpha.array() - 1.0).matrix().transpose() * t1).value();
+    likelihood += std::lgamma(alpha.sum()) - alpha.unaryExpr(cwise_lgamma).sum();
+
+    // E_q[log p(z | \theta)]
+    likelihood += (phi.transpose() * t1).sum();
+
+    // E_q[log p(w | z, \beta)]
+    likelihood += (
+        (phi.array() * log_beta.array()).colwise().sum().matrix() * counts
+    ).value();
+
+    // H(q)
+    likelihood += -((gamma.array() - 1).matrix().transpose() * t1).value();
+    likelihood += -std::lgamma(gamma.sum()) + gamma.unaryExpr(cwise_lgamma).sum();
+    likelihood += -(phi.array() * (phi.array() + 1e-44).log()).sum();
+
+    return likelihood;
+}
+
+
 template <typename Scalar>
 Scalar compute_supervised_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<Scalar> &alpha,
     const MatrixX<Scalar> &beta,
@@ -64,7 +119,7 @@ Scalar compute_supervised_likelihood(
 }
 template <typename Scalar>
 Scalar compute_supervised_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<Scalar> &alpha,
     const MatrixX<Scalar> &beta,
@@ -95,7 +150,7 @@ Scalar compute_supervised_likelihood(
 
 template <typename Scalar>
 Scalar compute_supervised_multinomial_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<Scalar> &alpha,
     const MatrixX<Scalar> &beta,
@@ -129,7 +184,7 @@ Scalar compute_supervised_multinomial_likelihood(
 
 template <typename Scalar>
 Scalar compute_supervised_correspondence_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<Scalar> &alpha,
     const MatrixX<Scalar> &beta,
@@ -168,7 +223,7 @@ Scalar compute_supervised_correspondence_likelihood(
 
 template <typename Scalar>
 void compute_h(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<Scalar> & X_ratio,
     const MatrixX<Scalar> &eta,
     const MatrixX<Scalar> &phi,
@@ -210,7 +265,7 @@ void compute_h(
 
 template <typename Scalar>
 void compute_supervised_phi_gamma(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<Scalar> & X_ratio,
     int y,
     const MatrixX<Scalar> & beta,
@@ -275,7 +330,7 @@ void compute_supervised_phi_gamma(
 
 template <typename Scalar>
 void compute_gamma(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<Scalar> & alpha,
     const MatrixX<Scalar> & phi,
     Ref<VectorX<Scalar> > gamma
@@ -303,6 +358,71 @@ void compute_unsupervised_phi(
     math_utils::normalize_cols(phi);
 }
 
+template <typename Scalar>
+void compute_unsupervised_gamma(
+    const Ref<const VectorXi> &X,
+    const Ref<const VectorX<Scalar> > & alpha,
+    const Ref<const MatrixX<Scalar> > & beta,
+    Ref<VectorX<Scalar> > gamma,
+    VectorX<Scalar> & scratch
+) {
+    auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
+    auto cwise_fast_exp = math_utils::CwiseFastExp<Scalar>();
+
+    // scratch holds t = exp(psi(gamma)) and gamma accumulates the columns of
+    // beta scaled by the count over the normalizer of phi
+    scratch = gamma.unaryExpr(cwise_digamma).unaryExpr(cwise_fast_exp);
+    gamma.setZero();
+    for (int i=0; i<X.rows(); i++) {
+        if (X[i] == 0) {
+            continue;
+        }
+
+        Scalar norm = beta.col(i).dot(scratch);
+        if (norm == 0) {
+            continue;
+        }
+
+        gamma += (X[i] / norm) * beta.col(i);
+    }
+    gamma = alpha + gamma.cwiseProduct(scratch);
+}
+
+template <typename Scalar>
+void compute_phi_scaled(
+    const Ref<const VectorXi> &X,
+    const MatrixX<Scalar> & phi,
+    const Ref<const VectorXi> &words,
+    Ref<MatrixX<Scalar> > phi_scaled
+) {
+    for (int j=0; j<words.rows(); j++) {
+        phi_scaled.col(j) = static_cast<Scalar>(X[words[j]]) * phi.col(words[j]);
+    }
+}
+
+template <typename Scalar>
+void compute_unsupervised_phi_scaled(
+    const Ref<const VectorXi> &X,
+    const Ref<const MatrixX<Scalar> > & beta,
+    const Ref<const VectorX<Scalar> > & gamma,
+    const Ref<const VectorXi> &words,
+    Ref<MatrixX<Scalar> > phi_scaled,
+    VectorX<Scalar> & scratch
+) {
+    auto cwise_digamma = math_utils::CwiseDigamma<Scalar>();
+    auto cwise_fast_exp = math_utils::CwiseFastExp<Scalar>();
+
+    // scratch holds exp(psi(gamma))
+    scratch = gamma.unaryExpr(cwise_digamma).unaryExpr(cwise_fast_exp);
+    for (int j=0; j<words.rows(); j++) {
+        phi_scaled.col(j) = beta.col(words[j]).cwiseProduct(scratch);
+        Scalar norm = phi_scaled.col(j).sum();
+        if (norm != 0) {
+            phi_scaled.col(j) *= X[words[j]] / norm;
+        }
+    }
+}
+
 template <typename Scalar>
 void compute_supervised_approximate_phi(
     const VectorX<Scalar> & X_ratio,
@@ -342,7 +462,7 @@ void compute_supervised_approximate_phi(
 
 template <typename Scalar>
 void compute_supervised_multinomial_phi(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const MatrixX<Scalar> & beta,
     const MatrixX<Scalar> & eta,
@@ -365,7 +485,7 @@ void compute_supervised_multinomial_phi(
 
 template <typename Scalar>
 void compute_supervised_correspondence_phi(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const MatrixX<Scalar> & beta,
     const MatrixX<Scalar> & eta,
@@ -386,7 +506,7 @@ void compute_supervised_correspondence_phi(
 
 template <typename Scalar>
 void compute_supervised_correspondence_tau(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const MatrixX<Scalar> & eta,
     const MatrixX<Scalar> & phi,
@@ -403,21 +523,49 @@ void compute_supervised_correspondence_tau(
 
 // Template instantiations
 template float compute_unsupervised_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<float> &alpha,
     const MatrixX<float> &beta,
     const MatrixX<float> &phi,
     const VectorX<float> &gamma
 );
 template double compute_unsupervised_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<double> &alpha,
     const MatrixX<double> &beta,
     const MatrixX<double> &phi,
     const VectorX<double> &gamma
 );
+template float compute_unsupervised_likelihood_sparse(
+    const VectorX<float> &counts,
+    const Ref<const VectorX<float> > &alpha,
+    const MatrixX<float> &beta,
+    const MatrixX<float> &phi,
+    const VectorX<float> &gamma
+);
+template float compute_unsupervised_likelihood_sparse_log_beta(
+    const VectorX<float> &counts,
+    const Ref<const VectorX<float> > &alpha,
+    const MatrixX<float> &log_beta,
+    const MatrixX<float> &phi,
+    const VectorX<float> &gamma
+);
+template double compute_unsupervised_likelihood_sparse(
+    const VectorX<double> &counts,
+    const Ref<const VectorX<double> > &alpha,
+    const MatrixX<double> &beta,
+    const MatrixX<double> &phi,
+    const VectorX<double> &gamma
+);
+template double compute_unsupervised_likelihood_sparse_log_beta(
+    const VectorX<double> &counts,
+    const Ref<const VectorX<double> > &alpha,
+    const MatrixX<double> &log_beta,
+    const MatrixX<double> &phi,
+    const VectorX<double> &gamma
+);
 template float compute_supervised_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<float> &alpha,
     const MatrixX<float> &beta,
@@ -426,7 +574,7 @@ template float compute_supervised_likelihood(
     const VectorX<float> &gamma
 );
 template double compute_supervised_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<double> &alpha,
     const MatrixX<double> &beta,
@@ -435,7 +583,7 @@ template double compute_supervised_likelihood(
     const VectorX<double> &gamma
 );
 template float compute_supervised_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<float> &alpha,
     const MatrixX<float> &beta,
@@ -445,7 +593,7 @@ template float compute_supervised_likelihood(
     const VectorX<float> &h
 );
 template double compute_supervised_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<double> &alpha,
     const MatrixX<double> &beta,
@@ -455,7 +603,7 @@ template double compute_supervised_likelihood(
     const VectorX<double> &h
 );
 template float compute_supervised_multinomial_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<float> &alpha,
     const MatrixX<float> &beta,
@@ -467,7 +615,7 @@ template float compute_supervised_multinomial_likelihood(
     float portion
 );
 template double compute_supervised_multinomial_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<double> &alpha,
     const MatrixX<double> &beta,
@@ -479,7 +627,7 @@ template double compute_supervised_multinomial_likelihood(
     double portion
 );
 template float compute_supervised_correspondence_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<float> &alpha,
     const MatrixX<float> &beta,
@@ -491,7 +639,7 @@ template float compute_supervised_correspondence_likelihood(
     float portion
 );
 template double compute_supervised_correspondence_likelihood(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const VectorX<double> &alpha,
     const MatrixX<double> &beta,
@@ -503,21 +651,21 @@ template double compute_supervised_correspondence_likelihood(
     double portion
 );
 template void compute_h(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<float> & X_ratio,
     const MatrixX<float> &eta,
     const MatrixX<float> &phi,
     Ref<VectorX<float> > h
 );
 template void compute_h(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<double> & X_ratio,
     const MatrixX<double> &eta,
     const MatrixX<double> &phi,
     Ref<VectorX<double> > h
 );
 template void compute_supervised_phi_gamma(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<float> & X_ratio,
     int y,
     const MatrixX<float> & beta,
@@ -528,7 +676,7 @@ template void compute_supervised_phi_gamma(
     Ref<VectorX<float> > h
 );
 template void compute_supervised_phi_gamma(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<double> & X_ratio,
     int y,
     const MatrixX<double> & beta,
@@ -539,13 +687,13 @@ template void compute_supervised_phi_gamma(
     Ref<VectorX<double> > h
 );
 template void compute_gamma(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<float> & alpha,
     const MatrixX<float> & phi,
     Ref<VectorX<float> > gamma
 );
 template void compute_gamma(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     const VectorX<double> & alpha,
     const MatrixX<double> & phi,
     Ref<VectorX<double> > gamma
@@ -560,6 +708,48 @@ template void compute_unsupervised_phi(
     const VectorX<double> & gamma,
     Ref<MatrixX<double> > phi
 );
+template void compute_unsupervised_gamma(
+    const Ref<const VectorXi> &X,
+    const Ref<const VectorX<float> > & alpha,
+    const Ref<const MatrixX<float> > & beta,
+    Ref<VectorX<float> > gamma,
+    VectorX<float> & scratch
+);
+template void compute_unsupervised_gamma(
+    const Ref<const VectorXi> &X,
+    const Ref<const VectorX<double> > & alpha,
+    const Ref<const MatrixX<double> > & beta,
+    Ref<VectorX<double> > gamma,
+    VectorX<double> & scratch
+);
+template void compute_phi_scaled(
+    const Ref<const VectorXi> &X,
+    const MatrixX<float> & phi,
+    const Ref<const VectorXi> &words,
+    Ref<MatrixX<float> > phi_scaled
+);
+template void compute_phi_scaled(
+    const Ref<const VectorXi> &X,
+    const MatrixX<double> & phi,
+    const Ref<const VectorXi> &words,
+    Ref<MatrixX<double> > phi_scaled
+);
+template void compute_unsupervised_phi_scaled(
+    const Ref<const VectorXi> &X,
+    const Ref<const MatrixX<float> > & beta,
+    const Ref<const VectorX<float> > & gamma,
+    const Ref<const VectorXi> &words,
+    Ref<MatrixX<float> > phi_scaled,
+    VectorX<float> & scratch
+);
+template void compute_unsupervised_phi_scaled(
+    const Ref<const VectorXi> &X,
+    const Ref<const MatrixX<double> > & beta,
+    const Ref<const VectorX<double> > & gamma,
+    const Ref<const VectorXi> &words,
+    Ref<MatrixX<double> > phi_scaled,
+    VectorX<double> & scratch
+);
 template void compute_supervised_approximate_phi(
     const VectorX<float> & X_ratio,
     int num_words,
@@ -581,7 +771,7 @@ template void compute_supervised_approximate_phi(
     Ref<MatrixX<double> > phi
 );
 template void compute_supervised_multinomial_phi(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const MatrixX<float> & beta,
     const MatrixX<float> & eta,
@@ -590,7 +780,7 @@ template void compute_supervised_multinomial_phi(
     Ref<MatrixX<float> > phi
 );
 template void compute_supervised_multinomial_phi(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const MatrixX<double> & beta,
     const MatrixX<double> & eta,
@@ -599,7 +789,7 @@ template void compute_supervised_multinomial_phi(
     Ref<MatrixX<double> > phi
 );
 template void compute_supervised_correspondence_phi(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const MatrixX<float> & beta,
     const MatrixX<float> & eta,
@@ -608,7 +798,7 @@ template void compute_supervised_correspondence_phi(
     Ref<MatrixX<float> > phi
 );
 template void compute_supervised_correspondence_phi(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const MatrixX<double> & beta,
     const MatrixX<double> & eta,
@@ -617,14 +807,14 @@ template void compute_supervised_correspondence_phi(
     Ref<MatrixX<double> > phi
 );
 template void compute_supervised_correspondence_tau(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const MatrixX<float> & eta,
     const MatrixX<float> & phi,
     Ref<VectorX<float> > tau
 );
 template void compute_supervised_correspondence_tau(
-    const VectorXi & X,
+    const Ref<const VectorXi> &X,
     int y,
     const MatrixX<double> & eta,
     const MatrixX<double> & phi,
@@ -1,4 +1,5 @@
 #include "ldaplusplus/em/AbstractEStep.hpp"
+#include "ldaplusplus/events/MetricsEvents.hpp"
 
 namespace ldaplusplus {
 namespace em {
@@ -7,7 +8,66 @@ namespace em {
 template <typename Scalar>
 AbstractEStep<Scalar>::AbstractEStep(int random_state)
     : random_(random_state)
-{}
+{
+    set_workers(1);
+}
+
+template <typename Scalar>
+void AbstractEStep<Scalar>::set_workers(size_t workers) {
+    random_.set_workers(workers);
+    if (iterations_.size() < workers) {
+        iterations_.resize(workers);
+    }
+}
+
+template <typename Scalar>
+void AbstractEStep<Scalar>::e_step() {
+    // merge the histograms of all the workers and the other threads
+    std::vector<size_t> histogram;
+    auto merge = [&histogram](std::vector<size_t> &h) {
+        if (histogram.size() < h.size()) {
+            histogram.resize(h.size(), 0);
+        }
+        for (size_t i=0; i<h.size(); i++) {
+            histogram[i] += h[i];
+        }
+        h.clear();
+    };
+    for (auto &h : iterations_) {
+        merge(h);
+    }
+    {
+        std::lock_guard<std::mutex> lock(iterations_mutex_);
+        merge(shared_iterations_);
+    }
+
+    if (!histogram.empty()) {
+        this->get_event_dispatcher()->template dispatch<events::ExpectationIterationsEvent>(
+            histogram
+        );
+    }
+}
+
+template <typename Scalar>
+void AbstractEStep<Scalar>::record_iterations(size_t iterations) {
+    auto record = [iterations](std::vector<size_t> &histogram) {
+        if (histogram.size() <= iterations) {
+            histogram.resize(iterations + 1, 0);
+        }
+        histogram[iterations]++;
+    };
+
+    size_t worker = thread_utils::worker_index();
+    if (worker < iterations_.size()) {
+        record(iterations_[worker]);
+    } else {
+        std::lock_guard<std::mutex> lock(iterations_mutex_);
+        record(shared_iterations_);
+    }
+}
+
+template <typename Scalar>
+const size_t AbstractEStep<Scalar>::SQUAREM_SCRATCH;
 
 template <typename Scalar>
 bool AbstractEStep<Scalar>::converged(
@@ -20,6 +80,63 @@ bool AbstractEStep<Scalar>::converged(
     return mean_change < tolerance;
 }
 
+template <typename Scalar>
+size_t AbstractEStep<Scalar>::squarem(
+    const std::function<void(Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &)> &update,
+    const std::function<Scalar(const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &)> &bound,
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> & gamma,
+    Scalar & value,
+    std::vector<Eigen::Matrix<Scalar, Eigen::Dynamic, 1> > & scratch
+) {
+    typedef Eigen::Matrix<Scalar, Eigen::Dynamic, 1> VectorX;
+
+    if (scratch.size() < SQUAREM_SCRATCH) {
+        scratch.resize(SQUAREM_SCRATCH);
+    }
+    VectorX &gamma_0 = scratch[0];
+    VectorX &gamma_1 = scratch[1];
+    VectorX &r = scratch[2];
+    VectorX &v = scratch[3];
+    VectorX &extrapolated = scratch[4];
+
+    // Two plain updates
+    gamma_0 = gamma;
+    update(gamma);
+    gamma_1 = gamma;
+    update(gamma);
+
+    // Compute the step length, a step of -1 is the plain update
+    r = gamma_1 - gamma_0;
+    v = gamma - gamma_1 - r;
+    Scalar v_norm = v.norm();
+    Scalar a = (v_norm > 0) ? -r.norm() / v_norm : -1;
+
+    // Move towards the plain update until gamma is positive
+    extrapolated = gamma_0 - 2*a*r + a*a*v;
+    for (int i=0; a < -1 && i<10 && (extrapolated.array() <= 0).any(); i++) {
+        a = (a - 1) / 2;
+        extrapolated = gamma_0 - 2*a*r + a*a*v;
+    }
+    if (a >= -1 || (extrapolated.array() <= 0).any()) {
+        value = bound(gamma);
+        return 2;
+    }
+
+    // Stabilize and check that the bound did not decrease
+    gamma = extrapolated;
+    update(gamma);
+    Scalar new_value = bound(gamma);
+    if (!(new_value < value)) {
+        value = new_value;
+        return 3;
+    }
+
+    gamma = gamma_1;
+    update(gamma);
+    value = bound(gamma);
+    return 4;
+}
+
 // Template instantiation
 template class AbstractEStep<float>;
 template class AbstractEStep<double>;
@@ -27,14 +27,14 @@ std::shared_ptr<parameters::Parameters> CorrespondenceSupervisedEStep<Scalar>::d
     const std::shared_ptr<parameters::Parameters> parameters
 ) {
     // Words form Document doc
-    const Eigen::VectorXi &X = doc->get_words();
+    const Eigen::Ref<const Eigen::VectorXi> &X = doc->get_words();
     int num_words = X.sum();
     int voc_size = X.rows();
     VectorX X_ratio = X.cast<Scalar>() / num_words;
 
     // Get the document's class
     int y = std::static_pointer_cast<corpus::ClassificationDocument>(doc)->get_class();
-    int corpus_size = doc->get_corpus()->size();
+    int corpus_size = doc->get_corpus()->total_weight();
 
     // Cast parameters to model parameters in order to save all necessary
     // matrixes
@@ -44,14 +44,19 @@ std::shared_ptr<parameters::Parameters> CorrespondenceSupervisedEStep<Scalar>::d
     int num_topics = beta.rows();
 
     // The variational parameters to be computed
-    MatrixX phi = MatrixX::Constant(num_topics, voc_size, 1.0/num_topics);
-    VectorX gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
-    VectorX tau = VectorX::Constant(voc_size, 1.0/voc_size);
+    auto variational_parameters = variational_parameters_.get(num_topics, voc_size);
+    MatrixX &phi = variational_parameters->phi;
+    VectorX &gamma = variational_parameters->gamma;
+    VectorX &tau = variational_parameters->tau;
+    phi.fill(1.0/num_topics);
+    gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
+    tau.setConstant(voc_size, 1.0/voc_size);
 
     // to check for convergence
     VectorX gamma_old = VectorX::Zero(num_topics);
 
-    for (size_t iteration=0; iteration<e_step_iterations_; iteration++) {
+    size_t iteration;
+    for (iteration=0; iteration<e_step_iterations_; iteration++) {
         // check for early stopping
         if (this->converged(gamma_old, gamma, e_step_tolerance_)) {
             break;
@@ -81,6 +86,16 @@ std::shared_ptr<parameters::Parameters> CorrespondenceSupervisedEStep<Scalar>::d
         // Equation (6) in Supervised topic models, Blei, McAulife 2008
         e_step_utils::compute_gamma<Scalar>(X, alpha, phi, gamma);
     }
+    this->record_iterations(iteration);
+
+    // Keep the columns of phi that the M steps need
+    variational_parameters->set_words(X, phi.rows());
+    e_step_utils::compute_phi_scaled<Scalar>(
+        X,
+        phi,
+        variational_parameters->words,
+        variational_parameters->phi_scaled
+    );
 
     // notify that the e step has finished and compute the likelihood with
     // probability compute_likelihood_
@@ -99,18 +114,15 @@ std::shared_ptr<parameters::Parameters> CorrespondenceSupervisedEStep<Scalar>::d
                     tau,
                     mu_,
                     1.0 / corpus_size
-                )
+                ),
+                doc->get_weight()
             );
     } else {
         this->get_event_dispatcher()->
             template dispatch<events::ExpectationProgressEvent<Scalar> >(NAN);
     }
 
-    return std::make_shared<parameters::SupervisedCorrespondenceVariationalParameters<Scalar> >(
-        gamma,
-        phi,
-        tau
-    );
+    return variational_parameters;
 }
 
 
@@ -35,12 +35,15 @@ void CorrespondenceSupervisedMStep<Scalar>::doc_m_step(
     std::shared_ptr<parameters::Parameters> m_parameters
 ) {
     // Words and class from document
-    const Eigen::VectorXi &X = doc->get_words();
+    const Eigen::Ref<const Eigen::VectorXi> &X = doc->get_words();
     int y = std::static_pointer_cast<corpus::ClassificationDocument>(doc)->get_class();
 
-    // Cast Parameters to VariationalParameters in order to have access to phi and tau
+    // Cast Parameters to VariationalParameters in order to have access to
+    // the columns of phi for the words of the document scaled by the counts
+    // and tau
     auto vp = std::static_pointer_cast<parameters::SupervisedCorrespondenceVariationalParameters<Scalar> >(v_parameters);
-    const MatrixX &phi = vp->phi;
+    const auto &words = vp->words;
+    const auto &phi_scaled = vp->phi_scaled;
     const VectorX &tau = vp->tau;
 
     // Cast model parameters to model for liberal use
@@ -48,27 +51,22 @@ void CorrespondenceSupervisedMStep<Scalar>::doc_m_step(
 
     // Allocate memory for our sufficient statistics buffers
     if (b_.rows() == 0) {
-        b_ = MatrixX::Zero(phi.rows(), phi.cols());
-        phi_scaled_ = MatrixX::Zero(phi.rows(), phi.cols());
-        phi_scaled_sum_ = VectorX::Zero(phi.rows());
+        b_ = MatrixX::Zero(model->beta.rows(), X.rows());
+        phi_scaled_sum_ = VectorX::Zero(model->beta.rows());
 
         h_ = MatrixX::Zero(model->eta.rows(), model->eta.cols());
 
         log_py_ = 0;
     }
 
-    // Scale phi according to the word counts
-    phi_scaled_ = (
-        phi.array().rowwise() *
-        (
-            X.cast<Scalar>().transpose().array() *
-            tau.transpose().array()
-        )
-    );
-    phi_scaled_sum_ = phi_scaled_.rowwise().sum();
-
-    // Update for beta
-    b_ += phi_scaled_;
+    // Scale phi according to tau (and the copies of a deduplicated
+    // document) and update beta
+    Scalar weight = doc->get_weight();
+    phi_scaled_sum_.setZero();
+    for (int i=0; i<words.rows(); i++) {
+        b_.col(words[i]) += (weight * tau[words[i]]) * phi_scaled.col(i);
+        phi_scaled_sum_ += (weight * tau[words[i]]) * phi_scaled.col(i);
+    }
 
     // Update for eta
     h_.col(y) += phi_scaled_sum_;
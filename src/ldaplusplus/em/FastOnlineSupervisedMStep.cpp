@@ -51,31 +51,38 @@ void FastOnlineSupervisedMStep<Scalar>::doc_m_step(
     std::shared_ptr<parameters::Parameters> m_parameters
 ) {
     // Data from document doc
-    const Eigen::VectorXi & X = doc->get_words();
+    const Eigen::Ref<const Eigen::VectorXi> &X = doc->get_words();
     int y = std::static_pointer_cast<corpus::ClassificationDocument>(doc)->get_class(); 
     // Variational parameters
-    const MatrixX & phi = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters)->phi;
+    const auto & words = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters)->words;
+    const auto & phi_scaled = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters)->phi_scaled;
     const VectorX &gamma = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters)->gamma;
     // Supervised model parameters
     const VectorX &alpha = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(m_parameters)->alpha;
 
     // Initialize our variables
     if (b_.rows() == 0) {
-        b_ = MatrixX::Zero(phi.rows(), phi.cols());
+        b_ = MatrixX::Zero(alpha.rows(), X.rows());
 
-        expected_z_bar_ = MatrixX::Zero(phi.rows(), minibatch_size_);
+        expected_z_bar_ = MatrixX::Zero(alpha.rows(), minibatch_size_);
         y_ = Eigen::VectorXi::Zero(minibatch_size_);
-        eta_velocity_ = MatrixX::Zero(phi.rows(), num_classes_);
-        eta_gradient_ = MatrixX::Zero(phi.rows(), num_classes_);
+        weights_ = VectorX::Zero(minibatch_size_);
+        eta_velocity_ = MatrixX::Zero(alpha.rows(), num_classes_);
+        eta_gradient_ = MatrixX::Zero(alpha.rows(), num_classes_);
     }
 
-    // Unsupervised sufficient statistics
-    b_.array() += phi.array().rowwise() * X.cast<Scalar>().transpose().array();
+    // Unsupervised sufficient statistics (a deduplicated document counts as
+    // many times as its copies)
+    Scalar weight = doc->get_weight();
+    for (int i=0; i<words.rows(); i++) {
+        b_.col(words[i]) += weight * phi_scaled.col(i);
+    }
 
     // Supervised suff stats
     expected_z_bar_.col(docs_seen_so_far_) = gamma - alpha;
     expected_z_bar_.col(docs_seen_so_far_).array() /= expected_z_bar_.col(docs_seen_so_far_).sum();
     y_(docs_seen_so_far_) = y;
+    weights_(docs_seen_so_far_) = weight;
 
     // mark another document as seen
     docs_seen_so_far_++;
@@ -112,7 +119,8 @@ void FastOnlineSupervisedMStep<Scalar>::m_step(
     optimization::MultinomialLogisticRegression<Scalar> mlr(
         expected_z_bar_,
         y_,
-        regularization_penalty_
+        regularization_penalty_,
+        weights_
     );
     mlr.gradient(eta, eta_gradient_);
     eta_velocity_ = eta_momentum_ * eta_velocity_ - eta_learning_rate_ * eta_gradient_;
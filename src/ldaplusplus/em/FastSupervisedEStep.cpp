@@ -32,7 +32,7 @@ std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar>::doc_e_step(
     const std::shared_ptr<parameters::Parameters> parameters
 ) {
     // Words form Document doc
-    const Eigen::VectorXi &X = doc->get_words();
+    const Eigen::Ref<const Eigen::VectorXi> &X = doc->get_words();
     int num_words = X.sum();
     int voc_size = X.rows();
     VectorX X_ratio = X.cast<Scalar>() / num_words;
@@ -48,13 +48,17 @@ std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar>::doc_e_step(
     int num_topics = beta.rows();
 
     // The variational parameters to be computed
-    MatrixX phi = MatrixX::Constant(num_topics, voc_size, 1.0/num_topics);
-    VectorX gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
+    auto variational_parameters = this->get_variational_parameters(num_topics, voc_size);
+    MatrixX &phi = variational_parameters->phi;
+    VectorX &gamma = variational_parameters->gamma;
+    phi.fill(1.0/num_topics);
+    gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
 
     // to check for convergence
     VectorX gamma_old = VectorX::Zero(num_topics);
 
-    for (size_t iteration=0; iteration<e_step_iterations_; iteration++) {
+    size_t iteration;
+    for (iteration=0; iteration<e_step_iterations_; iteration++) {
         // check for early stopping
         if (this->converged(gamma_old, gamma, e_step_tolerance_)) {
             break;
@@ -75,6 +79,16 @@ std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar>::doc_e_step(
         // Equation (6) in Supervised topic models, Blei, McAulife 2008
         e_step_utils::compute_gamma<Scalar>(X, alpha, phi, gamma);
     }
+    this->record_iterations(iteration);
+
+    // Keep the columns of phi that the M steps need
+    variational_parameters->set_words(X, phi.rows());
+    e_step_utils::compute_phi_scaled<Scalar>(
+        X,
+        phi,
+        variational_parameters->words,
+        variational_parameters->phi_scaled
+    );
 
     // notify that the e step has finished
     std::bernoulli_distribution emit_likelihood(compute_likelihood_);
@@ -88,18 +102,20 @@ std::shared_ptr<parameters::Parameters> FastSupervisedEStep<Scalar>::doc_e_step(
                 eta,
                 phi,
                 gamma
-            )
+            ),
+            doc->get_weight()
         );
     } else {
         this->get_event_dispatcher()->template dispatch<events::ExpectationProgressEvent<Scalar> >(NAN);
     }
 
-    return std::make_shared<parameters::VariationalParameters<Scalar> >(gamma, phi);
+    return variational_parameters;
 }
 
 
 template <typename Scalar>
 void FastSupervisedEStep<Scalar>::e_step() {
+    AbstractEStep<Scalar>::e_step();
     epochs_ ++;
 }
 
@@ -1,5 +1,6 @@
 #include "ldaplusplus/optimization/GradientDescent.hpp"
 #include "ldaplusplus/optimization/MultinomialLogisticRegression.hpp"
+#include "ldaplusplus/events/MetricsEvents.hpp"
 #include "ldaplusplus/events/ProgressEvents.hpp"
 #include "ldaplusplus/em/FastSupervisedMStep.hpp"
 
@@ -32,14 +33,16 @@ void FastSupervisedMStep<Scalar>::doc_m_step(
     // is being called. In case of y_ simple add one at the end. In case of
     // expected_z_bar add an extra column of size topicsx1
     if (docs_ >= expected_z_bar_.cols()) {
-        // Add an extra row in y_
+        // Add an extra row in y_ and weights_
         y_.conservativeResize(docs_+1);
+        weights_.conservativeResize(docs_+1);
         
         // Add an extra column in expected_z_bar_
         expected_z_bar_.conservativeResize(num_topics, docs_+1);
     }
 
     y_(docs_) = std::static_pointer_cast<corpus::ClassificationDocument>(doc)->get_class();
+    weights_(docs_) = doc->get_weight();
 
     expected_z_bar_.col(docs_) = gamma - alpha;
     // TODO: Maybe move the following normalization to m_step() and call
@@ -65,15 +68,23 @@ void FastSupervisedMStep<Scalar>::m_step(
     // resize the member variables to fit the documents we 've seen so far in
     // the doc_m_steps
     y_.conservativeResize(docs_);
+    weights_.conservativeResize(docs_);
     expected_z_bar_.conservativeResize(expected_z_bar_.rows(), docs_);
     docs_ = 0;
 
     // we need to maximize w.r.t to \eta
     Scalar initial_value = INFINITY;
-    MultinomialLogisticRegression<Scalar> mlr(expected_z_bar_, y_, regularization_penalty_);
+    size_t gradient_iterations = 0;
+    auto line_search = std::make_shared<ArmijoLineSearch<MultinomialLogisticRegression<Scalar>, MatrixX> >();
+    MultinomialLogisticRegression<Scalar> mlr(
+        expected_z_bar_,
+        y_,
+        regularization_penalty_,
+        weights_
+    );
     GradientDescent<MultinomialLogisticRegression<Scalar>, MatrixX> minimizer(
-        std::make_shared<ArmijoLineSearch<MultinomialLogisticRegression<Scalar>, MatrixX> >(),
-        [this, &initial_value](
+        line_search,
+        [this, &initial_value, &gradient_iterations](
             Scalar value,
             Scalar gradNorm,
             size_t iterations
@@ -84,6 +95,7 @@ void FastSupervisedMStep<Scalar>::m_step(
 
             Scalar relative_improvement = (initial_value - value) / value;
             initial_value = value;
+            gradient_iterations = iterations;
 
             return (
                 iterations < m_step_iterations_ &&
@@ -92,6 +104,11 @@ void FastSupervisedMStep<Scalar>::m_step(
         }
     );
     minimizer.minimize(mlr, eta);
+
+    this->get_event_dispatcher()->template dispatch<events::LineSearchEvent>(
+        gradient_iterations,
+        line_search->evaluations()
+    );
 }
 
 // Template instantiation
@@ -35,32 +35,36 @@ void MultinomialSupervisedMStep<Scalar>::doc_m_step(
     std::shared_ptr<parameters::Parameters> m_parameters
 ) {
     // Words and class from document
-    const Eigen::VectorXi &X = doc->get_words();
+    const Eigen::Ref<const Eigen::VectorXi> &X = doc->get_words();
     int y = std::static_pointer_cast<corpus::ClassificationDocument>(doc)->get_class();
 
-    // Cast Parameters to VariationalParameters in order to have access to phi
-    const MatrixX &phi = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters)->phi;
+    // Cast Parameters to VariationalParameters in order to have access to
+    // the columns of phi for the words of the document scaled by the counts
+    auto vp = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters);
+    const auto &words = vp->words;
+    const auto &phi_scaled = vp->phi_scaled;
 
     // Cast model parameters to model for liberal use
     auto model = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(m_parameters);
 
     // Allocate memory for our sufficient statistics buffers
     if (b_.rows() == 0) {
-        b_ = MatrixX::Zero(phi.rows(), phi.cols());
-        phi_scaled_ = MatrixX::Zero(phi.rows(), phi.cols());
-        phi_scaled_sum_ = VectorX::Zero(phi.rows());
+        b_ = MatrixX::Zero(model->beta.rows(), X.rows());
+        phi_scaled_sum_ = VectorX::Zero(model->beta.rows());
 
         h_ = MatrixX::Zero(model->eta.rows(), model->eta.cols());
 
         log_py_ = 0;
     }
 
-    // Scale phi according to the word counts
-    phi_scaled_ = phi.array().rowwise() * X.cast<Scalar>().transpose().array();
-    phi_scaled_sum_ = phi_scaled_.rowwise().sum();
+    // A deduplicated document counts as many times as its copies
+    Scalar weight = doc->get_weight();
+    phi_scaled_sum_ = weight * phi_scaled.rowwise().sum();
 
     // Update for beta without smoothing
-    b_ += phi_scaled_;
+    for (int i=0; i<words.rows(); i++) {
+        b_.col(words[i]) += weight * phi_scaled.col(i);
+    }
 
     // Update for eta with smoothing
     h_.col(y) += phi_scaled_sum_;
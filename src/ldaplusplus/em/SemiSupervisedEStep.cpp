@@ -45,6 +45,12 @@ void SemiSupervisedEStep<Scalar>::e_step() {
     unsupervised_step_->e_step();
 }
 
+template <typename Scalar>
+void SemiSupervisedEStep<Scalar>::set_workers(size_t workers) {
+    supervised_step_->set_workers(workers);
+    unsupervised_step_->set_workers(workers);
+}
+
 
 // template instantiation
 template class SemiSupervisedEStep<float>;
@@ -1,5 +1,6 @@
 #include "ldaplusplus/optimization/GradientDescent.hpp"
 #include "ldaplusplus/optimization/SecondOrderLogisticRegressionApproximation.hpp"
+#include "ldaplusplus/events/MetricsEvents.hpp"
 #include "ldaplusplus/events/ProgressEvents.hpp"
 #include "ldaplusplus/em/SupervisedMStep.hpp"
 
@@ -23,12 +24,12 @@ void SupervisedMStep<Scalar>::doc_m_step(
     );
 
     // Get the words from the doc
-    const Eigen::VectorXi & X = doc->get_words();
+    const Eigen::Ref<const Eigen::VectorXi> &X = doc->get_words();
     int N = X.sum();
 
     // Cast Parameters to VariationalParameters in order to have access to gamma and phi
     const VectorX &gamma = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters)->gamma;
-    const MatrixX &phi = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters)->phi;
+    const auto &phi_scaled = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters)->phi_scaled;
     // Cast Parameters to SupervisedModelParameters in order to have access to alpha
     const VectorX &alpha = std::static_pointer_cast<parameters::SupervisedModelParameters<Scalar> >(m_parameters)->alpha;
     int num_topics = alpha.rows();
@@ -37,8 +38,9 @@ void SupervisedMStep<Scalar>::doc_m_step(
     // is being called. In case of y_ simple add one at the end. In case of
     // expected_z_bar add an extra column of size topicsx1
     if (docs_ >= expected_z_bar_.cols()) {
-        // Add an extra row in y_
+        // Add an extra row in y_ and weights_
         y_.conservativeResize(docs_+1);
+        weights_.conservativeResize(docs_+1);
         
         // Add an extra column in expected_z_bar_
         expected_z_bar_.conservativeResize(num_topics, docs_+1);
@@ -49,13 +51,14 @@ void SupervisedMStep<Scalar>::doc_m_step(
 
     // get the class
     y_(docs_) = std::static_pointer_cast<corpus::ClassificationDocument>(doc)->get_class();
+    weights_(docs_) = doc->get_weight();
 
     // get the expected_z_bar
     expected_z_bar_.col(docs_) = gamma - alpha;
     expected_z_bar_.col(docs_).array() /= N;
 
-    // get the variance_z_bar
-    MatrixX phi_scaled = phi.array().rowwise() * X.cast<Scalar>().array().transpose();
+    // get the variance_z_bar (the words that do not appear in the document
+    // do not contribute)
     variance_z_bar_[docs_] = phi_scaled * phi_scaled.transpose();
     variance_z_bar_[docs_] *= 1.0/(N * N);
 
@@ -76,21 +79,25 @@ void SupervisedMStep<Scalar>::m_step(
     // resize the member variables to fit the documents we 've seen so far in
     // the doc_m_steps
     y_.conservativeResize(docs_);
+    weights_.conservativeResize(docs_);
     expected_z_bar_.conservativeResize(expected_z_bar_.rows(), docs_);
     variance_z_bar_.resize(docs_);
     docs_ = 0;
 
     // we need to maximize w.r.t to \eta
     Scalar initial_value = INFINITY;
+    size_t gradient_iterations = 0;
+    auto line_search = std::make_shared<ArmijoLineSearch<SecondOrderLogisticRegressionApproximation<Scalar>, MatrixX> >();
     SecondOrderLogisticRegressionApproximation<Scalar> mlr(
         expected_z_bar_,
         variance_z_bar_,
         y_,
-        regularization_penalty_
+        regularization_penalty_,
+        weights_
     );
     GradientDescent<SecondOrderLogisticRegressionApproximation<Scalar>, MatrixX> minimizer(
-        std::make_shared<ArmijoLineSearch<SecondOrderLogisticRegressionApproximation<Scalar>, MatrixX> >(),
-        [this, &initial_value](
+        line_search,
+        [this, &initial_value, &gradient_iterations](
             Scalar value,
             Scalar gradNorm,
             size_t iterations
@@ -101,6 +108,7 @@ void SupervisedMStep<Scalar>::m_step(
 
             Scalar relative_improvement = (initial_value - value) / value;
             initial_value = value;
+            gradient_iterations = iterations;
 
             return (
                 iterations < m_step_iterations_ &&
@@ -109,6 +117,11 @@ void SupervisedMStep<Scalar>::m_step(
         }
     );
     minimizer.minimize(mlr, eta);
+
+    this->get_event_dispatcher()->template dispatch<events::LineSearchEvent>(
+        gradient_iterations,
+        line_search->evaluations()
+    );
 }
 
 // Template instantiation
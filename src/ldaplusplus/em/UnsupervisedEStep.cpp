@@ -1,4 +1,6 @@
 #include <cmath>
+#include <functional>
+#include <vector>
 
 #include "ldaplusplus/events/ProgressEvents.hpp"
 #include "ldaplusplus/em/UnsupervisedEStep.hpp"
@@ -14,12 +16,50 @@ UnsupervisedEStep<Scalar>::UnsupervisedEStep(
     size_t e_step_iterations,
     Scalar e_step_tolerance,
     Scalar compute_likelihood,
-    int random_state
+    int random_state,
+    bool squarem
 ) : AbstractEStep<Scalar>(random_state)
 {
     e_step_iterations_ = e_step_iterations;
     e_step_tolerance_ = e_step_tolerance;
     compute_likelihood_ = compute_likelihood;
+    squarem_ = squarem;
+}
+
+
+/**
+ * Compute the likelihood of a document from the columns of phi for its words
+ * (see VariationalParameters::phi_scaled) using the precomputed log beta of
+ * the model if there is one.
+ */
+template <typename Scalar>
+static Scalar likelihood(
+    const Eigen::Ref<const Eigen::VectorXi> &X,
+    const parameters::ModelParametersView<Scalar> &model,
+    const Eigen::Ref<const Eigen::VectorXi> &words,
+    const Eigen::Ref<const Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> > &phi_scaled,
+    const Eigen::Matrix<Scalar, Eigen::Dynamic, 1> &gamma
+) {
+    bool log_beta = model.log_beta.size() > 0;
+    const auto &beta = (log_beta) ? model.log_beta : model.beta;
+    Eigen::Matrix<Scalar, Eigen::Dynamic, 1> counts(words.rows());
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> beta_d(beta.rows(), words.rows());
+    for (int i=0; i<words.rows(); i++) {
+        counts[i] = X[words[i]];
+        beta_d.col(i) = beta.col(words[i]);
+    }
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> phi_d =
+        phi_scaled.array().rowwise() / counts.transpose().array();
+
+    if (log_beta) {
+        return e_step_utils::compute_unsupervised_likelihood_sparse_log_beta<Scalar>(
+            counts, model.alpha, beta_d, phi_d, gamma
+        );
+    }
+
+    return e_step_utils::compute_unsupervised_likelihood_sparse<Scalar>(
+        counts, model.alpha, beta_d, phi_d, gamma
+    );
 }
 
 template <typename Scalar>
@@ -28,66 +68,122 @@ std::shared_ptr<parameters::Parameters> UnsupervisedEStep<Scalar>::doc_e_step(
     const std::shared_ptr<parameters::Parameters> parameters
 ) {
     // Words form Document doc
-    const Eigen::VectorXi &X = doc->get_words();
+    const Eigen::Ref<const Eigen::VectorXi> &X = doc->get_words();
     int num_words = X.sum();
 
-    // Cast parameters to model parameters in order to save all necessary
-    // matrixes
-    const VectorX &alpha = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(parameters)->alpha;
-    const MatrixX &beta = std::static_pointer_cast<parameters::ModelParameters<Scalar> >(parameters)->beta;
+    // View the model parameters (either ModelParameters or a read-only view
+    // of a mapped model) without copying them
+    auto model = parameters::ModelParametersView<Scalar>::view(*parameters);
+    const auto &alpha = model.alpha;
+    const auto &beta = model.beta;
     int num_topics = beta.rows();
 
-    // These are the variational parameters to be computed
-    MatrixX phi = MatrixX::Constant(num_topics, X.rows(), 1.0/num_topics);
-    VectorX gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
-
-    // to check for convergence
-    VectorX gamma_old = VectorX::Zero(num_topics);
-
-    for (size_t iteration=0; iteration<e_step_iterations_; iteration++) {
+    // These are the variational parameters to be computed (phi is computed
+    // only for the words of the document so the dense phi is left empty)
+    auto variational_parameters = this->get_variational_parameters(num_topics, 0);
+    variational_parameters->set_words(X, num_topics);
+    const auto &words = variational_parameters->words;
+    auto &phi_scaled = variational_parameters->phi_scaled;
+    VectorX &gamma = variational_parameters->gamma;
+    gamma = alpha.array() + static_cast<Scalar>(num_words)/num_topics;
+
+    // the buffers of the recycled parameters (after those of squarem) are
+    // reused so that no vector is allocated for every document
+    std::vector<VectorX> &buffers = variational_parameters->scratch;
+    buffers.resize(this->SQUAREM_SCRATCH + 3);
+    VectorX &gamma_old = buffers[this->SQUAREM_SCRATCH];
+    VectorX &gamma_input = buffers[this->SQUAREM_SCRATCH + 1];
+    VectorX &scratch = buffers[this->SQUAREM_SCRATCH + 2];
+    gamma_old.setZero(num_topics);
+    gamma_input = gamma;
+
+    // Update the Dirichlet parameters according to
+    //
+    // gamma_i ^ {t+1} =  alpha_i + \sum_n \phi_{n,i}^{t+1}
+    //
+    // Equation (7) in Latent Dirichlet Allocation, Blei 2003
+    //
+    // without computing phi which is not needed between iterations (see
+    // e_step_utils::compute_unsupervised_gamma)
+    auto update = [&](VectorX &g) {
+        gamma_input = g;
+        e_step_utils::compute_unsupervised_gamma<Scalar>(X, alpha, beta, g, scratch);
+    };
+
+    // The bound for a gamma with the phi that maximizes it, used to safeguard
+    // the extrapolation
+    auto bound = [&](const VectorX &g) {
+        e_step_utils::compute_unsupervised_phi_scaled<Scalar>(
+            X, beta, g, words, phi_scaled, scratch
+        );
+        return likelihood<Scalar>(X, model, words, phi_scaled, g);
+    };
+    Scalar bound_value = (squarem_) ? bound(gamma) : 0;
+
+    size_t iteration;
+    for (iteration=0; iteration<e_step_iterations_;) {
         // check for early stopping
         if (this->converged(gamma_old, gamma, e_step_tolerance_)) {
             break;
         }
         gamma_old = gamma;
 
-        // Update Multinomial parameter phi, according to the following
-        // pseudocode
-        //
-        // for n=1 to Nd do
-        //  for i=1 to K do
-        //      phi_{n,i}^{t+1} = beta_{i, w_n}exp(\psi(\gamma_i) - \psi(sum_i \gamma_i))
-        //  end
-        //  normalize phi_{n,i}^{t+1} sum to 1
-        // end
-        //
-        // Equation (6) in Latent Dirichlet Allocation, Blei 2003
-        e_step_utils::compute_unsupervised_phi<Scalar>(beta, gamma, phi);
-
-        // Update Dirichlet parameters according 
-        //
-        // gamma_i ^ {t+1} =  alpha_i + \sum_n \phi_{n,i}^{t+1}
-        //
-        // Equation (7) in Latent Dirichlet Allocation, Blei 2003 
-        e_step_utils::compute_gamma<Scalar>(X, alpha, phi, gamma);
+        // a cycle performs up to 4 updates so near the end of the budget
+        // the plain updates are used to never exceed it
+        if (squarem_ && iteration + 4 <= e_step_iterations_) {
+            // wrapped in std::ref so that the std::function does not
+            // allocate a copy of the lambda
+            iteration += this->squarem(
+                std::ref(update),
+                std::ref(bound),
+                gamma,
+                bound_value,
+                buffers
+            );
+        } else {
+            update(gamma);
+            iteration++;
+        }
     }
 
+    // Compute the Multinomial parameter phi once, for the words of the
+    // document and multiplied by their counts, from the gamma that was the
+    // input of the last update so that phi and gamma are the same as when
+    // they are updated alternately, according to the following pseudocode
+    //
+    // for n=1 to Nd do
+    //  for i=1 to K do
+    //      phi_{n,i}^{t+1} = beta_{i, w_n}exp(\psi(\gamma_i) - \psi(sum_i \gamma_i))
+    //  end
+    //  normalize phi_{n,i}^{t+1} sum to 1
+    // end
+    //
+    // Equation (6) in Latent Dirichlet Allocation, Blei 2003
+    e_step_utils::compute_unsupervised_phi_scaled<Scalar>(
+        X,
+        beta,
+        gamma_input,
+        words,
+        phi_scaled,
+        scratch
+    );
+    this->record_iterations(iteration);
+
     // notify that the e step has finished and compute the likelihood with
     // probability compute_likelihood_
     std::bernoulli_distribution emit_likelihood(compute_likelihood_);
     if (emit_likelihood(this->get_prng())) {
         this->get_event_dispatcher()->
             template dispatch<events::ExpectationProgressEvent<Scalar> >(
-                e_step_utils::compute_unsupervised_likelihood(
-                    X, alpha, beta, phi, gamma
-                )
+                likelihood<Scalar>(X, model, words, phi_scaled, gamma),
+                doc->get_weight()
             );
     } else {
         this->get_event_dispatcher()->
             template dispatch<events::ExpectationProgressEvent<Scalar> >(NAN);
     }
 
-    return std::make_shared<parameters::VariationalParameters<Scalar> >(gamma, phi);
+    return variational_parameters;
 }
 
 // Template instantiation
@@ -22,18 +22,23 @@ void UnsupervisedMStep<Scalar>::doc_m_step(
     std::shared_ptr<parameters::Parameters> m_parameters
 ) {
     // Words form Document doc
-    const Eigen::VectorXi &X = doc->get_words();
-    auto t1 = X.cast<Scalar>().transpose().array();
-    
-    // Cast Parameters to VariationalParameters in order to have access to phi
-    const MatrixX &phi = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters)->phi;
-    auto t2 = phi.array().rowwise() * t1;
-    
+    const Eigen::Ref<const Eigen::VectorXi> &X = doc->get_words();
+
+    // Cast Parameters to VariationalParameters in order to have access to
+    // the columns of phi for the words of the document scaled by the counts
+    auto vp = std::static_pointer_cast<parameters::VariationalParameters<Scalar> >(v_parameters);
+    const auto &words = vp->words;
+    const auto &phi_scaled = vp->phi_scaled;
+
     // Check if b_ is accessed and allocate suitable amound of memory
     if (b_.rows() == 0)
-        b_ = MatrixX::Zero(phi.rows(), phi.cols());
+        b_ = MatrixX::Zero(phi_scaled.rows(), X.rows());
 
-    b_.array() += t2;
+    // A deduplicated document counts as many times as its copies
+    Scalar weight = doc->get_weight();
+    for (int i=0; i<words.rows(); i++) {
+        b_.col(words[i]) += weight * phi_scaled.col(i);
+    }
 }
 
 // Template instantiation
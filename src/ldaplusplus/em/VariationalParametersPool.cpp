@@ -0,0 +1,80 @@
+#include <atomic>
+
+#include "ldaplusplus/em/VariationalParametersPool.hpp"
+#include "ldaplusplus/utils.hpp"
+
+namespace ldaplusplus {
+namespace em {
+
+
+template <typename VariationalParameters>
+VariationalParametersPool<VariationalParameters>::VariationalParametersPool(
+    size_t shards,
+    size_t capacity
+) : capacity_(capacity) {
+    for (size_t i=0; i<shards; i++) {
+        shards_.emplace_back(new Shard());
+    }
+}
+
+template <typename VariationalParameters>
+std::shared_ptr<VariationalParameters> VariationalParametersPool<VariationalParameters>::get(
+    size_t topics,
+    size_t words
+) {
+    Shard & shard = *shards_[thread_utils::worker_index() % shards_.size()];
+
+    std::shared_ptr<VariationalParameters> buffer;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        // new references are only made here under the lock so a buffer that
+        // only the pool references stays free until we return it
+        for (auto & candidate : shard.buffers) {
+            if (candidate.use_count() == 1) {
+                buffer = candidate;
+                break;
+            }
+        }
+
+        if (buffer) {
+            // use_count() is a relaxed load, make sure the writes of the
+            // thread that dropped the last reference happen before ours
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } else {
+            buffer = std::make_shared<VariationalParameters>();
+            if (shard.buffers.size() < capacity_) {
+                shard.buffers.push_back(buffer);
+            }
+        }
+    }
+
+    // resizing to the same dimensions does not reallocate
+    buffer->phi.resize(topics, words);
+    buffer->gamma.resize(topics);
+
+    return buffer;
+}
+
+template <typename VariationalParameters>
+size_t VariationalParametersPool<VariationalParameters>::size() const {
+    size_t size = 0;
+    for (auto & shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (auto & buffer : shard->buffers) {
+            size += (buffer.use_count() == 1) ? 1 : 0;
+        }
+    }
+
+    return size;
+}
+
+// Template instantiation
+template class VariationalParametersPool<parameters::VariationalParameters<float> >;
+template class VariationalParametersPool<parameters::VariationalParameters<double> >;
+template class VariationalParametersPool<parameters::SupervisedCorrespondenceVariationalParameters<float> >;
+template class VariationalParametersPool<parameters::SupervisedCorrespondenceVariationalParameters<double> >;
+
+
+}  // namespace em
+}  // namespace ldaplusplus
@@ -1,21 +1,82 @@
 
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+
 #include "ldaplusplus/events/Events.hpp"
 
 namespace ldaplusplus {
 namespace events {
 
 
-Event::Event(std::string id) : id_(id) {}
+namespace {
+    // The registry of event types (function statics so that they can be used
+    // during static initialization)
+    std::mutex & event_types_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    std::unordered_map<std::string, size_t> & event_types() {
+        static std::unordered_map<std::string, size_t> types;
+        return types;
+    }
+
+    // A deque so that the references returned by get_event_id() stay valid
+    std::deque<std::string> & event_ids() {
+        static std::deque<std::string> ids;
+        return ids;
+    }
+}
+
+
+size_t get_event_type(const std::string &id) {
+    std::lock_guard<std::mutex> l(event_types_mutex());
+
+    auto it = event_types().find(id);
+    if (it != event_types().end()) {
+        return it->second;
+    }
+
+    size_t type = event_ids().size();
+    event_ids().push_back(id);
+    event_types().emplace(id, type);
+
+    return type;
+}
+
+
+const std::string & get_event_id(size_t type) {
+    std::lock_guard<std::mutex> l(event_types_mutex());
+
+    return event_ids()[type];
+}
+
+
+Event::Event(std::string id) : type_(get_event_type(id)) {}
+
+
+Event::Event(size_t type) : type_(type) {}
 
 
 const std::string & Event::id() const {
-    return id_;
+    return get_event_id(type_);
 }
 
 
 FunctionEventListener::FunctionEventListener(
     std::function<void(std::shared_ptr<Event>)> listener
-) : listener_(listener)
+) : listener_(listener),
+    all_types_(true)
+{}
+
+
+FunctionEventListener::FunctionEventListener(
+    std::function<void(std::shared_ptr<Event>)> listener,
+    std::vector<size_t> types
+) : listener_(listener),
+    types_(std::move(types)),
+    all_types_(false)
 {}
 
 
@@ -24,8 +85,15 @@ void FunctionEventListener::on_event(std::shared_ptr<Event> event) {
 }
 
 
+bool FunctionEventListener::listens_to(size_t type) const {
+    return all_types_ ||
+        std::find(types_.begin(), types_.end(), type) != types_.end();
+}
+
+
 void EventDispatcher::add_listener(std::shared_ptr<EventListenerInterface> listener) {
     listeners_.push_back(listener);
+    subscriptions_.update(listeners_);
 }
 
 
@@ -36,76 +104,201 @@ void EventDispatcher::remove_listener(std::shared_ptr<EventListenerInterface> li
             break;
         }
     }
+    subscriptions_.update(listeners_);
 }
 
 
 void EventDispatcher::dispatch(std::shared_ptr<Event> event) {
     for (auto l : listeners_) {
-        l->on_event(event);
+        if (l->listens_to(event->type())) {
+            l->on_event(event);
+        }
     }
 }
 
 
+bool EventDispatcher::has_listeners(size_t type) const {
+    return subscriptions_.has(type);
+}
+
+
+ThreadSafeEventDispatcher::ThreadSafeEventDispatcher(size_t capacity)
+    : listeners_(std::make_shared<Listeners>()),
+      events_head_(0),
+      events_tail_(0),
+      has_overflow_(false)
+{
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    events_.reset(new EventSlot[size]);
+    events_mask_ = size - 1;
+    for (size_t i=0; i<size; i++) {
+        events_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
 void ThreadSafeEventDispatcher::add_listener(
     std::shared_ptr<EventListenerInterface> listener
 ) {
     std::lock_guard<std::mutex> l(listeners_mutex_);
 
-    listeners_.push_back(listener);
+    auto listeners = std::make_shared<Listeners>(*listeners_);
+    listeners->push_back(listener);
+    subscriptions_.update(*listeners);
+    listeners_ = listeners;
 }
 
 void ThreadSafeEventDispatcher::remove_listener(
     std::shared_ptr<EventListenerInterface> listener
 ) {
-    std::lock_guard<std::mutex> l(deleted_listeners_mutex_);
+    std::lock_guard<std::mutex> l(listeners_mutex_);
 
-    deleted_listeners_.insert(listener);
+    auto listeners = std::make_shared<Listeners>(*listeners_);
+    listeners->erase(
+        std::remove(listeners->begin(), listeners->end(), listener),
+        listeners->end()
+    );
+    subscriptions_.update(*listeners);
+    listeners_ = listeners;
+}
+
+bool ThreadSafeEventDispatcher::has_listeners(size_t type) const {
+    return subscriptions_.has(type);
 }
 
 void ThreadSafeEventDispatcher::dispatch(std::shared_ptr<Event> event) {
-    std::lock_guard<std::mutex> l(events_mutex_);
+    if (!has_listeners(event->type())) {
+        return;
+    }
 
-    events_.push_back(event);
+    // once an event overflows the following ones are queued after it until
+    // the overflow list is drained so that the events of every thread are
+    // delivered in order
+    if (has_overflow_.load(std::memory_order_acquire) || !push_event(event)) {
+        std::lock_guard<std::mutex> l(overflow_mutex_);
+
+        overflow_.push_back(event);
+        has_overflow_.store(true, std::memory_order_release);
+    }
 }
 
-void ThreadSafeEventDispatcher::process_events() {
-    // first lock the queue and the deleted listeners together and delete the
-    // listeners in the deleted list
-    {
-        std::unique_lock<std::mutex> l1(listeners_mutex_, std::defer_lock);
-        std::unique_lock<std::mutex> l2(deleted_listeners_mutex_, std::defer_lock);
+bool ThreadSafeEventDispatcher::push_event(std::shared_ptr<Event> &event) {
+    EventSlot * slot;
+    size_t position = events_head_.load(std::memory_order_relaxed);
+
+    while (true) {
+        slot = &events_[position & events_mask_];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) -
+                              static_cast<intptr_t>(position);
+
+        if (difference == 0) {
+            if (events_head_.compare_exchange_weak(
+                    position,
+                    position + 1,
+                    std::memory_order_relaxed))
+            {
+                break;
+            }
+        } else if (difference < 0) {
+            // the buffer is full
+            return false;
+        } else {
+            position = events_head_.load(std::memory_order_relaxed);
+        }
+    }
 
-        std::lock(l1, l2);
+    slot->event = std::move(event);
+    slot->sequence.store(position + 1, std::memory_order_release);
 
-        for (auto l=listeners_.begin(); l!=listeners_.end(); l++) {
-            if (deleted_listeners_.find(*l) != deleted_listeners_.end()) {
-                l = listeners_.erase(l);
-                l--;
+    return true;
+}
+
+bool ThreadSafeEventDispatcher::pop_event(std::shared_ptr<Event> &event) {
+    EventSlot * slot;
+    size_t position = events_tail_.load(std::memory_order_relaxed);
+
+    while (true) {
+        slot = &events_[position & events_mask_];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) -
+                              static_cast<intptr_t>(position + 1);
+
+        if (difference == 0) {
+            if (events_tail_.compare_exchange_weak(
+                    position,
+                    position + 1,
+                    std::memory_order_relaxed))
+            {
+                break;
             }
+        } else if (difference < 0) {
+            // the buffer is empty
+            return false;
+        } else {
+            position = events_tail_.load(std::memory_order_relaxed);
         }
-
-        deleted_listeners_.clear();
     }
 
-    // copy the event list
-    std::list<std::shared_ptr<Event> > events;
+    event = std::move(slot->event);
+    slot->sequence.store(position + events_mask_ + 1, std::memory_order_release);
+
+    return true;
+}
+
+void ThreadSafeEventDispatcher::notify_listeners(const std::shared_ptr<Event> &event) {
+    std::shared_ptr<const Listeners> listeners;
     {
-        std::lock_guard<std::mutex> l(events_mutex_);
-        events = events_;
-        events_.clear();
+        std::lock_guard<std::mutex> l(listeners_mutex_);
+        listeners = listeners_;
     }
 
-    // copy the listeners list
-    std::list<std::shared_ptr<EventListenerInterface> > listeners;
+    for (auto & l : *listeners) {
+        if (l->listens_to(event->type())) {
+            l->on_event(event);
+        }
+    }
+}
+
+void ThreadSafeEventDispatcher::process_events() {
+    // get the current listeners (a listener removed while processing will
+    // still receive the events of this call)
+    std::shared_ptr<const Listeners> listeners;
     {
         std::lock_guard<std::mutex> l(listeners_mutex_);
         listeners = listeners_;
     }
 
     // dispatch events without worry
-    for (auto ev : events) {
-        for (auto l : listeners) {
-            l->on_event(ev);
+    std::shared_ptr<Event> event;
+    while (pop_event(event)) {
+        for (auto & l : *listeners) {
+            if (l->listens_to(event->type())) {
+                l->on_event(event);
+            }
+        }
+    }
+    event.reset();
+
+    // and then the events that didn't fit in the buffer (and every event
+    // dispatched after them)
+    if (has_overflow_.load(std::memory_order_acquire)) {
+        std::list<std::shared_ptr<Event> > events;
+        {
+            std::lock_guard<std::mutex> l(overflow_mutex_);
+            events.swap(overflow_);
+            has_overflow_.store(false, std::memory_order_relaxed);
+        }
+
+        for (auto & ev : events) {
+            for (auto & l : *listeners) {
+                if (l->listens_to(ev->type())) {
+                    l->on_event(ev);
+                }
+            }
         }
     }
 }
@@ -116,10 +309,16 @@ SameThreadEventDispatcher::SameThreadEventDispatcher()
 {}
 
 void SameThreadEventDispatcher::dispatch(std::shared_ptr<Event> event) {
-    ThreadSafeEventDispatcher::dispatch(event);
-
     if (std::this_thread::get_id() == thread_id_) {
+        if (!has_listeners(event->type())) {
+            return;
+        }
+
+        // deliver the events of other threads first to keep the order
         ThreadSafeEventDispatcher::process_events();
+        notify_listeners(event);
+    } else {
+        ThreadSafeEventDispatcher::dispatch(event);
     }
 }
 
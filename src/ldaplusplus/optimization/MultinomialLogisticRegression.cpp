@@ -11,19 +11,28 @@ MultinomialLogisticRegression<Scalar>::MultinomialLogisticRegression(
     const MatrixX &X,
     const Eigen::VectorXi &y,
     Scalar L
-) : X_(X), y_(y), L_(L) {
+) : MultinomialLogisticRegression(X, y, L, VectorX::Ones(y.rows()))
+{}
+
+template <typename Scalar>
+MultinomialLogisticRegression<Scalar>::MultinomialLogisticRegression(
+    const MatrixX &X,
+    const Eigen::VectorXi &y,
+    Scalar L,
+    VectorX weights
+) : X_(X), y_(y), L_(L), weights_(std::move(weights)) {
     
     // Total number of classes
     int C = y_.maxCoeff() + 1;
     // Allocate suitable memory
     Cy_ = VectorX::Zero(C);
 
-    // Compute the total number of documents for every class
+    // Compute the total (weighted) number of documents for every class
     for (int d=0; d< y_.rows(); d++) {
-        Cy_(y_[d]) += 1;
+        Cy_(y_[d]) += weights_[d];
     }
 
-    Cy_ = y_.rows() / (Cy_.array() * C).array();
+    Cy_ = weights_.sum() / (Cy_.array() * C).array();
 }
 
 template <typename Scalar>
@@ -32,7 +41,7 @@ MultinomialLogisticRegression<Scalar>::MultinomialLogisticRegression(
     const Eigen::VectorXi &y,
     VectorX Cy,
     Scalar L
-) : X_(X), y_(y), L_(L), Cy_(std::move(Cy))
+) : X_(X), y_(y), L_(L), Cy_(std::move(Cy)), weights_(VectorX::Ones(y.rows()))
 {}
 
 
@@ -43,9 +52,10 @@ Scalar MultinomialLogisticRegression<Scalar>::value(const MatrixX &eta) const {
 
     // \eta_T E_q[Z]y - log(\sum_{y=1}^C exp(\eta^T E_q[Z]y))
     for (int d=0; d<y_.rows(); d++) {
+        Scalar c = weights_[d] * Cy_[y_[d]];
         t = eta.transpose() * X_.col(d);
-        likelihood += Cy_[y_[d]] * t[y_[d]];
-        likelihood -= Cy_[y_[d]] * std::log(t.array().exp().sum());
+        likelihood += c * t[y_[d]];
+        likelihood -= c * std::log(t.array().exp().sum());
 
         // This will be used in case we have overflow issues
         //Scalar a = t.maxCoeff();
@@ -66,10 +76,11 @@ void MultinomialLogisticRegression<Scalar>::gradient(const MatrixX &eta, Eigen::
     VectorX t(eta.cols());
 
     for (int d=0; d<y_.rows(); d++) {
-        grad.col(y_[d]) -= Cy_[y_[d]] * X_.col(d);
+        Scalar c = weights_[d] * Cy_[y_[d]];
+        grad.col(y_[d]) -= c * X_.col(d);
 
         t = (eta.transpose() * X_.col(d)).array().exp();
-        grad += Cy_[y_[d]] * (X_.col(d) * t.transpose()) / t.sum();
+        grad += c * (X_.col(d) * t.transpose()) / t.sum();
     }
 
     // Add suitable normalization for the gradient
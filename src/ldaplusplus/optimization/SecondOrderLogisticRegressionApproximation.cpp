@@ -12,19 +12,29 @@ SecondOrderLogisticRegressionApproximation<Scalar>::SecondOrderLogisticRegressio
     const std::vector<MatrixX> &X_var,
     const Eigen::VectorXi &y,
     Scalar L
-) : X_(X), X_var_(X_var), y_(y), L_(L) {
+) : SecondOrderLogisticRegressionApproximation(X, X_var, y, L, VectorX::Ones(y.rows()))
+{}
+
+template <typename Scalar>
+SecondOrderLogisticRegressionApproximation<Scalar>::SecondOrderLogisticRegressionApproximation(
+    const MatrixX &X,
+    const std::vector<MatrixX> &X_var,
+    const Eigen::VectorXi &y,
+    Scalar L,
+    VectorX weights
+) : X_(X), X_var_(X_var), y_(y), L_(L), weights_(std::move(weights)) {
     
     // Total number of classes
     int C = y_.maxCoeff() + 1;
     // Allocate suitable memory
     Cy_ = VectorX::Zero(C);
 
-    // Compute the total number of documents for every class
+    // Compute the total (weighted) number of documents for every class
     for (int d=0; d< y_.rows(); d++) {
-        Cy_(y_[d]) += 1;
+        Cy_(y_[d]) += weights_[d];
     }
 
-    Cy_ = y_.rows() / (Cy_.array() * C).array();
+    Cy_ = weights_.sum() / (Cy_.array() * C).array();
 }
 
 template <typename Scalar>
@@ -34,7 +44,8 @@ SecondOrderLogisticRegressionApproximation<Scalar>::SecondOrderLogisticRegressio
     const Eigen::VectorXi &y,
     VectorX Cy,
     Scalar L
-) : X_(X), X_var_(X_var), y_(y), L_(L), Cy_(std::move(Cy))
+) : X_(X), X_var_(X_var), y_(y), L_(L), Cy_(std::move(Cy)),
+    weights_(VectorX::Ones(y.rows()))
 {}
 
 
@@ -45,9 +56,10 @@ Scalar SecondOrderLogisticRegressionApproximation<Scalar>::value(const MatrixX &
 
     // \eta_T E_q[Z]y - log(\sum_{y=1}^C exp(\eta^T E_q[Z]y))(1 + \frac{1}{2} \eta^T V_q[z] \eta)
     for (int d=0; d<y_.rows(); d++) {
+        Scalar c = weights_[d] * Cy_[y_[d]];
         t = eta.transpose() * X_.col(d);
-        likelihood += Cy_[y_[d]] * t[y_[d]];
-        likelihood -= Cy_[y_[d]] * std::log(
+        likelihood += c * t[y_[d]];
+        likelihood -= c * std::log(
             (t.array().exp() * (1. + 0.5 * (eta.transpose() * X_var_[d] * eta).diagonal().array())).sum()
         );
     }
@@ -70,7 +82,8 @@ void SecondOrderLogisticRegressionApproximation<Scalar>::gradient(const MatrixX
     Scalar normalizer = 0;
 
     for (int d=0; d<y_.rows(); d++) {
-        grad.col(y_[d]) -= Cy_[y_[d]] * X_.col(d);
+        Scalar c = weights_[d] * Cy_[y_[d]];
+        grad.col(y_[d]) -= c * X_.col(d);
 
         // compute everything needed to assemble the gradients
         eta_Ez = (eta.transpose() * X_.col(d)).array().exp();
@@ -86,7 +99,7 @@ void SecondOrderLogisticRegressionApproximation<Scalar>::gradient(const MatrixX
         // exp(\eta_y^T E_q[z]) ( \eta_y^T (V_q[z] + V_q[z]^T) )
         grad_d.array() += eta_Vz.transpose().array().rowwise() * eta_Ez.array().transpose();
 
-        grad += Cy_[y_[d]] * (1./normalizer) * grad_d;
+        grad += c * (1./normalizer) * grad_d;
     }
 
     // Add suitable normalization for the gradient
@@ -0,0 +1,95 @@
+#include "ldaplusplus/perf_utils.hpp"
+
+#ifdef LDAPLUSPLUS_PERF_COUNTERS
+
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ldaplusplus {
+namespace perf_utils {
+
+
+static int open_counter(uint64_t config, int group_fd) {
+    struct perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = (group_fd == -1) ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // pid = 0, cpu = -1 means the calling thread on any cpu
+    return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+
+PerfCounters::PerfCounters() : leader_(-1), instructions_(-1), cache_misses_(-1) {
+    leader_ = open_counter(PERF_COUNT_HW_CPU_CYCLES, -1);
+    if (leader_ == -1) {
+        return;
+    }
+    instructions_ = open_counter(PERF_COUNT_HW_INSTRUCTIONS, leader_);
+    cache_misses_ = open_counter(PERF_COUNT_HW_CACHE_MISSES, leader_);
+
+    // all or nothing so that the group can be read in one go
+    if (instructions_ == -1 || cache_misses_ == -1) {
+        if (instructions_ != -1) close(instructions_);
+        if (cache_misses_ != -1) close(cache_misses_);
+        close(leader_);
+        leader_ = instructions_ = cache_misses_ = -1;
+        return;
+    }
+
+    ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+PerfCounters::~PerfCounters() {
+    if (available()) {
+        close(cache_misses_);
+        close(instructions_);
+        close(leader_);
+    }
+}
+
+CounterValues PerfCounters::read() const {
+    CounterValues values;
+    if (!available()) {
+        return values;
+    }
+
+    // The layout of a group read with the read_format set in open_counter()
+    struct {
+        uint64_t nr;
+        uint64_t time_enabled;
+        uint64_t time_running;
+        uint64_t values[3];
+    } buffer;
+    if (::read(leader_, &buffer, sizeof(buffer)) != sizeof(buffer) || buffer.nr != 3) {
+        return values;
+    }
+
+    double scale = 1;
+    if (buffer.time_running > 0 && buffer.time_running < buffer.time_enabled) {
+        scale = static_cast<double>(buffer.time_enabled) / buffer.time_running;
+    }
+    values.cycles = buffer.values[0] * scale;
+    values.instructions = buffer.values[1] * scale;
+    values.cache_misses = buffer.values[2] * scale;
+
+    return values;
+}
+
+
+}  // namespace perf_utils
+}  // namespace ldaplusplus
+
+#endif  // LDAPLUSPLUS_PERF_COUNTERS
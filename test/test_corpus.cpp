@@ -47,3 +47,101 @@ TEST(TestCorpus, TestEigenCorpus) {
         }
     }
 }
+
+TEST(TestCorpus, TestEigenCorpusViews) {
+    MatrixXi X = MatrixXi::Random(10, 100).array().abs().matrix();
+
+    auto corpus = std::make_shared<corpus::EigenCorpus>(X);
+
+    for (int i=0; i<100; i++) {
+        auto doc = corpus->at(i);
+        ASSERT_EQ(X.col(i).data(), doc->get_words().data());
+        ASSERT_EQ(corpus.get(), doc->get_corpus().get());
+        ASSERT_EQ(-1, std::static_pointer_cast<corpus::ClassificationDocument>(doc)->get_class());
+    }
+}
+
+TEST(TestCorpus, TestEigenClassificationCorpus) {
+    MatrixXi X = MatrixXi::Random(10, 100).array().abs().matrix();
+    VectorXi y = VectorXi::Random(100).unaryExpr([](int v) { return std::abs(v) % 5; });
+
+    auto corpus = std::make_shared<corpus::EigenClassificationCorpus>(X, y);
+    corpus->shuffle();
+
+    ASSERT_EQ(100, corpus->size());
+
+    std::vector<bool> seen(100, false);
+    for (int i=0; i<100; i++) {
+        auto doc = std::static_pointer_cast<corpus::ClassificationDocument>(
+            corpus->at(i)
+        );
+
+        // Find the column that the document points to
+        int j = (doc->get_words().data() - X.data()) / X.rows();
+        ASSERT_LE(0, j);
+        ASSERT_GT(100, j);
+        ASSERT_FALSE(seen[j]);
+        seen[j] = true;
+
+        ASSERT_EQ(y[j], doc->get_class());
+        ASSERT_EQ(corpus.get(), doc->get_corpus().get());
+        for (int k=0; k<10; k++) {
+            ASSERT_EQ(X(k, j), doc->get_words()[k]);
+        }
+    }
+}
+
+TEST(TestCorpus, TestEigenDeduplicatedCorpus) {
+    MatrixXi X_unique = MatrixXi::Random(10, 20).array().abs().matrix();
+    MatrixXi X(10, 60);
+    VectorXi y(60);
+    for (int d=0; d<60; d++) {
+        X.col(d) = X_unique.col(d % 20);
+        // the copies of the first five documents have different classes
+        y[d] = (d % 20 < 5) ? (d / 20) % 2 : (d % 20) % 3;
+    }
+
+    auto corpus = std::make_shared<corpus::EigenDeduplicatedCorpus>(X, y);
+    corpus->shuffle();
+
+    ASSERT_EQ(25, corpus->size());
+
+    int weights = 0;
+    for (size_t i=0; i<corpus->size(); i++) {
+        auto doc = std::static_pointer_cast<corpus::ClassificationDocument>(
+            corpus->at(i)
+        );
+        weights += doc->get_weight();
+        ASSERT_EQ(corpus.get(), doc->get_corpus().get());
+    }
+    ASSERT_EQ(60, weights);
+
+    // every column maps to a document with the same words and class
+    const VectorXi &index = corpus->get_document_index();
+    auto unshuffled = std::make_shared<corpus::EigenDeduplicatedCorpus>(X, y);
+    ASSERT_EQ(60, index.rows());
+    for (int d=0; d<60; d++) {
+        auto doc = std::static_pointer_cast<corpus::ClassificationDocument>(
+            unshuffled->at(index[d])
+        );
+        ASSERT_EQ(y[d], doc->get_class());
+        ASSERT_EQ((d % 20 < 5) ? 2 - y[d] : 3, doc->get_weight());
+        for (int k=0; k<10; k++) {
+            ASSERT_EQ(X(k, d), doc->get_words()[k]);
+        }
+    }
+
+    // the priors count every column
+    for (int c=0; c<3; c++) {
+        ASSERT_FLOAT_EQ((y.array() == c).count() / 60.0, corpus->get_prior(c));
+    }
+
+    // without classes the documents are unlabeled
+    auto unsupervised = std::make_shared<corpus::EigenDeduplicatedCorpus>(X);
+    ASSERT_EQ(20, unsupervised->size());
+    ASSERT_EQ(
+        -1,
+        std::static_pointer_cast<corpus::ClassificationDocument>(unsupervised->at(0))->get_class()
+    );
+    ASSERT_EQ(3, unsupervised->at(0)->get_weight());
+}
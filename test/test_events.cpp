@@ -0,0 +1,156 @@
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ldaplusplus/events/Events.hpp"
+#include "ldaplusplus/events/ProgressEvents.hpp"
+
+using namespace ldaplusplus;
+
+
+// An event that counts how many times it has been created
+class CountedEvent : public events::Event
+{
+    public:
+        static size_t static_type() {
+            static size_t type = events::get_event_type("CountedEvent");
+            return type;
+        }
+
+        CountedEvent(int value) : Event(static_type()), value_(value) {
+            created++;
+        }
+
+        int value() const { return value_; }
+
+        static std::atomic<int> created;
+
+    private:
+        int value_;
+};
+std::atomic<int> CountedEvent::created(0);
+
+
+TEST(TestEvents, TypesAndIds) {
+    size_t t1 = events::get_event_type("SomeEvent");
+    size_t t2 = events::get_event_type("SomeOtherEvent");
+
+    ASSERT_NE(t1, t2);
+    ASSERT_EQ(t1, events::get_event_type("SomeEvent"));
+    ASSERT_EQ("SomeEvent", events::get_event_id(t1));
+
+    events::Event e("SomeOtherEvent");
+    ASSERT_EQ(t2, e.type());
+    ASSERT_EQ("SomeOtherEvent", e.id());
+
+    // The scalar type does not change the event type
+    ASSERT_EQ(
+        events::ExpectationProgressEvent<float>::static_type(),
+        events::ExpectationProgressEvent<double>::static_type()
+    );
+    ASSERT_EQ(
+        "ExpectationProgressEvent",
+        events::ExpectationProgressEvent<float>(0).id()
+    );
+}
+
+TEST(TestEvents, DropEventsWithoutListeners) {
+    events::ThreadSafeEventDispatcher dispatcher;
+    CountedEvent::created = 0;
+
+    dispatcher.dispatch<CountedEvent>(1);
+    ASSERT_EQ(0, CountedEvent::created);
+
+    // A listener for another type does not change anything
+    int received = 0;
+    auto listener = dispatcher.add_listener(
+        [&received](std::shared_ptr<events::Event> event) { received++; },
+        {events::EpochProgressEvent<double>::static_type()}
+    );
+    dispatcher.dispatch<CountedEvent>(1);
+    dispatcher.process_events();
+    ASSERT_EQ(0, CountedEvent::created);
+    ASSERT_EQ(0, received);
+
+    // A listener for every type
+    auto all = dispatcher.add_listener(
+        [&received](std::shared_ptr<events::Event> event) { received++; }
+    );
+    dispatcher.dispatch<CountedEvent>(1);
+    dispatcher.process_events();
+    ASSERT_EQ(1, CountedEvent::created);
+    ASSERT_EQ(1, received);
+
+    dispatcher.remove_listener(all);
+    dispatcher.dispatch<CountedEvent>(1);
+    dispatcher.process_events();
+    ASSERT_EQ(1, CountedEvent::created);
+    ASSERT_EQ(1, received);
+}
+
+TEST(TestEvents, ThreadSafeDispatchFromManyThreads) {
+    // Use a small buffer to make sure that the overflow works as well
+    events::ThreadSafeEventDispatcher dispatcher(16);
+
+    std::vector<int> counts(4, 0);
+    dispatcher.add_listener(
+        [&counts](std::shared_ptr<events::Event> event) {
+            auto e = std::static_pointer_cast<CountedEvent>(event);
+            counts[e->value()]++;
+        },
+        {CountedEvent::static_type()}
+    );
+
+    std::vector<std::thread> threads;
+    for (int t=0; t<4; t++) {
+        threads.emplace_back([&dispatcher, t]() {
+            for (int i=0; i<1000; i++) {
+                dispatcher.dispatch<CountedEvent>(t);
+            }
+        });
+    }
+    for (int i=0; i<100; i++) {
+        dispatcher.process_events();
+    }
+    for (auto & t : threads) {
+        t.join();
+    }
+    dispatcher.process_events();
+
+    for (int t=0; t<4; t++) {
+        ASSERT_EQ(1000, counts[t]);
+    }
+}
+
+TEST(TestEvents, ThreadSafeDispatchKeepsOrderWithOverflow) {
+    events::ThreadSafeEventDispatcher dispatcher(4);
+
+    // the event dispatched while the buffer is drained finds free slots in
+    // it but it should still be delivered after the overflowed events
+    std::vector<int> values;
+    dispatcher.add_listener(
+        [&dispatcher, &values](std::shared_ptr<events::Event> event) {
+            auto e = std::static_pointer_cast<CountedEvent>(event);
+            values.push_back(e->value());
+            if (e->value() == 0) {
+                dispatcher.dispatch<CountedEvent>(6);
+            }
+        },
+        {CountedEvent::static_type()}
+    );
+
+    for (int i=0; i<6; i++) {
+        dispatcher.dispatch<CountedEvent>(i);
+    }
+    dispatcher.process_events();
+    dispatcher.process_events();
+
+    ASSERT_EQ(7, values.size());
+    for (int i=0; i<7; i++) {
+        EXPECT_EQ(i, values[i]);
+    }
+}
@@ -1,6 +1,7 @@
 
 #include <cmath>
 #include <memory>
+#include <random>
 #include <vector>
 
 #include <Eigen/Core>
@@ -12,7 +13,9 @@
 #include "ldaplusplus/em/FastSupervisedEStep.hpp"
 #include "ldaplusplus/Parameters.hpp"
 #include "ldaplusplus/em/SupervisedEStep.hpp"
+#include "ldaplusplus/em/UnsupervisedEStep.hpp"
 #include "ldaplusplus/e_step_utils.hpp"
+#include "ldaplusplus/events/MetricsEvents.hpp"
 
 using namespace Eigen;
 using namespace ldaplusplus;
@@ -206,3 +209,174 @@ TYPED_TEST(TestExpectationStep, FastDocEStep) {
         EXPECT_GT(likelihoods[i], likelihoods[i-1]);
     }
 }
+
+
+TYPED_TEST(TestExpectationStep, ComputeUnsupervisedGamma) {
+    VectorXi X(10);
+    X << 3, 0, 0, 2, 1, 0, 7, 0, 1, 0;
+    VectorX<TypeParam> alpha = VectorX<TypeParam>::Constant(5, 0.1);
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(5, 10);
+    MatrixX<TypeParam> phi(5, 10);
+    beta.array() -= beta.minCoeff() - 0.001;
+    beta.array().colwise() /= beta.rowwise().sum().array();
+
+    VectorX<TypeParam> gamma = VectorX<TypeParam>::Constant(5, X.sum() / 5.0);
+    VectorX<TypeParam> gamma_fused = gamma;
+    VectorX<TypeParam> scratch;
+    for (int i=0; i<10; i++) {
+        e_step_utils::compute_unsupervised_phi<TypeParam>(beta, gamma, phi);
+        e_step_utils::compute_gamma<TypeParam>(X, alpha, phi, gamma);
+        e_step_utils::compute_unsupervised_gamma<TypeParam>(
+            X, alpha, beta, gamma_fused, scratch
+        );
+
+        for (int k=0; k<5; k++) {
+            EXPECT_NEAR(gamma[k], gamma_fused[k], gamma[k] * 1e-4);
+        }
+    }
+}
+
+
+TYPED_TEST(TestExpectationStep, UnsupervisedDocEStep) {
+    VectorXi X(10);
+    X << 3, 0, 0, 2, 1, 0, 7, 0, 1, 0;
+    VectorX<TypeParam> alpha = VectorX<TypeParam>::Constant(5, 0.1);
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(5, 10);
+    beta.array() -= beta.minCoeff() - 0.001;
+    beta.array().colwise() /= beta.rowwise().sum().array();
+    auto model = std::make_shared<parameters::ModelParameters<TypeParam> >(alpha, beta);
+    auto doc = std::make_shared<corpus::EigenDocument>(X);
+
+    // phi and gamma should be the same as when they are updated alternately
+    em::UnsupervisedEStep<TypeParam> e_step(10, -1, 0);
+    auto vp = std::static_pointer_cast<parameters::VariationalParameters<TypeParam> >(
+        e_step.doc_e_step(doc, model)
+    );
+
+    MatrixX<TypeParam> phi(5, 10);
+    VectorX<TypeParam> gamma = alpha.array() + X.sum() / 5.0;
+    for (int i=0; i<10; i++) {
+        e_step_utils::compute_unsupervised_phi<TypeParam>(beta, gamma, phi);
+        e_step_utils::compute_gamma<TypeParam>(X, alpha, phi, gamma);
+    }
+
+    for (int k=0; k<5; k++) {
+        EXPECT_NEAR(gamma[k], vp->gamma[k], gamma[k] * 1e-4);
+    }
+
+    // only the columns of phi for the words of the document are computed
+    // and they are scaled by the counts
+    parameters::VariationalParameters<TypeParam> expected;
+    expected.set_words(X, 5);
+    e_step_utils::compute_phi_scaled<TypeParam>(
+        X, phi, expected.words, expected.phi_scaled
+    );
+    const auto &words = expected.words;
+    const auto &phi_scaled = expected.phi_scaled;
+    EXPECT_EQ(0, vp->phi.cols());
+    ASSERT_EQ(5, vp->words.rows());
+    ASSERT_EQ(5, vp->phi_scaled.cols());
+    for (int i=0; i<5; i++) {
+        EXPECT_EQ(words[i], vp->words[i]);
+        EXPECT_NEAR(1, vp->phi_scaled.col(i).sum() / X[words[i]], 1e-4);
+        for (int k=0; k<5; k++) {
+            EXPECT_NEAR(phi_scaled(k, i), vp->phi_scaled(k, i), 1e-4);
+        }
+    }
+}
+
+
+TYPED_TEST(TestExpectationStep, SquaremUnsupervisedEStep) {
+    // a fixed corpus of long documents
+    std::mt19937 rng(0);
+    std::exponential_distribution<> words_generator(0.2);
+    MatrixXi X(500, 20);
+    for (int d=0; d<X.cols(); d++) {
+        for (int i=0; i<X.rows(); i++) {
+            X(i, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+    VectorX<TypeParam> alpha = VectorX<TypeParam>::Constant(20, 0.1);
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(20, 500);
+    beta.array() -= beta.minCoeff() - 0.001;
+    beta.array().colwise() /= beta.rowwise().sum().array();
+    auto model = std::make_shared<parameters::ModelParameters<TypeParam> >(alpha, beta);
+    corpus::EigenCorpus corpus(X);
+
+    std::vector<double> iterations;
+    std::vector<TypeParam> likelihoods;
+    for (bool squarem : {false, true}) {
+        em::UnsupervisedEStep<TypeParam> e_step(1000, 1e-3, 0, 0, squarem);
+        e_step.get_event_dispatcher()->add_listener(
+            [&iterations](std::shared_ptr<events::Event> event) {
+                iterations.push_back(
+                    std::static_pointer_cast<events::ExpectationIterationsEvent>(event)->mean()
+                );
+            },
+            {events::ExpectationIterationsEvent::static_type()}
+        );
+        TypeParam likelihood = 0;
+        for (int d=0; d<X.cols(); d++) {
+            auto vp = std::static_pointer_cast<parameters::VariationalParameters<TypeParam> >(
+                e_step.doc_e_step(corpus.at(d), model)
+            );
+
+            // gamma is a fixed point
+            VectorX<TypeParam> gamma = vp->gamma;
+            VectorX<TypeParam> scratch;
+            e_step_utils::compute_unsupervised_gamma<TypeParam>(
+                X.col(d), alpha, beta, gamma, scratch
+            );
+            EXPECT_GT(1e-2, (gamma - vp->gamma).array().abs().mean());
+
+            MatrixX<TypeParam> phi(20, 500);
+            e_step_utils::compute_unsupervised_phi<TypeParam>(beta, vp->gamma, phi);
+            likelihood += e_step_utils::compute_unsupervised_likelihood<TypeParam>(
+                X.col(d), alpha, beta, phi, vp->gamma
+            );
+        }
+        e_step.e_step();
+        likelihoods.push_back(likelihood);
+    }
+
+    // never more updates in total for a solution at least as good
+    ASSERT_EQ(2, iterations.size());
+    EXPECT_LE(iterations[1], iterations[0]);
+    EXPECT_GT(likelihoods[1], likelihoods[0] - std::abs(likelihoods[0]) * 1e-4);
+}
+
+TYPED_TEST(TestExpectationStep, SquaremRespectsMaxIterations) {
+    std::mt19937 rng(0);
+    std::exponential_distribution<> words_generator(0.2);
+    std::uniform_real_distribution<TypeParam> uniform(-1, 1);
+    auto random = [&rng, &uniform]() { return uniform(rng); };
+    VectorXi X(500);
+    for (int i=0; i<X.rows(); i++) {
+        X[i] = static_cast<int>(words_generator(rng));
+    }
+    VectorX<TypeParam> alpha = VectorX<TypeParam>::Constant(20, 0.1);
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::NullaryExpr(20, 500, random);
+    beta.array() -= beta.minCoeff() - 0.001;
+    beta.array().colwise() /= beta.rowwise().sum().array();
+    auto model = std::make_shared<parameters::ModelParameters<TypeParam> >(alpha, beta);
+    auto doc = std::make_shared<corpus::EigenDocument>(X);
+
+    // a negative tolerance never converges so every E step runs up to the
+    // maximum number of iterations and not a SQUAREM cycle past it
+    std::vector<double> iterations;
+    for (size_t max_iterations : {1, 5, 10, 11}) {
+        em::UnsupervisedEStep<TypeParam> e_step(max_iterations, -1, 0, 0, true);
+        e_step.get_event_dispatcher()->add_listener(
+            [&iterations](std::shared_ptr<events::Event> event) {
+                iterations.push_back(
+                    std::static_pointer_cast<events::ExpectationIterationsEvent>(event)->mean()
+                );
+            },
+            {events::ExpectationIterationsEvent::static_type()}
+        );
+        e_step.doc_e_step(doc, model);
+        e_step.e_step();
+        ASSERT_FALSE(iterations.empty());
+        EXPECT_EQ(max_iterations, iterations.back());
+    }
+}
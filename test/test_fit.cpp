@@ -1,13 +1,24 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <tuple>
 #include <vector>
 
 #include <Eigen/Core>
+#include <Eigen/Sparse>
 #include <gtest/gtest.h>
 
 #include "test/utils.hpp"
 
+#include "ldaplusplus/em/UnsupervisedEStep.hpp"
 #include "ldaplusplus/LDABuilder.hpp"
 #include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/LikelihoodEvaluator.hpp"
+#include "ldaplusplus/events/MetricsEvents.hpp"
+#include "ldaplusplus/perf_utils.hpp"
 #include "ldaplusplus/events/ProgressEvents.hpp"
 
 using namespace Eigen;
@@ -21,6 +32,37 @@ class TestFit : public ParameterizedTest<T> {};
 TYPED_TEST_CASE(TestFit, ForFloatAndDouble);
 
 
+/**
+ * Generate N documents of 100 words from 5 topics over 100 words.
+ */
+static MatrixXi create_topics_corpus(int N, int random_state = 0) {
+    std::mt19937 rng(random_state);
+    std::gamma_distribution<> topic_generator(0.1);
+    std::exponential_distribution<> proportion_generator(1);
+    MatrixXd topics(100, 5);
+    for (int w=0; w<100; w++) {
+        for (int k=0; k<5; k++) {
+            topics(w, k) = topic_generator(rng) + 1e-6;
+        }
+    }
+    topics.array().rowwise() /= topics.colwise().sum().array();
+    MatrixXi X = MatrixXi::Zero(100, N);
+    for (int d=0; d<N; d++) {
+        VectorXd theta(5);
+        for (int k=0; k<5; k++) {
+            theta[k] = proportion_generator(rng);
+        }
+        VectorXd p = topics * (theta / theta.sum());
+        std::discrete_distribution<> word(p.data(), p.data() + p.rows());
+        for (int n=0; n<100; n++) {
+            X(word(rng), d)++;
+        }
+    }
+
+    return X;
+}
+
+
 TYPED_TEST(TestFit, partial_fit) {
     // Build the corpus
     std::mt19937 rng;
@@ -66,3 +108,804 @@ TYPED_TEST(TestFit, partial_fit) {
     //EXPECT_GT(likelihood, likelihood0);
     EXPECT_GT(py, py0);
 }
+
+TYPED_TEST(TestFit, deterministic_fit) {
+    // Build the corpus
+    std::mt19937 rng;
+    rng.seed(0);
+    MatrixXi X(100, 50);
+    VectorXi y(50);
+    std::uniform_int_distribution<> class_generator(0, 5);
+    std::exponential_distribution<> words_generator(0.1);
+    for (int d=0; d<50; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+        y(d) = class_generator(rng);
+    }
+
+    std::vector<std::shared_ptr<parameters::SupervisedModelParameters<TypeParam> > > models;
+    for (size_t workers : {1, 4, 4}) {
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+                set_iterations(3).
+                set_workers(workers).
+                set_deterministic().
+                set_fast_supervised_e_step(10, 1e-2, 10).
+                set_fast_supervised_m_step(10, 1e-2).
+                initialize_topics_seeded(X, 10).
+                initialize_eta_zeros(y.maxCoeff() + 1);
+        lda.fit(X, y);
+
+        models.push_back(
+            lda.template model_parameters<parameters::SupervisedModelParameters<TypeParam> >()
+        );
+    }
+
+    for (size_t i=1; i<models.size(); i++) {
+        EXPECT_EQ(models[0]->beta, models[i]->beta);
+        EXPECT_EQ(models[0]->eta, models[i]->eta);
+    }
+}
+
+TYPED_TEST(TestFit, metrics_events) {
+    // Build the corpus
+    std::mt19937 rng;
+    rng.seed(0);
+    MatrixXi X(100, 50);
+    VectorXi y(50);
+    std::uniform_int_distribution<> class_generator(0, 5);
+    std::exponential_distribution<> words_generator(0.1);
+    for (int d=0; d<50; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+        y(d) = class_generator(rng);
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_workers(2).
+            set_fast_supervised_e_step(10, 1e-2, 10).
+            set_fast_supervised_m_step(10, 1e-2).
+            initialize_topics_seeded(X, 10).
+            initialize_eta_zeros(y.maxCoeff() + 1);
+
+    std::vector<std::shared_ptr<events::EpochTimingEvent> > timings;
+    std::vector<std::shared_ptr<events::ExpectationIterationsEvent> > iterations;
+    std::vector<std::shared_ptr<events::LineSearchEvent> > line_searches;
+    std::vector<std::shared_ptr<events::HardwareCountersEvent> > counters;
+    lda.get_event_dispatcher()->add_listener(
+        [&](std::shared_ptr<events::Event> event) {
+            if (event->type() == events::EpochTimingEvent::static_type()) {
+                timings.push_back(std::static_pointer_cast<events::EpochTimingEvent>(event));
+            } else if (event->type() == events::ExpectationIterationsEvent::static_type()) {
+                iterations.push_back(std::static_pointer_cast<events::ExpectationIterationsEvent>(event));
+            } else if (event->type() == events::LineSearchEvent::static_type()) {
+                line_searches.push_back(std::static_pointer_cast<events::LineSearchEvent>(event));
+            } else if (event->type() == events::HardwareCountersEvent::static_type()) {
+                counters.push_back(std::static_pointer_cast<events::HardwareCountersEvent>(event));
+            }
+        },
+        {
+            events::EpochTimingEvent::static_type(),
+            events::ExpectationIterationsEvent::static_type(),
+            events::LineSearchEvent::static_type(),
+            events::HardwareCountersEvent::static_type()
+        }
+    );
+
+    lda.partial_fit(X, y);
+    lda.partial_fit(X, y);
+
+    ASSERT_EQ(2, timings.size());
+    ASSERT_EQ(2, iterations.size());
+    ASSERT_EQ(2, line_searches.size());
+    for (size_t i=0; i<2; i++) {
+        EXPECT_EQ(50, timings[i]->documents());
+        EXPECT_EQ(2, timings[i]->worker_documents().size());
+        EXPECT_GT(timings[i]->wall_time(), 0);
+        EXPECT_GE(
+            timings[i]->wall_time(),
+            timings[i]->queue_wait() + timings[i]->m_step_online() + timings[i]->m_step_batch()
+        );
+        EXPECT_EQ(
+            50,
+            std::accumulate(
+                timings[i]->e_step_latency().begin(),
+                timings[i]->e_step_latency().end(),
+                size_t(0)
+            )
+        );
+        EXPECT_GT(timings[i]->e_step_latency_quantile(0.5), 0);
+        EXPECT_LE(
+            timings[i]->e_step_latency_quantile(0.5),
+            timings[i]->e_step_latency_quantile(0.99)
+        );
+
+        EXPECT_EQ(50, iterations[i]->documents());
+        EXPECT_GE(iterations[i]->histogram().size(), 2);
+        EXPECT_LE(iterations[i]->histogram().size(), 11);
+        EXPECT_GT(iterations[i]->mean(), 0);
+        EXPECT_LE(iterations[i]->quantile(0.5), iterations[i]->quantile(0.99));
+
+        EXPECT_GT(line_searches[i]->iterations(), 0);
+        EXPECT_GT(line_searches[i]->evaluations(), line_searches[i]->iterations());
+    }
+
+    // The hardware counters are only reported if they can be measured
+    if (perf_utils::PerfCounters().available()) {
+        ASSERT_EQ(4, counters.size());
+        for (auto &c : counters) {
+            EXPECT_EQ(50, c->documents());
+            EXPECT_GT(c->instructions(), 0);
+        }
+        EXPECT_EQ("doc_e_step", counters[0]->phase());
+        EXPECT_EQ("doc_m_step", counters[1]->phase());
+    } else {
+        EXPECT_EQ(0, counters.size());
+    }
+}
+
+TYPED_TEST(TestFit, streaming_transform) {
+    std::mt19937 rng(0);
+    std::exponential_distribution<> words_generator(0.1);
+    MatrixXi X(100, 50);
+    for (int d=0; d<50; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 10);
+    MatrixX<TypeParam> expected = lda.transform(X);
+
+    // feed the documents in chunks of 16 and collect the chunks of gammas
+    int next = 0;
+    std::vector<MatrixX<TypeParam> > chunks;
+    lda.transform(
+        [&X, &next](MatrixXi &chunk) {
+            if (next >= X.cols()) {
+                return false;
+            }
+            int n = std::min(16, static_cast<int>(X.cols()) - next);
+            chunk = X.middleCols(next, n);
+            next += n;
+            return true;
+        },
+        [&chunks](const MatrixX<TypeParam> &gammas) {
+            chunks.push_back(gammas);
+        }
+    );
+
+    ASSERT_EQ(4, chunks.size());
+    int d = 0;
+    for (auto &gammas : chunks) {
+        ASSERT_EQ(10, gammas.rows());
+        EXPECT_TRUE(expected.middleCols(d, gammas.cols()).isApprox(gammas));
+        d += gammas.cols();
+    }
+    EXPECT_EQ(50, d);
+
+    // the workers run across the chunks, here chunks of 3 (and an empty one)
+    // so that more than one chunk is in flight for the deterministic workers
+    // as well
+    LDA<TypeParam> deterministic = LDABuilder<TypeParam>().
+        set_workers(3).
+        set_deterministic().
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 10);
+    auto small_chunks = [&X, &next](MatrixXi &chunk) {
+        if (next >= X.cols()) {
+            return false;
+        }
+        int n = (next == 9) ? 0 : std::min(3, static_cast<int>(X.cols()) - next);
+        chunk = X.middleCols(next, n);
+        next = (n == 0) ? 10 : next + n;
+        return true;
+    };
+    next = 0;
+    MatrixX<TypeParam> streamed(10, 0);
+    deterministic.transform(
+        small_chunks,
+        [&streamed](const MatrixX<TypeParam> &gammas) {
+            streamed.conservativeResize(10, streamed.cols() + gammas.cols());
+            streamed.rightCols(gammas.cols()) = gammas;
+        }
+    );
+    ASSERT_EQ(49, streamed.cols());
+    EXPECT_TRUE(expected.leftCols(9).isApprox(streamed.leftCols(9)));
+    EXPECT_TRUE(expected.rightCols(40).isApprox(streamed.rightCols(40)));
+
+    next = 0;
+    SparseMatrix<TypeParam> expected_top = lda.transform_sparse(X, 3);
+    int columns = 0;
+    lda.transform_sparse(
+        small_chunks,
+        [&expected_top, &columns](const SparseMatrix<TypeParam> &top) {
+            int offset = (columns < 9) ? columns : columns + 1;
+            MatrixX<TypeParam> dense = top;
+            MatrixX<TypeParam> expected_dense = expected_top.middleCols(offset, top.cols());
+            EXPECT_TRUE(expected_dense.isApprox(dense));
+            columns += top.cols();
+        },
+        3
+    );
+    EXPECT_EQ(49, columns);
+
+    // a throwing sink stops the workers and leaves the LDA usable
+    next = 0;
+    EXPECT_THROW(
+        lda.transform(
+            small_chunks,
+            [](const MatrixX<TypeParam> &) {
+                throw std::runtime_error("sink failed");
+            }
+        ),
+        std::runtime_error
+    );
+    EXPECT_TRUE(expected.isApprox(lda.transform(X)));
+}
+
+TYPED_TEST(TestFit, sparse_transform) {
+    std::mt19937 rng(0);
+    std::exponential_distribution<> words_generator(0.1);
+    MatrixXi X(100, 50);
+    for (int d=0; d<50; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 10);
+    MatrixX<TypeParam> theta = lda.transform(X);
+    theta.array().rowwise() /= theta.colwise().sum().array();
+
+    SparseMatrix<TypeParam> top = lda.transform_sparse(X, 3);
+    ASSERT_EQ(10, top.rows());
+    ASSERT_EQ(50, top.cols());
+    EXPECT_EQ(150, top.nonZeros());
+    for (int d=0; d<50; d++) {
+        // the kept topics are the largest ones
+        TypeParam smallest_kept = 1;
+        for (typename SparseMatrix<TypeParam>::InnerIterator it(top, d); it; ++it) {
+            EXPECT_NEAR(theta(it.row(), d), it.value(), 1e-4);
+            smallest_kept = std::min(smallest_kept, it.value());
+        }
+        int larger = (theta.col(d).array() > smallest_kept + 1e-4).count();
+        EXPECT_GT(3, larger);
+    }
+
+    SparseMatrix<TypeParam> above = lda.transform_sparse(X, 0, 0.2);
+    EXPECT_EQ((theta.array() > 0.2).count(), above.nonZeros());
+    for (int d=0; d<50; d++) {
+        for (typename SparseMatrix<TypeParam>::InnerIterator it(above, d); it; ++it) {
+            EXPECT_LT(0.2, it.value());
+        }
+    }
+}
+
+TYPED_TEST(TestFit, fused_predict) {
+    std::mt19937 rng(0);
+    std::exponential_distribution<> words_generator(0.1);
+    MatrixXi X(100, 50);
+    for (int d=0; d<50; d++) {
+        for (int w=0; w<100; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+    }
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 10).
+        initialize_eta_uniform(4);
+
+    // the fused path matches computing everything from the gammas
+    MatrixX<TypeParam> gammas;
+    VectorXi expected;
+    std::tie(gammas, expected) = lda.transform_predict(X);
+    MatrixX<TypeParam> expected_z_bar = gammas.colwise() - lda.template model_parameters<
+        parameters::SupervisedModelParameters<TypeParam>
+    >()->alpha;
+    expected_z_bar.array().rowwise() /= expected_z_bar.array().colwise().sum();
+    MatrixX<TypeParam> expected_scores = lda.template model_parameters<
+        parameters::SupervisedModelParameters<TypeParam>
+    >()->eta.transpose() * expected_z_bar;
+
+    MatrixX<TypeParam> scores = lda.decision_function(X);
+    ASSERT_EQ(4, scores.rows());
+    ASSERT_EQ(50, scores.cols());
+    EXPECT_TRUE(expected_scores.isApprox(scores, 1e-4));
+
+    VectorXi predictions = lda.predict(X);
+    ASSERT_EQ(50, predictions.rows());
+    for (int d=0; d<50; d++) {
+        EXPECT_EQ(expected[d], predictions[d]);
+    }
+
+    // and the gammas returned with the predictions are those of transform
+    EXPECT_TRUE(gammas.isApprox(lda.transform(X), 1e-4));
+}
+
+/**
+ * An unsupervised E step that throws on the nth document it infers (counting
+ * across jobs) to interrupt a job of the workers.
+ */
+template <typename Scalar>
+class FailingEStep : public em::UnsupervisedEStep<Scalar>
+{
+    public:
+        FailingEStep() : em::UnsupervisedEStep<Scalar>(10, 1e-2, 0), remaining(-1) {}
+
+        std::shared_ptr<parameters::Parameters> doc_e_step(
+            const std::shared_ptr<corpus::Document> doc,
+            const std::shared_ptr<parameters::Parameters> parameters
+        ) override {
+            if (--remaining == 0) {
+                throw std::runtime_error("Failed E step");
+            }
+            return em::UnsupervisedEStep<Scalar>::doc_e_step(doc, parameters);
+        }
+
+        std::atomic<int> remaining;
+};
+
+TYPED_TEST(TestFit, interrupted_jobs) {
+    MatrixXi X = create_topics_corpus(50);
+    auto e_step = std::make_shared<FailingEStep<TypeParam> >();
+    LDABuilder<TypeParam> builder;
+    builder.
+        set_workers(2).
+        set_e(e_step).
+        initialize_topics_seeded(X, 5).
+        initialize_eta_uniform(3);
+    LDA<TypeParam> lda = builder;
+
+    MatrixX<TypeParam> expected_gammas = lda.transform(X);
+    SparseMatrix<TypeParam> expected_top = lda.transform_sparse(X, 2);
+    VectorXi expected_predictions = lda.predict(X);
+
+    // an error in a worker reaches the caller and the next job does not see
+    // the documents or the results of the interrupted one
+    e_step->remaining = 20;
+    EXPECT_THROW(lda.transform_sparse(X, 2), std::runtime_error);
+    EXPECT_TRUE(expected_top.isApprox(lda.transform_sparse(X, 2)));
+
+    e_step->remaining = 20;
+    EXPECT_THROW(lda.predict(X), std::runtime_error);
+    EXPECT_EQ(expected_predictions, lda.predict(X));
+
+    e_step->remaining = 20;
+    EXPECT_THROW(lda.transform(X), std::runtime_error);
+    EXPECT_TRUE(expected_gammas.isApprox(lda.transform(X)));
+
+    e_step->remaining = 20;
+    EXPECT_THROW(lda.evaluate(X, 0.5), std::runtime_error);
+    EXPECT_TRUE(expected_gammas.isApprox(lda.transform(X)));
+
+    e_step->remaining = 70;
+    int read = 0;
+    auto source = [&X, &read](MatrixXi &chunk) {
+        if (read++ >= 2) {
+            return false;
+        }
+        chunk = X;
+        return true;
+    };
+    EXPECT_THROW(
+        lda.transform(source, [](const MatrixX<TypeParam> &) {}),
+        std::runtime_error
+    );
+    EXPECT_TRUE(expected_gammas.isApprox(lda.transform(X)));
+
+    // listeners that throw interrupt the job the same way
+    auto listener = lda.get_event_dispatcher()->add_listener(
+        [](std::shared_ptr<events::Event> event) {
+            throw std::runtime_error("Failed listener");
+        },
+        {events::ExpectationProgressEvent<TypeParam>::static_type()}
+    );
+    EXPECT_THROW(lda.transform_sparse(X, 2), std::runtime_error);
+    lda.get_event_dispatcher()->remove_listener(listener);
+    EXPECT_TRUE(expected_top.isApprox(lda.transform_sparse(X, 2)));
+}
+
+
+TYPED_TEST(TestFit, mismatched_words) {
+    MatrixXi X = create_topics_corpus(20);
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_workers(2).
+        initialize_topics_seeded(X, 5).
+        initialize_eta_uniform(3);
+
+    // a vocabulary that does not match the model is an error instead of a
+    // read past the end of beta
+    MatrixXi X_longer = MatrixXi::Zero(100000, 20);
+    X_longer.topRows(100) = X;
+    MatrixXi X_shorter = X.topRows(50);
+    VectorXi y = VectorXi::Zero(20);
+    for (auto &X_wrong : {X_longer, X_shorter}) {
+        EXPECT_THROW(lda.transform(X_wrong), std::invalid_argument);
+        EXPECT_THROW(lda.transform_sparse(X_wrong, 2), std::invalid_argument);
+        EXPECT_THROW(lda.evaluate(X_wrong, 0.5), std::invalid_argument);
+        EXPECT_THROW(lda.predict(X_wrong), std::invalid_argument);
+        EXPECT_THROW(lda.partial_fit(X_wrong, y), std::invalid_argument);
+        int read = 0;
+        auto source = [&X_wrong, &read](MatrixXi &chunk) {
+            if (read++ >= 1) {
+                return false;
+            }
+            chunk = X_wrong;
+            return true;
+        };
+        EXPECT_THROW(
+            lda.transform(source, [](const MatrixX<TypeParam> &) {}),
+            std::invalid_argument
+        );
+    }
+
+    // and the model still works afterwards
+    EXPECT_EQ(20, lda.transform(X).cols());
+
+    // with feature hashing any vocabulary is hashed into the model words
+    LDA<TypeParam> hashed = LDABuilder<TypeParam>().
+        set_feature_hashing(32).
+        initialize_topics_seeded(X, 5);
+    EXPECT_EQ(20, hashed.transform(X_longer).cols());
+}
+
+
+TYPED_TEST(TestFit, squarem_fit) {
+    MatrixXi X = create_topics_corpus(200);
+
+    LikelihoodEvaluator<TypeParam> evaluator(X, 50, 1e-4);
+    auto fit = [&X, &evaluator](size_t iterations, bool squarem, bool evaluated) {
+        LDABuilder<TypeParam> builder;
+        builder.
+            set_iterations(iterations).
+            set_workers(1).
+            set_squarem(squarem).
+            set_classic_e_step(50, 1e-4, (evaluated) ? 0.0 : 1.0).
+            set_classic_m_step();
+        if (evaluated) {
+            builder.set_likelihood_evaluator(X, 0.5);
+        }
+        LDA<TypeParam> lda = builder.initialize_topics_seeded(X, 5);
+        lda.fit(X);
+
+        return evaluator.likelihood(
+            *lda.template model_parameters<parameters::ModelParameters<TypeParam> >()
+        );
+    };
+
+    // a better model in far fewer passes safeguarded either by the bound of
+    // the training documents or by the evaluated documents
+    TypeParam plain = fit(40, false, false);
+    EXPECT_GT(fit(15, true, false), plain);
+    EXPECT_GT(fit(15, true, true), plain);
+
+    // the bound of every cycle describes an accepted model
+    LDA<TypeParam> bounded = LDABuilder<TypeParam>().
+        set_workers(1).
+        set_squarem().
+        set_classic_e_step(50, 1e-4, 1.0).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5);
+    auto documents = std::make_shared<corpus::EigenCorpus>(X);
+    for (int i=0; i<5; i++) {
+        bounded.squarem(documents);
+        EXPECT_TRUE(std::isfinite(bounded.epoch_likelihood()));
+    }
+
+    // the eta of the multinomial supervised models stays a distribution
+    MatrixXi X_labeled = X.leftCols(50);
+    VectorXi y(50);
+    for (int d=0; d<50; d++) {
+        X_labeled.col(d).head(50).maxCoeff(&y[d]);
+        y[d] %= 3;
+    }
+    LDA<TypeParam> supervised = LDABuilder<TypeParam>().
+        set_iterations(9).
+        set_workers(1).
+        set_squarem().
+        set_multinomial_supervised_e_step(20, 1e-4, 2, 1, 1.0).
+        set_multinomial_supervised_m_step().
+        initialize_topics_seeded(X_labeled, 5).
+        initialize_eta_uniform(3);
+    supervised.fit(X_labeled, y);
+    auto eta = supervised.template model_parameters<
+        parameters::SupervisedModelParameters<TypeParam>
+    >()->eta;
+    EXPECT_TRUE(eta.allFinite());
+    EXPECT_LT(0, eta.minCoeff());
+    EXPECT_TRUE(eta.rowwise().sum().isApprox(VectorX<TypeParam>::Ones(5)));
+
+    // without either there is nothing to safeguard the extrapolation with
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(5).
+        set_squarem().
+        set_classic_e_step(50, 1e-4, 0).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5);
+    EXPECT_THROW(lda.fit(X), std::runtime_error);
+}
+
+TYPED_TEST(TestFit, converged_fit) {
+    MatrixXi X = create_topics_corpus(200);
+
+    for (bool held_out : {false, true}) {
+        LDA<TypeParam> lda = LDABuilder<TypeParam>().
+            set_iterations(100).
+            set_workers(1).
+            set_convergence_tolerance(1e-3, held_out).
+            set_classic_e_step(50, 1e-4, (held_out) ? 0.0 : 1.0).
+            set_classic_m_step().
+            set_likelihood_evaluator(X, 0.5).
+            initialize_topics_seeded(X, 5);
+
+        size_t epochs = 0;
+        std::vector<TypeParam> bounds;
+        std::vector<TypeParam> evaluations;
+        lda.get_event_dispatcher()->add_listener(
+            [&epochs, &bounds, &lda](std::shared_ptr<events::Event> event) {
+                epochs++;
+                bounds.push_back(lda.epoch_likelihood());
+            },
+            {events::EpochProgressEvent<TypeParam>::static_type()}
+        );
+        lda.get_event_dispatcher()->add_listener(
+            [&evaluations](std::shared_ptr<events::Event> event) {
+                evaluations.push_back(std::static_pointer_cast<
+                    events::EvaluationProgressEvent<TypeParam>
+                >(event)->likelihood());
+            },
+            {events::EvaluationProgressEvent<TypeParam>::static_type()}
+        );
+        lda.fit(X);
+
+        EXPECT_LT(2, epochs);
+        EXPECT_GT(100, epochs);
+        if (held_out) {
+            // every epoch was evaluated and the last one improved less than
+            // the tolerance
+            ASSERT_EQ(epochs, evaluations.size());
+            TypeParam last = evaluations[epochs-1];
+            TypeParam previous = evaluations[epochs-2];
+            EXPECT_LT((last - previous) / std::abs(previous), 1e-3);
+        } else {
+            // the same holds for the bound of the training documents
+            TypeParam last = bounds[epochs-1];
+            TypeParam previous = bounds[epochs-2];
+            EXPECT_LT((last - previous) / std::abs(previous), 1e-3);
+        }
+    }
+}
+
+TYPED_TEST(TestFit, converged_fit_sampled_likelihood) {
+    MatrixXi X = create_topics_corpus(200);
+
+    // the bound of half the documents changes more from epoch to epoch than
+    // any tolerance so it cannot stop the training
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(10).
+        set_workers(1).
+        set_convergence_tolerance(1e-1, false).
+        set_classic_e_step(50, 1e-4, 0.5).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5);
+    size_t epochs = 0;
+    lda.get_event_dispatcher()->add_listener(
+        [&epochs](std::shared_ptr<events::Event> event) {
+            epochs++;
+        },
+        {events::EpochProgressEvent<TypeParam>::static_type()}
+    );
+    lda.fit(X);
+    EXPECT_EQ(10, epochs);
+
+    // neither can it safeguard the extrapolation
+    LDA<TypeParam> extrapolated = LDABuilder<TypeParam>().
+        set_iterations(3).
+        set_squarem().
+        set_classic_e_step(50, 1e-4, 0.5).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5);
+    EXPECT_THROW(extrapolated.fit(X), std::runtime_error);
+}
+
+TYPED_TEST(TestFit, converged_fit_needs_likelihood) {
+    MatrixXi X = create_topics_corpus(50);
+
+    // the held out documents need an evaluator
+    auto builder = LDABuilder<TypeParam>().
+        set_convergence_tolerance(1e-3, true).
+        set_classic_e_step(10, 1e-2, 0).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5);
+    EXPECT_THROW(LDA<TypeParam> lda = builder, std::runtime_error);
+
+    // and the training documents an E step that computes their likelihood
+    LDA<TypeParam> lda = builder.set_convergence_tolerance(1e-3, false);
+    EXPECT_THROW(lda.fit(X), std::runtime_error);
+}
+
+TYPED_TEST(TestFit, minibatch_partial_fit) {
+    MatrixXi X = create_topics_corpus(100);
+
+    auto create_lda = [&X]() -> LDA<TypeParam> {
+        return LDABuilder<TypeParam>().
+            set_workers(2).
+            set_deterministic().
+            set_classic_e_step(10, 1e-2, 0).
+            set_classic_m_step().
+            initialize_topics_seeded(X, 5);
+    };
+
+    // fit the documents 10 to 29 of the corpus
+    LDA<TypeParam> lda = create_lda();
+    size_t documents = 0;
+    lda.get_event_dispatcher()->add_listener(
+        [&documents](std::shared_ptr<events::Event> event) {
+            auto timing = std::static_pointer_cast<events::EpochTimingEvent>(event);
+            for (auto d : timing->worker_documents()) {
+                documents += d;
+            }
+        },
+        {events::EpochTimingEvent::static_type()}
+    );
+    auto corpus = std::make_shared<corpus::EigenCorpus>(X);
+    lda.partial_fit(corpus, 10, 30);
+    EXPECT_EQ(20, documents);
+
+    // the same as fitting only these documents
+    LDA<TypeParam> expected = create_lda();
+    MatrixXi X_range = X.middleCols(10, 20);
+    expected.partial_fit(X_range, VectorXi::Zero(20));
+    EXPECT_TRUE(
+        expected.template model_parameters<parameters::ModelParameters<TypeParam> >()->beta.isApprox(
+            lda.template model_parameters<parameters::ModelParameters<TypeParam> >()->beta,
+            1e-4
+        )
+    );
+
+    EXPECT_THROW(lda.partial_fit(corpus, 30, 10), std::runtime_error);
+    EXPECT_THROW(lda.partial_fit(corpus, 90, 101), std::runtime_error);
+}
+
+TYPED_TEST(TestFit, deduplicated_fit) {
+    // every document appears three times
+    MatrixXi X_unique = create_topics_corpus(40);
+    MatrixXi X(X_unique.rows(), 120);
+    VectorXi y(120);
+    for (int d=0; d<120; d++) {
+        X.col(d) = X_unique.col(d % 40);
+        y[d] = (d % 40) % 3;
+    }
+
+    auto create_lda = [&X](bool deduplicate) -> LDA<TypeParam> {
+        return LDABuilder<TypeParam>().
+            set_iterations(3).
+            set_workers(1).
+            set_deduplicate(deduplicate).
+            set_fast_supervised_e_step(10, 1e-2).
+            set_fast_supervised_m_step(3, 1e-2).
+            initialize_topics_seeded(X, 5).
+            initialize_eta_zeros(3);
+    };
+
+    // count the documents that went through the E step
+    LDA<TypeParam> deduplicated = create_lda(true);
+    size_t documents = 0;
+    deduplicated.get_event_dispatcher()->add_listener(
+        [&documents](std::shared_ptr<events::Event> event) {
+            auto timing = std::static_pointer_cast<events::EpochTimingEvent>(event);
+            for (auto d : timing->worker_documents()) {
+                documents += d;
+            }
+        },
+        {events::EpochTimingEvent::static_type()}
+    );
+    deduplicated.fit(X, y);
+    EXPECT_EQ(3*40, documents);
+
+    // the weighted M steps give the same model as the copies
+    LDA<TypeParam> expected = create_lda(false);
+    expected.fit(X, y);
+    auto expected_model = expected.template model_parameters<
+        parameters::SupervisedModelParameters<TypeParam>
+    >();
+    auto model = deduplicated.template model_parameters<
+        parameters::SupervisedModelParameters<TypeParam>
+    >();
+    EXPECT_TRUE(expected_model->beta.isApprox(model->beta, 1e-3));
+    EXPECT_TRUE(expected_model->eta.isApprox(model->eta, 1e-2));
+
+    // the bound of the training documents counts every copy (the first 10
+    // documents have 5 copies and the rest a single one)
+    MatrixXi X_skewed(X_unique.rows(), 80);
+    for (int d=0; d<80; d++) {
+        X_skewed.col(d) = X_unique.col((d < 40) ? d : d % 10);
+    }
+    auto create_evaluated_lda = [&X_skewed](bool deduplicate) -> LDA<TypeParam> {
+        return LDABuilder<TypeParam>().
+            set_iterations(1).
+            set_workers(1).
+            set_deduplicate(deduplicate).
+            set_convergence_tolerance(1e-3).
+            set_classic_e_step(10, 1e-2, 1.0).
+            set_classic_m_step().
+            initialize_topics_seeded(X_skewed, 5);
+    };
+    LDA<TypeParam> evaluated = create_evaluated_lda(true);
+    LDA<TypeParam> evaluated_expected = create_evaluated_lda(false);
+    evaluated.fit(X_skewed);
+    evaluated_expected.fit(X_skewed);
+    EXPECT_NEAR(
+        evaluated_expected.epoch_likelihood(),
+        evaluated.epoch_likelihood(),
+        std::abs(evaluated_expected.epoch_likelihood()) * 1e-4
+    );
+
+    // transform fans the result back out to every column (the unlabeled
+    // documents need an unsupervised E step)
+    LDA<TypeParam> unsupervised = LDABuilder<TypeParam>().
+        set_workers(1).
+        set_deduplicate().
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_seeded(X, 5).
+        initialize_eta_uniform(3);
+    MatrixX<TypeParam> gammas = unsupervised.transform(X);
+    ASSERT_EQ(120, gammas.cols());
+    for (int d=40; d<120; d++) {
+        EXPECT_EQ(gammas.col(d % 40), gammas.col(d));
+    }
+    VectorXi predictions = unsupervised.predict(X);
+    ASSERT_EQ(120, predictions.rows());
+    for (int d=40; d<120; d++) {
+        EXPECT_EQ(predictions[d % 40], predictions[d]);
+    }
+    SparseMatrix<TypeParam> topics = unsupervised.transform_sparse(X, 2);
+    ASSERT_EQ(120, topics.cols());
+    EXPECT_TRUE(MatrixX<TypeParam>(topics.col(0)).isApprox(MatrixX<TypeParam>(topics.col(80))));
+}
+
+TYPED_TEST(TestFit, hashed_fit) {
+    MatrixXi X = create_topics_corpus(50);
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(3).
+        set_workers(2).
+        set_feature_hashing(32).
+        set_classic_e_step(10, 1e-2, 0).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5).
+        set_likelihood_evaluator(X, 0.5);
+    lda.fit(X);
+
+    // the model is sized to the buckets instead of the vocabulary
+    auto model = lda.template model_parameters<parameters::ModelParameters<TypeParam> >();
+    ASSERT_EQ(5, model->beta.rows());
+    ASSERT_EQ(32, model->beta.cols());
+    EXPECT_TRUE(model->beta.allFinite());
+
+    // and any vocabulary is hashed into them
+    MatrixXi X_longer = MatrixXi::Zero(200, 50);
+    X_longer.topRows(100) = X;
+    MatrixX<TypeParam> gammas = lda.transform(X);
+    ASSERT_EQ(50, gammas.cols());
+    EXPECT_TRUE(gammas.isApprox(lda.transform(X_longer)));
+
+    TypeParam perplexity = lda.evaluate(X, 0.5);
+    EXPECT_LT(1, perplexity);
+    EXPECT_GT(32, perplexity);
+
+    LDA<TypeParam> random = LDABuilder<TypeParam>().
+        set_feature_hashing(32).
+        initialize_topics_random(100, 5);
+    EXPECT_EQ(32, random.template model_parameters<parameters::ModelParameters<TypeParam> >()->beta.cols());
+}
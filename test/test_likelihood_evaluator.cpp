@@ -0,0 +1,209 @@
+#include <cmath>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "ldaplusplus/Document.hpp"
+#include "ldaplusplus/em/UnsupervisedEStep.hpp"
+#include "ldaplusplus/e_step_utils.hpp"
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/LikelihoodEvaluator.hpp"
+#include "ldaplusplus/Parameters.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+// T will be available as TypeParam in TYPED_TEST functions
+template <typename T>
+class TestLikelihoodEvaluator : public ParameterizedTest<T> {};
+
+TYPED_TEST_CASE(TestLikelihoodEvaluator, ForFloatAndDouble);
+
+
+static MatrixXi create_corpus(int V, int N) {
+    std::mt19937 rng(0);
+    std::exponential_distribution<> words_generator(0.5);
+    MatrixXi X(V, N);
+    for (int d=0; d<N; d++) {
+        for (int w=0; w<V; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+        X(0, d) += 1;  // no empty documents
+    }
+
+    return X;
+}
+
+
+TYPED_TEST(TestLikelihoodEvaluator, SparseLikelihood) {
+    VectorXi X(10);
+    X << 3, 0, 0, 2, 1, 0, 7, 0, 1, 0;
+    VectorX<TypeParam> alpha = VectorX<TypeParam>::Constant(5, 0.1);
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(5, 10);
+    MatrixX<TypeParam> phi = MatrixX<TypeParam>::Random(5, 10);
+    VectorX<TypeParam> gamma = VectorX<TypeParam>::Constant(5, X.sum() / 5.0);
+    beta.array() -= beta.minCoeff() - 0.001;
+    beta.array().colwise() /= beta.rowwise().sum().array();
+    phi.array() -= phi.minCoeff() - 0.001;
+    phi.array().rowwise() /= phi.colwise().sum().array();
+
+    // keep only the words of the document
+    std::vector<int> words;
+    for (int i=0; i<X.rows(); i++) {
+        if (X[i] > 0) {
+            words.push_back(i);
+        }
+    }
+    VectorX<TypeParam> counts(words.size());
+    MatrixX<TypeParam> beta_d(5, words.size());
+    MatrixX<TypeParam> phi_d(5, words.size());
+    for (size_t i=0; i<words.size(); i++) {
+        counts[i] = X[words[i]];
+        beta_d.col(i) = beta.col(words[i]);
+        phi_d.col(i) = phi.col(words[i]);
+    }
+
+    TypeParam dense = e_step_utils::compute_unsupervised_likelihood<TypeParam>(
+        X, alpha, beta, phi, gamma
+    );
+    TypeParam sparse = e_step_utils::compute_unsupervised_likelihood_sparse<TypeParam>(
+        counts, alpha, beta_d, phi_d, gamma
+    );
+
+    EXPECT_NEAR(dense, sparse, std::abs(dense) * 1e-5);
+}
+
+
+TYPED_TEST(TestLikelihoodEvaluator, SameAsUnsupervisedEStep) {
+    MatrixXi X = create_corpus(50, 20);
+    VectorX<TypeParam> alpha = VectorX<TypeParam>::Constant(5, 0.1);
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(5, 50);
+    beta.array() -= beta.minCoeff() - 0.001;
+    beta.array().colwise() /= beta.rowwise().sum().array();
+    auto model = std::make_shared<parameters::ModelParameters<TypeParam> >(alpha, beta);
+
+    // a negative tolerance means that both perform exactly 10 iterations
+    em::UnsupervisedEStep<TypeParam> e_step(10, -1, 1.0);
+    TypeParam expected = 0;
+    e_step.get_event_dispatcher()->add_listener(
+        [&expected](std::shared_ptr<events::Event> event) {
+            expected += std::static_pointer_cast<
+                events::ExpectationProgressEvent<TypeParam>
+            >(event)->likelihood();
+        },
+        {events::ExpectationProgressEvent<TypeParam>::static_type()}
+    );
+    corpus::EigenCorpus corpus(X);
+    for (size_t d=0; d<corpus.size(); d++) {
+        e_step.doc_e_step(corpus.at(d), model);
+    }
+
+    LikelihoodEvaluator<TypeParam> evaluator(X, 10, -1);
+    EXPECT_EQ(20, evaluator.documents());
+    EXPECT_EQ(X.sum(), evaluator.total_words());
+    EXPECT_NEAR(expected, evaluator.likelihood(*model), std::abs(expected) * 1e-4);
+}
+
+
+TYPED_TEST(TestLikelihoodEvaluator, EvaluateEveryEpoch) {
+    MatrixXi X = create_corpus(100, 50);
+
+    LDABuilder<TypeParam> builder;
+    builder.
+        set_iterations(3).
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5).
+        set_likelihood_evaluator(X, 0.5);
+    LDA<TypeParam> lda = builder;
+
+    std::vector<std::shared_ptr<events::EvaluationProgressEvent<TypeParam> > > evaluations;
+    lda.get_event_dispatcher()->add_listener(
+        [&evaluations](std::shared_ptr<events::Event> event) {
+            evaluations.push_back(std::static_pointer_cast<
+                events::EvaluationProgressEvent<TypeParam>
+            >(event));
+        },
+        {events::EvaluationProgressEvent<TypeParam>::static_type()}
+    );
+    lda.fit(X);
+
+    // Some epochs may be skipped if the evaluation falls behind but the last
+    // one is always evaluated before fit() returns
+    ASSERT_GE(evaluations.size(), 1);
+    ASSERT_LE(evaluations.size(), 3);
+    EXPECT_EQ(3, evaluations.back()->epoch());
+    for (size_t i=0; i<evaluations.size(); i++) {
+        EXPECT_EQ(25, evaluations[i]->documents());
+        EXPECT_GT(0, evaluations[i]->likelihood());
+        EXPECT_GT(evaluations[i]->perplexity(), 1);
+        if (i > 0) {
+            EXPECT_LT(evaluations[i-1]->epoch(), evaluations[i]->epoch());
+        }
+    }
+}
+
+
+TYPED_TEST(TestLikelihoodEvaluator, DocumentCompletionPerplexity) {
+    MatrixXi X = create_corpus(100, 50);
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(3).
+        set_workers(2).
+        set_classic_e_step(10, 1e-2, 0).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5);
+    lda.fit(X);
+
+    std::vector<std::shared_ptr<events::EvaluationProgressEvent<TypeParam> > > evaluations;
+    lda.get_event_dispatcher()->add_listener(
+        [&evaluations](std::shared_ptr<events::Event> event) {
+            evaluations.push_back(std::static_pointer_cast<
+                events::EvaluationProgressEvent<TypeParam>
+            >(event));
+        },
+        {events::EvaluationProgressEvent<TypeParam>::static_type()}
+    );
+
+    TypeParam perplexity = lda.evaluate(X, 0.5, 1);
+    ASSERT_EQ(1, evaluations.size());
+    EXPECT_EQ(3, evaluations[0]->epoch());
+    EXPECT_EQ(50, evaluations[0]->documents());
+    EXPECT_LT(0, evaluations[0]->words());
+    EXPECT_GT(X.sum(), evaluations[0]->words());
+    EXPECT_NEAR(evaluations[0]->perplexity(), perplexity, perplexity * 1e-5);
+
+    // better than a uniform distribution over the words
+    EXPECT_LT(1, perplexity);
+    EXPECT_GT(100, perplexity);
+
+    // the split depends only on the random state (the order of the sum
+    // depends on the workers)
+    EXPECT_NEAR(perplexity, lda.evaluate(X, 0.5, 1), perplexity * 1e-4);
+    EXPECT_EQ(0, evaluations[1]->unseen_words());
+
+    // the held out words the model gives zero probability to are counted as
+    // unseen instead of making the perplexity infinite
+    auto model = lda.template model_parameters<parameters::ModelParameters<TypeParam> >();
+    model->beta.col(0).setZero();
+    TypeParam unseen_perplexity = lda.evaluate(X, 0.5, 1);
+    ASSERT_EQ(3, evaluations.size());
+    EXPECT_TRUE(std::isfinite(unseen_perplexity));
+    EXPECT_LT(0, evaluations[2]->unseen_words());
+    EXPECT_EQ(
+        evaluations[0]->words(),
+        evaluations[2]->words() + evaluations[2]->unseen_words()
+    );
+
+    EXPECT_THROW(lda.evaluate(X, 1.0), std::runtime_error);
+}
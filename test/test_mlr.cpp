@@ -90,6 +90,39 @@ TYPED_TEST(TestMultinomialLogisticRegression, Gradient) {
   * We compare the results from our Minimizer with the corresponding results from
   * LogisticRegression's implementation of SKlearn with the same initial parameters.
   */
+/**
+  * Weighting a document is the same as repeating it.
+  */
+TYPED_TEST(TestMultinomialLogisticRegression, DocumentWeights) {
+    MatrixX<TypeParam> eta = MatrixX<TypeParam>::Random(10, 3);
+    MatrixX<TypeParam> X = MatrixX<TypeParam>::Random(10, 6);
+    VectorXi y(6);
+    y << 0, 1, 2, 0, 1, 2;
+    VectorX<TypeParam> weights(6);
+    weights << 1, 3, 2, 1, 1, 4;
+
+    int N = static_cast<int>(weights.sum());
+    MatrixX<TypeParam> X_repeated(10, N);
+    VectorXi y_repeated(N);
+    for (int d=0, n=0; d<6; d++) {
+        for (int i=0; i<weights[d]; i++, n++) {
+            X_repeated.col(n) = X.col(d);
+            y_repeated[n] = y[d];
+        }
+    }
+
+    MultinomialLogisticRegression<TypeParam> weighted(X, y, 1, weights);
+    MultinomialLogisticRegression<TypeParam> repeated(X_repeated, y_repeated, 1);
+
+    TypeParam value = repeated.value(eta);
+    EXPECT_NEAR(value, weighted.value(eta), std::abs(value) * 1e-5);
+
+    MatrixX<TypeParam> grad(10, 3), grad_repeated(10, 3);
+    weighted.gradient(eta, grad);
+    repeated.gradient(eta, grad_repeated);
+    EXPECT_TRUE(grad_repeated.isApprox(grad, 1e-4));
+}
+
 TYPED_TEST(TestMultinomialLogisticRegression, Minimizer) {
     
     // X contains the two features from Fisher Iris 
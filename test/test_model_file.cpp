@@ -0,0 +1,254 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "ldaplusplus/events/ProgressEvents.hpp"
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/ModelFile.hpp"
+#include "ldaplusplus/NumpyFormat.hpp"
+#include "ldaplusplus/Parameters.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+template <typename T>
+class TestModelFile : public ParameterizedTest<T> {};
+TYPED_TEST_CASE(TestModelFile, ForFloatAndDouble);
+
+
+static MatrixXi create_corpus(int V, int N) {
+    std::mt19937 rng(0);
+    std::exponential_distribution<> words_generator(0.5);
+    MatrixXi X(V, N);
+    for (int d=0; d<N; d++) {
+        for (int w=0; w<V; w++) {
+            X(w, d) = static_cast<int>(words_generator(rng));
+        }
+        X(0, d) += 1;  // no empty documents
+    }
+
+    return X;
+}
+
+
+TYPED_TEST(TestModelFile, SaveMap) {
+    std::string filename = std::tmpnam(nullptr);
+
+    VectorX<TypeParam> alpha = VectorX<TypeParam>::Random(5);
+    MatrixX<TypeParam> beta = MatrixX<TypeParam>::Random(5, 31);
+    MatrixX<TypeParam> eta = MatrixX<TypeParam>::Random(5, 3);
+    model_file::save(filename, alpha, beta, eta);
+    ASSERT_TRUE(model_file::is_model_file(filename));
+
+    {
+        model_file::MappedModel model(filename);
+        ASSERT_EQ(sizeof(TypeParam), model.scalar_size());
+        ASSERT_EQ(5, model.topics());
+        ASSERT_EQ(31, model.words());
+        EXPECT_EQ(0, model.hash_buckets());
+
+        // the views point to the aligned mapped arrays
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(model.template beta<TypeParam>().data()) % 64);
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(model.template eta<TypeParam>().data()) % 64);
+        EXPECT_EQ(alpha, model.template alpha<TypeParam>());
+        EXPECT_EQ(beta, model.template beta<TypeParam>());
+        EXPECT_EQ(eta, model.template eta<TypeParam>());
+
+        // the views require the precision of the file
+        if (sizeof(TypeParam) == sizeof(float)) {
+            EXPECT_THROW(model.template beta<double>(), std::runtime_error);
+        } else {
+            EXPECT_THROW(model.template beta<float>(), std::runtime_error);
+        }
+
+        // while the parameters are converted to any precision
+        auto parameters = model.template parameters<double>();
+        EXPECT_EQ(alpha.template cast<double>(), parameters->alpha);
+        EXPECT_EQ(beta.template cast<double>(), parameters->beta);
+        EXPECT_EQ(eta.template cast<double>(), parameters->eta);
+    }
+
+    // unsupervised models have no eta
+    model_file::save(filename, alpha, beta, MatrixX<TypeParam>());
+    {
+        model_file::MappedModel model(filename);
+        EXPECT_EQ(0, model.template eta<TypeParam>().size());
+        EXPECT_EQ(beta, model.template parameters<TypeParam>()->beta);
+        EXPECT_FALSE(model.has_log_beta());
+        EXPECT_EQ(0, model.template log_beta<TypeParam>().size());
+    }
+
+    // the logarithm of beta is stored after eta
+    beta = beta.array().abs();
+    beta.col(3).setZero();
+    model_file::save(filename, alpha, beta, eta, model_file::LOG_BETA);
+    {
+        model_file::MappedModel model(filename);
+        ASSERT_TRUE(model.has_log_beta());
+        EXPECT_EQ(0, reinterpret_cast<uintptr_t>(model.template log_beta<TypeParam>().data()) % 64);
+        EXPECT_EQ(eta, model.template eta<TypeParam>());
+        MatrixX<TypeParam> log_beta = beta.array().log();
+        auto mapped_log_beta = model.template log_beta<TypeParam>();
+        EXPECT_TRUE(log_beta.leftCols(3).isApprox(mapped_log_beta.leftCols(3)));
+        EXPECT_TRUE(log_beta.rightCols(27).isApprox(mapped_log_beta.rightCols(27)));
+
+        // zero probabilities are floored instead of being -inf
+        EXPECT_TRUE(mapped_log_beta.col(3).allFinite());
+        EXPECT_GT(-80, mapped_log_beta.col(3).maxCoeff());
+    }
+
+    // hashed models remember their buckets which are their words
+    model_file::save(filename, alpha, beta, eta, 0, 31);
+    EXPECT_EQ(31, model_file::MappedModel(filename).hash_buckets());
+    EXPECT_THROW(
+        model_file::save(filename, alpha, beta, eta, 0, 32),
+        std::runtime_error
+    );
+
+    std::remove(filename.c_str());
+}
+
+
+TYPED_TEST(TestModelFile, Transform) {
+    std::string filename = std::tmpnam(nullptr);
+    MatrixXi X = create_corpus(100, 50);
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(3).
+        set_classic_e_step(10, 1e-2, 0).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5);
+    lda.fit(X);
+    auto model = lda.template model_parameters<parameters::ModelParameters<TypeParam> >();
+    model_file::save(filename, model->alpha, model->beta, MatrixX<TypeParam>());
+
+    model_file::MappedModel mapped(filename);
+    LDA<TypeParam> loaded = LDABuilder<TypeParam>().
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_topics_from_model(mapped.template parameters<TypeParam>());
+    EXPECT_EQ(lda.transform(X), loaded.transform(X));
+
+    // the view reads the mapped pages in place and keeps them mapped for as
+    // long as the LDA needs them
+    auto view = model_file::map_parameters<TypeParam>(filename);
+    EXPECT_EQ(model->beta, view->beta);
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(view->beta.data()) % 64);
+    LDA<TypeParam> mapped_lda = LDABuilder<TypeParam>().
+        set_classic_e_step(10, 1e-2, 0).
+        initialize_from_view(view);
+    view.reset();
+    EXPECT_EQ(lda.transform(X), mapped_lda.transform(X));
+    EXPECT_TRUE(
+        lda.transform_sparse(X, 2).isApprox(mapped_lda.transform_sparse(X, 2))
+    );
+    EXPECT_EQ(lda.evaluate(X, 0.5, 1), mapped_lda.evaluate(X, 0.5, 1));
+
+    // but it cannot be trained
+    EXPECT_THROW(mapped_lda.fit(X), std::runtime_error);
+    EXPECT_THROW(mapped_lda.partial_fit(X, VectorXi::Zero(X.cols())), std::runtime_error);
+    EXPECT_THROW(
+        LDA<TypeParam>(LDABuilder<TypeParam>().
+            set_fast_supervised_e_step().
+            initialize_from_view(model_file::map_parameters<TypeParam>(filename))),
+        std::runtime_error
+    );
+
+    std::remove(filename.c_str());
+}
+
+
+TYPED_TEST(TestModelFile, PrecomputedLogBeta) {
+    std::string filename = std::tmpnam(nullptr);
+    MatrixXi X = create_corpus(100, 50);
+
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(3).
+        set_classic_e_step(10, 1e-2, 0).
+        set_classic_m_step().
+        initialize_topics_seeded(X, 5);
+    lda.fit(X);
+    auto model = lda.template model_parameters<parameters::ModelParameters<TypeParam> >();
+    model_file::save(
+        filename,
+        model->alpha,
+        model->beta,
+        MatrixX<TypeParam>(),
+        model_file::LOG_BETA
+    );
+
+    // the likelihood (and the SQUAREM bound) of the E step read log beta
+    // from the file and compute the same values
+    auto sum_likelihood = [&X](LDA<TypeParam> &lda) {
+        double likelihood = 0;
+        auto listener = lda.get_event_dispatcher()->add_listener(
+            [&likelihood](std::shared_ptr<events::Event> event) {
+                likelihood += std::static_pointer_cast<
+                    events::ExpectationProgressEvent<TypeParam>
+                >(event)->likelihood();
+            },
+            {events::ExpectationProgressEvent<TypeParam>::static_type()}
+        );
+        MatrixX<TypeParam> gammas = lda.transform(X);
+        lda.get_event_dispatcher()->remove_listener(listener);
+
+        return std::make_pair(likelihood, gammas);
+    };
+    LDA<TypeParam> copied = LDABuilder<TypeParam>().
+        set_workers(1).
+        set_classic_e_step(10, 1e-2, 1.0, 0, true).
+        initialize_topics_from_model(model);
+    LDA<TypeParam> mapped = LDABuilder<TypeParam>().
+        set_workers(1).
+        set_classic_e_step(10, 1e-2, 1.0, 0, true).
+        initialize_from_view(model_file::map_parameters<TypeParam>(filename));
+    auto expected = sum_likelihood(copied);
+    auto actual = sum_likelihood(mapped);
+    EXPECT_TRUE(std::isfinite(actual.first));
+    EXPECT_NEAR(expected.first, actual.first, std::abs(expected.first) * 1e-5);
+    EXPECT_TRUE(expected.second.isApprox(actual.second, 1e-4));
+
+    std::remove(filename.c_str());
+}
+
+
+TEST(TestModelFile, InvalidFiles) {
+    std::string filename = std::tmpnam(nullptr);
+
+    // a numpy array is not a model file
+    MatrixXd A = MatrixXd::Random(10, 10);
+    numpy_format::save(filename, A);
+    EXPECT_FALSE(model_file::is_model_file(filename));
+    EXPECT_THROW(model_file::MappedModel model(filename), std::runtime_error);
+
+    // neither is a truncated one
+    model_file::save<double>(
+        filename,
+        VectorXd::Random(5),
+        MatrixXd::Random(5, 100),
+        MatrixXd()
+    );
+    {
+        std::ifstream input(filename, std::ios::in | std::ios::binary);
+        std::string content(300, '\0');
+        input.read(&content[0], content.size());
+        std::ofstream output(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+        output.write(content.data(), content.size());
+    }
+    EXPECT_TRUE(model_file::is_model_file(filename));
+    EXPECT_THROW(model_file::MappedModel model(filename), std::runtime_error);
+
+    EXPECT_THROW(model_file::MappedModel model(filename + ".missing"), std::runtime_error);
+
+    std::remove(filename.c_str());
+}
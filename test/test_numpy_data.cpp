@@ -1,6 +1,7 @@
-
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 #include <Eigen/Core>
 #include <gtest/gtest.h>
@@ -101,3 +102,51 @@ TYPED_TEST(TestNumpyData, SaveLoad) {
 
     ASSERT_TRUE(A==B);
 }
+
+TYPED_TEST(TestNumpyData, StreamWriteRead) {
+    std::string filename = std::tmpnam(nullptr);
+
+    MatrixX<TypeParam> A = MatrixX<TypeParam>::Random(10, 25);
+
+    {
+        numpy_format::NumpyOutputStream<TypeParam> output(filename, 10);
+        output.write(A.leftCols(7));
+        output.write(A.middleCols(7, 10));
+        output.write(A.rightCols(8));
+        EXPECT_EQ(25, output.cols());
+        EXPECT_THROW(output.write(MatrixX<TypeParam>::Zero(5, 2)), std::runtime_error);
+    }
+
+    // the header was patched with the final shape
+    MatrixX<TypeParam> B = numpy_format::load<TypeParam>(filename);
+    ASSERT_TRUE(A==B);
+
+    // and it can be read back in blocks
+    numpy_format::NumpyInputStream<TypeParam> input(filename);
+    EXPECT_EQ(10, input.rows());
+    EXPECT_EQ(25, input.cols());
+    MatrixX<TypeParam> block;
+    for (int i=0; i<25; i+=10) {
+        ASSERT_TRUE(input.read(block, 10));
+        ASSERT_EQ(std::min(10, 25-i), block.cols());
+        ASSERT_TRUE(A.middleCols(i, block.cols()) == block);
+    }
+    EXPECT_FALSE(input.read(block, 10));
+}
+
+TYPED_TEST(TestNumpyData, StreamReadRowMajor) {
+    std::string filename = std::tmpnam(nullptr);
+
+    Matrix<TypeParam, Dynamic, Dynamic, RowMajor> A(8, 13);
+    A.setRandom();
+    numpy_format::save(filename, A);
+
+    numpy_format::NumpyInputStream<TypeParam> input(filename);
+    MatrixX<TypeParam> block;
+    for (int i=0; i<13; i+=5) {
+        ASSERT_TRUE(input.read(block, 5));
+        ASSERT_EQ(8, block.rows());
+        ASSERT_TRUE(A.middleCols(i, block.cols()) == block);
+    }
+    EXPECT_FALSE(input.read(block, 5));
+}
@@ -0,0 +1,122 @@
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ldaplusplus/utils.hpp"
+
+using namespace ldaplusplus;
+
+
+TEST(TestXoshiro256, ReferenceOutput) {
+    // Computed with the reference implementation seeded by splitmix64(42)
+    math_utils::Xoshiro256 prng(42);
+
+    ASSERT_EQ(0x15780b2e0c2ec716u, prng());
+    ASSERT_EQ(0x6104d9866d113a7eu, prng());
+    ASSERT_EQ(0xae17533239e499a1u, prng());
+}
+
+TEST(TestXoshiro256, JumpCreatesDifferentStreams) {
+    math_utils::Xoshiro256 prng1(0);
+    math_utils::Xoshiro256 prng2(0);
+    prng2.jump();
+
+    int same = 0;
+    for (int i=0; i<1000; i++) {
+        same += prng1() == prng2();
+    }
+    ASSERT_EQ(0, same);
+
+    // jumping is deterministic
+    math_utils::Xoshiro256 prng3(0);
+    math_utils::Xoshiro256 prng4(0);
+    prng3.jump();
+    prng4.jump();
+    for (int i=0; i<1000; i++) {
+        ASSERT_EQ(prng3(), prng4());
+    }
+}
+
+TEST(TestXoshiro256, WorksWithDistributions) {
+    math_utils::Xoshiro256 prng(0);
+    std::bernoulli_distribution coin(0.25);
+
+    int heads = 0;
+    for (int i=0; i<10000; i++) {
+        heads += coin(prng);
+    }
+    ASSERT_NEAR(0.25, heads / 10000.0, 0.02);
+
+    std::vector<int> v(100);
+    std::iota(v.begin(), v.end(), 0);
+    std::shuffle(v.begin(), v.end(), prng);
+    std::sort(v.begin(), v.end());
+    for (int i=0; i<100; i++) {
+        ASSERT_EQ(i, v[i]);
+    }
+}
+
+TEST(TestWorkerPRNG, StreamPerWorker) {
+    math_utils::WorkerPRNG prng(42);
+    prng.set_workers(2);
+
+    // the threads that are not workers share the seeded stream
+    math_utils::Xoshiro256 shared(42);
+    std::vector<math_utils::Xoshiro256::result_type> drawn(2000);
+    std::thread t([&]() {
+        for (int i=0; i<1000; i++) {
+            drawn[i] = prng();
+        }
+    });
+    for (int i=1000; i<2000; i++) {
+        drawn[i] = prng();
+    }
+    t.join();
+
+    std::vector<math_utils::Xoshiro256::result_type> expected(2000);
+    for (auto &x : expected) {
+        x = shared();
+    }
+    std::sort(drawn.begin(), drawn.end());
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(expected, drawn);
+
+    // and the ith worker gets it jumped i+1 times
+    math_utils::Xoshiro256 worker(42);
+    worker.jump();
+    worker.jump();
+    std::thread w([&]() {
+        thread_utils::set_worker_index(1);
+        for (int i=0; i<1000; i++) {
+            ASSERT_EQ(worker(), prng());
+        }
+    });
+    w.join();
+}
+
+// ThreadSafePRNG is deprecated but it should keep working
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+TEST(TestThreadSafePRNG, SharesTheStreamBetweenCopies) {
+    math_utils::ThreadSafePRNG<std::mt19937> prng(42);
+    auto copy = prng;
+
+    // the copies draw from the same locked stream seeded with random_state
+    math_utils::Xoshiro256 expected(42);
+    for (int i=0; i<1000; i++) {
+        ASSERT_EQ(expected(), (i % 2) ? prng() : copy());
+    }
+
+    std::uniform_int_distribution<int> dice(1, 6);
+    for (int i=0; i<1000; i++) {
+        int x = dice(prng);
+        ASSERT_LE(1, x);
+        ASSERT_GE(6, x);
+    }
+}
+#pragma GCC diagnostic pop
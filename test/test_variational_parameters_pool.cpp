@@ -0,0 +1,101 @@
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "ldaplusplus/em/VariationalParametersPool.hpp"
+#include "ldaplusplus/Parameters.hpp"
+
+using namespace ldaplusplus;
+
+
+template <typename T>
+class TestVariationalParametersPool : public ParameterizedTest<T> {};
+TYPED_TEST_CASE(TestVariationalParametersPool, ForFloatAndDouble);
+
+
+TYPED_TEST(TestVariationalParametersPool, ReusesReleasedBuffers) {
+    em::VariationalParametersPool<parameters::VariationalParameters<TypeParam> > pool;
+
+    auto vp1 = pool.get(10, 100);
+    ASSERT_EQ(10, vp1->phi.rows());
+    ASSERT_EQ(100, vp1->phi.cols());
+    ASSERT_EQ(10, vp1->gamma.rows());
+
+    // vp1 is still in use so we should get a new buffer
+    auto vp2 = pool.get(10, 100);
+    ASSERT_NE(vp1.get(), vp2.get());
+    ASSERT_EQ(0, pool.size());
+
+    // Release vp1 and get it back
+    TypeParam *phi_data = vp1->phi.data();
+    auto vp1_ptr = vp1.get();
+    std::weak_ptr<parameters::VariationalParameters<TypeParam> > vp1_owner = vp1;
+    vp1.reset();
+    ASSERT_EQ(1, pool.size());
+    auto vp3 = pool.get(10, 100);
+    ASSERT_EQ(vp1_ptr, vp3.get());
+
+    // and the control block of the shared pointer is reused as well
+    ASSERT_FALSE(vp1_owner.expired());
+    ASSERT_FALSE(vp1_owner.owner_before(vp3));
+    ASSERT_FALSE(vp3.owner_before(vp1_owner));
+    ASSERT_EQ(phi_data, vp3->phi.data());
+    ASSERT_EQ(0, pool.size());
+
+    // A released buffer is resized to the requested shape
+    vp2.reset();
+    auto vp4 = pool.get(5, 100);
+    ASSERT_EQ(5, vp4->phi.rows());
+    ASSERT_EQ(100, vp4->phi.cols());
+    ASSERT_EQ(5, vp4->gamma.rows());
+    ASSERT_EQ(0, pool.size());
+}
+
+TYPED_TEST(TestVariationalParametersPool, ReleasedFromOtherThreads) {
+    em::VariationalParametersPool<parameters::VariationalParameters<TypeParam> > pool;
+
+    std::vector<std::shared_ptr<parameters::VariationalParameters<TypeParam> > > vps;
+    for (int i=0; i<4; i++) {
+        vps.push_back(pool.get(10, 100));
+        vps.back()->phi.fill(i);
+    }
+
+    // Drop all the references from another thread
+    std::thread t([&vps]() { vps.clear(); });
+    t.join();
+
+    ASSERT_EQ(4, pool.size());
+
+    for (int i=0; i<4; i++) {
+        vps.push_back(pool.get(10, 100));
+    }
+    ASSERT_EQ(0, pool.size());
+}
+
+TYPED_TEST(TestVariationalParametersPool, BoundedAcrossEpochs) {
+    em::VariationalParametersPool<parameters::VariationalParameters<TypeParam> > pool(4, 3);
+
+    // every epoch holds many more buffers than the pool keeps at once
+    std::vector<std::shared_ptr<parameters::VariationalParameters<TypeParam> > > vps;
+    for (int epoch=0; epoch<5; epoch++) {
+        for (int i=0; i<50; i++) {
+            vps.push_back(pool.get(10, 100));
+        }
+        std::thread t([&vps]() { vps.clear(); });
+        t.join();
+
+        ASSERT_EQ(3, pool.size());
+    }
+
+    // the buffers may outlive the pool
+    {
+        em::VariationalParametersPool<parameters::VariationalParameters<TypeParam> > other;
+        vps.push_back(other.get(10, 100));
+    }
+    vps.clear();
+}
@@ -0,0 +1,154 @@
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include <Eigen/Core>
+#include <gtest/gtest.h>
+
+#include "test/utils.hpp"
+
+#include "ldaplusplus/LDABuilder.hpp"
+#include "ldaplusplus/LDA.hpp"
+#include "ldaplusplus/Parameters.hpp"
+#include "ldaplusplus/Vocabulary.hpp"
+
+using namespace Eigen;
+using namespace ldaplusplus;
+
+
+template <typename T>
+class TestVocabulary : public ParameterizedTest<T> {};
+TYPED_TEST_CASE(TestVocabulary, ForFloatAndDouble);
+
+
+TEST(TestVocabulary, DropsRareWords) {
+    MatrixXi X = MatrixXi::Zero(8, 3);
+    X.row(1) << 1, 0, 0;
+    X.row(2) << 2, 1, 0;
+    X.row(4) << 1, 1, 1;
+    X.row(7) << 0, 0, 5;
+
+    corpus::Vocabulary vocabulary(X, 2);
+    ASSERT_EQ(3, vocabulary.size());
+    ASSERT_EQ(8, vocabulary.original_size());
+    EXPECT_EQ(2, vocabulary.words()[0]);
+    EXPECT_EQ(4, vocabulary.words()[1]);
+    EXPECT_EQ(7, vocabulary.words()[2]);
+    EXPECT_EQ(-1, vocabulary.compact_id(1));
+    EXPECT_EQ(1, vocabulary.compact_id(4));
+
+    MatrixXi X_compact = vocabulary.compact(X);
+    ASSERT_EQ(3, X_compact.rows());
+    ASSERT_EQ(3, X_compact.cols());
+    for (int i=0; i<3; i++) {
+        EXPECT_EQ(X.row(vocabulary.words()[i]), X_compact.row(i));
+    }
+
+    // masking keeps the original ids
+    MatrixXi X_masked = vocabulary.mask(X);
+    ASSERT_EQ(X.rows(), X_masked.rows());
+    EXPECT_EQ(X_compact.sum(), X_masked.sum());
+    EXPECT_EQ(0, X_masked.row(1).sum());
+    EXPECT_EQ(X.row(4), X_masked.row(4));
+
+    // every word is kept with a min count of 0
+    EXPECT_EQ(8, corpus::Vocabulary(X, 0).size());
+    EXPECT_EQ(4, corpus::Vocabulary(X).size());
+
+    EXPECT_THROW(vocabulary.compact(MatrixXi::Zero(7, 3)), std::runtime_error);
+    VectorXi unordered(2);
+    unordered << 3, 1;
+    EXPECT_THROW(corpus::Vocabulary(unordered, 8), std::runtime_error);
+}
+
+
+TYPED_TEST(TestVocabulary, ExpandTopics) {
+    MatrixXi X = MatrixXi::Random(50, 40).unaryExpr([](int v) { return std::abs(v) % 3; });
+    X.row(3).setZero();
+    X.row(17).setZero();
+    X.row(48).setZero();
+    corpus::Vocabulary vocabulary(X);
+    ASSERT_EQ(47, vocabulary.size());
+
+    // train on the compact documents only
+    MatrixXi X_compact = vocabulary.compact(X);
+    LDA<TypeParam> lda = LDABuilder<TypeParam>().
+        set_iterations(2).
+        set_workers(1).
+        set_classic_e_step(10, 1e-2, 0).
+        set_classic_m_step().
+        initialize_topics_seeded(X_compact, 5);
+    lda.fit(X_compact);
+    MatrixX<TypeParam> beta = lda.template model_parameters<
+        parameters::ModelParameters<TypeParam>
+    >()->beta;
+    ASSERT_EQ(47, beta.cols());
+
+    // the dropped words have zero probability in the expanded topics
+    MatrixX<TypeParam> expanded = vocabulary.expand_topics(beta);
+    ASSERT_EQ(50, expanded.cols());
+    EXPECT_EQ(0, expanded.col(17).norm());
+    EXPECT_EQ(beta.col(vocabulary.compact_id(20)), expanded.col(20));
+
+    // and the vocabulary is recovered from them
+    corpus::Vocabulary recovered = corpus::Vocabulary::from_topics<TypeParam>(expanded);
+    ASSERT_EQ(vocabulary.words(), recovered.words());
+    EXPECT_TRUE(beta.isApprox(recovered.compact_topics(expanded)));
+}
+
+
+TEST(TestVocabulary, FeatureHasher) {
+    corpus::FeatureHasher hasher(7);
+    ASSERT_EQ(7, hasher.buckets());
+
+    MatrixXi X = MatrixXi::Random(100, 20).unaryExpr([](int v) { return std::abs(v) % 4; });
+    MatrixXi X_hashed = hasher.transform(X);
+    ASSERT_EQ(7, X_hashed.rows());
+    ASSERT_EQ(20, X_hashed.cols());
+
+    // the tokens of every document are kept and every bucket gets its words
+    EXPECT_EQ(X.colwise().sum(), X_hashed.colwise().sum());
+    MatrixXi expected = MatrixXi::Zero(7, 20);
+    for (int w=0; w<100; w++) {
+        int b = hasher.bucket(w);
+        ASSERT_LE(0, b);
+        ASSERT_GT(7, b);
+        expected.row(b) += X.row(w);
+    }
+    EXPECT_EQ(expected, X_hashed);
+
+    // a longer vocabulary maps the first words the same way
+    MatrixXi X_longer = MatrixXi::Zero(150, 20);
+    X_longer.topRows(100) = X;
+    EXPECT_EQ(X_hashed, hasher.transform(X_longer));
+    EXPECT_EQ(X_hashed, corpus::FeatureHasher(7).transform(X));
+
+    // and a hasher is shared between threads
+    MatrixXi X_thread;
+    std::thread thread([&hasher, &X_longer, &X_thread]() {
+        X_thread = hasher.transform(X_longer);
+    });
+    MatrixXi X_main = hasher.transform(X_longer);
+    thread.join();
+    EXPECT_EQ(X_hashed, X_main);
+    EXPECT_EQ(X_hashed, X_thread);
+
+    EXPECT_THROW(corpus::FeatureHasher(0), std::runtime_error);
+}
+
+
+TEST(TestVocabulary, EigenHashedCorpus) {
+    corpus::FeatureHasher hasher(5);
+    MatrixXi X = MatrixXi::Random(30, 10).unaryExpr([](int v) { return std::abs(v) % 4; });
+    VectorXi y = VectorXi::LinSpaced(10, 0, 9).unaryExpr([](int v) { return v % 2; });
+    MatrixXi X_hashed = hasher.transform(X);
+
+    corpus::EigenHashedCorpus corpus(hasher, X, y);
+    ASSERT_EQ(10, corpus.size());
+    EXPECT_FLOAT_EQ(0.5, corpus.get_prior(1));
+    for (int d=0; d<10; d++) {
+        auto doc = std::static_pointer_cast<corpus::ClassificationDocument>(corpus.at(d));
+        EXPECT_EQ(X_hashed.col(d), doc->get_words());
+        EXPECT_EQ(y[d], doc->get_class());
+    }
+}